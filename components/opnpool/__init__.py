@@ -34,12 +34,15 @@ import re
 import subprocess
 import esphome.codegen as cg
 import esphome.config_validation as cv
+from esphome import automation
 from esphome.components import climate, switch, sensor, binary_sensor, text_sensor
 from esphome.const import (
-    CONF_ID,
-    CONF_DEVICE_CLASS, DEVICE_CLASS_TEMPERATURE, DEVICE_CLASS_POWER, DEVICE_CLASS_VOLUME_FLOW_RATE, DEVICE_CLASS_EMPTY,
-    CONF_UNIT_OF_MEASUREMENT, UNIT_CELSIUS, UNIT_WATT, UNIT_EMPTY, UNIT_REVOLUTIONS_PER_MINUTE, UNIT_PARTS_PER_MILLION, UNIT_PERCENT,
-    CONF_STATE_CLASS, STATE_CLASS_MEASUREMENT
+    CONF_ID, CONF_NAME, CONF_OPTIMISTIC,
+    CONF_DEVICE_CLASS, DEVICE_CLASS_TEMPERATURE, DEVICE_CLASS_POWER, DEVICE_CLASS_VOLUME_FLOW_RATE, DEVICE_CLASS_EMPTY, DEVICE_CLASS_DURATION,
+    CONF_UNIT_OF_MEASUREMENT, UNIT_CELSIUS, UNIT_WATT, UNIT_EMPTY, UNIT_REVOLUTIONS_PER_MINUTE, UNIT_PARTS_PER_MILLION, UNIT_PERCENT, UNIT_SECOND,
+    UNIT_HOUR, UNIT_KILOWATT_HOURS, DEVICE_CLASS_ENERGY, STATE_CLASS_TOTAL_INCREASING,
+    CONF_STATE_CLASS, STATE_CLASS_MEASUREMENT,
+    CONF_ENTITY_CATEGORY, ENTITY_CATEGORY_NONE, ENTITY_CATEGORY_DIAGNOSTIC
 )
 
 DEPENDENCIES = ["climate", "switch", "sensor", "binary_sensor", "text_sensor"]
@@ -54,6 +57,12 @@ OpnPoolSensor       = opnpool_ns.class_("OpnPoolSensor", sensor.Sensor, cg.Compo
 OpnPoolBinarySensor = opnpool_ns.class_("OpnPoolBinarySensor", binary_sensor.BinarySensor, cg.Component)
 OpnPoolTextSensor   = opnpool_ns.class_("OpnPoolTextSensor", text_sensor.TextSensor, cg.Component)
 
+# actions
+DumpUndecodedFramesAction = opnpool_ns.class_("DumpUndecodedFramesAction", automation.Action)
+DumpEventsAction = opnpool_ns.class_("DumpEventsAction", automation.Action)
+DumpHistoryAction = opnpool_ns.class_("DumpHistoryAction", automation.Action)
+ApplySceneAction = opnpool_ns.class_("ApplySceneAction", automation.Action)
+
 CONF_RS485         = "rs485"
 CONF_RS485_RX_PIN  = "rx_pin"
 CONF_RS485_TX_PIN  = "tx_pin"
@@ -65,6 +74,13 @@ CONF_MATTER_ENABLED       = "enabled"
 CONF_MATTER_DISCRIMINATOR = "discriminator"
 CONF_MATTER_PASSCODE      = "passcode"
 
+# Time that thermostat changes are collected into one HEAT_SET command
+CONF_COALESCE_WINDOW = "coalesce_window"
+
+# Pool volume in gallons, needed for the turnover time (0 = unknown)
+CONF_POOL_VOLUME = "pool_volume"
+CONF_HISTORY = "history"
+
 # Flash size configuration
 CONF_FLASH_SIZE = "flash_size"
 FLASH_SIZES = {
@@ -73,6 +89,43 @@ FLASH_SIZES = {
     "16MB": 16777216,
 }
 
+# Sensor publish policy (deadband, minimum interval, heartbeat, smoothing)
+CONF_DEADBAND          = "deadband"
+CONF_DEADBAND_PERCENT  = "deadband_percent"
+CONF_MIN_INTERVAL      = "min_interval"
+CONF_HEARTBEAT         = "heartbeat"
+CONF_SMOOTHING         = "smoothing"
+
+# Staleness configuration; MUST be in the same order as poolstate_subsys_t
+CONF_STALE_AFTER = "stale_after"
+CONF_STALE_AFTER_DEFAULTS = {  # time without updates before a subsystem is marked unavailable
+    "system":       "2min",
+    "circuits":     "2min",
+    "temperatures": "2min",
+    "thermostats":  "5min",
+    "schedules":    "5min",
+    "primary_pump": "2min",
+    "solar_pump":   "2min",
+    "chlorinator":  "5min",
+    **{f"pump_{n}": "2min" for n in range(3, 17)},  # pumps in the `pumps:` list
+}
+
+# Poll configuration; MUST be in the same order as poll_typ_t
+CONF_POLL             = "poll"
+CONF_POLL_SPACING     = "spacing"
+CONF_POLL_BOOST_AFTER = "boost_after"
+CONF_POLL_EVERY       = "every"
+CONF_POLL_EVERY_DEFAULTS = {  # desired freshness of data that the controller doesn't broadcast, 0s to never poll
+    "version":       "24h",
+    "time":          "1h",
+    "heat":          "1min",
+    "schedules":     "2min",   # keep below stale_after.schedules
+    "layout":        "0s",     # not decoded
+    "valves":        "0s",     # only logged as hex, for protocol research
+    "circuit_names": "0s",     # only logged as hex, for protocol research
+    "pump":          "10min",  # per pump; skipped while the controller polls the pump
+}
+
 # MUST be in the same order as network_pool_thermo_t
 CONF_CLIMATES = [  # used to overwrite climate_id_t enum in opnpool.h
     "pool_climate",
@@ -90,23 +143,41 @@ CONF_SWITCHES = [  # used to overwrite switch_id_t enum in opnpool.h
     "feature3",
     "feature4"
 ]
-CONF_ANALOG_SENSORS = { # keys are used to overwrite sensor_id_t enum in opnpool.h
+CONF_ANALOG_SENSORS = { # keys are used to overwrite sensor_id_t enum in opnpool.h; deadband and min_interval default to 0
     "air_temperature":    {"unit": UNIT_CELSIUS, CONF_DEVICE_CLASS: DEVICE_CLASS_TEMPERATURE, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT},
     "water_temperature":  {"unit": UNIT_CELSIUS, CONF_DEVICE_CLASS: DEVICE_CLASS_TEMPERATURE, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT},
-    "primary_pump_power": {"unit": UNIT_WATT, CONF_DEVICE_CLASS: DEVICE_CLASS_POWER, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT},
-    "primary_pump_flow":  {"unit": "gal/min", CONF_DEVICE_CLASS: DEVICE_CLASS_VOLUME_FLOW_RATE, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT},
-    "primary_pump_speed": {"unit": UNIT_REVOLUTIONS_PER_MINUTE, CONF_DEVICE_CLASS: DEVICE_CLASS_EMPTY, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT},
+    "primary_pump_power": {"unit": UNIT_WATT, CONF_DEVICE_CLASS: DEVICE_CLASS_POWER, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT, CONF_DEADBAND: 10.0, CONF_MIN_INTERVAL: "10s"},
+    "primary_pump_flow":  {"unit": "gal/min", CONF_DEVICE_CLASS: DEVICE_CLASS_VOLUME_FLOW_RATE, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT, CONF_DEADBAND: 1.0, CONF_MIN_INTERVAL: "10s"},
+    "primary_pump_speed": {"unit": UNIT_REVOLUTIONS_PER_MINUTE, CONF_DEVICE_CLASS: DEVICE_CLASS_EMPTY, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT, CONF_DEADBAND: 10.0, CONF_MIN_INTERVAL: "10s"},
     "chlorinator_level":  {"unit": UNIT_PERCENT, CONF_DEVICE_CLASS: DEVICE_CLASS_EMPTY, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT},
     "chlorinator_salt":   {"unit": UNIT_PARTS_PER_MILLION, CONF_DEVICE_CLASS: DEVICE_CLASS_EMPTY, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT},
     "primary_pump_error": {"unit": UNIT_EMPTY, CONF_DEVICE_CLASS: DEVICE_CLASS_EMPTY, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT},
+    "time_to_full_state": {"unit": UNIT_SECOND, CONF_DEVICE_CLASS: DEVICE_CLASS_DURATION, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT, CONF_ENTITY_CATEGORY: ENTITY_CATEGORY_DIAGNOSTIC},
+    # derived on the device over the last 24 hours, see core/poolstate_metrics.h
+    "primary_pump_energy":     {"unit": UNIT_KILOWATT_HOURS, CONF_DEVICE_CLASS: DEVICE_CLASS_EMPTY, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT, CONF_DEADBAND: 0.01, CONF_MIN_INTERVAL: "60s"},
+    "primary_pump_volume":     {"unit": "gal", CONF_DEVICE_CLASS: DEVICE_CLASS_EMPTY, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT, CONF_DEADBAND: 10.0, CONF_MIN_INTERVAL: "60s"},
+    "primary_pump_efficiency": {"unit": "W/(gal/min)", CONF_DEVICE_CLASS: DEVICE_CLASS_EMPTY, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT, CONF_DEADBAND: 0.1, CONF_MIN_INTERVAL: "60s"},
+    "turnover_time":           {"unit": UNIT_HOUR, CONF_DEVICE_CLASS: DEVICE_CLASS_DURATION, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT, CONF_DEADBAND: 0.1, CONF_MIN_INTERVAL: "60s"},
+    "heater_duty_cycle":       {"unit": UNIT_PERCENT, CONF_DEVICE_CLASS: DEVICE_CLASS_EMPTY, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT, CONF_DEADBAND: 1.0, CONF_MIN_INTERVAL: "60s"},
+    "pool_runtime":            {"unit": UNIT_HOUR, CONF_DEVICE_CLASS: DEVICE_CLASS_DURATION, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT, CONF_DEADBAND: 0.05, CONF_MIN_INTERVAL: "60s"},
+    "spa_runtime":             {"unit": UNIT_HOUR, CONF_DEVICE_CLASS: DEVICE_CLASS_DURATION, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT, CONF_DEADBAND: 0.05, CONF_MIN_INTERVAL: "60s"},
+    "water_temperature_min":   {"unit": UNIT_CELSIUS, CONF_DEVICE_CLASS: DEVICE_CLASS_TEMPERATURE, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT, CONF_MIN_INTERVAL: "60s"},
+    "water_temperature_max":   {"unit": UNIT_CELSIUS, CONF_DEVICE_CLASS: DEVICE_CLASS_TEMPERATURE, CONF_STATE_CLASS: STATE_CLASS_MEASUREMENT, CONF_MIN_INTERVAL: "60s"},
+    # lifetime counters, persisted in flash, see core/poolstate_counters.h
+    "primary_pump_energy_total": {"unit": UNIT_KILOWATT_HOURS, CONF_DEVICE_CLASS: DEVICE_CLASS_ENERGY, CONF_STATE_CLASS: STATE_CLASS_TOTAL_INCREASING, CONF_DEADBAND: 0.01, CONF_MIN_INTERVAL: "60s"},
+    "primary_pump_hours":        {"unit": UNIT_HOUR, CONF_DEVICE_CLASS: DEVICE_CLASS_DURATION, CONF_STATE_CLASS: STATE_CLASS_TOTAL_INCREASING, CONF_DEADBAND: 0.01, CONF_MIN_INTERVAL: "60s"},
+    "heater_hours":              {"unit": UNIT_HOUR, CONF_DEVICE_CLASS: DEVICE_CLASS_DURATION, CONF_STATE_CLASS: STATE_CLASS_TOTAL_INCREASING, CONF_DEADBAND: 0.01, CONF_MIN_INTERVAL: "60s"},
+    "chlorinator_cell_hours":    {"unit": UNIT_HOUR, CONF_DEVICE_CLASS: DEVICE_CLASS_DURATION, CONF_STATE_CLASS: STATE_CLASS_TOTAL_INCREASING, CONF_DEADBAND: 0.01, CONF_MIN_INTERVAL: "60s"},
 }
 CONF_BINARY_SENSORS = [  # used to overwrite binary_sensor_id_t enum in opnpool.h
     "primary_pump_running",
     "mode_service",
     "mode_temperature_inc", 
     "mode_freeze_protection",
-    "mode_timeout"
+    "mode_timeout",
+    "restored_state",  # on while values restored from the snapshot aren't confirmed by the bus
 ]
+CONF_DIAGNOSTIC_BINARY_SENSORS = ["restored_state"]
 CONF_TEXT_SENSORS = [  # used to overwrite text_sensor_id_t enum in opnpool.h
     "pool_sched",
     "spa_sched",
@@ -119,6 +190,90 @@ CONF_TEXT_SENSORS = [  # used to overwrite text_sensor_id_t enum in opnpool.h
     "interface_firmware"
 ]
 
+# Pumps other than the primary, by the controller's pump number (2 is the solar pump at
+# 0x61, 3 to 16 are at 0x62 to 0x6F). Each gets its own entities, and can be polled.
+CONF_PUMPS     = "pumps"
+CONF_PUMP      = "pump"
+CONF_PUMP_POLL = "poll"
+CONF_PUMP_SENSORS = {  # MUST be in the same order as pump_sensor_id_t
+    "power": CONF_ANALOG_SENSORS["primary_pump_power"],
+    "flow":  CONF_ANALOG_SENSORS["primary_pump_flow"],
+    "speed": CONF_ANALOG_SENSORS["primary_pump_speed"],
+    "error": CONF_ANALOG_SENSORS["primary_pump_error"],
+}
+CONF_PUMP_BINARY_SENSORS = [  # MUST be in the same order as pump_binary_sensor_id_t
+    "running",
+]
+CONF_PUMP_TEXT_SENSORS = [  # MUST be in the same order as pump_text_sensor_id_t
+    "mode",
+    "state",
+]
+
+def optional_entity(schema):
+    """Validate an entity configuration, or accept `false` to leave the entity out.
+
+    Entities that are left out are not generated, so the pool state is not dispatched
+    to them at run time.
+    """
+    def validator(value):
+        if value is False:
+            return value
+        return schema(value)
+    return validator
+
+def analog_sensor_schema(defaults):
+    """Return the schema of an analog sensor, with its unit, class and publish policy defaults."""
+    return optional_entity(sensor.sensor_schema(OpnPoolSensor).extend({
+        cv.GenerateID(): cv.declare_id(OpnPoolSensor),
+        cv.Optional(CONF_UNIT_OF_MEASUREMENT, default=defaults["unit"]): cv.string,
+        cv.Optional(CONF_DEVICE_CLASS, default=defaults[CONF_DEVICE_CLASS]): cv.string,
+        cv.Optional(CONF_ENTITY_CATEGORY, default=defaults.get(CONF_ENTITY_CATEGORY, ENTITY_CATEGORY_NONE)): cv.entity_category,
+        # publish policy: applied before the value reaches ESPHome's filters and the API
+        cv.Optional(CONF_DEADBAND, default=defaults.get(CONF_DEADBAND, 0.0)): cv.positive_float,
+        cv.Optional(CONF_DEADBAND_PERCENT, default="0%"): cv.percentage,
+        cv.Optional(CONF_MIN_INTERVAL, default=defaults.get(CONF_MIN_INTERVAL, "0s")): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_HEARTBEAT, default="0s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_SMOOTHING, default=1.0): cv.float_range(min=0.0, max=1.0, min_included=False),
+    }))
+
+BINARY_SENSOR_SCHEMA = optional_entity(binary_sensor.binary_sensor_schema(OpnPoolBinarySensor).extend({
+    cv.GenerateID(): cv.declare_id(OpnPoolBinarySensor)
+}))
+
+TEXT_SENSOR_SCHEMA = optional_entity(text_sensor.text_sensor_schema(OpnPoolTextSensor).extend({
+    cv.GenerateID(): cv.declare_id(OpnPoolTextSensor)
+}))
+
+def pump_entity_names(value):
+    """Name the entities of a pump after the pump, e.g. "Pump 3 Power", unless configured."""
+    value = cv.Schema({
+        cv.Required(CONF_PUMP): cv.int_range(min=2, max=16),
+        cv.Optional(CONF_NAME): cv.string,
+    }, extra=cv.ALLOW_EXTRA)(value)
+    prefix = value.get(CONF_NAME, f"Pump {value[CONF_PUMP]}")
+    for key in [*CONF_PUMP_SENSORS, *CONF_PUMP_BINARY_SENSORS, *CONF_PUMP_TEXT_SENSORS]:
+        value.setdefault(key, {"name": f"{prefix} {key.title()}"})
+    return value
+
+PUMP_SCHEMA = cv.All(pump_entity_names, cv.Schema({
+    cv.Required(CONF_PUMP): cv.int_range(min=2, max=16),
+    cv.Optional(CONF_NAME): cv.string,
+    # ask the pump for its status (PUMP_STATUS_REQ) at poll.every.pump; off for pumps
+    # that the controller already polls
+    cv.Optional(CONF_PUMP_POLL, default=False): cv.boolean,
+    **{cv.Optional(key): analog_sensor_schema(defaults) for key, defaults in CONF_PUMP_SENSORS.items()},
+    **{cv.Optional(key): BINARY_SENSOR_SCHEMA for key in CONF_PUMP_BINARY_SENSORS},
+    **{cv.Optional(key): TEXT_SENSOR_SCHEMA for key in CONF_PUMP_TEXT_SENSORS},
+}))
+
+def unique_pumps(value):
+    """Check that each pump is listed once."""
+    pumps = [pump_cfg[CONF_PUMP] for pump_cfg in value]
+    for pump in pumps:
+        if pumps.count(pump) > 1:
+            raise cv.Invalid(f"pump {pump} is listed more than once")
+    return value
+
 CONFIG_SCHEMA = cv.Schema({
     cv.GenerateID(): cv.declare_id(OpnPool),
     # RS485 settings (required, but with defaults)
@@ -134,38 +289,90 @@ CONFIG_SCHEMA = cv.Schema({
         cv.Optional(CONF_MATTER_DISCRIMINATOR, default=3840): cv.int_range(min=0, max=4095),
         cv.Optional(CONF_MATTER_PASSCODE, default=20202021): cv.int_range(min=1, max=99999998),
     }),
+    # Staleness TTLs per pool state subsystem (0s disables)
+    cv.Optional(CONF_STALE_AFTER, default={}): cv.Schema({
+        cv.Optional(key, default=ttl): cv.positive_time_period_milliseconds
+        for key, ttl in CONF_STALE_AFTER_DEFAULTS.items()
+    }),
+    # Controller polling: freshness per kind of data (0s disables), spacing and boost after a command
+    cv.Optional(CONF_POLL, default={}): cv.Schema({
+        cv.Optional(CONF_POLL_SPACING, default="2s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_POLL_BOOST_AFTER, default="3s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_POLL_EVERY, default={}): cv.Schema({
+            cv.Optional(key, default=every): cv.positive_time_period_milliseconds
+            for key, every in CONF_POLL_EVERY_DEFAULTS.items()
+        }),
+    }),
+    # Thermostat changes within this window are sent as one command (0s sends each change)
+    cv.Optional(CONF_COALESCE_WINDOW, default="500ms"): cv.positive_time_period_milliseconds,
+    # Pool volume in gallons, for the turnover time (0 leaves the turnover time unknown)
+    cv.Optional(CONF_POOL_VOLUME, default=0): cv.int_range(min=0, max=1000000),
+    # Keep the last 24 hours of key values in RAM, for opnpool.dump_history (false saves ~16 KB)
+    cv.Optional(CONF_HISTORY, default=True): cv.boolean,
     # Flash size (ESP32-C6-DevKitC-1-N8 has 8MB, some variants have 4MB)
     cv.Optional(CONF_FLASH_SIZE, default="8MB"): cv.one_of(*FLASH_SIZES.keys(), upper=True),
     **{
         cv.Optional(key, default={"name": key.replace("_", " ").title()}): climate.climate_schema(OpnPoolClimate).extend({
-            cv.GenerateID(): cv.declare_id(OpnPoolClimate)
+            cv.GenerateID(): cv.declare_id(OpnPoolClimate),
+            cv.Optional(CONF_OPTIMISTIC, default=False): cv.boolean,
         }) for key in CONF_CLIMATES
     },
     **{
         cv.Optional(key, default={"name": key.replace("_", " ").title()}): switch.switch_schema(OpnPoolSwitch).extend({
-            cv.GenerateID(): cv.declare_id(OpnPoolSwitch)
+            cv.GenerateID(): cv.declare_id(OpnPoolSwitch),
+            cv.Optional(CONF_OPTIMISTIC, default=False): cv.boolean,
         }) for key in CONF_SWITCHES
     },
     **{
-        cv.Optional(key, default={"name": key.replace("_", " ").title()}): sensor.sensor_schema(OpnPoolSensor).extend({
-            cv.GenerateID(): cv.declare_id(OpnPoolSensor),
-            cv.Optional(CONF_UNIT_OF_MEASUREMENT, default=CONF_ANALOG_SENSORS[key]["unit"]): cv.string,
-            cv.Optional(CONF_DEVICE_CLASS, default=CONF_ANALOG_SENSORS[key][CONF_DEVICE_CLASS]): cv.string,
-        }) for key in CONF_ANALOG_SENSORS
+        cv.Optional(key, default={"name": key.replace("_", " ").title()}): analog_sensor_schema(CONF_ANALOG_SENSORS[key])
+        for key in CONF_ANALOG_SENSORS
     },
     **{
-        cv.Optional(key, default={"name": key.replace("_", " ").title()}): binary_sensor.binary_sensor_schema(OpnPoolBinarySensor).extend({
-            cv.GenerateID(): cv.declare_id(OpnPoolBinarySensor)
-        }) for key in CONF_BINARY_SENSORS
+        cv.Optional(key, default={
+            "name": key.replace("_", " ").title(),
+            **({CONF_ENTITY_CATEGORY: ENTITY_CATEGORY_DIAGNOSTIC} if key in CONF_DIAGNOSTIC_BINARY_SENSORS else {}),
+        }): BINARY_SENSOR_SCHEMA
+        for key in CONF_BINARY_SENSORS
     },
     **{
-        cv.Optional(key, default={"name": key.replace("_", " ").title()}): text_sensor.text_sensor_schema(OpnPoolTextSensor).extend({
-            cv.GenerateID(): cv.declare_id(OpnPoolTextSensor)
-        }) for key in CONF_TEXT_SENSORS
+        cv.Optional(key, default={"name": key.replace("_", " ").title()}): TEXT_SENSOR_SCHEMA
+        for key in CONF_TEXT_SENSORS
     },
+    # pumps other than the primary, each with its own entities
+    cv.Optional(CONF_PUMPS, default=[]): cv.All(cv.ensure_list(PUMP_SCHEMA), unique_pumps),
 }).extend(cv.COMPONENT_SCHEMA)
 
 
+async def new_analog_sensor(entity_cfg):
+    """Instantiate and register an analog sensor, with its publish policy."""
+    if CONF_ID not in entity_cfg:
+        entity_cfg[CONF_ID] = cg.new_id()
+    sensor_entity = cg.new_Pvariable(entity_cfg[CONF_ID])
+    await sensor.register_sensor(sensor_entity, entity_cfg)
+    cg.add(sensor_entity.set_deadband(entity_cfg[CONF_DEADBAND]))
+    cg.add(sensor_entity.set_deadband_relative(entity_cfg[CONF_DEADBAND_PERCENT]))
+    cg.add(sensor_entity.set_min_interval(entity_cfg[CONF_MIN_INTERVAL].total_milliseconds))
+    cg.add(sensor_entity.set_heartbeat(entity_cfg[CONF_HEARTBEAT].total_milliseconds))
+    cg.add(sensor_entity.set_smoothing(entity_cfg[CONF_SMOOTHING]))
+    return sensor_entity
+
+async def new_binary_sensor(entity_cfg):
+    """Instantiate and register a binary sensor."""
+    if CONF_ID not in entity_cfg:
+        entity_cfg[CONF_ID] = cg.new_id()
+    bs_entity = cg.new_Pvariable(entity_cfg[CONF_ID])
+    await binary_sensor.register_binary_sensor(bs_entity, entity_cfg)
+    return bs_entity
+
+async def new_text_sensor(entity_cfg):
+    """Instantiate and register a text sensor."""
+    if CONF_ID not in entity_cfg:
+        entity_cfg[CONF_ID] = cg.new_id()
+    ts_entity = cg.new_Pvariable(entity_cfg[CONF_ID])
+    await text_sensor.register_text_sensor(ts_entity, entity_cfg)
+    return ts_entity
+
+
 async def to_code(config):
     """Generate C++ code for the OPNpool ESPHome component.
 
@@ -253,6 +460,27 @@ async def to_code(config):
     rs485_config = config[CONF_RS485]
     cg.add(var.set_rs485_pins(rs485_config[CONF_RS485_RX_PIN], rs485_config[CONF_RS485_TX_PIN], rs485_config[CONF_RS485_RTS_PIN]))
 
+    # staleness configuration
+    stale_after_config = config[CONF_STALE_AFTER]
+    for idx, stale_key in enumerate(CONF_STALE_AFTER_DEFAULTS):
+        cg.add(var.set_stale_after(idx, stale_after_config[stale_key].total_milliseconds))
+
+    # poll configuration
+    poll_config = config[CONF_POLL]
+    cg.add(var.set_poll_spacing(poll_config[CONF_POLL_SPACING].total_milliseconds))
+    cg.add(var.set_poll_boost_after(poll_config[CONF_POLL_BOOST_AFTER].total_milliseconds))
+    for idx, poll_key in enumerate(CONF_POLL_EVERY_DEFAULTS):
+        cg.add(var.set_poll_every(idx, poll_config[CONF_POLL_EVERY][poll_key].total_milliseconds))
+
+    # thermostat command coalescing
+    cg.add(var.set_coalesce_window(config[CONF_COALESCE_WINDOW].total_milliseconds))
+
+    # pool volume, for the turnover time
+    cg.add(var.set_pool_volume(config[CONF_POOL_VOLUME]))
+
+    # history of key values
+    cg.add(var.set_history(config[CONF_HISTORY]))
+
     # matter over Thread configuration
     matter_config = config[CONF_MATTER]
     if matter_config[CONF_MATTER_ENABLED]:
@@ -281,6 +509,7 @@ async def to_code(config):
             entity_cfg[CONF_ID] = cg.new_id()
         climate_entity = cg.new_Pvariable(entity_cfg[CONF_ID], var, id)
         await climate.register_climate(climate_entity, entity_cfg)
+        cg.add(climate_entity.set_optimistic(entity_cfg[CONF_OPTIMISTIC]))
         cg.add(getattr(var, f"set_{climate_key}")(climate_entity))
 
     # register switches (constructor injection)
@@ -290,35 +519,130 @@ async def to_code(config):
             entity_cfg[CONF_ID] = cg.new_id()
         switch_entity = cg.new_Pvariable(entity_cfg[CONF_ID], var, id)
         await switch.register_switch(switch_entity, entity_cfg)
+        cg.add(switch_entity.set_optimistic(entity_cfg[CONF_OPTIMISTIC]))
         cg.add(getattr(var, f"set_{switch_key}_switch")(switch_entity))
 
-    # register analog sensors (constructor injection)
+    # register analog sensors (constructor injection); each setter adds the sensor to the
+    # table that OpnPool::update_all() dispatches the pool state to
     for id, sensor_key in enumerate(CONF_ANALOG_SENSORS):
         entity_cfg = config[sensor_key]
-        if CONF_ID not in entity_cfg:
-            entity_cfg[CONF_ID] = cg.new_id()
-        sensor_entity = cg.new_Pvariable(entity_cfg[CONF_ID])
-        await sensor.register_sensor(sensor_entity, entity_cfg)
+        if entity_cfg is False:
+            continue  # left out by the user
+        sensor_entity = await new_analog_sensor(entity_cfg)
         cg.add(getattr(var, f"set_{sensor_key}_sensor")(sensor_entity))
 
     # register binary sensors (constructor injection)
     for id, binary_sensor_key in enumerate(CONF_BINARY_SENSORS):
         entity_cfg = config[binary_sensor_key]
-        if CONF_ID not in entity_cfg:
-            entity_cfg[CONF_ID] = cg.new_id()
-        bs_entity = cg.new_Pvariable(entity_cfg[CONF_ID])
-        await binary_sensor.register_binary_sensor(bs_entity, entity_cfg)
+        if entity_cfg is False:
+            continue  # left out by the user
+        bs_entity = await new_binary_sensor(entity_cfg)
         cg.add(getattr(var, f"set_{binary_sensor_key}_binary_sensor")(bs_entity))
 
     # register text sensors (constructor injection)
     for id, text_sensor_key in enumerate(CONF_TEXT_SENSORS):
         entity_cfg = config[text_sensor_key]
-        if CONF_ID not in entity_cfg:
-            entity_cfg[CONF_ID] = cg.new_id()
-        ts_entity = cg.new_Pvariable(entity_cfg[CONF_ID])
-        await text_sensor.register_text_sensor(ts_entity, entity_cfg)
+        if entity_cfg is False:
+            continue  # left out by the user
+        ts_entity = await new_text_sensor(entity_cfg)
         cg.add(getattr(var, f"set_{text_sensor_key}_text_sensor")(ts_entity))
 
+    # register the entities of the other pumps; the C++ side indexes pumps by
+    # datalink_pump_id_t, which counts from 0 for pump 1 (the primary pump)
+    for pump_cfg in config[CONF_PUMPS]:
+        pump_idx = pump_cfg[CONF_PUMP] - 1
+        if pump_cfg[CONF_PUMP_POLL]:
+            cg.add(var.set_pump_poll(pump_idx))
+        for id, sensor_key in enumerate(CONF_PUMP_SENSORS):
+            if pump_cfg[sensor_key] is not False:
+                sensor_entity = await new_analog_sensor(pump_cfg[sensor_key])
+                cg.add(var.set_pump_sensor(pump_idx, id, sensor_entity))
+        for id, binary_sensor_key in enumerate(CONF_PUMP_BINARY_SENSORS):
+            if pump_cfg[binary_sensor_key] is not False:
+                bs_entity = await new_binary_sensor(pump_cfg[binary_sensor_key])
+                cg.add(var.set_pump_binary_sensor(pump_idx, id, bs_entity))
+        for id, text_sensor_key in enumerate(CONF_PUMP_TEXT_SENSORS):
+            if pump_cfg[text_sensor_key] is not False:
+                ts_entity = await new_text_sensor(pump_cfg[text_sensor_key])
+                cg.add(var.set_pump_text_sensor(pump_idx, id, ts_entity))
+
+
+CONF_CLEAR = "clear"
+
+@automation.register_action(
+    "opnpool.dump_undecoded_frames",
+    DumpUndecodedFramesAction,
+    cv.Schema({
+        cv.GenerateID(): cv.use_id(OpnPool),
+        cv.Optional(CONF_CLEAR, default=False): cv.boolean,
+    }),
+)
+async def dump_undecoded_frames_to_code(config, action_id, template_arg, args):
+    """Generate the action that logs the frames the network layer couldn't decode."""
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    cg.add(var.set_clear(config[CONF_CLEAR]))
+    return var
+
+CONF_LAST = "last"
+
+@automation.register_action(
+    "opnpool.dump_events",
+    DumpEventsAction,
+    cv.Schema({
+        cv.GenerateID(): cv.use_id(OpnPool),
+        cv.Optional(CONF_LAST, default="0min"): cv.positive_time_period_minutes,
+    }),
+)
+async def dump_events_to_code(config, action_id, template_arg, args):
+    """Generate the action that logs the state transitions of the last so many minutes."""
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    cg.add(var.set_last(config[CONF_LAST].total_minutes))
+    return var
+
+CONF_BUCKET = "bucket"
+
+@automation.register_action(
+    "opnpool.dump_history",
+    DumpHistoryAction,
+    cv.Schema({
+        cv.GenerateID(): cv.use_id(OpnPool),
+        cv.Optional(CONF_LAST, default="0min"): cv.positive_time_period_minutes,
+        cv.Optional(CONF_BUCKET, default="60min"): cv.All(
+            cv.positive_time_period_minutes,
+            cv.Range(min=cv.TimePeriod(minutes=1)),
+        ),
+    }),
+)
+async def dump_history_to_code(config, action_id, template_arg, args):
+    """Generate the action that logs the history of the last so many minutes per bucket."""
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    cg.add(var.set_last(config[CONF_LAST].total_minutes))
+    cg.add(var.set_bucket(config[CONF_BUCKET].total_minutes))
+    return var
+
+@automation.register_action(
+    "opnpool.apply_scene",
+    ApplySceneAction,
+    cv.All(
+        cv.Schema({
+            cv.GenerateID(): cv.use_id(OpnPool),
+            **{cv.Optional(key): cv.boolean for key in CONF_SWITCHES},
+        }),
+        cv.has_at_least_one_key(*CONF_SWITCHES),
+    ),
+)
+async def apply_scene_to_code(config, action_id, template_arg, args):
+    """Generate the action that sets several circuits in one transmit window."""
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    for id, switch_key in enumerate(CONF_SWITCHES):
+        if switch_key in config:
+            cg.add(var.add_target(id, config[switch_key]))
+    return var
+
 # replace the enums in opnpool_ids.h to keep them consistent with CONF_* in this file
 
 ENTITY_ENUMS = {
@@ -327,6 +651,9 @@ ENTITY_ENUMS = {
     "sensor_id_t":        CONF_ANALOG_SENSORS,
     "binary_sensor_id_t": CONF_BINARY_SENSORS,
     "text_sensor_id_t":   CONF_TEXT_SENSORS,
+    "pump_sensor_id_t":        CONF_PUMP_SENSORS,
+    "pump_binary_sensor_id_t": CONF_PUMP_BINARY_SENSORS,
+    "pump_text_sensor_id_t":   CONF_PUMP_TEXT_SENSORS,
 }
 
 def generate_enum(enum_name, items):
@@ -43,6 +43,12 @@
 #include "opnpool.h"
 #include "utils/to_str.h"
 #include "poolstate.h"
+#include "poolstate_ttl.h"
+#include "poolstate_snapshot.h"
+#include "poolstate_history.h"
+#include "poolstate_metrics.h"
+#include "poolstate_counters.h"
+#include "poolstate_events.h"
 #include "entities/opnpool_climate.h"
 #include "entities/opnpool_switch.h"
 #include "entities/opnpool_sensor.h"
@@ -51,6 +57,8 @@
 #include "opnpool_ids.h"
 #include "pool_task/network.h"
 #include "pool_task/network_msg.h"
+#include "pool_task/network_capture.h"
+#include "pool_task/cmd_tracker.h"
 #pragma GCC diagnostic error "-Wall"
 #pragma GCC diagnostic error "-Wextra"
 #pragma GCC diagnostic error "-Wunused-parameter"
@@ -61,8 +69,11 @@ namespace opnpool {
 constexpr char TAG[] = "opnpool";
 
 constexpr uint32_t    POOL_TASK_STACK_SIZE = 2 * 4096;
-constexpr UBaseType_t TO_POOL_QUEUE_LEN = 6;
-constexpr UBaseType_t TO_MAIN_QUEUE_LEN = 10;
+constexpr UBaseType_t TO_POOL_QUEUE_LEN = 12;      // room for a scene that sets every circuit
+constexpr UBaseType_t TO_MAIN_QUEUE_LEN = 16;      // .. and for the echo of it
+static_assert(TO_POOL_QUEUE_LEN >= CMD_TRACKER_SIZE, "the queue to the pool_task can't hold all commands the tracker can track");
+static_assert(TO_MAIN_QUEUE_LEN >= CMD_TRACKER_SIZE, "the queue to the main task can't hold the echo of all tracked commands");
+constexpr uint32_t    SCENE_TIMEOUT_MS  = 15 * 1000;  // time for the controller to confirm a scene [ms]
 
 /**
  * @brief            Calls dump_config() on an entity if it exists.
@@ -80,139 +91,17 @@ _dump_if(EntityT * const entity)
 }
 
 /**
- * @brief            Publishes a value to an entity if it exists and the value is valid.
+ * @brief            Publishes an entity as unavailable if it exists.
  *
- * @tparam EntityT   The entity type.
- * @tparam ValueT    The value wrapper type (must have .valid and .value members).
+ * @tparam EntityT   The entity type (climate, sensor, binary sensor or text sensor).
  * @param[in] entity Pointer to the entity, or nullptr.
- * @param[in] base   The value wrapper containing validity flag and value.
- */
-template<typename EntityT, typename ValueT>
-static void
-_publish_if(EntityT * const entity, ValueT const base)
-{
-    if (entity != nullptr && base.valid) {
-        entity->publish_value_if_changed(base.value);
-    }
-}
-
-/**
- * @brief            Publishes an enum value as a string to an entity if it exists and is valid.
- *
- * @tparam EntityT   The entity type.
- * @tparam ValueT    The value wrapper type (must have .valid and .value members).
- * @param[in] entity Pointer to the entity, or nullptr.
- * @param[in] base   The value wrapper containing validity flag and enum value.
- */
-template<typename EntityT, typename ValueT>
-static void
-_publish_enum_if(EntityT * const entity, ValueT const base)
-{
-    if (entity != nullptr && base.valid) {
-        entity->publish_value_if_changed(enum_str(base.value));
-    }
-}
-
-/**
- * @brief            Publishes a string value as a string to an entity if it exists and is valid.
- *
- * @tparam EntityT   The entity type.
- * @tparam ValueT    The value wrapper type (must have .valid and .value members).
- * @param[in] entity Pointer to the entity, or nullptr.
- * @param[in] base   The value wrapper containing validity flag and string value.
- */
-template<typename EntityT, typename ValueT>
-static void
-_publish_str_if(EntityT * const entity, ValueT const base)
-{
-    if (entity != nullptr && base.valid) {
-        entity->publish_value_if_changed(base.value.to_str());
-    }
-}
-
-/**
- * @brief            Publishes a schedule as a formatted time range string.
- *
- * @param[in] sensor Pointer to the text sensor entity, or nullptr.
- * @param[in] sched  Pointer to the schedule data structure.
- */
-static void
-_publish_schedule_if(OpnPoolTextSensor * const sensor, poolstate_sched_t const * const sched)
-{
-    if (sensor == nullptr || !sched->valid) {
-        return;
-    }
-    char buf[16];  // HH:MM-HH:MM\0
-
-    snprintf(buf, sizeof(buf), "%02d:%02d-%02d:%02d",
-             sched->start / 60, sched->start % 60,
-             sched->stop / 60, sched->stop % 60);
-
-    sensor->publish_value_if_changed(buf);
-}
-
-/**
- * @brief            Publishes date and time as a formatted string.
- *
- * @param[in] sensor Pointer to the text sensor entity, or nullptr.
- * @param[in] tod    Pointer to the time-of-day data structure.
- */
-static void
-_publish_date_and_time_if(OpnPoolTextSensor * const sensor, poolstate_tod_t const * const tod)
-{
-    if (sensor == nullptr || tod == nullptr || !tod->time.valid) {
-        return;
-    }
-    static char time_str[22];  // 2026-01-15 22:43\0
-
-    if (tod->date.valid) {
-        snprintf(time_str, sizeof(time_str), "%04d-%02d-%02d %02d:%02d",
-                 2000 +tod->date.value.year, tod->date.value.month, tod->date.value.day,
-                 tod->time.value.hour, tod->time.value.minute);
-    } else {
-        snprintf(time_str, sizeof(time_str), "%02d:%02d",
-                 tod->time.value.hour, tod->time.value.minute);
-    }
-    sensor->publish_value_if_changed(time_str);
-}
-
-/**
- * @brief             Publishes firmware version as a formatted string.
- *
- * @param[in] sensor  Pointer to the text sensor entity, or nullptr.
- * @param[in] version Pointer to the version data structure.
- */
-static void
-_publish_version_if(OpnPoolTextSensor * const sensor, poolstate_system_t const * const system)
-{
-    if (sensor != nullptr && system != nullptr && system->addr.valid && system->version.valid) {
-        static char fw_str[18];  // 2.80\0
-        snprintf(fw_str, sizeof(fw_str), "%s %d.%d", system->addr.value.to_str(), system->version.major, system->version.minor);
-        sensor->publish_value_if_changed(fw_str);
-    }
-}
-
-/**
- * @brief Publishes the four mode binary sensors if present and valid.
- *
- * @param[in] sensors Array of binary sensor pointers.
- * @param[in] modes   The modes value wrapper (must have .valid and .value members).
  */
+template<typename EntityT>
 static void
-_publish_modes_if(OpnPoolBinarySensor * const * const  sensors, poolstate_modes_t const modes)
+_unavailable_if(EntityT * const entity)
 {
-    if (!modes.valid) return;
-    if (sensors[enum_index(binary_sensor_id_t::MODE_SERVICE)]) {
-        sensors[enum_index(binary_sensor_id_t::MODE_SERVICE)]->publish_value_if_changed(modes.value.is_service_mode());
-    }
-    if (sensors[enum_index(binary_sensor_id_t::MODE_TEMPERATURE_INC)]) {
-        sensors[enum_index(binary_sensor_id_t::MODE_TEMPERATURE_INC)]->publish_value_if_changed(modes.value.is_temp_increase_mode());
-    }
-    if (sensors[enum_index(binary_sensor_id_t::MODE_FREEZE_PROTECTION)]) {
-        sensors[enum_index(binary_sensor_id_t::MODE_FREEZE_PROTECTION)]->publish_value_if_changed(modes.value.is_freeze_protection_mode());
-    }
-    if (sensors[enum_index(binary_sensor_id_t::MODE_TIMEOUT)]) {
-        sensors[enum_index(binary_sensor_id_t::MODE_TIMEOUT)]->publish_value_if_changed(modes.value.is_timeout_mode());
+    if (entity != nullptr) {
+        entity->publish_unavailable();
     }
 }
 
@@ -247,6 +136,12 @@ void
 OpnPool::setup() {
     
     ESP_LOGI(TAG, "Setting up OpnPool...");
+    setup_ms_ = millis();
+
+        // claim a string arena for the main task, before the pool_task claims its own
+    if (to_str_bind_task() != ESP_OK) {
+        ESP_LOGW(TAG, "No string arena for the main task");
+    }
 
         // instantiate Poolstate
     poolState_ = new PoolState();
@@ -255,6 +150,53 @@ OpnPool::setup() {
         return;
     }
 
+        // warm start from the last snapshot; it goes stale unless the bus confirms it in time
+    snapshot_ = new PoolStateSnapshot();
+    if (snapshot_ != nullptr) {
+        poolstate_t restored;
+        if (snapshot_->restore(&restored) == ESP_OK) {
+            poolState_->set(&restored);
+
+                // only the subsystems it has data for, so pumps that aren't there don't go stale
+            poolstate_t const empty = {};
+            restored_ = poolstate_ttl::subsys_changed(&empty, &restored);
+            poolstate_ttl_.touch(restored_, setup_ms_);
+        }
+    }
+    publish_restored_ = true;
+
+        // keep a day worth of key values on the device, so trends survive HA outages
+    if (history_enabled_) {
+        history_ = new PoolStateHistory();
+        if (history_ == nullptr) {
+            ESP_LOGW(TAG, "Failed to instantiate PoolStateHistory");
+        }
+    }
+
+        // derive energy, runtime and such on the device, instead of in HA templates
+    metrics_ = new PoolStateMetrics();
+    if (metrics_ == nullptr) {
+        ESP_LOGW(TAG, "Failed to instantiate PoolStateMetrics");
+    } else {
+        metrics_->set_pool_volume(pool_volume_gal_);
+    }
+
+        // lifetime counters for maintenance, restored from flash
+    counters_ = new PoolStateCounters();
+    if (counters_ == nullptr) {
+        ESP_LOGW(TAG, "Failed to instantiate PoolStateCounters");
+    } else {
+        (void)counters_->restore();
+    }
+
+        // who changed what and when, kept in flash
+    events_ = new PoolStateEvents();
+    if (events_ == nullptr) {
+        ESP_LOGW(TAG, "Failed to instantiate PoolStateEvents");
+    } else {
+        (void)events_->restore();
+    }
+
         // alloc IPC struct
     ipc_ = new ipc_t{};
     if (ipc_ == nullptr) {
@@ -265,6 +207,7 @@ OpnPool::setup() {
 
         // assign in IPC struct
     ipc_->config.rs485_pins = rs485_pins_;
+    ipc_->config.poll = poll_config_;
     ipc_->to_pool_q = xQueueCreate(TO_POOL_QUEUE_LEN, sizeof(network_msg_t));
     ipc_->to_main_q = xQueueCreate(TO_MAIN_QUEUE_LEN, sizeof(network_msg_t));
     if (!ipc_->to_main_q || !ipc_->to_pool_q) {
@@ -345,26 +288,69 @@ OpnPool::~OpnPool()
         if (ipc_->to_pool_q) vQueueDelete(ipc_->to_pool_q);
         delete ipc_;
     }
+    delete events_;
+    delete counters_;
+    delete metrics_;
+    delete history_;
+    delete snapshot_;
     delete poolState_;
 }
 
+/**
+ * @brief Checkpoints the pool state before a reboot (e.g. for an OTA update).
+ */
+void
+OpnPool::on_shutdown()
+{
+    if (snapshot_ != nullptr && poolState_ != nullptr) {
+        poolstate_t state;
+        poolState_->get(&state);
+        (void)snapshot_->checkpoint(&state, millis(), true);
+    }
+    if (counters_ != nullptr && poolState_ != nullptr) {
+        poolstate_t state;
+        poolState_->get(&state);
+        counters_->feed(&state, millis());
+        (void)counters_->checkpoint(millis(), true);
+    }
+    if (events_ != nullptr) {
+        (void)events_->flush();
+    }
+}
+
 
 /**
  * @brief Main loop for the OpnPool component.
  *
  * This function is called repeatedly by the main ESPHome loop. It handles service
  * requests from the pool by checking the IPC queue for messages from the pool task.
+ * It also invalidates parts of the pool state that haven't been refreshed within their
+ * configured time-to-live, and publishes the related entities as unavailable.
  * Warning: don't do any blocking operations here.
  */
 void
 OpnPool::loop() {
 
     network_msg_t msg = {};
+    uint32_t const now = millis();
 
-    if (xQueueReceive(ipc_->to_main_q, &msg, 0) == pdPASS) {  // check if a message is available
+        // strings formatted during this cycle are released at its end
+    to_str_scope_t const to_str_scope;
+
+        // publish the snapshot restored during setup(), now that all entities are set up
+    if (publish_restored_) {
+        publish_restored_ = false;
+
+        if (restored_ != 0) {
+            poolstate_t restored;
+            poolState_->get(&restored);
+            this->update_all(&restored);
+            ESP_LOGI(TAG, "Published restored pool state (stale until confirmed)");
+        }
+        this->publish_restored_state_();
+    }
 
-            // reset global string buffer (as a new cycle begins)
-        name_reset_idx();
+    if (xQueueReceive(ipc_->to_main_q, &msg, 0) == pdPASS) {  // check if a message is available
 
             // start with new_state being the current state
         poolstate_t new_state;
@@ -380,30 +366,171 @@ OpnPool::loop() {
 
         if (poolstate_rx::update_state(&msg, &new_state) == ESP_OK) {
 
-            if (poolState_->has_changed(&new_state)) {
+                // refresh the staleness deadline of the subsystems this message vouches for
+            poolstate_subsys_mask_t const touched = poolstate_ttl::subsys_touched_by(&msg);
+            poolstate_ttl_.touch(touched, now);
+            fresh_ |= touched;
+            if (restored_ & touched) {
+                restored_ &= ~touched;
+                this->publish_restored_state_();
+            }
+
+            poolstate_subsys_mask_t const changed = poolState_->changed_subsys(&new_state);
+            if (changed != 0) {
 
                 poolState_->set(&new_state);
 
                     // publish this as an update to the HA sensors 
-                this->update_climates(&new_state);
-                this->update_switches(&new_state);
-                this->update_text_sensors(&new_state);
-                this->update_analog_sensors(&new_state);
-                this->update_binary_sensors(&new_state);
+                this->update_all(&new_state);
+
+                if (snapshot_ != nullptr) {
+                    (void)snapshot_->checkpoint(&new_state, now);
+                }
+
+                    // count up to this transition with the old values
+                if (counters_ != nullptr) {
+                    counters_->feed(&new_state, now);
+                }
+
+                    // log the transitions, attributed to the commands that caused them
+                if (events_ != nullptr) {
+                    events_->feed(&new_state, now);
+                }
+
+#ifdef USE_MATTER
+                    // only the changed subsystems, the bridge pushes only the attributes that changed
+                if (matter_bridge_ != nullptr) {
+                    matter_bridge_->update_from_poolstate(&new_state, changed, now);
+                }
+#endif
+            }
+
+                // measure the time it takes to learn the complete state from the bus
+            constexpr poolstate_subsys_mask_t complete_mask =
+                poolstate_subsys_bit(poolstate_subsys_t::SYSTEM) | poolstate_subsys_bit(poolstate_subsys_t::CIRCUITS) |
+                poolstate_subsys_bit(poolstate_subsys_t::TEMPS) | poolstate_subsys_bit(poolstate_subsys_t::THERMOS);
+
+            if (time_to_complete_ms_ == 0 && (fresh_ & complete_mask) == complete_mask && poolState_->is_complete()) {
+                time_to_complete_ms_ = now - setup_ms_;
+                ESP_LOGI(TAG, "Complete pool state after %lu ms", static_cast<unsigned long>(time_to_complete_ms_));
+
+                OpnPoolSensor * const time_to_full_state = this->sensors_[enum_index(sensor_id_t::TIME_TO_FULL_STATE)];
+                if (time_to_full_state != nullptr) {
+                    time_to_full_state->publish_value_if_changed(time_to_complete_ms_ / 1000.0f);
+                }
             }
  
             ESP_LOGVV(TAG, "FYI Poolstate changed");
+        }
+    }
 
-#ifdef USE_MATTER
-                // Update Matter endpoints with new state
-            if (matter_bridge_ != nullptr) {
-                matter_bridge_->update_from_poolstate(&new_state);
+        // invalidate subsystems whose time-to-live expired
+    poolstate_subsys_mask_t const stale = poolstate_ttl_.expire(now);
+    if (stale != 0) {
+
+        poolstate_t new_state;
+        poolState_->get(&new_state);
+
+        for (auto subsys : magic_enum::enum_values<poolstate_subsys_t>()) {
+            if (stale & poolstate_subsys_bit(subsys)) {
+                ESP_LOGW(TAG, "No %s update for %lu s, marking it unavailable", enum_str(subsys),
+                         static_cast<unsigned long>(poolstate_ttl_.get_ttl(subsys) / 1000));
+                poolstate_ttl::invalidate(&new_state, subsys);
+                this->publish_unavailable(subsys);
             }
+        }
+        poolState_->set(&new_state);
+
+            // restored values that went stale are gone, so they no longer await confirmation
+        if (restored_ & stale) {
+            restored_ &= ~stale;
+            this->publish_restored_state_();
+        }
+
+#ifdef USE_MATTER
+        if (matter_bridge_ != nullptr) {
+            matter_bridge_->update_from_poolstate(&new_state, stale, now);
+        }
 #endif
+    }
+
+        // send the thermostat changes collected during the coalescing window
+    if (heat_set_.pending && static_cast<int32_t>(now - heat_set_.due_ms) >= 0) {
+        this->flush_heat_set_();
+    }
+
+        // give up on a scene that the controller didn't confirm in time
+    if (scene_.active && static_cast<int32_t>(now - (scene_.start_ms + SCENE_TIMEOUT_MS)) >= 0) {
+        this->end_scene_(false, "controller didn't confirm it in time");
+    }
+
+        // revert the entities of commands that the controller never acknowledged
+    network_msg_t failed;
+    while (cmd_tracker_take_failed(&failed)) {
+        this->command_failed(&failed);
+    }
+
+        // roll back optimistic states that the controller didn't confirm in time
+    for (auto sw : this->switches_) {
+        if (sw != nullptr) {
+            sw->expire_pending(now);
+        }
+    }
+    for (auto climate : this->climates_) {
+        if (climate != nullptr) {
+            climate->expire_pending(now);
+        }
+    }
+
+        // publish sensor changes held back by their minimum interval, and heartbeats
+    for (auto sensor : this->sensors_) {
+        if (sensor != nullptr) {
+            sensor->publish_due(now);
         }
     }
 
+        // record the key values in the history (after expiry, so stale values show as gaps)
+    if (history_ != nullptr && history_->is_due(now)) {
+        poolstate_t state;
+        poolState_->get(&state);
+        history_->sample(&state, now);
+    }
+
+        // update the derived metrics (after expiry, so stale values aren't integrated)
+    if (metrics_ != nullptr && metrics_->is_due(now)) {
+        poolstate_t state;
+        poolState_->get(&state);
+        metrics_->feed(&state, now);
+        this->publish_metrics_();
+    }
+
+        // count the values held since the last transition, and persist them now and then
+    if (counters_ != nullptr && counters_->is_due(now)) {
+        poolstate_t state;
+        poolState_->get(&state);
+        counters_->feed(&state, now);
+        (void)counters_->checkpoint(now);
+        this->publish_counters_();
+    }
+
+        // write a snapshot change that came too soon after the previous write
+    if (snapshot_ != nullptr && snapshot_->is_due(now)) {
+        poolstate_t state;
+        poolState_->get(&state);
+        (void)snapshot_->checkpoint(&state, now);
+    }
+
+        // write the events collected in RAM now and then
+    if (events_ != nullptr && events_->is_due(now)) {
+        (void)events_->flush();
+    }
+
 #ifdef USE_MATTER
+        // report pump changes that were held back by their minimum interval
+    if (matter_bridge_ != nullptr) {
+        matter_bridge_->publish_due(now);
+    }
+
         // Process pending Matter commands (from Matter controller → pool)
     if (matter_bridge_ != nullptr) {
         network_msg_t matter_cmd = {};
@@ -411,7 +538,9 @@ OpnPool::loop() {
             ESP_LOGD(TAG, "Processing Matter command: %s", enum_str(matter_cmd.typ));
             if (xQueueSend(ipc_->to_pool_q, &matter_cmd, 0) != pdPASS) {
                 ESP_LOGW(TAG, "Failed to queue Matter command to pool_task");
+                continue;
             }
+            this->note_command(&matter_cmd, poolstate_event_src_t::MATTER);
         }
     }
 #endif
@@ -431,6 +560,95 @@ OpnPool::dump_config() {
     ESP_LOGCONFIG(TAG, "  RS485 rx pin: %u", this->ipc_->config.rs485_pins.rx_pin);
     ESP_LOGCONFIG(TAG, "  RS485 tx pin: %u", this->ipc_->config.rs485_pins.tx_pin);
     ESP_LOGCONFIG(TAG, "  RS485 rts pin: %u", this->ipc_->config.rs485_pins.rts_pin);
+    for (auto subsys : magic_enum::enum_values<poolstate_subsys_t>()) {
+        ESP_LOGCONFIG(TAG, "  Stale after (%s): %lu ms", enum_str(subsys),
+                      static_cast<unsigned long>(poolstate_ttl_.get_ttl(subsys)));
+    }
+    for (auto poll : magic_enum::enum_values<poll_typ_t>()) {
+        ESP_LOGCONFIG(TAG, "  Poll every (%s): %lu ms", enum_str(poll),
+                      static_cast<unsigned long>(poll_config_.every_ms[enum_index(poll)]));
+    }
+    ESP_LOGCONFIG(TAG, "  Poll spacing: %lu ms, boost after: %lu ms",
+                  static_cast<unsigned long>(poll_config_.spacing_ms),
+                  static_cast<unsigned long>(poll_config_.boost_after_ms));
+    for (auto pump_id : magic_enum::enum_values<datalink_pump_id_t>()) {
+        uint16_t const bit = 1U << enum_index(pump_id);
+        if ((pumps_ | poll_config_.pumps) & bit) {
+            ESP_LOGCONFIG(TAG, "  Pump %u (0x%02X):%s%s", enum_index(pump_id) + 1U, datalink_addr_t::pump(pump_id).addr,
+                          (pumps_ & bit) ? " entities" : "", (poll_config_.pumps & bit) ? " polled" : "");
+        }
+    }
+    if (snapshot_ != nullptr) {
+        ESP_LOGCONFIG(TAG, "  Snapshot writes: %lu", static_cast<unsigned long>(snapshot_->get_write_count()));
+    }
+    ESP_LOGCONFIG(TAG, "  Time to complete state: %lu ms", static_cast<unsigned long>(time_to_complete_ms_));
+    ESP_LOGCONFIG(TAG, "  Restored, not confirmed yet: 0x%06lX", static_cast<unsigned long>(restored_));
+    ESP_LOGCONFIG(TAG, "  Thermostat changes: %lu, sent as %lu HEAT_SET (coalesce window %lu ms)",
+                  static_cast<unsigned long>(heat_set_.requests), static_cast<unsigned long>(heat_set_.sent),
+                  static_cast<unsigned long>(coalesce_window_ms_));
+    ESP_LOGCONFIG(TAG, "  Scenes: %lu applied, %lu failed",
+                  static_cast<unsigned long>(scene_.applied), static_cast<unsigned long>(scene_.failed));
+    if (history_ != nullptr) {
+        ESP_LOGCONFIG(TAG, "  History: %lu samples in %lu bytes (%lu raw)",
+                      static_cast<unsigned long>(history_->get_sample_count()),
+                      static_cast<unsigned long>(history_->get_byte_count()),
+                      static_cast<unsigned long>(history_->get_raw_byte_count()));
+    } else {
+        ESP_LOGCONFIG(TAG, "  History: disabled");
+    }
+    ESP_LOGCONFIG(TAG, "  Pool volume: %lu gal", static_cast<unsigned long>(pool_volume_gal_));
+    if (counters_ != nullptr) {
+        poolstate_counters_t const & counters = counters_->get();
+        ESP_LOGCONFIG(TAG, "  Counters (%s, %lu writes): pump %lu h %lu kWh, heater %lu h, chlorinator cell %lu h",
+                      counters_->is_persistent() ? "in flash" : "since boot",
+                      static_cast<unsigned long>(counters_->get_write_count()),
+                      static_cast<unsigned long>(counters.pump_s / 3600), static_cast<unsigned long>(counters.pump_wh / 1000),
+                      static_cast<unsigned long>(counters.heater_s / 3600), static_cast<unsigned long>(counters.chlor_cell_s / 3600));
+        for (auto circuit : magic_enum::enum_values<network_pool_circuit_t>()) {
+            ESP_LOGCONFIG(TAG, "  Runtime (%s): %lu h", enum_str(circuit),
+                          static_cast<unsigned long>(counters.circuit_s[enum_index(circuit)] / 3600));
+        }
+    }
+    if (events_ != nullptr) {
+        ESP_LOGCONFIG(TAG, "  Events (%s): %lu since boot, %lu writes",
+                      events_->is_persistent() ? "in flash" : "in RAM",
+                      static_cast<unsigned long>(events_->get_event_count()),
+                      static_cast<unsigned long>(events_->get_write_count()));
+    }
+
+#ifdef USE_MATTER
+    if (matter_bridge_ != nullptr) {
+        matter::matter_push_stats_t const push = matter_bridge_->get_push_stats();
+        ESP_LOGCONFIG(TAG, "  Matter attributes: %lu pushed in %lu batches, %lu unchanged, %lu held back",
+                      static_cast<unsigned long>(push.pushed), static_cast<unsigned long>(push.batches),
+                      static_cast<unsigned long>(push.skipped), static_cast<unsigned long>(push.held));
+    }
+#endif
+
+    network_capture_stats_t const capture = network_capture_stats();
+    ESP_LOGCONFIG(TAG, "  Undecoded frames: %u distinct, %lu total", capture.entries, static_cast<unsigned long>(capture.frames));
+
+    for (uint8_t idx = 0; idx < cmd_tracker_typ_count(); idx++) {
+        cmd_tracker_stats_t stats;
+        if (!cmd_tracker_get_stats(idx, &stats) || stats.commands == 0) {
+            continue;
+        }
+        ESP_LOGCONFIG(TAG, "  Commands (%s): %lu sent, %lu retried, %lu acked, %lu confirmed, %lu failed, %lu superseded",
+                      enum_str(stats.typ), static_cast<unsigned long>(stats.commands),
+                      static_cast<unsigned long>(stats.retries), static_cast<unsigned long>(stats.acked),
+                      static_cast<unsigned long>(stats.confirmed), static_cast<unsigned long>(stats.failed),
+                      static_cast<unsigned long>(stats.superseded));
+
+        char hist[2][CMD_TRACKER_BUCKETS * 11 + 1];
+        for (uint8_t h = 0; h < 2; h++) {
+            uint32_t const * const counts = h == 0 ? stats.ack_hist : stats.done_hist;
+            char * p = hist[h];
+            for (uint8_t bucket = 0; bucket < CMD_TRACKER_BUCKETS; bucket++) {
+                p += snprintf(p, sizeof(hist[h]) - (p - hist[h]), " %lu", static_cast<unsigned long>(counts[bucket]));
+            }
+        }
+        ESP_LOGCONFIG(TAG, "    Latency <100/250/500/1000/2500/more ms: ack%s, done%s", hist[0], hist[1]);
+    }
 
     for (auto idx : magic_enum::enum_values<climate_id_t>()) {
         _dump_if(this->climates_[enum_index(idx)]);
@@ -449,6 +667,87 @@ OpnPool::dump_config() {
             _dump_if(this->text_sensors_[enum_index(idx)]);
         }
     }
+    for (auto const & slot : pump_sensor_dispatch_) {
+        slot.entity->dump_config();
+    }
+    for (auto const & slot : pump_binary_sensor_dispatch_) {
+        slot.entity->dump_config();
+    }
+    for (auto const & slot : pump_text_sensor_dispatch_) {
+        slot.entity->dump_config();
+    }
+}
+
+/**
+ * @brief Logs the frames that the network layer couldn't decode.
+ *
+ * @details
+ * Reads the capture ring that pool_task fills, so the bus keeps running. Used by the
+ * `opnpool.dump_undecoded_frames` action.
+ *
+ * @param[in] clear Empty the capture ring afterwards.
+ */
+void
+OpnPool::dump_undecoded_frames(bool const clear)
+{
+    network_capture_dump();
+    if (clear) {
+        network_capture_clear();
+    }
+}
+
+/**
+ * @brief Notes a command sent to the controller, so the event log can attribute the
+ *        transition that follows.
+ *
+ * @param[in] msg The command, as handed to the pool_task.
+ * @param[in] src Where the command came from.
+ */
+void
+OpnPool::note_command(network_msg_t const * const msg, poolstate_event_src_t const src)
+{
+    if (events_ != nullptr) {
+        events_->note_command(msg, src, millis());
+    }
+}
+
+/**
+ * @brief Logs the state transitions of the last so many minutes, e.g. from a button.
+ *
+ * @details
+ * The range is relative to the controller's time. Until that is known, or with
+ * last_min of 0, all events are logged.
+ *
+ * @param[in] last_min Minutes to go back, 0 for all events.
+ */
+void
+OpnPool::dump_events(uint32_t const last_min)
+{
+    if (events_ == nullptr || poolState_ == nullptr) {
+        return;
+    }
+    poolstate_t state;
+    poolState_->get(&state);
+
+    uint32_t const now = poolstate_event_time(&state.system.tod);
+    uint32_t const from = (last_min != 0 && now > last_min) ? now - last_min : 0;
+    events_->dump(from, UINT32_MAX);
+}
+
+/**
+ * @brief Logs the history of the last so many minutes, e.g. from a button.
+ *
+ * @param[in] last_min   Minutes to go back, 0 for all samples held.
+ * @param[in] bucket_min Minutes per bucket.
+ */
+void
+OpnPool::dump_history(uint32_t const last_min, uint32_t const bucket_min)
+{
+    if (history_ == nullptr) {
+        ESP_LOGW(TAG, "History is disabled");
+        return;
+    }
+    history_->dump(millis(), last_min * 60 * 1000, bucket_min * 60 * 1000);
 }
 
 /**
@@ -518,139 +817,626 @@ OpnPool::update_switches(const poolstate_t * const state)
 
         sw->publish_value_if_changed(active_circuit->value);
     }
+    this->check_scene_(state);
 }
 
 /**
  * @brief Updates analog sensor entities with current pool state.
  *
+ * @details
+ * Only visits the configured analog sensors, see opnpool_dispatch.h.
+ *
  * @param[in] state Pointer to the current pool state.
  */
 void
 OpnPool::update_analog_sensors(poolstate_t const * const state)
 {
-    OpnPoolSensor * const air_temp_sensor = this->sensors_[enum_index(sensor_id_t::AIR_TEMPERATURE)];
-    auto const air_temp = state->temps[enum_index(poolstate_temp_typ_t::AIR)];
-    if (air_temp_sensor != nullptr && air_temp.valid) {
-        //auto air_temp_c = fahrenheit_to_celsius(air_temp.value);
-        //air_temp_c = std::round(air_temp_c * 10.0f) / 10.0f;
-        auto air_temp_f =std::round(air_temp.value * 10.0f) / 10.0f;
-        air_temp_sensor->publish_value_if_changed(air_temp_f);    
-    }
-
-    OpnPoolSensor * const water_temperature_sensor = this->sensors_[enum_index(sensor_id_t::WATER_TEMPERATURE)];
-    auto const water_temp = state->temps[enum_index(poolstate_temp_typ_t::WATER)];
-    if (water_temperature_sensor != nullptr && water_temp.valid) {    
-        //auto water_temp_c = fahrenheit_to_celsius(water_temp.value);
-        //water_temp_c = std::round(water_temp_c * 10.0f) / 10.0f;
-        auto water_temp_f =std::round(water_temp.value * 10.0f) / 10.0f;
-        water_temperature_sensor->publish_value_if_changed(water_temp_f);
-    }   
-    _publish_if(
-        this->sensors_[enum_index(sensor_id_t::PRIMARY_PUMP_POWER)],        
-        state->pumps[enum_index(datalink_pump_id_t::PRIMARY)].power
-    );
-    _publish_if(
-        this->sensors_[enum_index(sensor_id_t::PRIMARY_PUMP_FLOW)],         
-        state->pumps[enum_index(datalink_pump_id_t::PRIMARY)].flow
-    );
-    _publish_if(
-        this->sensors_[enum_index(sensor_id_t::PRIMARY_PUMP_SPEED)],        
-        state->pumps[enum_index(datalink_pump_id_t::PRIMARY)].speed
-    );
-    _publish_if(
-        this->sensors_[enum_index(sensor_id_t::PRIMARY_PUMP_ERROR)],        
-        state->pumps[enum_index(datalink_pump_id_t::PRIMARY)].error
-    );
-    _publish_if(
-        this->sensors_[enum_index(sensor_id_t::CHLORINATOR_LEVEL)], 
-        state->chlor.level
-    );
-    _publish_if(
-        this->sensors_[enum_index(sensor_id_t::CHLORINATOR_SALT)],  
-        state->chlor.salt
-    );
+    for (auto const & slot : sensor_dispatch_) {
+        float value;
+        if (slot.read(state, &value)) {
+            slot.entity->publish_value_if_changed(value);
+        }
+    }
+    for (auto const & slot : pump_sensor_dispatch_) {
+        float value;
+        if (slot.read(&state->pumps[slot.pump_idx], &value)) {
+            slot.entity->publish_value_if_changed(value);
+        }
+    }
 }
 
 /**
  * @brief Updates binary sensor entities with current pool state.
  *
+ * @details
+ * Only visits the configured binary sensors, see opnpool_dispatch.h.
+ *
  * @param[in] state Pointer to the current pool state.
  */
-
 void
 OpnPool::update_binary_sensors(poolstate_t const * const state)
 {
-    _publish_if(
-        this->binary_sensors_[enum_index(binary_sensor_id_t::PRIMARY_PUMP_POWER)],           
-        state->pumps[enum_index(datalink_pump_id_t::PRIMARY)].running
-    );
-    _publish_modes_if(
-        this->binary_sensors_,
-        state->system.modes);
+    for (auto const & slot : binary_sensor_dispatch_) {
+        bool value;
+        if (slot.read(state, &value)) {
+            slot.entity->publish_value_if_changed(value);
+        }
+    }
+    for (auto const & slot : pump_binary_sensor_dispatch_) {
+        bool value;
+        if (slot.read(&state->pumps[slot.pump_idx], &value)) {
+            slot.entity->publish_value_if_changed(value);
+        }
+    }
 }
 
 /**
  * @brief Updates text sensor entities with current pool state.
  *
+ * @details
+ * Only visits the configured text sensors, see opnpool_dispatch.h.
+ *
  * @param[in] state Pointer to the current pool state.
  */
 void
 OpnPool::update_text_sensors(poolstate_t const * const state)
 {
-    _publish_schedule_if(
-        this->text_sensors_[enum_index(text_sensor_id_t::POOL_SCHED)],
-        &state->scheds[enum_index(network_pool_circuit_t::POOL)]
-    );
-    _publish_schedule_if(
-        this->text_sensors_[enum_index(text_sensor_id_t::SPA_SCHED)],
-        &state->scheds[enum_index(network_pool_circuit_t::SPA)]
-    );
-    _publish_enum_if(
-        this->text_sensors_[enum_index(text_sensor_id_t::PRIMARY_PUMP_STATE)],
-        state->pumps[enum_index(datalink_pump_id_t::PRIMARY)].state
-    );
-    _publish_str_if(
-        this->text_sensors_[enum_index(text_sensor_id_t::PRIMARY_PUMP_MODE)], 
-        state->pumps[enum_index(datalink_pump_id_t::PRIMARY)].mode
-    );
-    _publish_if(
-        this->text_sensors_[enum_index(text_sensor_id_t::CHLORINATOR_NAME)], 
-        state->chlor.name
-    );
-    _publish_enum_if(
-        this->text_sensors_[enum_index(text_sensor_id_t::CHLORINATOR_STATUS)],
-        state->chlor.status
-    );
-    _publish_date_and_time_if(
-        this->text_sensors_[enum_index(text_sensor_id_t::SYSTEM_TIME)],
-        &state->system.tod
-    );
-    _publish_version_if(
-        this->text_sensors_[enum_index(text_sensor_id_t::CONTROLLER_TYPE)],
-        &state->system
-    );
+    for (auto const & slot : text_sensor_dispatch_) {
+        char buf[TEXT_SENSOR_READ_SIZE];
+        char const * const value = slot.read(state, buf, sizeof(buf));
+        if (value != nullptr) {
+            slot.entity->publish_value_if_changed(value);
+        }
+    }
+    for (auto const & slot : pump_text_sensor_dispatch_) {
+        char const * const value = slot.read(&state->pumps[slot.pump_idx]);
+        if (value != nullptr) {
+            slot.entity->publish_value_if_changed(value);
+        }
+    }
 }
 
-// ============================================================================
-// Setter methods (required by ESPHome's component model for code generation)
-// ============================================================================
-
 /**
- * @brief Sets the RS-485 GPIO pin assignments.
+ * @brief Reverts the entity of a command that the controller never acknowledged.
  *
- * @param[in] rx_pin  GPIO pin for RS-485 receive.
- * @param[in] tx_pin  GPIO pin for RS-485 transmit.
- * @param[in] rts_pin GPIO pin for RS-485 direction control.
+ * @param[in] msg The failed command, as handed back by the command tracker.
  */
 void
-OpnPool::set_rs485_pins(uint8_t const rx_pin, uint8_t const tx_pin, uint8_t const rts_pin)
+OpnPool::command_failed(network_msg_t const * const msg)
 {
-    rs485_pins_.rx_pin = rx_pin;
-    rs485_pins_.tx_pin = tx_pin;
-    rs485_pins_.rts_pin = rts_pin;
+    if (!msg) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return;
+    }
+
+    switch (msg->typ) {
+        case network_msg_typ_t::CTRL_CIRCUIT_SET: {
+            uint8_t const circuit_idx = msg->u.a5.ctrl_circuit_set.circuit_plus_1 - 1;
+            if (circuit_idx < enum_count<switch_id_t>() && this->switches_[circuit_idx] != nullptr) {
+                this->switches_[circuit_idx]->command_failed();  // switch_id_t matches network_pool_circuit_t
+            }
+            if (scene_.active && circuit_idx < enum_count<switch_id_t>() && (scene_.mask & (1U << circuit_idx))) {
+                this->end_scene_(false, "controller didn't acknowledge a circuit");
+            }
+            break;
+        }
+        case network_msg_typ_t::CTRL_HEAT_SET:
+            for (auto climate : this->climates_) {
+                if (climate != nullptr) {
+                    climate->command_failed();
+                }
+            }
+            break;
+        default:
+            ESP_LOGW(TAG, "Controller didn't acknowledge %s", enum_str(msg->typ));
+            break;
+    }
 }
 
-void
+/**
+ * @brief Returns the thermostat settings waiting to be sent, if the window is open.
+ *
+ * @details
+ * The climates start from these settings instead of the pool state, so a change to one
+ * thermostat doesn't undo an earlier change to the other that wasn't sent yet.
+ *
+ * @return The merged settings, or nullptr if no changes are waiting.
+ */
+heat_setting_t const *
+OpnPool::get_pending_heat_set() const
+{
+    return heat_set_.pending ? &heat_set_.setting : nullptr;
+}
+
+/**
+ * @brief Collects a thermostat change, to send it when the coalescing window closes.
+ *
+ * @details
+ * A thermostat slider or an automation can make several changes within a second. Each
+ * CTRL_HEAT_SET carries the settings of both thermostats, so the last one holds all
+ * changes. The window opens with the first change and isn't extended by later ones,
+ * so a steady stream of changes still reaches the controller.
+ *
+ * @param[in] setting Settings of both thermostats, with the change applied.
+ */
+void
+OpnPool::queue_heat_set(heat_setting_t const * const setting)
+{
+    if (!setting) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return;
+    }
+    heat_set_.setting = *setting;
+    heat_set_.requests++;
+    if (!heat_set_.pending) {
+        heat_set_.pending = true;
+        heat_set_.due_ms = millis() + coalesce_window_ms_;
+    }
+    if (coalesce_window_ms_ == 0) {
+        this->flush_heat_set_();
+    }
+}
+
+/**
+ * @brief Sends the collected thermostat settings to the pool_task as one CTRL_HEAT_SET.
+ *
+ * @details
+ * The pool_task drops a CTRL_HEAT_SET that is still waiting for a transmit opportunity
+ * when this one arrives. If it can't be sent, e.g. because the controller address is
+ * still unknown, the climates revert their optimistic state.
+ */
+void
+OpnPool::flush_heat_set_()
+{
+    heat_set_.pending = false;
+
+    poolstate_t state;
+    poolState_->get(&state);
+
+    network_msg_t msg = {};
+    msg.src = datalink_addr_t::remote();
+    msg.dst = state.system.addr.value;
+    msg.typ = network_msg_typ_t::CTRL_HEAT_SET;
+    msg.u.a5.ctrl_heat_set.pool_set_point = heat_set_.setting.pool_set_point;
+    msg.u.a5.ctrl_heat_set.spa_set_point = heat_set_.setting.spa_set_point;
+    msg.u.a5.ctrl_heat_set.heat_src.set_pool(heat_set_.setting.pool_heat_src);
+    msg.u.a5.ctrl_heat_set.heat_src.set_spa(heat_set_.setting.spa_heat_src);
+
+    if (!msg.dst.is_controller()) {
+        ESP_LOGW(TAG, "Controller address still unknown, cannot send HEAT_SET");
+        this->command_failed(&msg);
+        return;
+    }
+
+    ESP_LOGV(TAG, "Sending HEAT_SET: pool=%u°F, spa=%u°F, heat_src=%u,%u",
+             msg.u.a5.ctrl_heat_set.pool_set_point,
+             msg.u.a5.ctrl_heat_set.spa_set_point,
+             (uint8_t)msg.u.a5.ctrl_heat_set.heat_src.get_pool(),
+             (uint8_t)msg.u.a5.ctrl_heat_set.heat_src.get_spa());
+
+    if (ipc_send_network_msg_to_pool_task(&msg, ipc_) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to send HEAT_SET message to pool task");
+        this->command_failed(&msg);
+        return;
+    }
+    this->note_command(&msg, poolstate_event_src_t::HA);
+    heat_set_.sent++;
+}
+
+/**
+ * @brief Sets several circuits at once, e.g. for a "party mode" or "spa mode" preset.
+ *
+ * @details
+ * Only sends a CTRL_CIRCUIT_SET for the circuits that aren't in the requested state
+ * yet. These are marked as one burst, so the pool_task transmits them back to back in
+ * the same transmit window, and the equipment doesn't go through intermediate states.
+ * The scene is queued completely or not at all. The per-command retries stay with the
+ * command tracker; the scene as a whole is applied once the controller reports all
+ * requested states, see check_scene_().
+ *
+ * If a target appears more than once, the last one counts.
+ *
+ * @param[in] targets Requested circuit states.
+ * @param[in] count   Number of targets.
+ * @return            ESP_OK if the scene was queued or is already in effect,
+ *                    ESP_ERR_INVALID_STATE if the controller address is still unknown,
+ *                    ESP_ERR_NO_MEM if there is no room in the queue to the pool_task.
+ */
+esp_err_t
+OpnPool::apply_scene(scene_target_t const * const targets, uint8_t const count)
+{
+    if (!targets) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    poolstate_t state;
+    poolState_->get(&state);
+
+    datalink_addr_t const controller_addr = state.system.addr.value;
+    if (!controller_addr.is_controller()) {
+        ESP_LOGW(TAG, "Controller address still unknown, cannot apply scene");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+        // requested states, the last target of a circuit wins
+    uint16_t requested = 0;
+    uint16_t values = 0;
+    for (uint8_t idx = 0; idx < count; idx++) {
+        uint8_t const switch_idx = enum_index(targets[idx].id);
+        if (switch_idx >= enum_count<switch_id_t>()) {
+            continue;
+        }
+        uint16_t const bit = 1U << switch_idx;
+        requested |= bit;
+        values = targets[idx].value ? (values | bit) : (values & ~bit);
+    }
+
+        // leave out the circuits that are already in the requested state
+    uint16_t mask = 0;
+    for (auto switch_id : magic_enum::enum_values<switch_id_t>()) {
+        uint16_t const bit = 1U << enum_index(switch_id);
+        auto const active = &state.circuits[enum_index(switch_id_to_network_circuit(switch_id))].active;
+        if ((requested & bit) && !(active->valid && active->value == ((values & bit) != 0))) {
+            mask |= bit;
+        }
+    }
+    uint8_t remaining = __builtin_popcount(mask);
+    if (remaining == 0) {
+        ESP_LOGV(TAG, "Scene already in effect");
+        return ESP_OK;
+    }
+
+        // all or nothing, the main task is the only one that sends to the pool_task
+    if (uxQueueSpacesAvailable(ipc_->to_pool_q) < remaining) {
+        ESP_LOGW(TAG, "No room to queue a scene of %u circuits", remaining);
+        scene_.failed++;
+        return ESP_ERR_NO_MEM;
+    }
+    if (scene_.active) {
+        ESP_LOGW(TAG, "Scene replaces one that isn't confirmed yet");
+    }
+    scene_ = {
+        .active = true,
+        .mask = mask,
+        .values = static_cast<uint16_t>(values & mask),
+        .start_ms = millis(),
+        .applied = scene_.applied,
+        .failed = scene_.failed
+    };
+    ESP_LOGI(TAG, "Applying scene, %u circuits to change", remaining);
+
+    for (auto switch_id : magic_enum::enum_values<switch_id_t>()) {
+        uint16_t const bit = 1U << enum_index(switch_id);
+        if (!(mask & bit)) {
+            continue;
+        }
+        bool const value = (values & bit) != 0;
+
+        network_msg_t msg = {};
+        msg.src = datalink_addr_t::remote();
+        msg.dst = controller_addr;
+        msg.typ = network_msg_typ_t::CTRL_CIRCUIT_SET;
+        msg.burst = --remaining;
+        msg.u.a5.ctrl_circuit_set.circuit_plus_1 = enum_index(switch_id_to_network_circuit(switch_id)) + 1;
+        msg.u.a5.ctrl_circuit_set.value = value ? 1 : 0;
+
+        if (ipc_send_network_msg_to_pool_task(&msg, ipc_) != ESP_OK) {
+            this->end_scene_(false, "couldn't queue it");
+            return ESP_FAIL;
+        }
+        this->note_command(&msg, poolstate_event_src_t::HA);
+        OpnPoolSwitch * const sw = this->switches_[enum_index(switch_id)];
+        if (sw != nullptr) {
+            sw->show_requested(value);
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Completes the scene once the controller reports all of its circuit states.
+ *
+ * @param[in] state Pointer to the current pool state.
+ */
+void
+OpnPool::check_scene_(poolstate_t const * const state)
+{
+    if (!scene_.active) {
+        return;
+    }
+    for (auto switch_id : magic_enum::enum_values<switch_id_t>()) {
+        uint16_t const bit = 1U << enum_index(switch_id);
+        if (!(scene_.mask & bit)) {
+            continue;
+        }
+        auto const active = &state->circuits[enum_index(switch_id_to_network_circuit(switch_id))].active;
+        if (!active->valid || active->value != ((scene_.values & bit) != 0)) {
+            return;  // not applied yet
+        }
+    }
+    this->end_scene_(true, nullptr);
+}
+
+/**
+ * @brief Stops tracking the scene.
+ *
+ * @details
+ * The switches of a failed scene roll back on their own, as their commands fail or
+ * their optimistic state expires.
+ *
+ * @param[in] applied True if the controller confirmed all circuits.
+ * @param[in] reason  Why the scene didn't take effect, for the log.
+ */
+void
+OpnPool::end_scene_(bool const applied, char const * const reason)
+{
+    scene_.active = false;
+    if (applied) {
+        scene_.applied++;
+        ESP_LOGI(TAG, "Scene applied in %lu ms", static_cast<unsigned long>(millis() - scene_.start_ms));
+    } else {
+        scene_.failed++;
+        ESP_LOGW(TAG, "Scene failed, %s", reason);
+    }
+}
+
+/**
+ * @brief Publishes the derived metrics to their sensors.
+ *
+ * @details
+ * Metrics without data yet (e.g. the turnover time without a pool volume) are left
+ * unpublished. The sensors' deadband and minimum interval limit what reaches HA.
+ */
+void
+OpnPool::publish_metrics_()
+{
+    struct metric_sensor_t {
+        sensor_id_t        id;
+        poolstate_metric_t metric;
+    };
+    static constexpr metric_sensor_t metric_sensors[] = {
+        {sensor_id_t::PRIMARY_PUMP_ENERGY,     poolstate_metric_t::PUMP_ENERGY},
+        {sensor_id_t::PRIMARY_PUMP_VOLUME,     poolstate_metric_t::PUMP_VOLUME},
+        {sensor_id_t::PRIMARY_PUMP_EFFICIENCY, poolstate_metric_t::PUMP_EFFICIENCY},
+        {sensor_id_t::TURNOVER_TIME,           poolstate_metric_t::TURNOVER_TIME},
+        {sensor_id_t::HEATER_DUTY_CYCLE,       poolstate_metric_t::HEATER_DUTY},
+        {sensor_id_t::POOL_RUNTIME,            poolstate_metric_t::POOL_RUNTIME},
+        {sensor_id_t::SPA_RUNTIME,             poolstate_metric_t::SPA_RUNTIME},
+        {sensor_id_t::WATER_TEMPERATURE_MIN,   poolstate_metric_t::WATER_TEMP_MIN},
+        {sensor_id_t::WATER_TEMPERATURE_MAX,   poolstate_metric_t::WATER_TEMP_MAX},
+    };
+    for (auto const & entry : metric_sensors) {
+        OpnPoolSensor * const sensor = this->sensors_[enum_index(entry.id)];
+        float value;
+        if (sensor != nullptr && metrics_->get(entry.metric, &value)) {
+            sensor->publish_value_if_changed(value);
+        }
+    }
+}
+
+/**
+ * @brief Publishes whether values restored from the snapshot still await the bus.
+ *
+ * @details
+ * The restored values are published like live ones, so this tells them apart: it is on
+ * until each restored subsystem was confirmed by the bus, or went stale.
+ */
+void
+OpnPool::publish_restored_state_()
+{
+    OpnPoolBinarySensor * const restored_state = this->binary_sensors_[enum_index(binary_sensor_id_t::RESTORED_STATE)];
+    if (restored_state != nullptr) {
+        restored_state->publish_value_if_changed(restored_ != 0);
+    }
+}
+
+/**
+ * @brief Publishes the lifetime counters to their sensors.
+ */
+void
+OpnPool::publish_counters_()
+{
+    poolstate_counters_t const & counters = counters_->get();
+    struct counter_sensor_t {
+        sensor_id_t id;
+        float       value;
+    };
+    counter_sensor_t const counter_sensors[] = {
+        {sensor_id_t::PRIMARY_PUMP_ENERGY_TOTAL, counters.pump_wh / 1000.0f},
+        {sensor_id_t::PRIMARY_PUMP_HOURS,        counters.pump_s / 3600.0f},
+        {sensor_id_t::HEATER_HOURS,              counters.heater_s / 3600.0f},
+        {sensor_id_t::CHLORINATOR_CELL_HOURS,    counters.chlor_cell_s / 3600.0f},
+    };
+    for (auto const & entry : counter_sensors) {
+        OpnPoolSensor * const sensor = this->sensors_[enum_index(entry.id)];
+        if (sensor != nullptr) {
+            sensor->publish_value_if_changed(entry.value);
+        }
+    }
+}
+
+/**
+ * @brief Publishes the entities that depend on a stale subsystem as unavailable.
+ *
+ * @details
+ * The sensors go unavailable with the subsystem in their binding. ESPHome switches have
+ * no unavailable state, so they keep their last state when the circuits go stale. The
+ * climates depend on circuits, temperatures and thermostats.
+ *
+ * @param[in] subsys The subsystem that went stale.
+ */
+void
+OpnPool::publish_unavailable(poolstate_subsys_t const subsys)
+{
+    for (auto const & slot : sensor_dispatch_) {
+        if (slot.subsys == subsys) {
+            slot.entity->publish_unavailable();
+        }
+    }
+    for (auto const & slot : binary_sensor_dispatch_) {
+        if (slot.subsys == subsys) {
+            slot.entity->publish_unavailable();
+        }
+    }
+    for (auto const & slot : text_sensor_dispatch_) {
+        if (slot.subsys == subsys) {
+            slot.entity->publish_unavailable();
+        }
+    }
+    for (auto const & slot : pump_sensor_dispatch_) {
+        if (slot.subsys == subsys) {
+            slot.entity->publish_unavailable();
+        }
+    }
+    for (auto const & slot : pump_binary_sensor_dispatch_) {
+        if (slot.subsys == subsys) {
+            slot.entity->publish_unavailable();
+        }
+    }
+    for (auto const & slot : pump_text_sensor_dispatch_) {
+        if (slot.subsys == subsys) {
+            slot.entity->publish_unavailable();
+        }
+    }
+    switch (subsys) {
+        case poolstate_subsys_t::TEMPS:
+        case poolstate_subsys_t::CIRCUITS:
+        case poolstate_subsys_t::THERMOS:
+            for (auto climate_id : magic_enum::enum_values<climate_id_t>()) {
+                _unavailable_if(this->climates_[enum_index(climate_id)]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Updates all entities with current pool state.
+ *
+ * @param[in] state Pointer to the current pool state.
+ */
+void
+OpnPool::update_all(poolstate_t const * const state)
+{
+    this->update_climates(state);
+    this->update_switches(state);
+    this->update_text_sensors(state);
+    this->update_analog_sensors(state);
+    this->update_binary_sensors(state);
+}
+
+// ============================================================================
+// Setter methods (required by ESPHome's component model for code generation)
+// ============================================================================
+
+/**
+ * @brief Sets the RS-485 GPIO pin assignments.
+ *
+ * @param[in] rx_pin  GPIO pin for RS-485 receive.
+ * @param[in] tx_pin  GPIO pin for RS-485 transmit.
+ * @param[in] rts_pin GPIO pin for RS-485 direction control.
+ */
+void
+OpnPool::set_rs485_pins(uint8_t const rx_pin, uint8_t const tx_pin, uint8_t const rts_pin)
+{
+    rs485_pins_.rx_pin = rx_pin;
+    rs485_pins_.tx_pin = tx_pin;
+    rs485_pins_.rts_pin = rts_pin;
+}
+
+/**
+ * @brief Sets the time-to-live of a pool state subsystem.
+ *
+ * @param[in] subsys Index of the subsystem (poolstate_subsys_t).
+ * @param[in] ttl_ms Time-to-live in milliseconds, or 0 to never go stale.
+ */
+void
+OpnPool::set_stale_after(uint8_t const subsys, uint32_t const ttl_ms)
+{
+    if (subsys >= enum_count<poolstate_subsys_t>()) {
+        ESP_LOGE(TAG, "Invalid subsystem index: %u", subsys);
+        return;
+    }
+    poolstate_ttl_.set_ttl(static_cast<poolstate_subsys_t>(subsys), ttl_ms);
+}
+
+/**
+ * @brief Sets how fresh a kind of polled data should be kept.
+ *
+ * @param[in] poll     Index of the poll type (poll_typ_t).
+ * @param[in] every_ms Desired freshness in milliseconds, or 0 to never poll.
+ */
+void
+OpnPool::set_poll_every(uint8_t const poll, uint32_t const every_ms)
+{
+    if (poll >= enum_count<poll_typ_t>()) {
+        ESP_LOGE(TAG, "Invalid poll index: %u", poll);
+        return;
+    }
+    poll_config_.every_ms[poll] = every_ms;
+}
+
+/**
+ * @brief Sets the minimum time between two polls.
+ *
+ * @param[in] spacing_ms Minimum time between polls in milliseconds.
+ */
+void
+OpnPool::set_poll_spacing(uint32_t const spacing_ms)
+{
+    poll_config_.spacing_ms = spacing_ms;
+}
+
+/**
+ * @brief Sets the delay from a command to the poll that confirms its effect.
+ *
+ * @param[in] boost_after_ms Delay in milliseconds.
+ */
+void
+OpnPool::set_poll_boost_after(uint32_t const boost_after_ms)
+{
+    poll_config_.boost_after_ms = boost_after_ms;
+}
+
+/**
+ * @brief Sets the time that thermostat changes are collected before they are sent.
+ *
+ * @param[in] window_ms Coalescing window in milliseconds, 0 to send each change right away.
+ */
+void
+OpnPool::set_coalesce_window(uint32_t const window_ms)
+{
+    coalesce_window_ms_ = window_ms;
+}
+
+/**
+ * @brief Sets the pool volume, needed for the turnover time.
+ *
+ * @param[in] gallons Pool volume in gallons, 0 if unknown.
+ */
+void
+OpnPool::set_pool_volume(uint32_t const gallons)
+{
+    pool_volume_gal_ = gallons;
+    if (metrics_ != nullptr) {
+        metrics_->set_pool_volume(gallons);
+    }
+}
+
+/**
+ * @brief Enables or disables the history, must be called before setup().
+ *
+ * @param[in] enabled False to save its RAM.
+ */
+void
+OpnPool::set_history(bool const enabled)
+{
+    history_enabled_ = enabled;
+}
+
+void
 OpnPool::set_pool_climate(OpnPoolClimate * const climate)
 { 
     this->climates_[enum_index(poolstate_thermo_typ_t::POOL)] = climate; 
@@ -716,136 +1502,334 @@ OpnPool::set_feature4_switch(OpnPoolSwitch * const sw)
     this->switches_[enum_index(network_pool_circuit_t::FEATURE4)] = sw; 
 }
 
+/**
+ * @brief Stores a sensor and adds it to the entities updated from the pool state.
+ *
+ * @param[in] id The sensor entity ID.
+ * @param[in] s  The sensor, from the generated setup code.
+ */
+void
+OpnPool::add_sensor_(sensor_id_t const id, OpnPoolSensor * const s)
+{
+    this->sensors_[enum_index(id)] = s;
+    sensor_dispatch_.add(s, sensor_binding(id));
+}
+
+/**
+ * @brief Stores a binary sensor and adds it to the entities updated from the pool state.
+ *
+ * @param[in] id The binary sensor entity ID.
+ * @param[in] bs The binary sensor, from the generated setup code.
+ */
+void
+OpnPool::add_binary_sensor_(binary_sensor_id_t const id, OpnPoolBinarySensor * const bs)
+{
+    this->binary_sensors_[enum_index(id)] = bs;
+    binary_sensor_dispatch_.add(bs, binary_sensor_binding(id));
+}
+
+/**
+ * @brief Stores a text sensor and adds it to the entities updated from the pool state.
+ *
+ * @param[in] id The text sensor entity ID.
+ * @param[in] ts The text sensor, from the generated setup code.
+ */
+void
+OpnPool::add_text_sensor_(text_sensor_id_t const id, OpnPoolTextSensor * const ts)
+{
+    this->text_sensors_[enum_index(id)] = ts;
+    text_sensor_dispatch_.add(ts, text_sensor_binding(id));
+}
+
 void
 OpnPool::set_air_temperature_sensor(OpnPoolSensor * const s)
 { 
-    this->sensors_[enum_index(sensor_id_t::AIR_TEMPERATURE)] = s; 
+    this->add_sensor_(sensor_id_t::AIR_TEMPERATURE, s);
 }
 
 void
 OpnPool::set_water_temperature_sensor(OpnPoolSensor * const s)
 { 
-    this->sensors_[enum_index(sensor_id_t::WATER_TEMPERATURE)] = s; 
+    this->add_sensor_(sensor_id_t::WATER_TEMPERATURE, s);
 }
 
 void
 OpnPool::set_primary_pump_power_sensor(OpnPoolSensor * const s)
 { 
-    this->sensors_[enum_index(sensor_id_t::PRIMARY_PUMP_POWER)] = s; 
+    this->add_sensor_(sensor_id_t::PRIMARY_PUMP_POWER, s);
 }
 
 void
 OpnPool::set_primary_pump_flow_sensor(OpnPoolSensor * const s)
 { 
-    this->sensors_[enum_index(sensor_id_t::PRIMARY_PUMP_FLOW)] = s; 
+    this->add_sensor_(sensor_id_t::PRIMARY_PUMP_FLOW, s);
 }
 
 void
 OpnPool::set_primary_pump_speed_sensor(OpnPoolSensor * const s)
 { 
-    this->sensors_[enum_index(sensor_id_t::PRIMARY_PUMP_SPEED)] = s; 
+    this->add_sensor_(sensor_id_t::PRIMARY_PUMP_SPEED, s);
 }
 
 void
 OpnPool::set_primary_pump_error_sensor(OpnPoolSensor * const s)
 { 
-    this->sensors_[enum_index(sensor_id_t::PRIMARY_PUMP_ERROR)] = s; 
+    this->add_sensor_(sensor_id_t::PRIMARY_PUMP_ERROR, s);
 }
 
 void
 OpnPool::set_chlorinator_level_sensor(OpnPoolSensor * const s)
 { 
-    this->sensors_[enum_index(sensor_id_t::CHLORINATOR_LEVEL)] = s; 
+    this->add_sensor_(sensor_id_t::CHLORINATOR_LEVEL, s);
 }
 
 void
 OpnPool::set_chlorinator_salt_sensor(OpnPoolSensor * const s)
 { 
-    this->sensors_[enum_index(sensor_id_t::CHLORINATOR_SALT)] = s; 
+    this->add_sensor_(sensor_id_t::CHLORINATOR_SALT, s);
+}
+
+void
+OpnPool::set_time_to_full_state_sensor(OpnPoolSensor * const s)
+{ 
+    this->add_sensor_(sensor_id_t::TIME_TO_FULL_STATE, s);
+}
+
+void
+OpnPool::set_primary_pump_energy_sensor(OpnPoolSensor * const s)
+{ 
+    this->add_sensor_(sensor_id_t::PRIMARY_PUMP_ENERGY, s);
+}
+
+void
+OpnPool::set_primary_pump_volume_sensor(OpnPoolSensor * const s)
+{ 
+    this->add_sensor_(sensor_id_t::PRIMARY_PUMP_VOLUME, s);
+}
+
+void
+OpnPool::set_primary_pump_efficiency_sensor(OpnPoolSensor * const s)
+{ 
+    this->add_sensor_(sensor_id_t::PRIMARY_PUMP_EFFICIENCY, s);
+}
+
+void
+OpnPool::set_turnover_time_sensor(OpnPoolSensor * const s)
+{ 
+    this->add_sensor_(sensor_id_t::TURNOVER_TIME, s);
+}
+
+void
+OpnPool::set_heater_duty_cycle_sensor(OpnPoolSensor * const s)
+{ 
+    this->add_sensor_(sensor_id_t::HEATER_DUTY_CYCLE, s);
+}
+
+void
+OpnPool::set_pool_runtime_sensor(OpnPoolSensor * const s)
+{ 
+    this->add_sensor_(sensor_id_t::POOL_RUNTIME, s);
+}
+
+void
+OpnPool::set_spa_runtime_sensor(OpnPoolSensor * const s)
+{ 
+    this->add_sensor_(sensor_id_t::SPA_RUNTIME, s);
+}
+
+void
+OpnPool::set_water_temperature_min_sensor(OpnPoolSensor * const s)
+{ 
+    this->add_sensor_(sensor_id_t::WATER_TEMPERATURE_MIN, s);
+}
+
+void
+OpnPool::set_water_temperature_max_sensor(OpnPoolSensor * const s)
+{ 
+    this->add_sensor_(sensor_id_t::WATER_TEMPERATURE_MAX, s);
+}
+
+void
+OpnPool::set_primary_pump_energy_total_sensor(OpnPoolSensor * const s)
+{ 
+    this->add_sensor_(sensor_id_t::PRIMARY_PUMP_ENERGY_TOTAL, s);
+}
+
+void
+OpnPool::set_primary_pump_hours_sensor(OpnPoolSensor * const s)
+{ 
+    this->add_sensor_(sensor_id_t::PRIMARY_PUMP_HOURS, s);
+}
+
+void
+OpnPool::set_heater_hours_sensor(OpnPoolSensor * const s)
+{ 
+    this->add_sensor_(sensor_id_t::HEATER_HOURS, s);
+}
+
+void
+OpnPool::set_chlorinator_cell_hours_sensor(OpnPoolSensor * const s)
+{ 
+    this->add_sensor_(sensor_id_t::CHLORINATOR_CELL_HOURS, s);
 }
 
 void
 OpnPool::set_primary_pump_running_binary_sensor(OpnPoolBinarySensor * const bs)
 { 
-    this->binary_sensors_[enum_index(binary_sensor_id_t::PRIMARY_PUMP_POWER)] = bs; 
+    this->add_binary_sensor_(binary_sensor_id_t::PRIMARY_PUMP_POWER, bs);
 }
 
 void
 OpnPool::set_mode_service_binary_sensor(OpnPoolBinarySensor * const bs)
 { 
-    this->binary_sensors_[enum_index(binary_sensor_id_t::MODE_SERVICE)] = bs; 
+    this->add_binary_sensor_(binary_sensor_id_t::MODE_SERVICE, bs);
 }
 
 void
 OpnPool::set_mode_temperature_inc_binary_sensor(OpnPoolBinarySensor * const bs)
 { 
-    this->binary_sensors_[enum_index(binary_sensor_id_t::MODE_TEMPERATURE_INC)] = bs; 
+    this->add_binary_sensor_(binary_sensor_id_t::MODE_TEMPERATURE_INC, bs);
 }
 
 void
 OpnPool::set_mode_freeze_protection_binary_sensor(OpnPoolBinarySensor * const bs)
 { 
-    this->binary_sensors_[enum_index(binary_sensor_id_t::MODE_FREEZE_PROTECTION)] = bs; 
+    this->add_binary_sensor_(binary_sensor_id_t::MODE_FREEZE_PROTECTION, bs);
 }
 
 void
 OpnPool::set_mode_timeout_binary_sensor(OpnPoolBinarySensor * const bs)
 { 
-    this->binary_sensors_[enum_index(binary_sensor_id_t::MODE_TIMEOUT)] = bs; 
+    this->add_binary_sensor_(binary_sensor_id_t::MODE_TIMEOUT, bs);
+}
+
+void
+OpnPool::set_restored_state_binary_sensor(OpnPoolBinarySensor * const bs)
+{
+    this->add_binary_sensor_(binary_sensor_id_t::RESTORED_STATE, bs);
 }
 
 void
 OpnPool::set_pool_sched_text_sensor(OpnPoolTextSensor * const ts) 
 { 
-    this->text_sensors_[enum_index(text_sensor_id_t::POOL_SCHED)] = ts; 
+    this->add_text_sensor_(text_sensor_id_t::POOL_SCHED, ts);
 }
 
 void
 OpnPool::set_spa_sched_text_sensor(OpnPoolTextSensor * const ts)
 { 
-    this->text_sensors_[enum_index(text_sensor_id_t::SPA_SCHED)] = ts; 
+    this->add_text_sensor_(text_sensor_id_t::SPA_SCHED, ts);
 }
 
 void
 OpnPool::set_primary_pump_mode_text_sensor(OpnPoolTextSensor * const ts)
 { 
-    this->text_sensors_[enum_index(text_sensor_id_t::PRIMARY_PUMP_MODE)] = ts; 
+    this->add_text_sensor_(text_sensor_id_t::PRIMARY_PUMP_MODE, ts);
 }
 
 void
 OpnPool::set_primary_pump_state_text_sensor(OpnPoolTextSensor * const ts)
 { 
-    this->text_sensors_[enum_index(text_sensor_id_t::PRIMARY_PUMP_STATE)] = ts; 
+    this->add_text_sensor_(text_sensor_id_t::PRIMARY_PUMP_STATE, ts);
 }
 
 void
 OpnPool::set_chlorinator_name_text_sensor(OpnPoolTextSensor * const ts)
 { 
-    this->text_sensors_[enum_index(text_sensor_id_t::CHLORINATOR_NAME)] = ts; 
+    this->add_text_sensor_(text_sensor_id_t::CHLORINATOR_NAME, ts);
 }
 
 void
 OpnPool::set_chlorinator_status_text_sensor(OpnPoolTextSensor * const ts)
 { 
-    this->text_sensors_[enum_index(text_sensor_id_t::CHLORINATOR_STATUS)] = ts; 
+    this->add_text_sensor_(text_sensor_id_t::CHLORINATOR_STATUS, ts);
 }
 
 void
 OpnPool::set_system_time_text_sensor(OpnPoolTextSensor * const ts)
 { 
-    this->text_sensors_[enum_index(text_sensor_id_t::SYSTEM_TIME)] = ts;  
+    this->add_text_sensor_(text_sensor_id_t::SYSTEM_TIME, ts); 
 }
 
 void
 OpnPool::set_controller_type_text_sensor(OpnPoolTextSensor * const ts)
 { 
-    this->text_sensors_[enum_index(text_sensor_id_t::CONTROLLER_TYPE)] = ts; 
+    this->add_text_sensor_(text_sensor_id_t::CONTROLLER_TYPE, ts);
 }
 
 void
 OpnPool::set_interface_firmware_text_sensor(OpnPoolTextSensor * const ts)
 {
-    this->text_sensors_[enum_index(text_sensor_id_t::INTERFACE_FIRMWARE)] = ts;
+    this->add_text_sensor_(text_sensor_id_t::INTERFACE_FIRMWARE, ts);
+}
+
+/**
+ * @brief Adds a sensor of a pump in the `pumps:` list.
+ *
+ * @param[in] pump Index of the pump (datalink_pump_id_t).
+ * @param[in] id   Index of the sensor (pump_sensor_id_t).
+ * @param[in] s    The sensor, from the generated setup code.
+ */
+void
+OpnPool::set_pump_sensor(uint8_t const pump, uint8_t const id, OpnPoolSensor * const s)
+{
+    if (pump >= enum_count<datalink_pump_id_t>() || id >= enum_count<pump_sensor_id_t>()) {
+        ESP_LOGE(TAG, "Invalid pump %u sensor index: %u", pump, id);
+        return;
+    }
+    pumps_ |= 1U << pump;
+    pump_sensor_dispatch_.add(s, pump_sensor_read(static_cast<pump_sensor_id_t>(id)), pump);
+}
+
+/**
+ * @brief Adds a binary sensor of a pump in the `pumps:` list.
+ *
+ * @param[in] pump Index of the pump (datalink_pump_id_t).
+ * @param[in] id   Index of the binary sensor (pump_binary_sensor_id_t).
+ * @param[in] bs   The binary sensor, from the generated setup code.
+ */
+void
+OpnPool::set_pump_binary_sensor(uint8_t const pump, uint8_t const id, OpnPoolBinarySensor * const bs)
+{
+    if (pump >= enum_count<datalink_pump_id_t>() || id >= enum_count<pump_binary_sensor_id_t>()) {
+        ESP_LOGE(TAG, "Invalid pump %u binary sensor index: %u", pump, id);
+        return;
+    }
+    pumps_ |= 1U << pump;
+    pump_binary_sensor_dispatch_.add(bs, pump_binary_sensor_read(static_cast<pump_binary_sensor_id_t>(id)), pump);
+}
+
+/**
+ * @brief Adds a text sensor of a pump in the `pumps:` list.
+ *
+ * @param[in] pump Index of the pump (datalink_pump_id_t).
+ * @param[in] id   Index of the text sensor (pump_text_sensor_id_t).
+ * @param[in] ts   The text sensor, from the generated setup code.
+ */
+void
+OpnPool::set_pump_text_sensor(uint8_t const pump, uint8_t const id, OpnPoolTextSensor * const ts)
+{
+    if (pump >= enum_count<datalink_pump_id_t>() || id >= enum_count<pump_text_sensor_id_t>()) {
+        ESP_LOGE(TAG, "Invalid pump %u text sensor index: %u", pump, id);
+        return;
+    }
+    pumps_ |= 1U << pump;
+    pump_text_sensor_dispatch_.add(ts, pump_text_sensor_read(static_cast<pump_text_sensor_id_t>(id)), pump);
+}
+
+/**
+ * @brief Polls a pump for its status, in turn with the other polled pumps.
+ *
+ * @param[in] pump Index of the pump (datalink_pump_id_t).
+ */
+void
+OpnPool::set_pump_poll(uint8_t const pump)
+{
+    if (pump >= enum_count<datalink_pump_id_t>()) {
+        ESP_LOGE(TAG, "Invalid pump index: %u", pump);
+        return;
+    }
+    poll_config_.pumps |= 1U << pump;
 }
 
 #ifdef USE_MATTER
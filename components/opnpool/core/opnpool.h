@@ -23,9 +23,13 @@
 #include <esp_system.h>
 #include <esp_types.h>
 #include <esphome/core/component.h>
+#include <esphome/core/automation.h>
 
 #include "utils/enum_helpers.h"
 #include "opnpool_ids.h"
+#include "poolstate_ttl.h"
+#include "opnpool_dispatch.h"
+#include "pool_task/poll_sched.h"
 
 #ifdef USE_MATTER
 #include "matter/matter_bridge.h"
@@ -37,14 +41,22 @@ namespace opnpool {
 // Forward declarations (to avoid circular dependencies)
 struct ipc_t;
 struct poolstate_t;
+struct network_msg_t;
 struct pending_switch_t;
 struct pending_climate_t;
 class PoolState;
+class PoolStateSnapshot;
+class PoolStateHistory;
+class PoolStateMetrics;
+class PoolStateCounters;
+class PoolStateEvents;
 class OpnPoolClimate;
 class OpnPoolSwitch;
 class OpnPoolSensor;
 class OpnPoolBinarySensor;
 class OpnPoolTextSensor;
+enum class network_heat_src_t : uint8_t;
+enum class poolstate_event_src_t : uint8_t;
 
 /// @brief RS-485 GPIO pin configuration.
 struct rs485_pins_t {
@@ -53,6 +65,20 @@ struct rs485_pins_t {
     uint8_t rts_pin{23};  ///< Direction control (RTS) pin GPIO number.
 };
 
+/// @brief Set points and heat sources of both thermostats, as sent in a CTRL_HEAT_SET.
+struct heat_setting_t {
+    uint8_t            pool_set_point;  ///< Pool set point [°F].
+    uint8_t            spa_set_point;   ///< Spa set point [°F].
+    network_heat_src_t pool_heat_src;   ///< Pool heat source.
+    network_heat_src_t spa_heat_src;    ///< Spa heat source.
+};
+
+/// @brief Requested state of one circuit in a scene.
+struct scene_target_t {
+    switch_id_t id;     ///< Switch of the circuit.
+    bool        value;  ///< Requested state (true for ON, false for OFF).
+};
+
 /**
  * @brief Main OPNpool component for ESPHome.
  *
@@ -67,11 +93,29 @@ class OpnPool : public Component {
     void setup() override;      ///< Initializes IPC, spawns pool_task, publishes firmware version.
     void loop() override;       ///< Processes messages from pool_task, updates entities.
     void dump_config() override;///< Logs component configuration.
+    void on_shutdown() override;///< Checkpoints the pool state before reboot.
     ~OpnPool();                 ///< Cleans up resources.
 
     // ========== RS-485 Configuration ==========
     void set_rs485_pins(uint8_t rx_pin, uint8_t tx_pin, uint8_t rts_pin);
 
+    // ========== Staleness Configuration ==========
+    void set_stale_after(uint8_t subsys, uint32_t ttl_ms);
+
+    // ========== Poll Configuration ==========
+    void set_poll_every(uint8_t poll, uint32_t every_ms);
+    void set_poll_spacing(uint32_t spacing_ms);
+    void set_poll_boost_after(uint32_t boost_after_ms);
+
+    // ========== Command Coalescing ==========
+    void set_coalesce_window(uint32_t window_ms);
+
+    // ========== Derived Metrics ==========
+    void set_pool_volume(uint32_t gallons);
+
+    // ========== History ==========
+    void set_history(bool enabled);
+
     // ========== Climate Setters ==========
     void set_pool_climate(OpnPoolClimate * const climate);
     void set_spa_climate(OpnPoolClimate * const climate);
@@ -96,6 +140,20 @@ class OpnPool : public Component {
     void set_primary_pump_error_sensor(OpnPoolSensor * const s);
     void set_chlorinator_level_sensor(OpnPoolSensor * const s);
     void set_chlorinator_salt_sensor(OpnPoolSensor * const s);
+    void set_time_to_full_state_sensor(OpnPoolSensor * const s);
+    void set_primary_pump_energy_sensor(OpnPoolSensor * const s);
+    void set_primary_pump_volume_sensor(OpnPoolSensor * const s);
+    void set_primary_pump_efficiency_sensor(OpnPoolSensor * const s);
+    void set_turnover_time_sensor(OpnPoolSensor * const s);
+    void set_heater_duty_cycle_sensor(OpnPoolSensor * const s);
+    void set_pool_runtime_sensor(OpnPoolSensor * const s);
+    void set_spa_runtime_sensor(OpnPoolSensor * const s);
+    void set_water_temperature_min_sensor(OpnPoolSensor * const s);
+    void set_water_temperature_max_sensor(OpnPoolSensor * const s);
+    void set_primary_pump_energy_total_sensor(OpnPoolSensor * const s);
+    void set_primary_pump_hours_sensor(OpnPoolSensor * const s);
+    void set_heater_hours_sensor(OpnPoolSensor * const s);
+    void set_chlorinator_cell_hours_sensor(OpnPoolSensor * const s);
 
     // ========== Binary Sensor Setters ==========
     void set_primary_pump_running_binary_sensor(OpnPoolBinarySensor * const bs);
@@ -103,6 +161,7 @@ class OpnPool : public Component {
     void set_mode_temperature_inc_binary_sensor(OpnPoolBinarySensor * const bs);
     void set_mode_freeze_protection_binary_sensor(OpnPoolBinarySensor * const bs);
     void set_mode_timeout_binary_sensor(OpnPoolBinarySensor * const bs);
+    void set_restored_state_binary_sensor(OpnPoolBinarySensor * const bs);
 
     // ========== Text Sensor Setters ==========
     void set_pool_sched_text_sensor(OpnPoolTextSensor * const ts);
@@ -115,6 +174,12 @@ class OpnPool : public Component {
     void set_controller_type_text_sensor(OpnPoolTextSensor * const ts);
     void set_interface_firmware_text_sensor(OpnPoolTextSensor * const ts);
 
+    // ========== Pumps in the `pumps:` List ==========
+    void set_pump_sensor(uint8_t pump, uint8_t id, OpnPoolSensor * const s);
+    void set_pump_binary_sensor(uint8_t pump, uint8_t id, OpnPoolBinarySensor * const bs);
+    void set_pump_text_sensor(uint8_t pump, uint8_t id, OpnPoolTextSensor * const ts);
+    void set_pump_poll(uint8_t pump);
+
 #ifdef USE_MATTER
     // ========== Matter Configuration ==========
     void set_matter_config(uint16_t discriminator, uint32_t passcode);
@@ -136,17 +201,83 @@ class OpnPool : public Component {
     void update_analog_sensors(poolstate_t const * const state);
     void update_binary_sensors(poolstate_t const * const state);
     void update_all(poolstate_t const * const state);
+    void publish_unavailable(poolstate_subsys_t const subsys);
+    void command_failed(network_msg_t const * const msg);
+
+    // ========== Thermostat Commands ==========
+    [[nodiscard]] heat_setting_t const * get_pending_heat_set() const;
+    void queue_heat_set(heat_setting_t const * const setting);
+
+    // ========== Scenes ==========
+    esp_err_t apply_scene(scene_target_t const * const targets, uint8_t const count);
+
+    // ========== Event Log ==========
+    void note_command(network_msg_t const * const msg, poolstate_event_src_t const src);
+    void dump_events(uint32_t const last_min);
+
+    // ========== History ==========
+    void dump_history(uint32_t const last_min, uint32_t const bucket_min);
+
+    // ========== Diagnostics ==========
+    void dump_undecoded_frames(bool const clear);
 
     // ========== Accessors ==========
-    ipc_t *         get_ipc()              { return ipc_; }                 ///< Returns IPC structure pointer.
-    PoolState *     get_opnpool_state()    { return poolState_; }           ///< Returns pool state pointer.
-    OpnPoolSwitch * get_switch(uint8_t id) { return this->switches_[id]; }  ///< Returns switch by ID.
+    ipc_t *            get_ipc()              { return ipc_; }                 ///< Returns IPC structure pointer.
+    PoolState *        get_opnpool_state()    { return poolState_; }           ///< Returns pool state pointer.
+    PoolStateHistory * get_history()          { return history_; }             ///< Returns pool state history pointer.
+    OpnPoolSwitch *    get_switch(uint8_t id) { return this->switches_[id]; }  ///< Returns switch by ID.
     
   protected:
+    void add_sensor_(sensor_id_t const id, OpnPoolSensor * const s);
+    void add_binary_sensor_(binary_sensor_id_t const id, OpnPoolBinarySensor * const bs);
+    void add_text_sensor_(text_sensor_id_t const id, OpnPoolTextSensor * const ts);
+    void flush_heat_set_();
+    void check_scene_(poolstate_t const * const state);
+    void end_scene_(bool const applied, char const * const reason);
+    void publish_metrics_();
+    void publish_counters_();
+    void publish_restored_state_();
+
     rs485_pins_t rs485_pins_;                ///< RS-485 GPIO pin configuration.
+    poll_config_t poll_config_;              ///< Poll scheduler configuration.
     ipc_t * ipc_{nullptr};                   ///< IPC structure for task communication.
     PoolState * poolState_{nullptr};         ///< Pool state manager instance.
     TaskHandle_t pool_task_handle_{nullptr}; ///< FreeRTOS task handle for pool_task.
+    PoolStateTtl poolstate_ttl_;             ///< Per-subsystem staleness tracking.
+    PoolStateSnapshot * snapshot_{nullptr};  ///< Warm-start snapshot in NVS.
+    PoolStateHistory * history_{nullptr};    ///< Last 24 hours of key pool state values.
+    PoolStateMetrics * metrics_{nullptr};    ///< Metrics derived from the pool state.
+    PoolStateCounters * counters_{nullptr};  ///< Lifetime runtime and energy counters in flash.
+    PoolStateEvents * events_{nullptr};      ///< Log of state transitions in flash.
+    uint32_t pool_volume_gal_{0};            ///< Pool volume for the turnover time, 0 if unknown.
+    bool history_enabled_{true};             ///< Keep the history, at the cost of ~16 KB RAM.
+    bool publish_restored_{false};           ///< Publish the restored snapshot, if any, and its status on the next loop().
+    uint32_t setup_ms_{0};                   ///< Time at which setup() ran.
+    uint32_t time_to_complete_ms_{0};        ///< Time from setup() to a complete, fresh pool state.
+    poolstate_subsys_mask_t fresh_{0};       ///< Subsystems refreshed from the bus since boot.
+    poolstate_subsys_mask_t restored_{0};    ///< Subsystems restored from the snapshot, until confirmed or stale.
+    uint32_t coalesce_window_ms_{500};       ///< Time that thermostat changes are collected before sending them.
+    uint16_t pumps_{0};                      ///< Pumps with entities in the `pumps:` list, one bit per datalink_pump_id_t.
+
+    /// @brief Thermostat changes collected during the coalescing window.
+    struct heat_set_t {
+        bool           pending;   ///< True while the window is open.
+        uint32_t       due_ms;    ///< Time at which the window closes.
+        heat_setting_t setting;   ///< Settings to send, with all changes merged in.
+        uint32_t       requests;  ///< Thermostat changes from the climates.
+        uint32_t       sent;      ///< CTRL_HEAT_SET commands sent to the pool_task.
+    } heat_set_{};
+
+    /// @brief The circuits of the last scene, tracked until the controller confirms all of them.
+    struct scene_t {
+        bool     active;    ///< True while the controller hasn't confirmed all circuits.
+        uint16_t mask;      ///< Circuits that the scene changes, one bit per switch_id_t.
+        uint16_t values;    ///< Requested states of those circuits.
+        uint32_t start_ms;  ///< Time at which the scene was sent to the pool_task.
+        uint32_t applied;   ///< Scenes that the controller confirmed.
+        uint32_t failed;    ///< Scenes that weren't sent, or not confirmed in time.
+    } scene_{};
+    static_assert(enum_count<switch_id_t>() <= 16, "scene_t masks hold one bit per switch");
 
     // ========== Entity Arrays ==========
     OpnPoolClimate * climates_[enum_count<climate_id_t>()]{nullptr};              ///< Climate entity pointers.
@@ -155,6 +286,14 @@ class OpnPool : public Component {
     OpnPoolBinarySensor * binary_sensors_[enum_count<binary_sensor_id_t>()]{nullptr}; ///< Binary sensor pointers.
     OpnPoolTextSensor * text_sensors_[enum_count<text_sensor_id_t>()]{nullptr};   ///< Text sensor pointers.
 
+    // ========== Entities Updated from the Pool State ==========
+    EntityDispatch<OpnPoolSensor, sensor_id_t, sensor_read_t> sensor_dispatch_;                                ///< Configured sensors.
+    EntityDispatch<OpnPoolBinarySensor, binary_sensor_id_t, binary_sensor_read_t> binary_sensor_dispatch_;  ///< Configured binary sensors.
+    EntityDispatch<OpnPoolTextSensor, text_sensor_id_t, text_sensor_read_t> text_sensor_dispatch_;          ///< Configured text sensors.
+    PumpEntityDispatch<OpnPoolSensor, pump_sensor_id_t, pump_sensor_read_t> pump_sensor_dispatch_;                          ///< Sensors of the other pumps.
+    PumpEntityDispatch<OpnPoolBinarySensor, pump_binary_sensor_id_t, pump_binary_sensor_read_t> pump_binary_sensor_dispatch_;  ///< Binary sensors of the other pumps.
+    PumpEntityDispatch<OpnPoolTextSensor, pump_text_sensor_id_t, pump_text_sensor_read_t> pump_text_sensor_dispatch_;          ///< Text sensors of the other pumps.
+
 #ifdef USE_MATTER
     // ========== Matter Integration ==========
     matter::MatterBridge * matter_bridge_{nullptr};  ///< Matter bridge instance.
@@ -162,6 +301,69 @@ class OpnPool : public Component {
 #endif
 };
 
+/**
+ * @brief Action `opnpool.dump_undecoded_frames`, logs the frames the network layer couldn't decode.
+ */
+template<typename... Ts>
+class DumpUndecodedFramesAction : public Action<Ts...>, public Parented<OpnPool> {
+
+  public:
+    void set_clear(bool const clear) { clear_ = clear; }
+    void play(Ts... /*x*/) override { this->parent_->dump_undecoded_frames(clear_); }
+
+  protected:
+    bool clear_{false};  ///< Empty the capture ring afterwards.
+};
+
+/**
+ * @brief Action `opnpool.dump_events`, logs the state transitions of the last so many minutes.
+ */
+template<typename... Ts>
+class DumpEventsAction : public Action<Ts...>, public Parented<OpnPool> {
+
+  public:
+    void set_last(uint32_t const last_min) { last_min_ = last_min; }
+    void play(Ts... /*x*/) override { this->parent_->dump_events(last_min_); }
+
+  protected:
+    uint32_t last_min_{0};  ///< Minutes to go back, 0 for all events.
+};
+
+/**
+ * @brief Action `opnpool.dump_history`, logs the history of the last so many minutes per bucket.
+ */
+template<typename... Ts>
+class DumpHistoryAction : public Action<Ts...>, public Parented<OpnPool> {
+
+  public:
+    void set_last(uint32_t const last_min) { last_min_ = last_min; }
+    void set_bucket(uint32_t const bucket_min) { bucket_min_ = bucket_min; }
+    void play(Ts... /*x*/) override { this->parent_->dump_history(last_min_, bucket_min_); }
+
+  protected:
+    uint32_t last_min_{0};     ///< Minutes to go back, 0 for all samples held.
+    uint32_t bucket_min_{60};  ///< Minutes per bucket.
+};
+
+/**
+ * @brief Action `opnpool.apply_scene`, sets several circuits in one transmit window.
+ */
+template<typename... Ts>
+class ApplySceneAction : public Action<Ts...>, public Parented<OpnPool> {
+
+  public:
+    void add_target(uint8_t const id, bool const value) {
+        if (count_ < enum_count<switch_id_t>()) {
+            targets_[count_++] = {static_cast<switch_id_t>(id), value};
+        }
+    }
+    void play(Ts... /*x*/) override { (void)this->parent_->apply_scene(targets_, count_); }
+
+  protected:
+    scene_target_t targets_[enum_count<switch_id_t>()]{};  ///< Requested circuit states.
+    uint8_t        count_{0};                              ///< Number of targets in use.
+};
+
 } // namespace opnpool
 } // namespace esphome
 
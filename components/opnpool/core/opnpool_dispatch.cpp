@@ -0,0 +1,374 @@
+/**
+ * @file opnpool_dispatch.cpp
+ * @brief Dispatch of pool state changes to the configured sensor entities.
+ *
+ * @details
+ * Implements the functions that read each entity value from poolstate_t, and the
+ * binding tables that tie them to the entity IDs. The tables are checked at compile
+ * time, so they stay in the order of the ID enums that __init__.py generates.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <esp_system.h>
+#include <esp_types.h>
+#include <cmath>
+#include <cstdio>
+
+#include "opnpool_dispatch.h"
+#include "poolstate.h"
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wunused-parameter"
+
+namespace esphome {
+namespace opnpool {
+
+    // copies a valid value wrapper (.valid and .value members) to *value
+template<typename ValueT, typename OutT>
+static inline bool
+_read(ValueT const & base, OutT * const value)
+{
+    if (!base.valid) {
+        return false;
+    }
+    *value = static_cast<OutT>(base.value);
+    return true;
+}
+
+static inline poolstate_pump_t const *
+_primary_pump(poolstate_t const * const state)
+{
+    return &state->pumps[enum_index(datalink_pump_id_t::PRIMARY)];
+}
+
+    // reads a value of the primary pump, with the reader that the pumps in the `pumps:` list use
+template<typename OutT, bool (*READ)(poolstate_pump_t const *, OutT *)>
+static bool
+_read_primary(poolstate_t const * const state, OutT * const value)
+{
+    return READ(_primary_pump(state), value);
+}
+
+template<char const * (*READ)(poolstate_pump_t const *)>
+static char const *
+_read_primary_text(poolstate_t const * const state, char * const /*buf*/, size_t const /*size*/)
+{
+    return READ(_primary_pump(state));
+}
+
+// ============================================================================
+// Analog sensors
+// ============================================================================
+
+    // temperatures are published in Fahrenheit, rounded to 0.1
+static bool
+_read_temp(poolstate_t const * const state, poolstate_temp_typ_t const typ, float * const value)
+{
+    auto const temp = state->temps[enum_index(typ)];
+    if (!temp.valid) {
+        return false;
+    }
+    *value = std::round(temp.value * 10.0f) / 10.0f;
+    return true;
+}
+
+static bool
+_read_air_temp(poolstate_t const * const state, float * const value)
+{
+    return _read_temp(state, poolstate_temp_typ_t::AIR, value);
+}
+
+static bool
+_read_water_temp(poolstate_t const * const state, float * const value)
+{
+    return _read_temp(state, poolstate_temp_typ_t::WATER, value);
+}
+
+static bool
+_read_pump_power(poolstate_pump_t const * const pump, float * const value)
+{
+    return _read(pump->power, value);
+}
+
+static bool
+_read_pump_flow(poolstate_pump_t const * const pump, float * const value)
+{
+    return _read(pump->flow, value);
+}
+
+static bool
+_read_pump_speed(poolstate_pump_t const * const pump, float * const value)
+{
+    return _read(pump->speed, value);
+}
+
+static bool
+_read_pump_error(poolstate_pump_t const * const pump, float * const value)
+{
+    return _read(pump->error, value);
+}
+
+static bool
+_read_chlor_level(poolstate_t const * const state, float * const value)
+{
+    return _read(state->chlor.level, value);
+}
+
+static bool
+_read_chlor_salt(poolstate_t const * const state, float * const value)
+{
+    return _read(state->chlor.salt, value);
+}
+
+    // MUST be in the order of sensor_id_t
+constexpr sensor_binding_t _sensor_bindings[] = {
+    {sensor_id_t::AIR_TEMPERATURE,           poolstate_subsys_t::TEMPS,        _read_air_temp},
+    {sensor_id_t::WATER_TEMPERATURE,         poolstate_subsys_t::TEMPS,        _read_water_temp},
+    {sensor_id_t::PRIMARY_PUMP_POWER,        poolstate_subsys_t::PRIMARY_PUMP, _read_primary<float, _read_pump_power>},
+    {sensor_id_t::PRIMARY_PUMP_FLOW,         poolstate_subsys_t::PRIMARY_PUMP, _read_primary<float, _read_pump_flow>},
+    {sensor_id_t::PRIMARY_PUMP_SPEED,        poolstate_subsys_t::PRIMARY_PUMP, _read_primary<float, _read_pump_speed>},
+    {sensor_id_t::CHLORINATOR_LEVEL,         poolstate_subsys_t::CHLOR,        _read_chlor_level},
+    {sensor_id_t::CHLORINATOR_SALT,          poolstate_subsys_t::CHLOR,        _read_chlor_salt},
+    {sensor_id_t::PRIMARY_PUMP_ERROR,        poolstate_subsys_t::PRIMARY_PUMP, _read_primary<float, _read_pump_error>},
+    {sensor_id_t::TIME_TO_FULL_STATE,        poolstate_subsys_t::SYSTEM,       nullptr},  // published by OpnPool::loop()
+        // published by OpnPool::loop() from the metrics
+    {sensor_id_t::PRIMARY_PUMP_ENERGY,       poolstate_subsys_t::PRIMARY_PUMP, nullptr},
+    {sensor_id_t::PRIMARY_PUMP_VOLUME,       poolstate_subsys_t::PRIMARY_PUMP, nullptr},
+    {sensor_id_t::PRIMARY_PUMP_EFFICIENCY,   poolstate_subsys_t::PRIMARY_PUMP, nullptr},
+    {sensor_id_t::TURNOVER_TIME,             poolstate_subsys_t::PRIMARY_PUMP, nullptr},
+    {sensor_id_t::HEATER_DUTY_CYCLE,         poolstate_subsys_t::THERMOS,      nullptr},
+    {sensor_id_t::POOL_RUNTIME,              poolstate_subsys_t::CIRCUITS,     nullptr},
+    {sensor_id_t::SPA_RUNTIME,               poolstate_subsys_t::CIRCUITS,     nullptr},
+    {sensor_id_t::WATER_TEMPERATURE_MIN,     poolstate_subsys_t::TEMPS,        nullptr},
+    {sensor_id_t::WATER_TEMPERATURE_MAX,     poolstate_subsys_t::TEMPS,        nullptr},
+        // published by OpnPool::loop() from the lifetime counters
+    {sensor_id_t::PRIMARY_PUMP_ENERGY_TOTAL, poolstate_subsys_t::PRIMARY_PUMP, nullptr},
+    {sensor_id_t::PRIMARY_PUMP_HOURS,        poolstate_subsys_t::PRIMARY_PUMP, nullptr},
+    {sensor_id_t::HEATER_HOURS,              poolstate_subsys_t::THERMOS,      nullptr},
+    {sensor_id_t::CHLORINATOR_CELL_HOURS,    poolstate_subsys_t::CHLOR,        nullptr},
+};
+
+// ============================================================================
+// Binary sensors
+// ============================================================================
+
+static bool
+_read_pump_running(poolstate_pump_t const * const pump, bool * const value)
+{
+    return _read(pump->running, value);
+}
+
+    // reads one of the controller mode flags
+template<bool (network_ctrl_modes_t::*IS_MODE)() const>
+static bool
+_read_mode(poolstate_t const * const state, bool * const value)
+{
+    auto const modes = state->system.modes;
+    if (!modes.valid) {
+        return false;
+    }
+    *value = (modes.value.*IS_MODE)();
+    return true;
+}
+
+    // MUST be in the order of binary_sensor_id_t
+constexpr binary_sensor_binding_t _binary_sensor_bindings[] = {
+    {binary_sensor_id_t::PRIMARY_PUMP_POWER,     poolstate_subsys_t::PRIMARY_PUMP, _read_primary<bool, _read_pump_running>},
+    {binary_sensor_id_t::MODE_SERVICE,           poolstate_subsys_t::SYSTEM,       _read_mode<&network_ctrl_modes_t::is_service_mode>},
+    {binary_sensor_id_t::MODE_TEMPERATURE_INC,   poolstate_subsys_t::SYSTEM,       _read_mode<&network_ctrl_modes_t::is_temp_increase_mode>},
+    {binary_sensor_id_t::MODE_FREEZE_PROTECTION, poolstate_subsys_t::SYSTEM,       _read_mode<&network_ctrl_modes_t::is_freeze_protection_mode>},
+    {binary_sensor_id_t::MODE_TIMEOUT,           poolstate_subsys_t::SYSTEM,       _read_mode<&network_ctrl_modes_t::is_timeout_mode>},
+    {binary_sensor_id_t::RESTORED_STATE,         poolstate_subsys_t::SYSTEM,       nullptr},  // published by OpnPool::loop()
+};
+
+// ============================================================================
+// Text sensors
+// ============================================================================
+
+    // schedule as "HH:MM-HH:MM"
+static char const *
+_read_sched(poolstate_t const * const state, network_pool_circuit_t const circuit, char * const buf, size_t const size)
+{
+    auto const sched = &state->scheds[enum_index(circuit)];
+    if (!sched->valid) {
+        return nullptr;
+    }
+    snprintf(buf, size, "%02d:%02d-%02d:%02d",
+             sched->start / 60, sched->start % 60,
+             sched->stop / 60, sched->stop % 60);
+    return buf;
+}
+
+static char const *
+_read_pool_sched(poolstate_t const * const state, char * const buf, size_t const size)
+{
+    return _read_sched(state, network_pool_circuit_t::POOL, buf, size);
+}
+
+static char const *
+_read_spa_sched(poolstate_t const * const state, char * const buf, size_t const size)
+{
+    return _read_sched(state, network_pool_circuit_t::SPA, buf, size);
+}
+
+static char const *
+_read_pump_mode(poolstate_pump_t const * const pump)
+{
+    auto const mode = pump->mode;
+    return mode.valid ? mode.value.to_str() : nullptr;
+}
+
+static char const *
+_read_pump_state(poolstate_pump_t const * const pump)
+{
+    auto const pump_state = pump->state;
+    return pump_state.valid ? enum_str(pump_state.value) : nullptr;
+}
+
+static char const *
+_read_chlor_name(poolstate_t const * const state, char * const /*buf*/, size_t const /*size*/)
+{
+    return state->chlor.name.valid ? state->chlor.name.value : nullptr;
+}
+
+static char const *
+_read_chlor_status(poolstate_t const * const state, char * const /*buf*/, size_t const /*size*/)
+{
+    auto const status = state->chlor.status;
+    return status.valid ? enum_str(status.value) : nullptr;
+}
+
+    // date and time as "2026-01-15 22:43", or only the time if the date isn't known
+static char const *
+_read_system_time(poolstate_t const * const state, char * const buf, size_t const size)
+{
+    auto const tod = &state->system.tod;
+    if (!tod->time.valid) {
+        return nullptr;
+    }
+    if (tod->date.valid) {
+        snprintf(buf, size, "%04d-%02d-%02d %02d:%02d",
+                 2000 + tod->date.value.year, tod->date.value.month, tod->date.value.day,
+                 tod->time.value.hour, tod->time.value.minute);
+    } else {
+        snprintf(buf, size, "%02d:%02d", tod->time.value.hour, tod->time.value.minute);
+    }
+    return buf;
+}
+
+    // controller address and firmware version, e.g. "CTRL 2.80"
+static char const *
+_read_controller_type(poolstate_t const * const state, char * const buf, size_t const size)
+{
+    auto const system = &state->system;
+    if (!system->addr.valid || !system->version.valid) {
+        return nullptr;
+    }
+    snprintf(buf, size, "%s %d.%d", system->addr.value.to_str(), system->version.major, system->version.minor);
+    return buf;
+}
+
+    // MUST be in the order of text_sensor_id_t
+constexpr text_sensor_binding_t _text_sensor_bindings[] = {
+    {text_sensor_id_t::POOL_SCHED,         poolstate_subsys_t::SCHEDS,       _read_pool_sched},
+    {text_sensor_id_t::SPA_SCHED,          poolstate_subsys_t::SCHEDS,       _read_spa_sched},
+    {text_sensor_id_t::PRIMARY_PUMP_MODE,  poolstate_subsys_t::PRIMARY_PUMP, _read_primary_text<_read_pump_mode>},
+    {text_sensor_id_t::PRIMARY_PUMP_STATE, poolstate_subsys_t::PRIMARY_PUMP, _read_primary_text<_read_pump_state>},
+    {text_sensor_id_t::CHLORINATOR_NAME,   poolstate_subsys_t::CHLOR,        _read_chlor_name},
+    {text_sensor_id_t::CHLORINATOR_STATUS, poolstate_subsys_t::CHLOR,        _read_chlor_status},
+    {text_sensor_id_t::SYSTEM_TIME,        poolstate_subsys_t::SYSTEM,       _read_system_time},
+    {text_sensor_id_t::CONTROLLER_TYPE,    poolstate_subsys_t::SYSTEM,       _read_controller_type},
+    {text_sensor_id_t::INTERFACE_FIRMWARE, poolstate_subsys_t::SYSTEM,       nullptr},  // published by OpnPool::setup()
+};
+
+// ============================================================================
+// Pumps in the `pumps:` list
+// ============================================================================
+
+    // MUST be in the order of pump_sensor_id_t
+constexpr pump_sensor_read_t _pump_sensor_reads[] = {
+    _read_pump_power,
+    _read_pump_flow,
+    _read_pump_speed,
+    _read_pump_error,
+};
+
+    // MUST be in the order of pump_binary_sensor_id_t
+constexpr pump_binary_sensor_read_t _pump_binary_sensor_reads[] = {
+    _read_pump_running,
+};
+
+    // MUST be in the order of pump_text_sensor_id_t
+constexpr pump_text_sensor_read_t _pump_text_sensor_reads[] = {
+    _read_pump_mode,
+    _read_pump_state,
+};
+
+static_assert(sizeof(_pump_sensor_reads) / sizeof(_pump_sensor_reads[0]) == enum_count<pump_sensor_id_t>(),
+              "_pump_sensor_reads must follow pump_sensor_id_t");
+static_assert(sizeof(_pump_binary_sensor_reads) / sizeof(_pump_binary_sensor_reads[0]) == enum_count<pump_binary_sensor_id_t>(),
+              "_pump_binary_sensor_reads must follow pump_binary_sensor_id_t");
+static_assert(sizeof(_pump_text_sensor_reads) / sizeof(_pump_text_sensor_reads[0]) == enum_count<pump_text_sensor_id_t>(),
+              "_pump_text_sensor_reads must follow pump_text_sensor_id_t");
+
+    // true if each binding sits at the index of its ID, and every ID has one
+template<typename BindingT, size_t N>
+static constexpr bool
+_in_id_order(BindingT const (&bindings)[N])
+{
+    if (N != enum_count<decltype(bindings[0].id)>()) {
+        return false;
+    }
+    for (size_t idx = 0; idx < N; idx++) {
+        if (enum_index(bindings[idx].id) != idx) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(_in_id_order(_sensor_bindings), "_sensor_bindings must follow sensor_id_t");
+static_assert(_in_id_order(_binary_sensor_bindings), "_binary_sensor_bindings must follow binary_sensor_id_t");
+static_assert(_in_id_order(_text_sensor_bindings), "_text_sensor_bindings must follow text_sensor_id_t");
+
+sensor_binding_t const &
+sensor_binding(sensor_id_t const id)
+{
+    return _sensor_bindings[enum_index(id)];
+}
+
+binary_sensor_binding_t const &
+binary_sensor_binding(binary_sensor_id_t const id)
+{
+    return _binary_sensor_bindings[enum_index(id)];
+}
+
+text_sensor_binding_t const &
+text_sensor_binding(text_sensor_id_t const id)
+{
+    return _text_sensor_bindings[enum_index(id)];
+}
+
+pump_sensor_read_t
+pump_sensor_read(pump_sensor_id_t const id)
+{
+    return _pump_sensor_reads[enum_index(id)];
+}
+
+pump_binary_sensor_read_t
+pump_binary_sensor_read(pump_binary_sensor_id_t const id)
+{
+    return _pump_binary_sensor_reads[enum_index(id)];
+}
+
+pump_text_sensor_read_t
+pump_text_sensor_read(pump_text_sensor_id_t const id)
+{
+    return _pump_text_sensor_reads[enum_index(id)];
+}
+
+}  // namespace opnpool
+}  // namespace esphome
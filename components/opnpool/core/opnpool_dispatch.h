@@ -0,0 +1,180 @@
+/**
+ * @file opnpool_dispatch.h
+ * @brief Dispatch of pool state changes to the configured sensor entities.
+ *
+ * @details
+ * Each sensor, binary sensor and text sensor ID has a binding: the pool state subsystem
+ * its value belongs to, and a function that reads the value from poolstate_t. The
+ * bindings are constant tables, indexed by entity ID.
+ *
+ * The code generated from the YAML configuration only calls the OpnPool setters for the
+ * entities that are configured. Each setter appends the entity and its binding to an
+ * EntityDispatch list, so updating the entities and marking them unavailable only
+ * visits the entities that the site uses, without checking for missing ones.
+ *
+ * The entities of the pumps in the `pumps:` list share one set of readers, that take the
+ * pump instead of the whole pool state. A PumpEntityDispatch list holds them, with the
+ * index of their pump.
+ *
+ * Intended for use in the single-threaded ESPHome main task.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+#ifndef __cplusplus
+# error "Requires C++ compilation"
+#endif
+
+#include <esp_system.h>
+#include <esp_types.h>
+
+#include "utils/enum_helpers.h"
+#include "opnpool_ids.h"
+#include "poolstate_ttl.h"
+#include "pool_task/datalink.h"
+
+namespace esphome {
+namespace opnpool {
+
+    // forward declarations (to avoid circular dependencies)
+struct poolstate_t;
+struct poolstate_pump_t;
+
+/// @brief Reads an analog sensor value, returns false if it isn't valid.
+using sensor_read_t = bool (*)(poolstate_t const * state, float * value);
+
+/// @brief Reads a binary sensor value, returns false if it isn't valid.
+using binary_sensor_read_t = bool (*)(poolstate_t const * state, bool * value);
+
+/// @brief Returns a text sensor value, formatted in buf if needed, or nullptr if it isn't valid.
+using text_sensor_read_t = char const * (*)(poolstate_t const * state, char * buf, size_t size);
+
+/// @brief Size of the buffer that a text_sensor_read_t formats into.
+constexpr size_t TEXT_SENSOR_READ_SIZE = 24;
+
+/// @brief Reads an analog value of a pump, returns false if it isn't valid.
+using pump_sensor_read_t = bool (*)(poolstate_pump_t const * pump, float * value);
+
+/// @brief Reads a binary value of a pump, returns false if it isn't valid.
+using pump_binary_sensor_read_t = bool (*)(poolstate_pump_t const * pump, bool * value);
+
+/// @brief Returns a text value of a pump, or nullptr if it isn't valid.
+using pump_text_sensor_read_t = char const * (*)(poolstate_pump_t const * pump);
+
+/**
+ * @brief Where the value of an entity comes from.
+ *
+ * @tparam IdT   Entity ID type.
+ * @tparam ReadT Function that reads the value from the pool state.
+ */
+template<typename IdT, typename ReadT>
+struct entity_binding_t {
+    IdT                id;      ///< Entity ID, equal to the index in its table.
+    poolstate_subsys_t subsys;  ///< Subsystem whose staleness makes the entity unavailable.
+    ReadT              read;    ///< Reads the value, or nullptr if it isn't part of the pool state.
+};
+
+using sensor_binding_t        = entity_binding_t<sensor_id_t, sensor_read_t>;
+using binary_sensor_binding_t = entity_binding_t<binary_sensor_id_t, binary_sensor_read_t>;
+using text_sensor_binding_t   = entity_binding_t<text_sensor_id_t, text_sensor_read_t>;
+
+[[nodiscard]] sensor_binding_t const &        sensor_binding(sensor_id_t const id);
+[[nodiscard]] binary_sensor_binding_t const & binary_sensor_binding(binary_sensor_id_t const id);
+[[nodiscard]] text_sensor_binding_t const &   text_sensor_binding(text_sensor_id_t const id);
+
+[[nodiscard]] pump_sensor_read_t        pump_sensor_read(pump_sensor_id_t const id);
+[[nodiscard]] pump_binary_sensor_read_t pump_binary_sensor_read(pump_binary_sensor_id_t const id);
+[[nodiscard]] pump_text_sensor_read_t   pump_text_sensor_read(pump_text_sensor_id_t const id);
+
+/**
+ * @brief The configured entities of one kind that are updated from the pool state.
+ *
+ * @tparam EntityT Entity class (e.g. OpnPoolSensor).
+ * @tparam IdT     Entity ID type.
+ * @tparam ReadT   Function that reads the value from the pool state.
+ */
+template<typename EntityT, typename IdT, typename ReadT>
+class EntityDispatch {
+  public:
+    /// @brief A configured entity and how to read its value.
+    struct slot_t {
+        EntityT *          entity;  ///< The entity.
+        ReadT              read;    ///< Reads its value from the pool state.
+        poolstate_subsys_t subsys;  ///< Subsystem whose staleness makes it unavailable.
+    };
+
+    /**
+     * @brief Adds an entity, unless its value isn't part of the pool state.
+     *
+     * @param[in] entity  The entity, from the generated setup code.
+     * @param[in] binding Binding of the entity's ID.
+     */
+    void add(EntityT * const entity, entity_binding_t<IdT, ReadT> const & binding) {
+        if (entity != nullptr && binding.read != nullptr && count_ < enum_count<IdT>()) {
+            slots_[count_++] = {
+                .entity = entity,
+                .read = binding.read,
+                .subsys = binding.subsys
+            };
+        }
+    }
+
+    slot_t const * begin() const { return slots_; }
+    slot_t const * end() const { return slots_ + count_; }
+
+  protected:
+    slot_t  slots_[enum_count<IdT>()]{};  ///< Entities in the order they were configured.
+    uint8_t count_{0};                    ///< Number of slots in use.
+};
+
+/**
+ * @brief The configured entities of one kind of the pumps in the `pumps:` list.
+ *
+ * @tparam EntityT Entity class (e.g. OpnPoolSensor).
+ * @tparam IdT     Entity ID type (e.g. pump_sensor_id_t).
+ * @tparam ReadT   Function that reads the value from the pump.
+ */
+template<typename EntityT, typename IdT, typename ReadT>
+class PumpEntityDispatch {
+  public:
+    /// @brief A configured entity, its pump, and how to read its value.
+    struct slot_t {
+        EntityT *          entity;    ///< The entity.
+        ReadT              read;      ///< Reads its value from the pump.
+        uint8_t            pump_idx;  ///< Index of the pump in poolstate_t::pumps.
+        poolstate_subsys_t subsys;    ///< Subsystem of that pump.
+    };
+
+    /**
+     * @brief Adds an entity of a pump.
+     *
+     * @param[in] entity   The entity, from the generated setup code.
+     * @param[in] read     Reads its value from the pump.
+     * @param[in] pump_idx Index of the pump in poolstate_t::pumps.
+     */
+    void add(EntityT * const entity, ReadT const read, uint8_t const pump_idx) {
+        if (entity != nullptr && read != nullptr && pump_idx < enum_count<datalink_pump_id_t>() &&
+            count_ < sizeof(slots_) / sizeof(slots_[0])) {
+            slots_[count_++] = {
+                .entity = entity,
+                .read = read,
+                .pump_idx = pump_idx,
+                .subsys = poolstate_ttl::pump_subsys(pump_idx)
+            };
+        }
+    }
+
+    slot_t const * begin() const { return slots_; }
+    slot_t const * end() const { return slots_ + count_; }
+
+  protected:
+        // the primary pump has its own entities, so the list holds up to 15 pumps
+    slot_t  slots_[(enum_count<datalink_pump_id_t>() - 1) * enum_count<IdT>()]{};  ///< Entities in the order they were configured.
+    uint8_t count_{0};                                                              ///< Number of slots in use.
+};
+
+}  // namespace opnpool
+}  // namespace esphome
@@ -51,14 +51,28 @@ enum class switch_id_t : uint8_t {
 
     /// @brief Sensor entity identifiers for pool measurements.
 enum class sensor_id_t : uint8_t {
-    AIR_TEMPERATURE    = 0,  ///< Ambient air temperature sensor.
-    WATER_TEMPERATURE  = 1,  ///< Pool/spa water temperature sensor.
-    PRIMARY_PUMP_POWER = 2,  ///< Primary pump power consumption sensor.
-    PRIMARY_PUMP_FLOW  = 3,  ///< Primary pump flow rate sensor.
-    PRIMARY_PUMP_SPEED = 4,  ///< Primary pump speed (RPM) sensor.
-    CHLORINATOR_LEVEL  = 5,  ///< Chlorinator output level sensor.
-    CHLORINATOR_SALT   = 6,  ///< Chlorinator salt level sensor.
-    PRIMARY_PUMP_ERROR = 7   ///< Primary pump error code sensor.
+    AIR_TEMPERATURE           = 0,   ///< Ambient air temperature sensor.
+    WATER_TEMPERATURE         = 1,   ///< Pool/spa water temperature sensor.
+    PRIMARY_PUMP_POWER        = 2,   ///< Primary pump power consumption sensor.
+    PRIMARY_PUMP_FLOW         = 3,   ///< Primary pump flow rate sensor.
+    PRIMARY_PUMP_SPEED        = 4,   ///< Primary pump speed (RPM) sensor.
+    CHLORINATOR_LEVEL         = 5,   ///< Chlorinator output level sensor.
+    CHLORINATOR_SALT          = 6,   ///< Chlorinator salt level sensor.
+    PRIMARY_PUMP_ERROR        = 7,   ///< Primary pump error code sensor.
+    TIME_TO_FULL_STATE        = 8,   ///< Time from boot to a complete pool state (diagnostic).
+    PRIMARY_PUMP_ENERGY       = 9,   ///< Primary pump energy over the last 24 hours.
+    PRIMARY_PUMP_VOLUME       = 10,  ///< Water moved by the primary pump over the last 24 hours.
+    PRIMARY_PUMP_EFFICIENCY   = 11,  ///< Primary pump power per flow while it runs.
+    TURNOVER_TIME             = 12,  ///< Time to move the pool volume at the average flow.
+    HEATER_DUTY_CYCLE         = 13,  ///< Part of the last 24 hours that a heater was heating.
+    POOL_RUNTIME              = 14,  ///< Pool circuit runtime over the last 24 hours.
+    SPA_RUNTIME               = 15,  ///< Spa circuit runtime over the last 24 hours.
+    WATER_TEMPERATURE_MIN     = 16,  ///< Lowest water temperature over the last 24 hours.
+    WATER_TEMPERATURE_MAX     = 17,  ///< Highest water temperature over the last 24 hours.
+    PRIMARY_PUMP_ENERGY_TOTAL = 18,  ///< Primary pump energy since installation.
+    PRIMARY_PUMP_HOURS        = 19,  ///< Primary pump runtime since installation.
+    HEATER_HOURS              = 20,  ///< Heater on-time since installation.
+    CHLORINATOR_CELL_HOURS    = 21   ///< Chlorinator cell time since installation.
 };
 
     /// @brief Binary sensor entity identifiers for pool status indicators.
@@ -67,7 +81,8 @@ enum class binary_sensor_id_t : uint8_t {
     MODE_SERVICE           = 1,  ///< Service mode active indicator.
     MODE_TEMPERATURE_INC   = 2,  ///< Temperature increase mode indicator.
     MODE_FREEZE_PROTECTION = 3,  ///< Freeze protection mode active indicator.
-    MODE_TIMEOUT           = 4   ///< Timeout mode active indicator.
+    MODE_TIMEOUT           = 4,  ///< Timeout mode active indicator.
+    RESTORED_STATE         = 5   ///< Restored snapshot not yet confirmed by the bus.
 };
 
     /// @brief Text sensor entity identifiers for pool status strings.
@@ -83,6 +98,25 @@ enum class text_sensor_id_t : uint8_t {
     INTERFACE_FIRMWARE  = 8   ///< Interface board firmware version.
 };
 
+    /// @brief Sensor identifiers of each pump in the `pumps:` list.
+enum class pump_sensor_id_t : uint8_t {
+    POWER = 0,  ///< Power consumption.
+    FLOW  = 1,  ///< Flow rate.
+    SPEED = 2,  ///< Speed (RPM).
+    ERROR = 3   ///< Error code.
+};
+
+    /// @brief Binary sensor identifiers of each pump in the `pumps:` list.
+enum class pump_binary_sensor_id_t : uint8_t {
+    RUNNING = 0  ///< Running status.
+};
+
+    /// @brief Text sensor identifiers of each pump in the `pumps:` list.
+enum class pump_text_sensor_id_t : uint8_t {
+    MODE  = 0,  ///< Operating mode.
+    STATE = 1   ///< State description.
+};
+
 /**
  * @brief Converts a climate entity ID to the corresponding thermostat type.
  *
@@ -33,17 +33,10 @@
 #include <esp_types.h>
 #include <freertos/FreeRTOS.h>
 
-#if defined(MAGIC_ENUM_RANGE_MIN)
-# undef MAGIC_ENUM_RANGE_MIN
-#endif
-#if defined(MAGIC_ENUM_RANGE_MAX)
-# undef MAGIC_ENUM_RANGE_MAX
-#endif
-#define MAGIC_ENUM_RANGE_MIN 0
-#define MAGIC_ENUM_RANGE_MAX 256
-#include "utils/magic_enum.h"
+#include "utils/enum_helpers.h"
 #include "pool_task/network.h"
 #include "pool_task/network_msg.h"
+#include "poolstate_ttl.h"
 
 namespace esphome {
 namespace opnpool {
@@ -245,6 +238,7 @@ enum class poolstate_chlor_status_typ_t : uint8_t {
     COLD       = 0x40,  ///< Water too cold for chlorination.
     OK         = 0x80   ///< Normal operation.
 };
+ENUM_HELPERS_UINT8_RANGE(poolstate_chlor_status_typ_t)
 
 /// @brief Chlorinator status with validity flag.
 struct poolstate_chlor_status_t {
@@ -351,6 +345,36 @@ class PoolState {
         return memcmp(&last_, state, sizeof(poolstate_t)) != 0;
     }
 
+    /**
+     * @brief Determines which subsystems of a given state differ from the stored state.
+     *
+     * @param[in] state Pointer to the state to compare.
+     * @return          Mask of subsystems with at least one field that changed.
+     */
+    [[nodiscard]] poolstate_subsys_mask_t changed_subsys(poolstate_t const * const state) const {
+        return poolstate_ttl::subsys_changed(&last_, state);
+    }
+
+    /**
+     * @brief Checks if the stored state has the essentials to populate the entities.
+     *
+     * @details
+     * Complete means we know the controller firmware, the water temperature, both
+     * thermostats and the pool circuit. Schedules are not required, as a circuit
+     * without a schedule never reports one.
+     *
+     * @return True if the stored state is complete.
+     */
+    bool is_complete() const {
+        auto const & pool = last_.thermos[enum_index(poolstate_thermo_typ_t::POOL)];
+        auto const & spa = last_.thermos[enum_index(poolstate_thermo_typ_t::SPA)];
+        return last_.system.version.valid &&
+               last_.temps[enum_index(poolstate_temp_typ_t::WATER)].valid &&
+               pool.set_point_in_f.valid && pool.heat_src.valid &&
+               spa.set_point_in_f.valid && spa.heat_src.valid &&
+               last_.circuits[enum_index(network_pool_circuit_t::POOL)].active.valid;
+    }
+
   private:
     poolstate_t last_ = {};  ///< Last known pool state (zero-initialized sets .valid to false).
 };
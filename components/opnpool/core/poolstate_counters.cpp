@@ -0,0 +1,196 @@
+/**
+ * @file poolstate_counters.cpp
+ * @brief Lifetime runtime and energy counters, persisted in flash.
+ *
+ * @details
+ * Implements PoolStateCounters.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <esp_system.h>
+#include <esp_types.h>
+#include <esp_partition.h>
+#include <esphome/core/log.h>
+#include <cstring>
+
+#include "poolstate_counters.h"
+#include "poolstate.h"
+#include "utils/flash_log.h"
+#include "utils/partition_io.h"
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wunused-parameter"
+
+namespace esphome {
+namespace opnpool {
+
+constexpr char TAG[] = "poolstate_counters";
+
+constexpr char PARTITION_LABEL[] = "counters";
+
+constexpr uint32_t MS_PER_S = 1000;                ///< Unit of the runtime counters.
+constexpr uint32_t W_MS_PER_WH = 3600UL * 1000UL;  ///< Unit of the energy counter.
+
+static_assert(sizeof(poolstate_counters_t) <= FlashLog::MAX_PAYLOAD, "counters must fit in a flash log record");
+
+/**
+ * @brief Adds to a counter, carrying parts of its unit over.
+ *
+ * @param[in,out] total  The counter.
+ * @param[in,out] rest   Parts of a unit not counted yet.
+ * @param[in]     amount Amount to add, in parts of a unit.
+ * @param[in]     unit   Parts per unit.
+ */
+static void
+_count(uint32_t * const total, uint32_t * const rest, uint32_t const amount, uint32_t const unit)
+{
+    *rest += amount;
+    *total += *rest / unit;
+    *rest %= unit;
+}
+
+PoolStateCounters::PoolStateCounters() :
+    counters_{}, written_{}, rest_ms_{}, held_{}, io_{nullptr}, log_{nullptr},
+    last_feed_ms_{0}, last_write_ms_{0}, started_{false}, wrote_{false}
+{
+}
+
+PoolStateCounters::~PoolStateCounters()
+{
+    delete log_;
+    delete io_;
+}
+
+esp_err_t
+PoolStateCounters::restore()
+{
+    esp_partition_t const * const partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, PARTITION_LABEL);
+    if (partition == nullptr) {
+        ESP_LOGW(TAG, "No \"%s\" partition, counting from boot", PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    io_ = new PartitionIo(partition);
+    log_ = new FlashLog(io_, FORMAT, sizeof(poolstate_counters_t));
+
+    poolstate_counters_t restored;
+    esp_err_t const err = log_->open(&restored);
+    if (err == ESP_OK) {
+        counters_ = restored;
+        written_ = restored;
+        ESP_LOGI(TAG, "Restored counters (pump %lu h, %lu kWh)",
+                 static_cast<unsigned long>(counters_.pump_s / 3600),
+                 static_cast<unsigned long>(counters_.pump_wh / 1000));
+    } else if (err != ESP_ERR_NOT_FOUND) {
+        ESP_LOGW(TAG, "Can't use the \"%s\" partition (%s), counting from boot", PARTITION_LABEL, esp_err_to_name(err));
+        delete log_;
+        delete io_;
+        log_ = nullptr;
+        io_ = nullptr;
+    }
+    return err;
+}
+
+void
+PoolStateCounters::feed(poolstate_t const * const state, uint32_t const now_ms)
+{
+    if (!state) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return;
+    }
+    if (started_) {
+        uint32_t dt_ms = now_ms - last_feed_ms_;
+        if (dt_ms > MAX_GAP_MS) {
+            dt_ms = MAX_GAP_MS;
+        }
+
+            // count the values held since the previous feed
+        for (uint8_t ii = 0; ii < enum_count<network_pool_circuit_t>(); ii++) {
+            if (held_.circuit_on[ii]) {
+                _count(&counters_.circuit_s[ii], &rest_ms_.circuit_s[ii], dt_ms, MS_PER_S);
+            }
+        }
+        if (held_.heating) {
+            _count(&counters_.heater_s, &rest_ms_.heater_s, dt_ms, MS_PER_S);
+        }
+        if (held_.pump_running) {
+            _count(&counters_.pump_s, &rest_ms_.pump_s, dt_ms, MS_PER_S);
+        }
+        if (held_.pump_power_valid) {
+            _count(&counters_.pump_wh, &rest_ms_.pump_wh, held_.pump_power * dt_ms, W_MS_PER_WH);
+        }
+        if (held_.chlor_generating) {
+            _count(&counters_.chlor_cell_s, &rest_ms_.chlor_cell_s, dt_ms, MS_PER_S);
+        }
+    }
+    started_ = true;
+    last_feed_ms_ = now_ms;
+
+        // hold the current values until the next feed
+    for (uint8_t ii = 0; ii < enum_count<network_pool_circuit_t>(); ii++) {
+        auto const & active = state->circuits[ii].active;
+        held_.circuit_on[ii] = active.valid && active.value;
+    }
+    held_.heating = false;
+    for (auto const & thermo : state->thermos) {
+        held_.heating |= thermo.heating.valid && thermo.heating.value;
+    }
+    auto const & pump = state->pumps[enum_index(datalink_pump_id_t::PRIMARY)];
+    auto const & chlor = state->chlor;
+
+    held_.pump_running = pump.running.valid && pump.running.value;
+    held_.pump_power_valid = pump.power.valid;
+    held_.pump_power = pump.power.value;
+
+        // the cell only generates while water flows through it
+    held_.chlor_generating = held_.pump_running &&
+                             chlor.level.valid && chlor.level.value > 0 &&
+                             chlor.status.valid && chlor.status.value == poolstate_chlor_status_typ_t::OK;
+}
+
+/**
+ * @brief Writes the counters to flash if they changed and the write interval passed.
+ *
+ * @details
+ * With the default partition of 16 sectors and writes at least WRITE_INTERVAL_MS apart,
+ * each sector is erased at most every few days.
+ *
+ * @param[in] now_ms Current time in milliseconds.
+ * @param[in] force  Write (if changed) regardless of the write interval.
+ * @return           ESP_OK if written or nothing to do, an error if the write failed.
+ */
+esp_err_t
+PoolStateCounters::checkpoint(uint32_t const now_ms, bool const force)
+{
+    if (log_ == nullptr) {
+        return ESP_OK;  // not persistent
+    }
+    if (!force && wrote_ && now_ms - last_write_ms_ < WRITE_INTERVAL_MS) {
+        return ESP_OK;  // too soon
+    }
+    if (memcmp(&counters_, &written_, sizeof(counters_)) == 0) {
+        return ESP_OK;  // unchanged
+    }
+    esp_err_t const err = log_->append(&counters_);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to write counters (%s)", esp_err_to_name(err));
+        return err;
+    }
+    written_ = counters_;
+    last_write_ms_ = now_ms;
+    wrote_ = true;
+    ESP_LOGV(TAG, "Wrote counters #%lu", static_cast<unsigned long>(log_->get_stats().writes));
+    return ESP_OK;
+}
+
+uint32_t
+PoolStateCounters::get_write_count() const
+{
+    return log_ != nullptr ? log_->get_stats().writes : 0;
+}
+
+}  // namespace opnpool
+}  // namespace esphome
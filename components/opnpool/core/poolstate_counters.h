@@ -0,0 +1,127 @@
+/**
+ * @file poolstate_counters.h
+ * @brief Lifetime runtime and energy counters, persisted in flash.
+ *
+ * @details
+ * Counts circuit runtime, heater on-time, primary pump runtime and energy, and
+ * chlorinator cell time, for maintenance that is due after so many hours. Unlike the
+ * 24 hour metrics, these counters never reset, and they survive reboots and OTA updates.
+ *
+ * OpnPool::loop() feeds the pool state on every change and every FEED_INTERVAL_MS; the
+ * values of each feed count until the next one. Parts of a second (or Wh) carry over
+ * in RAM.
+ *
+ * The counters are kept in a FlashLog in the `counters` partition (see partitions.csv),
+ * which spreads the writes over its sectors. Writes happen when the counters changed,
+ * no more often than WRITE_INTERVAL_MS, except when forced on shutdown. Without that
+ * partition (e.g. a device that only got OTA updates since it was added), the counters
+ * only count from boot.
+ *
+ * Intended for use in the single-threaded ESPHome main task.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+#ifndef __cplusplus
+# error "Requires C++ compilation"
+#endif
+
+#include <esp_system.h>
+#include <esp_types.h>
+
+#include "utils/enum_helpers.h"
+#include "pool_task/network_msg.h"
+
+namespace esphome {
+namespace opnpool {
+
+    // forward declarations (to avoid circular dependencies)
+struct poolstate_t;
+class FlashLogIo;
+class FlashLog;
+
+/// @brief The counters, as stored in flash.
+struct poolstate_counters_t {
+    uint32_t circuit_s[enum_count<network_pool_circuit_t>()];  ///< Time that each circuit was on [s].
+    uint32_t heater_s;                                          ///< Time that a heater was heating [s].
+    uint32_t pump_s;                                            ///< Time that the primary pump was running [s].
+    uint32_t pump_wh;                                           ///< Primary pump energy [Wh].
+    uint32_t chlor_cell_s;                                      ///< Time that the chlorinator cell was generating [s].
+};
+
+/**
+ * @brief Lifetime counters, fed from the pool state and persisted in flash.
+ */
+class PoolStateCounters {
+
+  public:
+    static constexpr uint32_t FEED_INTERVAL_MS  = 10 * 1000;      ///< Time between periodic feeds.
+    static constexpr uint32_t MAX_GAP_MS        = 60 * 1000;      ///< Longest time a value is held between feeds.
+    static constexpr uint32_t WRITE_INTERVAL_MS = 5 * 60 * 1000;  ///< Minimum time between writes.
+    static constexpr uint8_t  FORMAT            = 1;              ///< Bump when poolstate_counters_t changes.
+
+    PoolStateCounters();
+    ~PoolStateCounters();
+
+    /**
+     * @brief Restores the counters from the `counters` partition.
+     *
+     * @return ESP_OK if restored, ESP_ERR_NOT_FOUND if there is no partition or no record
+     *         yet, or another error if the partition can't be used.
+     */
+    esp_err_t restore();
+
+    /// @brief Returns true if the next periodic feed is due.
+    [[nodiscard]] bool is_due(uint32_t const now_ms) const {
+        return !started_ || static_cast<int32_t>(now_ms - last_feed_ms_) >= static_cast<int32_t>(FEED_INTERVAL_MS);
+    }
+
+    /**
+     * @brief Counts the time since the previous feed, and holds the current values.
+     *
+     * @param[in] state  Current pool state.
+     * @param[in] now_ms Current time in milliseconds (e.g. millis()).
+     */
+    void feed(poolstate_t const * const state, uint32_t const now_ms);
+
+    /**
+     * @brief Writes the counters to flash if they changed and the write interval passed.
+     *
+     * @param[in] now_ms Current time in milliseconds (e.g. millis()).
+     * @param[in] force  Write (if changed) regardless of the write interval.
+     * @return           ESP_OK if written or nothing to do, an error if the write failed.
+     */
+    esp_err_t checkpoint(uint32_t const now_ms, bool const force = false);
+
+    [[nodiscard]] poolstate_counters_t const & get() const { return counters_; }  ///< Returns the counters.
+    [[nodiscard]] bool is_persistent() const { return log_ != nullptr; }           ///< True if backed by flash.
+    [[nodiscard]] uint32_t get_write_count() const;                                ///< Returns the writes since boot.
+
+  private:
+    /// @brief Values from the previous feed, held until the next one.
+    struct held_t {
+        bool     circuit_on[enum_count<network_pool_circuit_t>()];
+        bool     heating;
+        bool     pump_running;
+        bool     pump_power_valid;
+        uint16_t pump_power;  ///< [W]
+        bool     chlor_generating;
+    };
+
+    poolstate_counters_t counters_;       ///< The counters.
+    poolstate_counters_t written_;        ///< The counters as last written or restored.
+    poolstate_counters_t rest_ms_;        ///< Parts of a unit that carry over, in ms (W·ms for pump_wh).
+    held_t               held_;           ///< Values from the previous feed.
+    FlashLogIo *         io_;             ///< The `counters` partition, nullptr if there is none.
+    FlashLog *           log_;            ///< Log in that partition, nullptr if there is none.
+    uint32_t             last_feed_ms_;   ///< Time of the previous feed.
+    uint32_t             last_write_ms_;  ///< Time of the last write.
+    bool                 started_;        ///< False until the first feed.
+    bool                 wrote_;          ///< True once written since boot.
+};
+
+}  // namespace opnpool
+}  // namespace esphome
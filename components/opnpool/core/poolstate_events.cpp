@@ -0,0 +1,409 @@
+/**
+ * @file poolstate_events.cpp
+ * @brief Log of pool state transitions, kept in a flash ring buffer.
+ *
+ * @details
+ * Implements PoolStateEvents.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <esp_system.h>
+#include <esp_types.h>
+#include <esp_partition.h>
+#include <esphome/core/log.h>
+#include <cstring>
+
+#include "poolstate_events.h"
+#include "utils/to_str.h"
+#include "utils/flash_log.h"
+#include "utils/partition_io.h"
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wunused-parameter"
+
+namespace esphome {
+namespace opnpool {
+
+constexpr char TAG[] = "poolstate_events";
+
+constexpr char PARTITION_LABEL[] = "events";
+
+uint32_t
+poolstate_event_time(poolstate_tod_t const * const tod)
+{
+    if (!tod) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return 0;
+    }
+    if (!tod->date.valid || !tod->time.valid) {
+        return 0;
+    }
+    network_date_t const & date = tod->date.value;
+    network_time_t const & time = tod->time.value;
+    if (date.month < 1 || date.month > 12 || date.day < 1 || date.day > 31 || time.hour > 23 || time.minute > 59) {
+        return 0;
+    }
+
+        // days since 2000-01-01, counting the year from March so leap days come last
+    uint32_t const y = 2000U + date.year - (date.month <= 2 ? 1 : 0);
+    uint32_t const m = date.month <= 2 ? date.month + 9 : date.month - 3;
+    uint32_t const days = 365 * y + y / 4 - y / 100 + y / 400 + (153 * m + 2) / 5 + date.day - 1 - 730425;
+
+    return (days * 24 + time.hour) * 60 + time.minute;
+}
+
+/**
+ * @brief Splits a time from poolstate_event_time() into its date and time.
+ */
+static void
+_event_tod(uint32_t const time, uint16_t * const year, uint8_t * const month, uint8_t * const day,
+           uint8_t * const hour, uint8_t * const minute)
+{
+    *minute = time % 60;
+    *hour = (time / 60) % 24;
+
+        // inverse of poolstate_event_time(), again with the year starting in March
+    uint32_t const days = time / (24 * 60) + 730425;
+    uint32_t const era = days / 146097;
+    uint32_t const doe = days - era * 146097;
+    uint32_t const yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t const doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t const mp = (5 * doy + 2) / 153;
+
+    *day = static_cast<uint8_t>(doy - (153 * mp + 2) / 5 + 1);
+    *month = static_cast<uint8_t>(mp < 10 ? mp + 3 : mp - 9);
+    *year = static_cast<uint16_t>(yoe + era * 400 + (*month <= 2 ? 1 : 0));
+}
+
+/**
+ * @brief Logs an event, as a visitor of PoolStateEvents::query().
+ */
+[[nodiscard]] static bool
+_log_event(void * const /*ctx*/, poolstate_event_t const * const event)
+{
+        // release the names of each event, there may be thousands
+    to_str_scope_t const to_str_scope;
+
+    char when[24] = "unknown time";
+    if (event->time != 0) {
+        uint16_t year;
+        uint8_t month, day, hour, minute;
+        _event_tod(event->time, &year, &month, &day, &hour, &minute);
+        snprintf(when, sizeof(when), "%04u-%02u-%02u %02u:%02u", year, month, day, hour, minute);
+    }
+    auto const typ = static_cast<poolstate_event_typ_t>(event->typ);
+    auto const src = static_cast<poolstate_event_src_t>(event->src);
+
+    char const * what = "";
+    char const * value = uint8_str(event->value);
+    switch (typ) {
+        case poolstate_event_typ_t::START:
+            value = "";
+            break;
+        case poolstate_event_typ_t::CIRCUIT:
+            what = enum_str(static_cast<network_pool_circuit_t>(event->id));
+            value = event->value ? "on" : "off";
+            break;
+        case poolstate_event_typ_t::HEAT_SRC:
+            what = enum_str(static_cast<poolstate_thermo_typ_t>(event->id));
+            value = enum_str(static_cast<network_heat_src_t>(event->value));
+            break;
+        case poolstate_event_typ_t::PUMP_ERROR:
+            what = enum_str(static_cast<datalink_pump_id_t>(event->id));
+            break;
+        case poolstate_event_typ_t::CHLOR_STATUS:
+            value = enum_str(static_cast<poolstate_chlor_status_typ_t>(event->value));
+            break;
+    }
+    ESP_LOGI(TAG, "%s, %s, %s, %s, %s", when, enum_str(typ), what, value, enum_str(src));
+    return true;
+}
+
+PoolStateEvents::PoolStateEvents() :
+    batch_{}, circuit_cmds_{}, heat_src_cmds_{}, circuits_{}, heat_srcs_{}, pump_errors_{}, chlor_status_{},
+    io_{nullptr}, log_{nullptr}, first_ms_{0}, events_{0}, started_{false}
+{
+}
+
+PoolStateEvents::~PoolStateEvents()
+{
+    delete log_;
+    delete io_;
+}
+
+esp_err_t
+PoolStateEvents::restore()
+{
+    esp_partition_t const * const partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, PARTITION_LABEL);
+    if (partition == nullptr) {
+        ESP_LOGW(TAG, "No \"%s\" partition, keeping the last events in RAM", PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    io_ = new PartitionIo(partition);
+    log_ = new FlashLog(io_, FORMAT, sizeof(batch_t));
+
+        // only to find where the next batch goes
+    batch_t last;
+    esp_err_t const err = log_->open(&last);
+    if (err != ESP_OK && err != ESP_ERR_NOT_FOUND) {
+        ESP_LOGW(TAG, "Can't use the \"%s\" partition (%s), keeping the last events in RAM",
+                 PARTITION_LABEL, esp_err_to_name(err));
+        delete log_;
+        delete io_;
+        log_ = nullptr;
+        io_ = nullptr;
+        return err;
+    }
+    return ESP_OK;
+}
+
+void
+PoolStateEvents::note_command(network_msg_t const * const msg, poolstate_event_src_t const src, uint32_t const now_ms)
+{
+    if (!msg) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return;
+    }
+    command_t const cmd = {
+        .valid = true,
+        .src = src,
+        .ms = now_ms
+    };
+    switch (msg->typ) {
+        case network_msg_typ_t::CTRL_CIRCUIT_SET: {
+            uint8_t const idx = msg->u.a5.ctrl_circuit_set.circuit_plus_1 - 1U;
+            if (idx < enum_count<network_pool_circuit_t>()) {
+                circuit_cmds_[idx] = cmd;
+            }
+            break;
+        }
+        case network_msg_typ_t::CTRL_HEAT_SET: {
+                // a HEAT_SET carries both heat sources, only note the ones that change
+            network_heat_src_t const srcs[] = {
+                msg->u.a5.ctrl_heat_set.heat_src.get_pool(),
+                msg->u.a5.ctrl_heat_set.heat_src.get_spa()
+            };
+            static_assert(sizeof(srcs) / sizeof(srcs[0]) == enum_count<poolstate_thermo_typ_t>(), "one per thermostat");
+            for (uint8_t ii = 0; ii < enum_count<poolstate_thermo_typ_t>(); ii++) {
+                if (!heat_srcs_[ii].valid || heat_srcs_[ii].value != enum_index(srcs[ii])) {
+                    heat_src_cmds_[ii] = cmd;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Adds an event to the batch, and writes the batch when it is full.
+ *
+ * @details
+ * When the batch can't be written, the oldest event in it makes room.
+ */
+void
+PoolStateEvents::add_(poolstate_event_typ_t const typ, poolstate_event_src_t const src, uint8_t const id,
+                      uint8_t const value, uint32_t const time, uint32_t const now_ms)
+{
+    if (batch_.count == EVENTS_PER_BATCH && this->flush() != ESP_OK) {
+        memmove(&batch_.events[0], &batch_.events[1], sizeof(poolstate_event_t) * (EVENTS_PER_BATCH - 1));
+        batch_.count--;
+    }
+    if (batch_.count == 0) {
+        first_ms_ = now_ms;
+    }
+    batch_.events[batch_.count++] = {
+        .time = time,
+        .typ = enum_index(typ),
+        .src = enum_index(src),
+        .id = id,
+        .value = value
+    };
+    events_++;
+    ESP_LOGD(TAG, "%s %u = %u (%s)", enum_str(typ), id, value, enum_str(src));
+}
+
+/**
+ * @brief Compares a value with the previous feed, and adds an event if it changed.
+ *
+ * @details
+ * Invalid values are skipped, so a value that goes stale and comes back unchanged isn't
+ * an event. The first valid value after boot isn't an event either.
+ *
+ * @param[in,out] held   Value from the previous feed.
+ * @param[in]     valid  True if the current value is valid.
+ * @param[in]     value  Current value.
+ * @param[in]     typ    Type of the event.
+ * @param[in]     id     Circuit, thermostat, or pump.
+ * @param[in,out] cmd    Last command for it, nullptr if there are no commands for it.
+ * @param[in]     time   Controller time.
+ * @param[in]     now_ms Current time in milliseconds.
+ */
+void
+PoolStateEvents::compare_(held_t * const held, bool const valid, uint8_t const value, poolstate_event_typ_t const typ,
+                          uint8_t const id, command_t * const cmd, uint32_t const time, uint32_t const now_ms)
+{
+    if (!valid) {
+        return;
+    }
+    if (held->valid && held->value != value) {
+
+            // attribute it to a recent command, each command to one transition
+        poolstate_event_src_t src = poolstate_event_src_t::CONTROLLER;
+        if (cmd != nullptr && cmd->valid && now_ms - cmd->ms < ATTRIBUTE_MS) {
+            src = cmd->src;
+            cmd->valid = false;
+        }
+        this->add_(typ, src, id, value, time, now_ms);
+    }
+    *held = {
+        .valid = true,
+        .value = value
+    };
+}
+
+void
+PoolStateEvents::feed(poolstate_t const * const state, uint32_t const now_ms)
+{
+    if (!state) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return;
+    }
+    uint32_t const time = poolstate_event_time(&state->system.tod);
+
+    if (!started_) {
+        started_ = true;
+        this->add_(poolstate_event_typ_t::START, poolstate_event_src_t::CONTROLLER, 0, 0, time, now_ms);
+    }
+    for (uint8_t ii = 0; ii < enum_count<network_pool_circuit_t>(); ii++) {
+        auto const & active = state->circuits[ii].active;
+        this->compare_(&circuits_[ii], active.valid, active.value ? 1 : 0, poolstate_event_typ_t::CIRCUIT, ii,
+                       &circuit_cmds_[ii], time, now_ms);
+    }
+    for (uint8_t ii = 0; ii < enum_count<poolstate_thermo_typ_t>(); ii++) {
+        auto const & heat_src = state->thermos[ii].heat_src;
+        this->compare_(&heat_srcs_[ii], heat_src.valid, enum_index(heat_src.value), poolstate_event_typ_t::HEAT_SRC, ii,
+                       &heat_src_cmds_[ii], time, now_ms);
+    }
+    for (uint8_t ii = 0; ii < enum_count<datalink_pump_id_t>(); ii++) {
+        auto const & error = state->pumps[ii].error;
+        this->compare_(&pump_errors_[ii], error.valid, error.value, poolstate_event_typ_t::PUMP_ERROR, ii,
+                       nullptr, time, now_ms);
+    }
+    auto const & status = state->chlor.status;
+    this->compare_(&chlor_status_, status.valid, enum_index(status.value), poolstate_event_typ_t::CHLOR_STATUS, 0,
+                   nullptr, time, now_ms);
+}
+
+/**
+ * @brief Writes the batch to flash.
+ *
+ * @details
+ * With the default partition of 16 sectors that each hold 32 batches, the log keeps the
+ * last 7000 or so events when the batches are full.
+ *
+ * @return ESP_OK if written or nothing to do, an error if the write failed.
+ */
+esp_err_t
+PoolStateEvents::flush()
+{
+    if (log_ == nullptr) {
+        return ESP_ERR_NOT_SUPPORTED;  // the batch is all there is
+    }
+    if (batch_.count == 0) {
+        return ESP_OK;
+    }
+    esp_err_t const err = log_->append(&batch_);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to write %u events (%s)", batch_.count, esp_err_to_name(err));
+        first_ms_ += FLUSH_MS;  // try again later
+        return err;
+    }
+    ESP_LOGV(TAG, "Wrote %u events", batch_.count);
+    batch_ = {};
+    return ESP_OK;
+}
+
+/// @brief Context of query(), passed through FlashLog::for_each().
+struct query_ctx_t {
+    uint32_t                from;
+    uint32_t                to;
+    poolstate_event_visit_t visit;
+    void *                  ctx;
+    bool                    stopped;
+};
+
+/**
+ * @brief Visits the events of a batch that are in the time range.
+ *
+ * @return True to continue with the next batch.
+ */
+[[nodiscard]] static bool
+_query_batch(query_ctx_t * const query, uint8_t const count, poolstate_event_t const * const events)
+{
+    for (uint8_t ii = 0; ii < count && ii < PoolStateEvents::EVENTS_PER_BATCH; ii++) {
+        poolstate_event_t const event = events[ii];
+        if (event.time >= query->from && event.time <= query->to && !query->visit(query->ctx, &event)) {
+            query->stopped = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+PoolStateEvents::query(uint32_t const from, uint32_t const to, poolstate_event_visit_t const visit, void * const ctx)
+{
+    if (!visit) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return;
+    }
+    query_ctx_t query = {
+        .from = from,
+        .to = to,
+        .visit = visit,
+        .ctx = ctx,
+        .stopped = false
+    };
+    if (log_ != nullptr) {
+        (void)log_->for_each([](void * const ctx, uint32_t const /*seq*/, void const * const payload) {
+            batch_t batch;
+            memcpy(&batch, payload, sizeof(batch));
+            return _query_batch(static_cast<query_ctx_t *>(ctx), batch.count, batch.events);
+        }, &query);
+    }
+    if (!query.stopped) {
+        (void)_query_batch(&query, batch_.count, batch_.events);
+    }
+}
+
+/**
+ * @brief Logs the events in a time range, oldest first.
+ *
+ * @details
+ * Streams the events one line at a time, as "time, type, what, value, source", without
+ * collecting them first.
+ *
+ * @param[in] from Earliest time, in minutes since 2000-01-01.
+ * @param[in] to   Latest time, in minutes since 2000-01-01.
+ */
+void
+PoolStateEvents::dump(uint32_t const from, uint32_t const to)
+{
+    ESP_LOGI(TAG, "Events (%s):", log_ != nullptr ? "in flash" : "in RAM");
+    this->query(from, to, _log_event, nullptr);
+}
+
+uint32_t
+PoolStateEvents::get_write_count() const
+{
+    return log_ != nullptr ? log_->get_stats().writes : 0;
+}
+
+}  // namespace opnpool
+}  // namespace esphome
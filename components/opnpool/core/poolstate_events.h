@@ -0,0 +1,208 @@
+/**
+ * @file poolstate_events.h
+ * @brief Log of pool state transitions, kept in a flash ring buffer.
+ *
+ * @details
+ * Records when circuits turn on or off, heat sources change, pumps report an error (or
+ * clear it), and the chlorinator status changes. Each event carries the controller's
+ * date and time, and where the change came from: Home Assistant, Matter, or the
+ * controller itself (its schedules, or its own panel).
+ *
+ * OpnPool::loop() feeds the pool state on every change, and the events are found by
+ * comparing with the values of the previous feed. The commands that OPNpool sends are
+ * noted with their source; a transition that follows such a command within
+ * ATTRIBUTE_MS is attributed to it, others to the controller.
+ *
+ * Events are collected in RAM and written as one record of up to EVENTS_PER_BATCH
+ * events, when the batch is full, FLUSH_MS after its first event, or on shutdown. The
+ * records go to a FlashLog in the `events` partition (see partitions.csv), so the
+ * oldest events make room for new ones. Without that partition, only the last
+ * EVENTS_PER_BATCH events are kept, in RAM.
+ *
+ * Intended for use in the single-threaded ESPHome main task.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+#ifndef __cplusplus
+# error "Requires C++ compilation"
+#endif
+
+#include <esp_system.h>
+#include <esp_types.h>
+
+#include "utils/enum_helpers.h"
+#include "pool_task/network_msg.h"
+#include "poolstate.h"
+
+namespace esphome {
+namespace opnpool {
+
+    // forward declarations (to avoid circular dependencies)
+class FlashLogIo;
+class FlashLog;
+
+/// @brief What changed.
+enum class poolstate_event_typ_t : uint8_t {
+    START        = 0,  ///< First pool state after boot; id and value are 0.
+    CIRCUIT      = 1,  ///< Circuit turned on or off; id is the network_pool_circuit_t, value 0 or 1.
+    HEAT_SRC     = 2,  ///< Heat source changed; id is the poolstate_thermo_typ_t, value the network_heat_src_t.
+    PUMP_ERROR   = 3,  ///< Pump error changed; id is the datalink_pump_id_t, value the error (0 if cleared).
+    CHLOR_STATUS = 4   ///< Chlorinator status changed; value is the poolstate_chlor_status_typ_t.
+};
+
+/// @brief Where a change came from.
+enum class poolstate_event_src_t : uint8_t {
+    CONTROLLER = 0,  ///< The controller, e.g. its schedules or its own panel.
+    HA         = 1,  ///< A command from Home Assistant (switch, climate, or scene).
+    MATTER     = 2   ///< A command from a Matter controller.
+};
+
+/// @brief One event, as stored in flash.
+struct poolstate_event_t {
+    uint32_t time;   ///< Controller time in minutes since 2000-01-01, 0 if unknown.
+    uint8_t  typ;    ///< poolstate_event_typ_t.
+    uint8_t  src;    ///< poolstate_event_src_t.
+    uint8_t  id;     ///< Circuit, thermostat, or pump, see poolstate_event_typ_t.
+    uint8_t  value;  ///< New value, see poolstate_event_typ_t.
+} PACK8;
+
+/**
+ * @brief Called by PoolStateEvents::query() for each matching event.
+ *
+ * @param[in] ctx   Context given to query().
+ * @param[in] event The event.
+ * @return          True to continue, false to stop.
+ */
+using poolstate_event_visit_t = bool (*)(void * const ctx, poolstate_event_t const * const event);
+
+/**
+ * @brief Returns the controller time in minutes since 2000-01-01.
+ *
+ * @param[in] tod Controller date and time.
+ * @return        Minutes since 2000-01-01, or 0 if the date or time is unknown.
+ */
+[[nodiscard]] uint32_t poolstate_event_time(poolstate_tod_t const * const tod);
+
+/**
+ * @brief Log of pool state transitions, fed from the pool state and kept in flash.
+ */
+class PoolStateEvents {
+
+  public:
+    static constexpr uint8_t  EVENTS_PER_BATCH = 14;              ///< Events per flash record.
+    static constexpr uint32_t FLUSH_MS         = 5 * 60 * 1000;   ///< Longest time an event waits in RAM.
+    static constexpr uint32_t ATTRIBUTE_MS     = 30 * 1000;       ///< Time in which a transition is attributed to a command.
+    static constexpr uint8_t  FORMAT           = 1;               ///< Bump when batch_t changes.
+
+    PoolStateEvents();
+    ~PoolStateEvents();
+
+    /**
+     * @brief Opens the log in the `events` partition.
+     *
+     * @return ESP_OK, or ESP_ERR_NOT_FOUND if there is no partition, or another error if
+     *         the partition can't be used.
+     */
+    esp_err_t restore();
+
+    /**
+     * @brief Notes a command that OPNpool sends to the controller.
+     *
+     * @param[in] msg    The CTRL_CIRCUIT_SET or CTRL_HEAT_SET; others are ignored.
+     * @param[in] src    Where the command came from.
+     * @param[in] now_ms Current time in milliseconds (e.g. millis()).
+     */
+    void note_command(network_msg_t const * const msg, poolstate_event_src_t const src, uint32_t const now_ms);
+
+    /**
+     * @brief Records the transitions since the previous feed.
+     *
+     * @param[in] state  Current pool state.
+     * @param[in] now_ms Current time in milliseconds (e.g. millis()).
+     */
+    void feed(poolstate_t const * const state, uint32_t const now_ms);
+
+    /// @brief Returns true if the batch should be written.
+    [[nodiscard]] bool is_due(uint32_t const now_ms) const {
+        return log_ != nullptr && batch_.count > 0 && static_cast<int32_t>(now_ms - first_ms_) >= static_cast<int32_t>(FLUSH_MS);
+    }
+
+    /**
+     * @brief Writes the batch to flash.
+     *
+     * @return ESP_OK if written or nothing to do, an error if the write failed.
+     */
+    esp_err_t flush();
+
+    /**
+     * @brief Visits the events in a time range, oldest first.
+     *
+     * @details
+     * Covers the events in flash and those still in RAM. Events without a controller
+     * time (0) only match a range that starts at 0.
+     *
+     * @param[in] from  Earliest time, in minutes since 2000-01-01.
+     * @param[in] to    Latest time, in minutes since 2000-01-01.
+     * @param[in] visit Called for each matching event.
+     * @param[in] ctx   Passed to visit.
+     */
+    void query(uint32_t const from, uint32_t const to, poolstate_event_visit_t const visit, void * const ctx);
+
+    /**
+     * @brief Logs the events in a time range, oldest first.
+     *
+     * @param[in] from Earliest time, in minutes since 2000-01-01.
+     * @param[in] to   Latest time, in minutes since 2000-01-01.
+     */
+    void dump(uint32_t const from, uint32_t const to);
+
+    [[nodiscard]] bool is_persistent() const { return log_ != nullptr; }  ///< True if backed by flash.
+    [[nodiscard]] uint32_t get_event_count() const { return events_; }     ///< Returns the events since boot.
+    [[nodiscard]] uint32_t get_write_count() const;                        ///< Returns the writes since boot.
+
+  private:
+    /// @brief Events as written in one flash record.
+    struct batch_t {
+        uint8_t           count;    ///< Events in use.
+        uint8_t           reserved[3];
+        poolstate_event_t events[EVENTS_PER_BATCH];
+    } PACK8;
+
+    /// @brief Last command for a circuit or thermostat.
+    struct command_t {
+        bool                  valid;  ///< True if a command was noted.
+        poolstate_event_src_t src;    ///< Where it came from.
+        uint32_t              ms;     ///< When it was sent.
+    };
+
+    /// @brief A value from the previous feed.
+    struct held_t {
+        bool    valid;
+        uint8_t value;
+    };
+
+    void add_(poolstate_event_typ_t const typ, poolstate_event_src_t const src, uint8_t const id,
+              uint8_t const value, uint32_t const time, uint32_t const now_ms);
+    void compare_(held_t * const held, bool const valid, uint8_t const value, poolstate_event_typ_t const typ,
+                  uint8_t const id, command_t * const cmd, uint32_t const time, uint32_t const now_ms);
+
+    batch_t      batch_;                                                   ///< Events not written yet.
+    command_t    circuit_cmds_[enum_count<network_pool_circuit_t>()];     ///< Last command per circuit.
+    command_t    heat_src_cmds_[enum_count<poolstate_thermo_typ_t>()];    ///< Last command per thermostat.
+    held_t       circuits_[enum_count<network_pool_circuit_t>()];         ///< Circuit states.
+    held_t       heat_srcs_[enum_count<poolstate_thermo_typ_t>()];        ///< Heat sources.
+    held_t       pump_errors_[enum_count<datalink_pump_id_t>()];          ///< Pump errors.
+    held_t       chlor_status_;                                            ///< Chlorinator status.
+    FlashLogIo * io_;                                                      ///< The `events` partition, nullptr if there is none.
+    FlashLog *   log_;                                                     ///< Log in that partition, nullptr if there is none.
+    uint32_t     first_ms_;                                                ///< Time of the first event in the batch.
+    uint32_t     events_;                                                  ///< Events recorded since boot.
+    bool         started_;                                                 ///< False until the first feed.
+};
+
+}  // namespace opnpool
+}  // namespace esphome
@@ -0,0 +1,260 @@
+/**
+ * @file poolstate_fields.h
+ * @brief Declarative field descriptors that map message payloads onto the pool state.
+ *
+ * @details
+ * A message type that carries plain values is described by a table of field descriptors.
+ * Each descriptor names the byte offset, width and byte order of a value in the payload,
+ * a scale factor, the poolstate field that receives it and its key in the debug log. The
+ * templated engine below walks such a table to decode a payload into the pool state, and
+ * to add the decoded values to the verbose debug log.
+ *
+ * Tables are constexpr std::tuple's of descriptors that are passed to the engine as a
+ * template argument. The walk is unrolled at compile time and every offset, encoding and
+ * target is a constant, so each field compiles down to the same loads and stores as a
+ * hand-written assignment.
+ *
+ * Values that need interpretation beyond offset and scale (bitmasks, nibbles, error
+ * flags) remain hand-written in poolstate_rx.cpp.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+#ifndef __cplusplus
+# error "Requires C++ compilation"
+#endif
+
+#include <esp_system.h>
+#include <esp_types.h>
+#include <string.h>
+#include <tuple>
+#include <type_traits>
+
+#include "utils/to_str.h"
+#include "utils/json_writer.h"
+#include "utils/enum_helpers.h"
+#include "pool_task/network_msg.h"
+
+namespace esphome {
+namespace opnpool {
+
+/// @brief How a value is stored in the message payload.
+enum class poolstate_field_enc_t : uint8_t {
+    RAW       = 0,  ///< Copied as is, sizeof the poolstate value (enums, times, byte structs).
+    U8        = 1,  ///< Unsigned byte.
+    U16_HI_LO = 2,  ///< Unsigned 16-bit, most significant byte first.
+    U16_LO_HI = 3   ///< Unsigned 16-bit, least significant byte first.
+};
+
+/**
+ * @brief Describes one value in a message payload and where it goes in the pool state.
+ *
+ * @tparam S Poolstate structure that holds the field (e.g. poolstate_pump_t).
+ * @tparam W Poolstate wrapper of the field (e.g. poolstate_uint16_t).
+ */
+template<typename S, typename W>
+struct poolstate_field_t {
+    using scope_t   = S;  ///< Poolstate structure that holds the field.
+    using wrapper_t = W;  ///< Poolstate wrapper of the field.
+
+    uint8_t               offset;     ///< Byte offset in the payload.
+    poolstate_field_enc_t enc;        ///< Width and byte order in the payload.
+    uint8_t               scale;      ///< Multiplier for integer values.
+    W S::*                target;     ///< Poolstate field that receives the value.
+    char const *          key;        ///< Key in the debug log, or nullptr to leave it out.
+    bool                  omit_zero;  ///< Leave the value out of the debug log when zero.
+};
+
+/**
+ * @brief Creates a field descriptor.
+ *
+ * @param offset    Byte offset in the payload, typically offsetof() the network_msg.h member.
+ * @param enc       Width and byte order in the payload.
+ * @param target    Pointer to the poolstate member that receives the value.
+ * @param key       Key in the debug log, or nullptr.
+ * @param scale     Multiplier for integer values.
+ * @param omit_zero Leave the value out of the debug log when zero.
+ */
+template<typename S, typename W>
+constexpr poolstate_field_t<S, W>
+poolstate_field(size_t const offset, poolstate_field_enc_t const enc, W S::* const target, char const * const key,
+                uint8_t const scale = 1, bool const omit_zero = false)
+{
+    return {static_cast<uint8_t>(offset), enc, scale, target, key, omit_zero};
+}
+
+namespace poolstate_fields {
+
+/// @cond INTERNAL
+namespace detail {
+
+template<typename T, typename = void>
+struct has_to_str : std::false_type {};
+
+template<typename T>
+struct has_to_str<T, std::void_t<decltype(std::declval<T const &>().to_str())>> : std::true_type {};
+
+template<typename W>
+using value_t = std::remove_cv_t<decltype(W::value)>;
+
+    // number of payload bytes a field occupies
+template<typename S, typename W>
+constexpr size_t
+width(poolstate_field_t<S, W> const & f)
+{
+    switch (f.enc) {
+        case poolstate_field_enc_t::U8:        return 1;
+        case poolstate_field_enc_t::U16_HI_LO: return 2;
+        case poolstate_field_enc_t::U16_LO_HI: return 2;
+        default:                               return sizeof(value_t<W>);
+    }
+}
+
+    // an encoding only makes sense for integer targets; everything else is copied
+template<typename S, typename W>
+constexpr bool
+valid(poolstate_field_t<S, W> const & f)
+{
+    using V = value_t<W>;
+    if constexpr (std::is_integral_v<V>) {
+        return f.enc != poolstate_field_enc_t::RAW && f.scale != 0;
+    } else {
+        return f.enc == poolstate_field_enc_t::RAW && f.scale == 1 && std::is_trivially_copyable_v<V>;
+    }
+}
+
+template<auto const & FIELDS>
+using fields_t = std::remove_cv_t<std::remove_reference_t<decltype(FIELDS)>>;
+
+template<auto const & FIELDS, size_t I>
+using field_value_t = value_t<typename std::tuple_element_t<I, fields_t<FIELDS>>::wrapper_t>;
+
+template<auto const & FIELDS>
+using index_t = std::make_index_sequence<std::tuple_size_v<fields_t<FIELDS>>>;
+
+    // the descriptor is a template argument, so its offset, encoding and scale are constants
+template<auto const & FIELDS, size_t I>
+inline field_value_t<FIELDS, I>
+read(uint8_t const * const payload)
+{
+    using V = field_value_t<FIELDS, I>;
+    constexpr auto f = std::get<I>(FIELDS);
+    uint8_t const * const p = payload + f.offset;
+
+    if constexpr (f.enc == poolstate_field_enc_t::RAW) {
+        V value;
+        memcpy(&value, p, sizeof(V));
+        return value;
+    } else {
+        uint32_t raw;
+        if constexpr (f.enc == poolstate_field_enc_t::U16_HI_LO) {
+            raw = (static_cast<uint32_t>(p[0]) << 8) | p[1];
+        } else if constexpr (f.enc == poolstate_field_enc_t::U16_LO_HI) {
+            raw = (static_cast<uint32_t>(p[1]) << 8) | p[0];
+        } else {
+            raw = p[0];
+        }
+        if constexpr (std::is_same_v<V, bool>) {
+            return raw != 0;
+        } else {
+            return static_cast<V>(raw * f.scale);
+        }
+    }
+}
+
+template<typename V>
+inline void
+log_value(JsonWriter * const dbg, char const * const key, V const & value, bool const omit_zero)
+{
+    if constexpr (has_to_str<V>::value) {
+        dbg->add_string(key, value.to_str());
+    } else if constexpr (std::is_enum_v<V>) {
+        dbg->add_string(key, enum_str(value));
+    } else if constexpr (std::is_same_v<V, network_time_t>) {
+        dbg->add_string(key, time_str(value.hour, value.minute));
+    } else if constexpr (std::is_same_v<V, bool>) {
+        dbg->add_bool(key, value);
+    } else {
+        static_assert(std::is_integral_v<V>, "no debug log format for this field type");
+        if (!omit_zero || value != 0) {
+            dbg->add_number(key, static_cast<int32_t>(value));
+        }
+    }
+}
+
+}  // namespace detail
+/// @endcond
+
+/// @cond INTERNAL
+namespace detail {
+
+template<auto const & FIELDS, typename S, size_t... I>
+inline void
+decode(uint8_t const * const p, S * const scope, std::index_sequence<I...>)
+{
+    ((scope->*std::get<I>(FIELDS).target = {.valid = true, .value = read<FIELDS, I>(p)}), ...);
+}
+
+template<auto const & FIELDS, typename S, size_t... I>
+inline void
+log(JsonWriter * const dbg, S const * const scope, std::index_sequence<I...>)
+{
+    ([&] {
+        constexpr auto f = std::get<I>(FIELDS);
+        if constexpr (f.key != nullptr) {
+            log_value(dbg, f.key, (scope->*f.target).value, f.omit_zero);
+        }
+    }(), ...);
+}
+
+}  // namespace detail
+/// @endcond
+
+/**
+ * @brief Checks at compile time that all fields fit in a payload of type MSG and have
+ *        an encoding that matches their poolstate type.
+ */
+template<typename MSG, typename... F>
+constexpr bool
+fits(std::tuple<F...> const & fields)
+{
+    return std::apply([](auto const &... f) {
+        return ((f.offset + detail::width(f) <= sizeof(MSG) && detail::valid(f)) && ...);
+    }, fields);
+}
+
+/**
+ * @brief Decodes the fields from a payload into the pool state, marking them valid.
+ *
+ * @tparam FIELDS Field descriptor table.
+ * @param payload Start of the message payload.
+ * @param scope   Poolstate structure that holds the fields.
+ */
+template<auto const & FIELDS, typename S>
+inline void
+decode(void const * const payload, S * const scope)
+{
+    detail::decode<FIELDS>(static_cast<uint8_t const *>(payload), scope, detail::index_t<FIELDS>{});
+}
+
+/**
+ * @brief Adds the fields of a poolstate structure to the debug log.
+ *
+ * @tparam FIELDS Field descriptor table.
+ * @param dbg     JSON object to add the fields to.
+ * @param scope   Poolstate structure that holds the fields.
+ */
+template<auto const & FIELDS, typename S>
+inline void
+log(JsonWriter * const dbg, S const * const scope)
+{
+    detail::log<FIELDS>(dbg, scope, detail::index_t<FIELDS>{});
+}
+
+}  // namespace poolstate_fields
+
+}  // namespace opnpool
+}  // namespace esphome
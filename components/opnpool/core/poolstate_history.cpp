@@ -0,0 +1,491 @@
+/**
+ * @file poolstate_history.cpp
+ * @brief In-memory time series of pool state samples.
+ *
+ * @details
+ * Implements the PoolStateHistory ring. Encoding of a sample within a block:
+ *
+ *   - A single REPEAT byte (0x80) if the validity mask and all values equal those of the
+ *     previous sample in the block.
+ *   - Otherwise, a validity mask byte (bit n set if series n is valid), followed by the
+ *     zigzag varint delta of every valid series against its previous value in the block.
+ *
+ * The encoder and decoder both start a block with all values at 0, so the first sample
+ * of a block is effectively a key frame. Blocks are never decoded beyond what a query
+ * needs, and downsampling uses the per-block aggregates whenever a block falls entirely
+ * within a bucket.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <esp_system.h>
+#include <esp_types.h>
+#include <esphome/core/log.h>
+#include <cstdio>
+#include <iterator>
+#include <limits>
+
+#include "poolstate_history.h"
+#include "poolstate.h"
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wunused-parameter"
+
+namespace esphome {
+namespace opnpool {
+
+constexpr char TAG[] = "poolstate_history";
+
+constexpr uint8_t REPEAT = 0x80;  ///< Sample identical to the previous one.
+
+static_assert(PoolStateHistory::NUM_SERIES < 8, "validity mask must leave room for the REPEAT bit");
+
+/**
+ * @brief Returns the signed distance from `from` to `to`, allowing for millis() wrap.
+ */
+[[nodiscard]] static inline int32_t
+_diff(uint32_t const to, uint32_t const from)
+{
+    return static_cast<int32_t>(to - from);
+}
+
+/**
+ * @brief Extracts the series values from the pool state.
+ *
+ * @param[in]  state  Pool state.
+ * @param[out] values Value per series.
+ * @return            Validity mask (bit n set if series n is valid).
+ */
+[[nodiscard]] static uint8_t
+_extract(poolstate_t const * const state, int32_t * const values)
+{
+    uint8_t valid = 0;
+    auto set = [&](poolstate_history_series_t const series, bool const is_valid, int32_t const value) {
+        values[enum_index(series)] = is_valid ? value : 0;
+        if (is_valid) {
+            valid |= 1U << enum_index(series);
+        }
+    };
+    auto const & water = state->temps[enum_index(poolstate_temp_typ_t::WATER)];
+    auto const & pump = state->pumps[enum_index(datalink_pump_id_t::PRIMARY)];
+
+    set(poolstate_history_series_t::WATER_TEMP, water.valid, water.value);
+    set(poolstate_history_series_t::PUMP_POWER, pump.power.valid, pump.power.value);
+    set(poolstate_history_series_t::PUMP_SPEED, pump.speed.valid, pump.speed.value);
+    set(poolstate_history_series_t::PUMP_FLOW, pump.flow.valid, pump.flow.value);
+    set(poolstate_history_series_t::CHLOR_SALT, state->chlor.salt.valid, state->chlor.salt.value);
+
+    int32_t circuits = 0;
+    bool circuits_valid = false;
+    for (uint8_t ii = 0; ii < enum_count<network_pool_circuit_t>(); ii++) {
+        if (state->circuits[ii].active.valid) {
+            circuits_valid = true;
+            circuits |= state->circuits[ii].active.value ? (1 << ii) : 0;
+        }
+    }
+    set(poolstate_history_series_t::CIRCUITS, circuits_valid, circuits);
+    return valid;
+}
+
+/**
+ * @brief Writes a zigzag varint.
+ *
+ * @param[out] buf   Buffer (at least 5 bytes).
+ * @param[in]  value Value to encode.
+ * @return           Number of bytes written.
+ */
+[[nodiscard]] static uint8_t
+_put_varint(uint8_t * const buf, int32_t const value)
+{
+    uint32_t zz = (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    uint8_t len = 0;
+    while (zz >= 0x80) {
+        buf[len++] = static_cast<uint8_t>(zz) | 0x80;
+        zz >>= 7;
+    }
+    buf[len++] = static_cast<uint8_t>(zz);
+    return len;
+}
+
+/**
+ * @brief Reads a zigzag varint.
+ *
+ * @param[in]     buf Buffer.
+ * @param[in,out] pos Read position, advanced past the varint.
+ * @return            Decoded value.
+ */
+[[nodiscard]] static int32_t
+_get_varint(uint8_t const * const buf, uint16_t * const pos)
+{
+    uint32_t zz = 0;
+    uint8_t shift = 0;
+    uint8_t byte;
+    do {
+        byte = buf[(*pos)++];
+        zz |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        shift += 7;
+    } while ((byte & 0x80) && shift < 35);
+    return static_cast<int32_t>(zz >> 1) ^ -static_cast<int32_t>(zz & 1);
+}
+
+PoolStateHistory::PoolStateHistory() : head_{0}, started_{false}, last_sample_ms_{0}
+{
+    memset(blocks_, 0, sizeof(blocks_));
+}
+
+/**
+ * @brief Starts a new block, overwriting the oldest one.
+ *
+ * @param[in] now_ms Time of the first sample in the new block.
+ */
+void
+PoolStateHistory::open_block_(uint32_t const now_ms)
+{
+    if (started_) {
+        head_ = (head_ + 1) % NUM_BLOCKS;
+    }
+    block_t * const block = &blocks_[head_];
+    memset(block, 0, sizeof(block_t));
+    block->start_ms = now_ms;
+}
+
+/**
+ * @brief Appends a sample to a block.
+ *
+ * @param[in,out] block  The block.
+ * @param[in]     valid  Validity mask of the sample.
+ * @param[in]     values Value per series.
+ * @return               True if appended, false if the block is full.
+ */
+bool
+PoolStateHistory::append_(block_t * const block, uint8_t const valid, int32_t const * const values)
+{
+    if (block->samples >= BLOCK_SAMPLES) {
+        return false;
+    }
+    uint8_t buf[1 + NUM_SERIES * 5];
+    uint8_t len = 0;
+
+    bool repeat = block->samples > 0 && valid == block->last_valid;
+    for (uint8_t ss = 0; repeat && ss < NUM_SERIES; ss++) {
+        repeat = !(valid & (1U << ss)) || values[ss] == block->last[ss];
+    }
+    if (repeat) {
+        buf[len++] = REPEAT;
+    } else {
+        buf[len++] = valid;
+        for (uint8_t ss = 0; ss < NUM_SERIES; ss++) {
+            if (valid & (1U << ss)) {
+                len += _put_varint(&buf[len], values[ss] - block->last[ss]);
+            }
+        }
+    }
+    if (block->len + len > BLOCK_BYTES) {
+        return false;
+    }
+    memcpy(&block->data[block->len], buf, len);
+    block->len += len;
+    block->samples++;
+    block->last_valid = valid;
+
+    for (uint8_t ss = 0; ss < NUM_SERIES; ss++) {
+        if (valid & (1U << ss)) {
+            block->last[ss] = values[ss];
+
+            aggr_t * const aggr = &block->aggr[ss];
+            if (aggr->count == 0 || values[ss] < aggr->min) aggr->min = values[ss];
+            if (aggr->count == 0 || values[ss] > aggr->max) aggr->max = values[ss];
+            aggr->sum += values[ss];
+            aggr->count++;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Records a sample if SAMPLE_INTERVAL_MS passed since the previous one.
+ *
+ * @details
+ * Samples within a block are SAMPLE_INTERVAL_MS apart, so no per-sample timestamps are
+ * stored. If sampling fell behind by more than an interval, a new block is started to
+ * keep the timestamps accurate.
+ *
+ * @param[in] state  Current pool state.
+ * @param[in] now_ms Current time in milliseconds.
+ */
+void
+PoolStateHistory::sample(poolstate_t const * const state, uint32_t const now_ms)
+{
+    if (state == nullptr) { ESP_LOGW(TAG, "null to %s", __func__); return; }
+
+    if (!is_due(now_ms)) {
+        return;
+    }
+    int32_t values[NUM_SERIES];
+    uint8_t const valid = _extract(state, values);
+
+    if (!started_ || _diff(now_ms, last_sample_ms_) >= static_cast<int32_t>(2 * SAMPLE_INTERVAL_MS)) {
+        open_block_(now_ms);
+        started_ = true;
+        last_sample_ms_ = now_ms;
+    } else {
+        last_sample_ms_ += SAMPLE_INTERVAL_MS;
+    }
+    if (!append_(&blocks_[head_], valid, values)) {
+        open_block_(last_sample_ms_);
+        (void)append_(&blocks_[head_], valid, values);  // always fits in an empty block
+    }
+}
+
+/**
+ * @brief Prepares to decode the samples of a block.
+ */
+void
+PoolStateHistory::begin_(block_t const * const block, cursor_t * const cursor)
+{
+    memset(cursor, 0, sizeof(cursor_t));
+    cursor->block = block;
+}
+
+/**
+ * @brief Decodes the next sample of a block.
+ *
+ * @param[in,out] cursor Decoder state; `values` and `valid` hold the sample.
+ * @return               False if there are no more samples.
+ */
+bool
+PoolStateHistory::next_(cursor_t * const cursor)
+{
+    block_t const * const block = cursor->block;
+    if (cursor->idx >= block->samples || cursor->pos >= block->len) {
+        return false;
+    }
+    uint8_t const hdr = block->data[cursor->pos++];
+    if (hdr != REPEAT) {
+        cursor->valid = hdr;
+        for (uint8_t ss = 0; ss < NUM_SERIES; ss++) {
+            if (hdr & (1U << ss)) {
+                cursor->values[ss] += _get_varint(block->data, &cursor->pos);
+            }
+        }
+    }
+    cursor->idx++;
+    return true;
+}
+
+/**
+ * @brief Returns the samples of a series within a time range.
+ *
+ * @details
+ * Walks the blocks from oldest to newest, and only decodes blocks that overlap the range.
+ *
+ * @param[in]  series  The series to query.
+ * @param[in]  from_ms Start of the range (inclusive).
+ * @param[in]  to_ms   End of the range (inclusive).
+ * @param[out] points  Array to receive the valid samples, oldest first.
+ * @param[in]  max     Size of the array.
+ * @return             Number of samples returned.
+ */
+size_t
+PoolStateHistory::query(poolstate_history_series_t const series, uint32_t const from_ms, uint32_t const to_ms,
+                        poolstate_history_point_t * const points, size_t const max) const
+{
+    if (points == nullptr) { ESP_LOGW(TAG, "null to %s", __func__); return 0; }
+
+    uint8_t const ss = enum_index(series);
+    size_t count = 0;
+
+    for (uint8_t nn = 1; nn <= NUM_BLOCKS && count < max; nn++) {
+
+        block_t const * const block = &blocks_[(head_ + nn) % NUM_BLOCKS];
+        if (block->samples == 0) {
+            continue;
+        }
+        uint32_t const end_ms = block->start_ms + (block->samples - 1) * SAMPLE_INTERVAL_MS;
+        if (_diff(end_ms, from_ms) < 0 || _diff(block->start_ms, to_ms) > 0) {
+            continue;  // no overlap
+        }
+        cursor_t cursor;
+        begin_(block, &cursor);
+        while (count < max && next_(&cursor)) {
+            uint32_t const t = block->start_ms + (cursor.idx - 1) * SAMPLE_INTERVAL_MS;
+            if ((cursor.valid & (1U << ss)) && _diff(t, from_ms) >= 0 && _diff(t, to_ms) <= 0) {
+                points[count++] = {
+                    .time_ms = t,
+                    .value = cursor.values[ss]
+                };
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Returns min/max/avg of a series per time bucket.
+ *
+ * @details
+ * For each bucket, blocks that lie entirely within it contribute their precomputed
+ * aggregates; only blocks that straddle the bucket's boundaries are decoded.
+ *
+ * @param[in]  series    The series to query.
+ * @param[in]  from_ms   Start of the first bucket.
+ * @param[in]  bucket_ms Width of each bucket.
+ * @param[out] buckets   Array to receive the buckets.
+ * @param[in]  count     Number of buckets to compute.
+ */
+void
+PoolStateHistory::downsample(poolstate_history_series_t const series, uint32_t const from_ms, uint32_t const bucket_ms,
+                             poolstate_history_bucket_t * const buckets, size_t const count) const
+{
+    if (buckets == nullptr || bucket_ms == 0) { ESP_LOGW(TAG, "invalid args to %s", __func__); return; }
+
+    uint8_t const ss = enum_index(series);
+
+    for (size_t bb = 0; bb < count; bb++) {
+
+        uint32_t const bucket_start = from_ms + bb * bucket_ms;
+        uint32_t const bucket_last = bucket_start + bucket_ms - 1;
+        int32_t  min = std::numeric_limits<int32_t>::max();
+        int32_t  max = std::numeric_limits<int32_t>::min();
+        int64_t  sum = 0;
+        uint16_t n = 0;
+
+        for (uint8_t nn = 1; nn <= NUM_BLOCKS; nn++) {
+
+            block_t const * const block = &blocks_[(head_ + nn) % NUM_BLOCKS];
+            if (block->samples == 0 || block->aggr[ss].count == 0) {
+                continue;
+            }
+            uint32_t const end_ms = block->start_ms + (block->samples - 1) * SAMPLE_INTERVAL_MS;
+            if (_diff(end_ms, bucket_start) < 0 || _diff(block->start_ms, bucket_last) > 0) {
+                continue;  // no overlap
+            }
+            if (_diff(block->start_ms, bucket_start) >= 0 && _diff(end_ms, bucket_last) <= 0) {
+                aggr_t const * const aggr = &block->aggr[ss];  // entirely within the bucket
+                if (aggr->min < min) min = aggr->min;
+                if (aggr->max > max) max = aggr->max;
+                sum += aggr->sum;
+                n += aggr->count;
+                continue;
+            }
+            cursor_t cursor;  // straddles the bucket boundary
+            begin_(block, &cursor);
+            while (next_(&cursor)) {
+                uint32_t const t = block->start_ms + (cursor.idx - 1) * SAMPLE_INTERVAL_MS;
+                if ((cursor.valid & (1U << ss)) && _diff(t, bucket_start) >= 0 && _diff(t, bucket_last) <= 0) {
+                    int32_t const value = cursor.values[ss];
+                    if (value < min) min = value;
+                    if (value > max) max = value;
+                    sum += value;
+                    n++;
+                }
+            }
+        }
+        buckets[bb] = {
+            .start_ms = bucket_start,
+            .count = n,
+            .min = n ? min : 0,
+            .max = n ? max : 0,
+            .avg = n ? static_cast<int32_t>(sum / n) : 0
+        };
+    }
+}
+
+/**
+ * @brief Logs min/avg/max per bucket, and the circuit changes, of a recent time range.
+ *
+ * @details
+ * Buckets without samples are left out. The circuits are a bit mask, so instead of
+ * their aggregates, every sample where the mask changed is logged.
+ *
+ * @param[in] now_ms    Current time in milliseconds (e.g. millis()).
+ * @param[in] last_ms   Time to go back, 0 for all samples held.
+ * @param[in] bucket_ms Width of each bucket.
+ */
+void
+PoolStateHistory::dump(uint32_t const now_ms, uint32_t const last_ms, uint32_t const bucket_ms) const
+{
+    if (bucket_ms == 0) { ESP_LOGW(TAG, "invalid args to %s", __func__); return; }
+
+    uint32_t const span_ms = (last_ms != 0 && last_ms < SPAN_MS) ? last_ms : SPAN_MS;
+    uint32_t const count = (span_ms + bucket_ms - 1) / bucket_ms;
+    uint32_t const from_ms = now_ms - count * bucket_ms + 1;
+
+    static char const * const units[NUM_SERIES] = {"F", "W", "RPM", "GPM", "PPM", ""};
+
+    ESP_LOGI(TAG, "History (%lu samples, %lu min buckets):",
+             static_cast<unsigned long>(get_sample_count()), static_cast<unsigned long>(bucket_ms / 60000));
+
+    for (uint32_t bb = 0; bb < count; bb++) {
+
+        uint32_t const start_ms = from_ms + bb * bucket_ms;
+        char line[160];
+        size_t len = 0;
+        bool any = false;
+
+        for (auto const series : magic_enum::enum_values<poolstate_history_series_t>()) {
+
+            if (series == poolstate_history_series_t::CIRCUITS) {
+                continue;
+            }
+            poolstate_history_bucket_t bucket;
+            this->downsample(series, start_ms, bucket_ms, &bucket, 1);
+            if (bucket.count == 0) {
+                continue;
+            }
+            any = true;
+            if (len < sizeof(line)) {
+                len += snprintf(line + len, sizeof(line) - len, " %s %ld/%ld/%ld %s",
+                                enum_str(series), static_cast<long>(bucket.min), static_cast<long>(bucket.avg),
+                                static_cast<long>(bucket.max), units[enum_index(series)]);
+            }
+        }
+        if (any) {
+            ESP_LOGI(TAG, "  -%lu min:%s", static_cast<unsigned long>((now_ms - start_ms) / 60000), line);
+        }
+    }
+
+        // the circuits, in chunks so the stack stays small
+    poolstate_history_point_t points[16];
+    uint32_t t_ms = from_ms;
+    int64_t prev = -1;
+    size_t n;
+    do {
+        n = this->query(poolstate_history_series_t::CIRCUITS, t_ms, now_ms, points, std::size(points));
+        for (size_t ii = 0; ii < n; ii++) {
+            if (points[ii].value != prev) {
+                ESP_LOGI(TAG, "  -%lu min: CIRCUITS 0x%03lX", static_cast<unsigned long>((now_ms - points[ii].time_ms) / 60000),
+                         static_cast<unsigned long>(points[ii].value));
+                prev = points[ii].value;
+            }
+        }
+        if (n > 0) {
+            t_ms = points[n - 1].time_ms + 1;
+        }
+    } while (n == std::size(points));
+}
+
+uint32_t
+PoolStateHistory::get_sample_count() const
+{
+    uint32_t samples = 0;
+    for (auto const & block : blocks_) {
+        samples += block.samples;
+    }
+    return samples;
+}
+
+uint32_t
+PoolStateHistory::get_byte_count() const
+{
+    uint32_t bytes = 0;
+    for (auto const & block : blocks_) {
+        bytes += block.len;
+    }
+    return bytes;
+}
+
+}  // namespace opnpool
+}  // namespace esphome
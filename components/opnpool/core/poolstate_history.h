@@ -0,0 +1,176 @@
+/**
+ * @file poolstate_history.h
+ * @brief In-memory time series of pool state samples.
+ *
+ * @details
+ * Keeps the last 24 hours of a few key pool state values on the device itself, so trends
+ * survive Home Assistant outages. Samples are taken at a fixed interval from the pool
+ * state in OpnPool::loop() and stored in a fixed-size ring of blocks.
+ *
+ * Each block starts with a key frame (absolute values) and stores the following samples
+ * as zigzag varint deltas. A sample whose values and validity didn't change takes a
+ * single byte. Every block also keeps min/max/sum per series, so downsampled queries
+ * only decode the blocks that straddle a bucket boundary.
+ *
+ * Intended for use in the single-threaded ESPHome main task.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+#ifndef __cplusplus
+# error "Requires C++ compilation"
+#endif
+
+#include <esp_system.h>
+#include <esp_types.h>
+
+#include "utils/enum_helpers.h"
+
+namespace esphome {
+namespace opnpool {
+
+    // forward declarations (to avoid circular dependencies)
+struct poolstate_t;
+
+/// @brief Pool state values recorded in the history.
+enum class poolstate_history_series_t : uint8_t {
+    WATER_TEMP = 0,  ///< Water temperature in °F.
+    PUMP_POWER = 1,  ///< Primary pump power in W.
+    PUMP_SPEED = 2,  ///< Primary pump speed in RPM.
+    PUMP_FLOW  = 3,  ///< Primary pump flow in GPM.
+    CHLOR_SALT = 4,  ///< Chlorinator salt level in PPM.
+    CIRCUITS   = 5   ///< Bit mask of active circuits (bit n is network_pool_circuit_t n).
+};
+
+/// @brief One decoded sample of a series.
+struct poolstate_history_point_t {
+    uint32_t time_ms;  ///< Time of the sample (millis()).
+    int32_t  value;    ///< Value of the sample.
+};
+
+/// @brief Aggregate of the valid samples in a time bucket.
+struct poolstate_history_bucket_t {
+    uint32_t start_ms;  ///< Start of the bucket (millis()).
+    uint16_t count;     ///< Number of valid samples in the bucket (0 if none).
+    int32_t  min;       ///< Minimum value.
+    int32_t  max;       ///< Maximum value.
+    int32_t  avg;       ///< Average value (rounded toward zero).
+};
+
+/**
+ * @brief Fixed-RAM ring of delta compressed pool state samples.
+ */
+class PoolStateHistory {
+
+  public:
+    static constexpr uint32_t SAMPLE_INTERVAL_MS = 60 * 1000;  ///< Time between samples.
+    static constexpr uint16_t BLOCK_SAMPLES      = 60;         ///< Max samples per block.
+    static constexpr uint16_t BLOCK_BYTES        = 448;        ///< Compressed bytes per block.
+    static constexpr uint8_t  NUM_BLOCKS         = 26;         ///< 24 h of full blocks, plus slack.
+    static constexpr uint8_t  NUM_SERIES         = enum_count<poolstate_history_series_t>();
+    static constexpr uint32_t SPAN_MS            = NUM_BLOCKS * BLOCK_SAMPLES * SAMPLE_INTERVAL_MS;  ///< Oldest sample held.
+
+    PoolStateHistory();
+
+    /// @brief Returns true if the next sample is due.
+    [[nodiscard]] bool is_due(uint32_t const now_ms) const {
+        return !started_ || static_cast<int32_t>(now_ms - last_sample_ms_) >= static_cast<int32_t>(SAMPLE_INTERVAL_MS);
+    }
+
+    /**
+     * @brief Records a sample if SAMPLE_INTERVAL_MS passed since the previous one.
+     *
+     * @param[in] state  Current pool state.
+     * @param[in] now_ms Current time in milliseconds (e.g. millis()).
+     */
+    void sample(poolstate_t const * const state, uint32_t const now_ms);
+
+    /**
+     * @brief Returns the samples of a series within a time range.
+     *
+     * @param[in]  series  The series to query.
+     * @param[in]  from_ms Start of the range (inclusive).
+     * @param[in]  to_ms   End of the range (inclusive).
+     * @param[out] points  Array to receive the valid samples, oldest first.
+     * @param[in]  max     Size of the array.
+     * @return             Number of samples returned.
+     */
+    size_t query(poolstate_history_series_t const series, uint32_t const from_ms, uint32_t const to_ms,
+                 poolstate_history_point_t * const points, size_t const max) const;
+
+    /**
+     * @brief Returns min/max/avg of a series per time bucket.
+     *
+     * @param[in]  series    The series to query.
+     * @param[in]  from_ms   Start of the first bucket.
+     * @param[in]  bucket_ms Width of each bucket.
+     * @param[out] buckets   Array to receive the buckets.
+     * @param[in]  count     Number of buckets to compute.
+     */
+    void downsample(poolstate_history_series_t const series, uint32_t const from_ms, uint32_t const bucket_ms,
+                    poolstate_history_bucket_t * const buckets, size_t const count) const;
+
+    /**
+     * @brief Logs min/avg/max per bucket, and the circuit changes, of a recent time range.
+     *
+     * @param[in] now_ms    Current time in milliseconds (e.g. millis()).
+     * @param[in] last_ms   Time to go back, 0 for all samples held.
+     * @param[in] bucket_ms Width of each bucket.
+     */
+    void dump(uint32_t const now_ms, uint32_t const last_ms, uint32_t const bucket_ms) const;
+
+    /// @brief Returns the number of samples held.
+    [[nodiscard]] uint32_t get_sample_count() const;
+
+    /// @brief Returns the number of compressed bytes held.
+    [[nodiscard]] uint32_t get_byte_count() const;
+
+    /// @brief Returns the number of bytes the held samples would take uncompressed.
+    [[nodiscard]] uint32_t get_raw_byte_count() const { return get_sample_count() * (1 + NUM_SERIES * sizeof(int32_t)); }
+
+  private:
+    /// @brief Running min/max/sum over the valid samples of a series in a block.
+    struct aggr_t {
+        int32_t  min;
+        int32_t  max;
+        int64_t  sum;
+        uint16_t count;
+    };
+
+    /// @brief A key frame followed by delta encoded samples.
+    struct block_t {
+        uint32_t start_ms;           ///< Time of the first sample.
+        uint16_t samples;            ///< Number of samples in the block (0 if unused).
+        uint16_t len;                ///< Number of bytes used in data[].
+        uint8_t  last_valid;         ///< Validity mask of the last sample (encoder state).
+        int32_t  last[NUM_SERIES];   ///< Values of the last sample (encoder state).
+        aggr_t   aggr[NUM_SERIES];   ///< Aggregates per series.
+        uint8_t  data[BLOCK_BYTES];  ///< Encoded samples.
+    };
+
+    /// @brief Decoder state while walking the samples of a block.
+    struct cursor_t {
+        block_t const * block;
+        uint16_t        pos;
+        uint16_t        idx;
+        uint8_t         valid;
+        int32_t         values[NUM_SERIES];
+    };
+
+    static void begin_(block_t const * const block, cursor_t * const cursor);
+    static bool next_(cursor_t * const cursor);
+
+    void open_block_(uint32_t const now_ms);
+    bool append_(block_t * const block, uint8_t const valid, int32_t const * const values);
+
+    block_t  blocks_[NUM_BLOCKS];  ///< Ring of blocks.
+    uint8_t  head_;                ///< Index of the block being filled.
+    bool     started_;             ///< True once the first sample was taken.
+    uint32_t last_sample_ms_;      ///< Time of the last sample.
+};
+
+}  // namespace opnpool
+}  // namespace esphome
@@ -0,0 +1,258 @@
+/**
+ * @file poolstate_metrics.cpp
+ * @brief Metrics derived from the pool state, such as pump energy and heater duty cycle.
+ *
+ * @details
+ * Implements PoolStateMetrics. Each feed integrates the values held since the previous
+ * feed (left Riemann sum) into the current bucket of every window, and into the window
+ * total. When the current bucket is older than BUCKET_MS, the next bucket is reused;
+ * its old contents are first subtracted from the total, so the total always covers the
+ * last NUM_BUCKETS buckets without rescanning them.
+ *
+ * The time between feeds is capped at MAX_GAP_MS, so a value is not held over a stall
+ * of the main loop or a gap in the pool state.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <esp_system.h>
+#include <esp_types.h>
+#include <esphome/core/log.h>
+#include <cstring>
+
+#include "poolstate_metrics.h"
+#include "poolstate.h"
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wunused-parameter"
+
+namespace esphome {
+namespace opnpool {
+
+constexpr char TAG[] = "poolstate_metrics";
+
+PoolStateMetrics::PoolStateMetrics() :
+    power_{false, 0.0f}, flow_{false, 0.0f}, held_{}, pool_volume_gal_{0},
+    head_start_ms_{0}, last_feed_ms_{0}, head_{0}, started_{false}
+{
+    memset(windows_, 0, sizeof(windows_));
+    memset(&water_temp_, 0, sizeof(water_temp_));
+}
+
+/**
+ * @brief Moves the window forward to the bucket that contains now_ms.
+ *
+ * @details
+ * Each bucket that is reused is subtracted from its window total first. If the window
+ * moved by more than its length, everything is cleared instead.
+ *
+ * @param[in] now_ms Current time in milliseconds.
+ */
+void
+PoolStateMetrics::advance_(uint32_t const now_ms)
+{
+    uint32_t const elapsed = now_ms - head_start_ms_;
+    if (elapsed < BUCKET_MS) {
+        return;
+    }
+    uint32_t const steps = elapsed / BUCKET_MS;
+
+    if (steps >= NUM_BUCKETS) {
+        for (auto & window : windows_) {
+            memset(window.bucket, 0, sizeof(window.bucket));
+            window.total = 0;
+        }
+        water_temp_.valid = 0;
+        head_start_ms_ = now_ms;
+        ESP_LOGV(TAG, "window cleared after %lu buckets", static_cast<unsigned long>(steps));
+        return;
+    }
+    for (uint32_t ss = 0; ss < steps; ss++) {
+        head_ = (head_ + 1) % NUM_BUCKETS;
+        for (auto & window : windows_) {
+            window.total -= window.bucket[head_];
+            window.bucket[head_] = 0;
+        }
+        water_temp_.valid &= ~(1UL << head_);
+    }
+    head_start_ms_ += steps * BUCKET_MS;
+}
+
+/**
+ * @brief Adds an amount to the current bucket of a window.
+ *
+ * @param[in] idx    The window.
+ * @param[in] valid  True if the value behind the amount was valid; otherwise nothing is added.
+ * @param[in] amount The amount to add.
+ */
+void
+PoolStateMetrics::add_(window_idx_t const idx, bool const valid, uint32_t const amount)
+{
+    if (!valid) {
+        return;
+    }
+    window_t * const window = &windows_[idx];
+    window->bucket[head_] += amount;
+    window->total += amount;
+    window->seen = true;
+}
+
+/**
+ * @brief Updates a moving average with a value held for dt_ms.
+ *
+ * @details
+ * Uses alpha = dt / (tau + dt), so the result does not depend on how often it is fed.
+ *
+ * @param[in,out] ewma  The average.
+ * @param[in]     value The new value.
+ * @param[in]     dt_ms Time that the value was held.
+ */
+void
+PoolStateMetrics::average_(ewma_t * const ewma, float const value, uint32_t const dt_ms)
+{
+    if (!ewma->valid) {
+        ewma->value = value;
+        ewma->valid = true;
+        return;
+    }
+    float const alpha = static_cast<float>(dt_ms) / static_cast<float>(EWMA_TAU_MS + dt_ms);
+    ewma->value += alpha * (value - ewma->value);
+}
+
+void
+PoolStateMetrics::feed(poolstate_t const * const state, uint32_t const now_ms)
+{
+    if (!state) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return;
+    }
+    if (!started_) {
+        head_start_ms_ = now_ms;
+        started_ = true;
+    } else {
+        uint32_t dt_ms = now_ms - last_feed_ms_;
+        if (dt_ms > MAX_GAP_MS) {
+            dt_ms = MAX_GAP_MS;
+        }
+        advance_(now_ms);
+
+            // integrate the values held since the previous feed
+        add_(WINDOW_ENERGY, held_.power_valid, (static_cast<uint32_t>(held_.power) * dt_ms + 500) / 1000);
+        add_(WINDOW_VOLUME, held_.flow_valid, (static_cast<uint32_t>(held_.flow) * dt_ms + 500) / 1000);
+        add_(WINDOW_HEAT_ON, held_.heat_valid, held_.heating ? dt_ms : 0);
+        add_(WINDOW_HEAT_SEEN, held_.heat_valid, dt_ms);
+        add_(WINDOW_POOL_ON, held_.pool_valid, held_.pool_on ? dt_ms : 0);
+        add_(WINDOW_SPA_ON, held_.spa_valid, held_.spa_on ? dt_ms : 0);
+
+            // averages only while water flows, so efficiency and turnover reflect the pump running
+        if (held_.power_valid && held_.flow_valid && held_.flow > 0) {
+            average_(&power_, held_.power, dt_ms);
+            average_(&flow_, held_.flow, dt_ms);
+        }
+    }
+    last_feed_ms_ = now_ms;
+
+        // hold the current values until the next feed
+    auto const & pump = state->pumps[enum_index(datalink_pump_id_t::PRIMARY)];
+    auto const & pool_thermo = state->thermos[enum_index(poolstate_thermo_typ_t::POOL)];
+    auto const & spa_thermo = state->thermos[enum_index(poolstate_thermo_typ_t::SPA)];
+    auto const & pool = state->circuits[enum_index(network_pool_circuit_t::POOL)];
+    auto const & spa = state->circuits[enum_index(network_pool_circuit_t::SPA)];
+
+    held_.power_valid = pump.power.valid;
+    held_.power = pump.power.value;
+    held_.flow_valid = pump.flow.valid;
+    held_.flow = pump.flow.value;
+    held_.heat_valid = pool_thermo.heating.valid || spa_thermo.heating.valid;
+    held_.heating = (pool_thermo.heating.valid && pool_thermo.heating.value) ||
+                    (spa_thermo.heating.valid && spa_thermo.heating.value);
+    held_.pool_valid = pool.active.valid;
+    held_.pool_on = pool.active.value;
+    held_.spa_valid = spa.active.valid;
+    held_.spa_on = spa.active.value;
+
+        // water temperature extremes are sampled, not integrated
+    auto const & water = state->temps[enum_index(poolstate_temp_typ_t::WATER)];
+    if (water.valid) {
+        uint32_t const bit = 1UL << head_;
+        if (!(water_temp_.valid & bit)) {
+            water_temp_.min[head_] = water.value;
+            water_temp_.max[head_] = water.value;
+            water_temp_.valid |= bit;
+        } else if (water.value < water_temp_.min[head_]) {
+            water_temp_.min[head_] = water.value;
+        } else if (water.value > water_temp_.max[head_]) {
+            water_temp_.max[head_] = water.value;
+        }
+    }
+}
+
+bool
+PoolStateMetrics::get(poolstate_metric_t const metric, float * const value) const
+{
+    if (!value) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return false;
+    }
+    auto const & energy = windows_[WINDOW_ENERGY];
+    auto const & volume = windows_[WINDOW_VOLUME];
+    auto const & heat_on = windows_[WINDOW_HEAT_ON];
+    auto const & heat_seen = windows_[WINDOW_HEAT_SEEN];
+    auto const & pool_on = windows_[WINDOW_POOL_ON];
+    auto const & spa_on = windows_[WINDOW_SPA_ON];
+    constexpr float MS_PER_HOUR = 3600.0f * 1000.0f;
+
+    switch (metric) {
+        case poolstate_metric_t::PUMP_ENERGY:
+            if (!energy.seen) return false;
+            *value = static_cast<float>(energy.total) / MS_PER_HOUR;  // W·s to kWh
+            return true;
+        case poolstate_metric_t::PUMP_VOLUME:
+            if (!volume.seen) return false;
+            *value = static_cast<float>(volume.total) / 60.0f;  // GPM·s to gal
+            return true;
+        case poolstate_metric_t::PUMP_EFFICIENCY:
+            if (!power_.valid || !flow_.valid || flow_.value <= 0.0f) return false;
+            *value = power_.value / flow_.value;
+            return true;
+        case poolstate_metric_t::TURNOVER_TIME:
+            if (pool_volume_gal_ == 0 || !flow_.valid || flow_.value <= 0.0f) return false;
+            *value = static_cast<float>(pool_volume_gal_) / (flow_.value * 60.0f);
+            return true;
+        case poolstate_metric_t::HEATER_DUTY:
+            if (!heat_seen.seen || heat_seen.total == 0) return false;
+            *value = 100.0f * static_cast<float>(heat_on.total) / static_cast<float>(heat_seen.total);
+            return true;
+        case poolstate_metric_t::POOL_RUNTIME:
+            if (!pool_on.seen) return false;
+            *value = static_cast<float>(pool_on.total) / MS_PER_HOUR;
+            return true;
+        case poolstate_metric_t::SPA_RUNTIME:
+            if (!spa_on.seen) return false;
+            *value = static_cast<float>(spa_on.total) / MS_PER_HOUR;
+            return true;
+        case poolstate_metric_t::WATER_TEMP_MIN:
+        case poolstate_metric_t::WATER_TEMP_MAX: {
+            if (!water_temp_.valid) return false;
+            bool const is_min = metric == poolstate_metric_t::WATER_TEMP_MIN;
+            uint8_t result = is_min ? UINT8_MAX : 0;
+            for (uint8_t bb = 0; bb < NUM_BUCKETS; bb++) {
+                if (!(water_temp_.valid & (1UL << bb))) {
+                    continue;
+                }
+                uint8_t const candidate = is_min ? water_temp_.min[bb] : water_temp_.max[bb];
+                if (is_min ? candidate < result : candidate > result) {
+                    result = candidate;
+                }
+            }
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace opnpool
+}  // namespace esphome
@@ -0,0 +1,167 @@
+/**
+ * @file poolstate_metrics.h
+ * @brief Metrics derived from the pool state, such as pump energy and heater duty cycle.
+ *
+ * @details
+ * Computes on the device what used to take Home Assistant templates, so the metrics
+ * don't break when Home Assistant restarts. OpnPool::loop() feeds the pool state every
+ * FEED_INTERVAL_MS, and each feed updates the aggregates incrementally, in O(1):
+ *
+ *   - Integrals of the values held since the previous feed (pump energy, water moved,
+ *     heater and circuit runtime), summed per bucket of a sliding 24 hour window.
+ *   - Min/max per bucket of the same window (water temperature).
+ *   - Time based exponentially weighted moving averages (pump power and flow while the
+ *     pump runs).
+ *
+ * The window moves one hourly bucket at a time; the oldest bucket is subtracted from
+ * the running total as it is reused. All memory is in the object itself.
+ *
+ * Intended for use in the single-threaded ESPHome main task.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+#ifndef __cplusplus
+# error "Requires C++ compilation"
+#endif
+
+#include <esp_system.h>
+#include <esp_types.h>
+
+#include "utils/enum_helpers.h"
+
+namespace esphome {
+namespace opnpool {
+
+    // forward declarations (to avoid circular dependencies)
+struct poolstate_t;
+
+/// @brief Metrics derived from the pool state.
+enum class poolstate_metric_t : uint8_t {
+    PUMP_ENERGY     = 0,  ///< Primary pump energy over the window [kWh].
+    PUMP_VOLUME     = 1,  ///< Water moved by the primary pump over the window [gal].
+    PUMP_EFFICIENCY = 2,  ///< Primary pump power per flow while it runs, averaged [W/GPM].
+    TURNOVER_TIME   = 3,  ///< Time to move the pool volume at the average flow [h].
+    HEATER_DUTY     = 4,  ///< Part of the time that a heater was heating, over the window [%].
+    POOL_RUNTIME    = 5,  ///< Time that the pool circuit was on, over the window [h].
+    SPA_RUNTIME     = 6,  ///< Time that the spa circuit was on, over the window [h].
+    WATER_TEMP_MIN  = 7,  ///< Lowest water temperature over the window [°F].
+    WATER_TEMP_MAX  = 8   ///< Highest water temperature over the window [°F].
+};
+
+/**
+ * @brief Incremental aggregates over the pool state, with fixed memory.
+ */
+class PoolStateMetrics {
+
+  public:
+    static constexpr uint32_t FEED_INTERVAL_MS = 10 * 1000;       ///< Time between feeds.
+    static constexpr uint32_t MAX_GAP_MS       = 60 * 1000;       ///< Longest time a value is held between feeds.
+    static constexpr uint8_t  NUM_BUCKETS      = 24;              ///< Buckets in the sliding window.
+    static constexpr uint32_t BUCKET_MS        = 60 * 60 * 1000;  ///< Time covered by each bucket.
+    static constexpr uint32_t EWMA_TAU_MS      = 5 * 60 * 1000;   ///< Time constant of the moving averages.
+
+    PoolStateMetrics();
+
+    /**
+     * @brief Sets the pool volume, needed for the turnover time.
+     *
+     * @param[in] gallons Pool volume in gallons, or 0 if unknown.
+     */
+    void set_pool_volume(uint32_t const gallons) { pool_volume_gal_ = gallons; }
+
+    /// @brief Returns true if the next feed is due.
+    [[nodiscard]] bool is_due(uint32_t const now_ms) const {
+        return !started_ || static_cast<int32_t>(now_ms - last_feed_ms_) >= static_cast<int32_t>(FEED_INTERVAL_MS);
+    }
+
+    /**
+     * @brief Updates the aggregates with the pool state.
+     *
+     * @details
+     * The values of the previous feed are integrated over the time since then, so a
+     * value counts from the feed that saw it until the next one.
+     *
+     * @param[in] state  Current pool state.
+     * @param[in] now_ms Current time in milliseconds (e.g. millis()).
+     */
+    void feed(poolstate_t const * const state, uint32_t const now_ms);
+
+    /**
+     * @brief Returns the current value of a metric.
+     *
+     * @param[in]  metric The metric.
+     * @param[out] value  Its value, in the unit listed with poolstate_metric_t.
+     * @return            False if there is no data for it yet.
+     */
+    [[nodiscard]] bool get(poolstate_metric_t const metric, float * const value) const;
+
+  private:
+    /// @brief Series that are summed over the window.
+    enum window_idx_t : uint8_t {
+        WINDOW_ENERGY,     ///< Pump energy [W·s].
+        WINDOW_VOLUME,     ///< Water moved [GPM·s].
+        WINDOW_HEAT_ON,    ///< Time that a heater was heating [ms].
+        WINDOW_HEAT_SEEN,  ///< Time that the heater state was known [ms].
+        WINDOW_POOL_ON,    ///< Time that the pool circuit was on [ms].
+        WINDOW_SPA_ON,     ///< Time that the spa circuit was on [ms].
+        NUM_WINDOWS
+    };
+
+    /// @brief Sum of a series over the buckets of the window.
+    struct window_t {
+        uint32_t bucket[NUM_BUCKETS];  ///< Sum per bucket, head_ collects the current hour.
+        uint32_t total;                ///< Sum over all buckets.
+        bool     seen;                 ///< True once the series had a valid value.
+    };
+
+    /// @brief Min/max of a series per bucket of the window.
+    struct extremes_t {
+        uint8_t  min[NUM_BUCKETS];  ///< Minimum per bucket.
+        uint8_t  max[NUM_BUCKETS];  ///< Maximum per bucket.
+        uint32_t valid;             ///< Bit n set if bucket n has a value.
+    };
+
+    /// @brief Exponentially weighted moving average, weighted by time.
+    struct ewma_t {
+        bool  valid;  ///< True once it has a value.
+        float value;  ///< The average.
+    };
+
+    /// @brief Values from the previous feed, held until this one.
+    struct held_t {
+        bool     power_valid;
+        uint16_t power;    ///< Pump power [W].
+        bool     flow_valid;
+        uint16_t flow;     ///< Pump flow [GPM].
+        bool     heat_valid;
+        bool     heating;  ///< True if a heater is heating.
+        bool     pool_valid;
+        bool     pool_on;  ///< True if the pool circuit is on.
+        bool     spa_valid;
+        bool     spa_on;   ///< True if the spa circuit is on.
+    };
+
+    void advance_(uint32_t const now_ms);
+    void add_(window_idx_t const idx, bool const valid, uint32_t const amount);
+    static void average_(ewma_t * const ewma, float const value, uint32_t const dt_ms);
+
+    window_t   windows_[NUM_WINDOWS];  ///< Sums over the window.
+    extremes_t water_temp_;            ///< Water temperature [°F] min/max over the window.
+    ewma_t     power_;                 ///< Pump power while it runs [W].
+    ewma_t     flow_;                  ///< Pump flow while it runs [GPM].
+    held_t     held_;                  ///< Values from the previous feed.
+    uint32_t   pool_volume_gal_;       ///< Pool volume [gal], 0 if unknown.
+    uint32_t   head_start_ms_;         ///< Start of the current bucket.
+    uint32_t   last_feed_ms_;          ///< Time of the previous feed.
+    uint8_t    head_;                  ///< Index of the current bucket.
+    bool       started_;               ///< False until the first feed.
+};
+
+static_assert(PoolStateMetrics::NUM_BUCKETS <= 32, "extremes_t::valid has one bit per bucket");
+
+}  // namespace opnpool
+}  // namespace esphome
@@ -13,9 +13,10 @@
  * publishing sensor values, driving automation, and integrating with ESPHome and Home
  * Assistant entities.
  *
- * Verbose debug logging and diagnostics are supported via cJSON objects, allowing
- * detailed inspection of state changes and message processing for troubleshooting and
- * development.
+ * Verbose debug logging and diagnostics are supported via a streaming JSON writer,
+ * allowing detailed inspection of state changes and message processing for
+ * troubleshooting and development. The writer uses a fixed buffer, so verbose logging
+ * doesn't add heap allocations to the message path.
  *
  * Design notes:
  * - ESPHome operates in a single-threaded environment, so explicit thread safety
@@ -37,10 +38,13 @@
 #include <freertos/task.h>
 #include <freertos/semphr.h>
 #include <esphome/core/log.h>
-#include <cJSON.h>
 #include <type_traits>
+#include <array>
+#include <tuple>
+#include <cstddef>
 
 #include "utils/to_str.h"
+#include "utils/json_writer.h"
 #include "utils/enum_helpers.h"
 #include "pool_task/network.h"
 #include "pool_task/network_msg.h"
@@ -48,6 +52,7 @@
 #include "poolstate.h"
 #include "opnpool.h"
 #include "poolstate_rx_log.h"
+#include "poolstate_fields.h"
 #include "opnpool_ids.h"
 #pragma GCC diagnostic error "-Wall"
 #pragma GCC diagnostic error "-Wextra"
@@ -93,7 +98,7 @@ _update_circuit_delay_from_bits(poolstate_circuit_t * const arr, uint16_t const
 }
 
 static void
-_update_circuits(cJSON * const dbg, network_ctrl_state_bcast_t const * const msg, poolstate_circuit_t * const circuits)
+_update_circuits(JsonWriter * const dbg, network_ctrl_state_bcast_t const * const msg, poolstate_circuit_t * const circuits)
 {
     constexpr uint8_t pool_idx = enum_index(network_pool_circuit_t::POOL);
     constexpr uint8_t spa_idx  = enum_index(network_pool_circuit_t::SPA);
@@ -117,7 +122,7 @@ _update_circuits(cJSON * const dbg, network_ctrl_state_bcast_t const * const msg
 }
 
 static void
-_update_thermos(cJSON * const dbg, network_ctrl_state_bcast_t const * const msg, poolstate_thermo_t * const thermos, poolstate_circuit_t const * const circuits)
+_update_thermos(JsonWriter * const dbg, network_ctrl_state_bcast_t const * const msg, poolstate_thermo_t * const thermos, poolstate_circuit_t const * const circuits)
 {
         // update circuits.thermos (only update when the pump is running)
     constexpr uint8_t pool_therm_idx = enum_index(poolstate_thermo_typ_t::POOL);
@@ -167,7 +172,7 @@ _update_thermos(cJSON * const dbg, network_ctrl_state_bcast_t const * const msg,
 }
 
 static void
-_update_system_modes(cJSON * const dbg, network_ctrl_state_bcast_t const * const msg, poolstate_modes_t * const mode)
+_update_system_modes(JsonWriter * const dbg, network_ctrl_state_bcast_t const * const msg, poolstate_modes_t * const mode)
 {
     *mode = {
         .valid = true,
@@ -180,7 +185,7 @@ _update_system_modes(cJSON * const dbg, network_ctrl_state_bcast_t const * const
 }
 
 static void
-_update_system_time(cJSON * const dbg, network_ctrl_state_bcast_t const * const msg, poolstate_time_t * const time)
+_update_system_time(JsonWriter * const dbg, network_ctrl_state_bcast_t const * const msg, poolstate_time_t * const time)
 {
     *time = {
         .valid = true,
@@ -194,7 +199,7 @@ _update_system_time(cJSON * const dbg, network_ctrl_state_bcast_t const * const
 }
 
 static void
-_update_temps(cJSON * const dbg, network_ctrl_state_bcast_t const * const msg, poolstate_uint8_t * const temps)
+_update_temps(JsonWriter * const dbg, network_ctrl_state_bcast_t const * const msg, poolstate_uint8_t * const temps)
 {
     uint8_t const air_idx = enum_index(poolstate_temp_typ_t::AIR);
     uint8_t const water_idx = enum_index(poolstate_temp_typ_t::WATER);
@@ -219,6 +224,64 @@ _update_temps(cJSON * const dbg, network_ctrl_state_bcast_t const * const msg, p
 
 /// @}
 
+/// @name Field Descriptors
+/// @brief Where the plain values of a message go in the pool state, see poolstate_fields.h.
+/// @{
+
+using enc_t = poolstate_field_enc_t;
+namespace log_key = poolstate_rx_log;
+
+constexpr auto _pump_status_fields = std::make_tuple(
+    poolstate_field(offsetof(network_pump_status_resp_t, mode),      enc_t::RAW,       &poolstate_pump_t::mode,  log_key::KEY_MODE),
+    poolstate_field(offsetof(network_pump_status_resp_t, clock),     enc_t::RAW,       &poolstate_pump_t::time,  log_key::KEY_TIME),
+    poolstate_field(offsetof(network_pump_status_resp_t, state),     enc_t::RAW,       &poolstate_pump_t::state, log_key::KEY_STATE),
+    poolstate_field(offsetof(network_pump_status_resp_t, power),     enc_t::U16_HI_LO, &poolstate_pump_t::power, log_key::KEY_POWER),
+    poolstate_field(offsetof(network_pump_status_resp_t, speed),     enc_t::U16_HI_LO, &poolstate_pump_t::speed, log_key::KEY_SPEED),
+    poolstate_field(offsetof(network_pump_status_resp_t, flow),      enc_t::U8,        &poolstate_pump_t::flow,  log_key::KEY_FLOW, 1, true),
+    poolstate_field(offsetof(network_pump_status_resp_t, level),     enc_t::U8,        &poolstate_pump_t::level, log_key::KEY_LEVEL, 1, true),
+    poolstate_field(offsetof(network_pump_status_resp_t, error),     enc_t::U8,        &poolstate_pump_t::error, log_key::KEY_ERROR),
+    poolstate_field(offsetof(network_pump_status_resp_t, remaining), enc_t::RAW,       &poolstate_pump_t::timer, log_key::KEY_TIMER)
+);
+static_assert(poolstate_fields::fits<network_pump_status_resp_t>(_pump_status_fields), "bad PUMP_STATUS_RESP field");
+
+    // thermostat values are logged together by poolstate_rx_log::add_thermos()
+constexpr auto _heat_resp_pool_fields = std::make_tuple(
+    poolstate_field(offsetof(network_ctrl_heat_resp_t, pool_temp),      enc_t::U8, &poolstate_thermo_t::temp_in_f,      nullptr),
+    poolstate_field(offsetof(network_ctrl_heat_resp_t, pool_set_point), enc_t::U8, &poolstate_thermo_t::set_point_in_f, nullptr)
+);
+constexpr auto _heat_resp_spa_fields = std::make_tuple(
+    poolstate_field(offsetof(network_ctrl_heat_resp_t, spa_temp),       enc_t::U8, &poolstate_thermo_t::temp_in_f,      nullptr),
+    poolstate_field(offsetof(network_ctrl_heat_resp_t, spa_set_point),  enc_t::U8, &poolstate_thermo_t::set_point_in_f, nullptr)
+);
+static_assert(poolstate_fields::fits<network_ctrl_heat_resp_t>(_heat_resp_pool_fields), "bad CTRL_HEAT_RESP field");
+static_assert(poolstate_fields::fits<network_ctrl_heat_resp_t>(_heat_resp_spa_fields), "bad CTRL_HEAT_RESP field");
+
+constexpr auto _heat_set_pool_fields = std::make_tuple(
+    poolstate_field(offsetof(network_ctrl_heat_set_t, pool_set_point), enc_t::U8, &poolstate_thermo_t::set_point_in_f, nullptr)
+);
+constexpr auto _heat_set_spa_fields = std::make_tuple(
+    poolstate_field(offsetof(network_ctrl_heat_set_t, spa_set_point),  enc_t::U8, &poolstate_thermo_t::set_point_in_f, nullptr)
+);
+static_assert(poolstate_fields::fits<network_ctrl_heat_set_t>(_heat_set_pool_fields), "bad CTRL_HEAT_SET field");
+static_assert(poolstate_fields::fits<network_ctrl_heat_set_t>(_heat_set_spa_fields), "bad CTRL_HEAT_SET field");
+
+constexpr auto _chlor_model_resp_fields = std::make_tuple(
+    poolstate_field(offsetof(network_chlor_model_resp_t, salt), enc_t::U8, &poolstate_chlor_t::salt, log_key::KEY_SALT, 50)
+);
+static_assert(poolstate_fields::fits<network_chlor_model_resp_t>(_chlor_model_resp_fields), "bad CHLOR_MODEL_RESP field");
+
+constexpr auto _chlor_level_set_fields = std::make_tuple(
+    poolstate_field(offsetof(network_chlor_level_set_t, level), enc_t::U8, &poolstate_chlor_t::level, log_key::KEY_LEVEL)
+);
+static_assert(poolstate_fields::fits<network_chlor_level_set_t>(_chlor_level_set_fields), "bad CHLOR_LEVEL_SET field");
+
+constexpr auto _chlor_level_resp_fields = std::make_tuple(
+    poolstate_field(offsetof(network_chlor_level_resp_t, salt), enc_t::U8, &poolstate_chlor_t::salt, log_key::KEY_SALT, 50)
+);
+static_assert(poolstate_fields::fits<network_chlor_level_resp_t>(_chlor_level_resp_fields), "bad CHLOR_LEVEL_RESP field");
+
+/// @}
+
 /// @name Pump Message Handlers
 /// @brief Handlers for messages from variable-speed pumps.
 /// @{
@@ -234,7 +297,7 @@ _update_temps(cJSON * const dbg, network_ctrl_state_bcast_t const * const msg, p
  * verbose logging is enabled, logs the register update to the debug JSON object.
  */
 static void
-_pump_reg_set(cJSON * const dbg, network_pump_reg_set_t const * const msg, datalink_pump_id_t const pump_id)
+_pump_reg_set(JsonWriter * const dbg, network_pump_reg_set_t const * const msg, datalink_pump_id_t const pump_id)
 {
     if (!msg) {
         ESP_LOGW(TAG, "null to %s", __func__);
@@ -260,7 +323,7 @@ _pump_reg_set(cJSON * const dbg, network_pump_reg_set_t const * const msg, datal
  * enabled, logs the value to the debug JSON object.
  */
 static void
-_pump_reg_resp(cJSON * const dbg, network_pump_reg_resp_t const * const msg, datalink_pump_id_t const pump_id)
+_pump_reg_resp(JsonWriter * const dbg, network_pump_reg_resp_t const * const msg, datalink_pump_id_t const pump_id)
 {
     if (!msg) {
         ESP_LOGW(TAG, "null to %s", __func__);
@@ -279,18 +342,23 @@ _pump_reg_resp(cJSON * const dbg, network_pump_reg_resp_t const * const msg, dat
  *
  * @param dbg        Optional JSON object for verbose debug logging.
  * @param pump_id  The device ID of the pump.
- * @param msg        The network_pump_ctrl_t message received.
+ * @param msg        Pointer to the received network_pump_ctrl_t message.
  *
  * This function logs the pump control value to the debug JSON object if verbose logging
  * is enabled.
  */
 static void
-_pump_ctrl(cJSON * const dbg, network_pump_ctrl_t const msg, datalink_pump_id_t const pump_id)
+_pump_ctrl(JsonWriter * const dbg, network_pump_ctrl_t const * const msg, datalink_pump_id_t const pump_id)
 {
+    if (!msg) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return;
+    }
+
     // no change to poolstate
 
     if (ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE) {
-       poolstate_rx_log::add_pump_ctrl(dbg, poolstate_rx_log::KEY_CTRL, pump_id, msg);
+       poolstate_rx_log::add_pump_ctrl(dbg, poolstate_rx_log::KEY_CTRL, pump_id, *msg);
     }
 }
 
@@ -306,9 +374,9 @@ _pump_ctrl(cJSON * const dbg, network_pump_ctrl_t const msg, datalink_pump_id_t
  * JSON object if verbose logging is enabled.
  */
 static void
-_pump_mode(cJSON * const dbg, network_pump_run_mode_t const msg, datalink_pump_id_t const pump_id, poolstate_pump_t * const pumps)
+_pump_mode(JsonWriter * const dbg, network_pump_run_mode_t const * const msg, datalink_pump_id_t const pump_id, poolstate_pump_t * const pumps)
 {
-    if (!pumps) {
+    if (!msg || !pumps) {
         ESP_LOGW(TAG, "null to %s", __func__);
         return;
     }
@@ -317,7 +385,7 @@ _pump_mode(cJSON * const dbg, network_pump_run_mode_t const msg, datalink_pump_i
 
     pump->mode = {
         .valid = true,
-        .value = msg
+        .value = *msg
     };
 
     if (ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE) {
@@ -337,7 +405,7 @@ _pump_mode(cJSON * const dbg, network_pump_run_mode_t const msg, datalink_pump_i
  * status to the debug JSON object if verbose logging is enabled.
  */
 static void
-_pump_running(cJSON * const dbg, network_pump_running_t const * const msg, datalink_pump_id_t const pump_id, poolstate_pump_t * const pumps)
+_pump_running(JsonWriter * const dbg, network_pump_running_t const * const msg, datalink_pump_id_t const pump_id, poolstate_pump_t * const pumps)
 {
     if (!msg || !pumps) {
         ESP_LOGW(TAG, "null to %s", __func__);
@@ -375,7 +443,7 @@ _pump_running(cJSON * const dbg, network_pump_running_t const * const msg, datal
  * the debug JSON object if verbose logging is enabled.
  */
 static void
-_pump_status(cJSON * const dbg, network_pump_status_resp_t const * const msg, datalink_pump_id_t const pump_id, poolstate_pump_t * const pumps)
+_pump_status(JsonWriter * const dbg, network_pump_status_resp_t const * const msg, datalink_pump_id_t const pump_id, poolstate_pump_t * const pumps)
 {
     if (!msg || !pumps) {
         ESP_LOGW(TAG, "null to %s", __func__);
@@ -392,51 +460,18 @@ _pump_status(cJSON * const dbg, network_pump_status_resp_t const * const msg, da
         return;
     }
 
-    *pump = {
-        .time = {
-            .valid  = true,
-            .value  = msg->clock,
-        },
-        .mode = {
-            .valid = true,
-            .value = msg->mode
-        },
-        .running = {
-            .valid = true,
-            .value = running
-        },
-        .state = {
-            .valid = true,
-            .value = msg->state
-        },
-        .power = {
-            .valid = true,
-            .value = msg->power.to_uint16()
-        },
-        .flow = {
-            .valid = true,
-            .value = msg->flow
-        },
-        .speed = {
-            .valid = true,
-            .value = msg->speed.to_uint16()
-        },
-        .level = {
-            .valid = true,      
-            .value = msg->level
-        },
-        .error = {
-            .valid = true,
-            .value = msg->error
-        },
-        .timer = {
-            .valid = true,
-            .value = msg->remaining
-        }
+    pump->running = {
+        .valid = true,
+        .value = running
     };
+    poolstate_fields::decode<_pump_status_fields>(msg, pump);
 
     if (ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE) {
-        poolstate_rx_log::add_pump(dbg, poolstate_rx_log::KEY_STATUS, pump_id, pump);
+        dbg->begin_object(poolstate_rx_log::KEY_STATUS);
+        dbg->add_string(poolstate_rx_log::KEY_ID, enum_str(pump_id));
+        dbg->add_bool(poolstate_rx_log::KEY_RUNNING, pump->running.value);
+        poolstate_fields::log<_pump_status_fields>(dbg, pump);
+        dbg->end_object();
     }
 }
 
@@ -458,7 +493,7 @@ _pump_status(cJSON * const dbg, network_pump_status_resp_t const * const msg, da
  * time-of-day is added to the debug JSON object.
  */
 static void
-_ctrl_time(cJSON * const dbg, network_ctrl_time_t const * const msg, poolstate_t * const state)
+_ctrl_time(JsonWriter * const dbg, network_ctrl_time_t const * const msg, poolstate_t * const state)
 {
     if (!msg || !state) {
         ESP_LOGW(TAG, "null to %s", __func__);
@@ -494,7 +529,7 @@ _ctrl_time(cJSON * const dbg, network_ctrl_time_t const * const msg, poolstate_t
  * JSON object.
  */
 static void
-_ctrl_heat_resp(cJSON * const dbg, network_ctrl_heat_resp_t const * const msg, poolstate_t * const state)
+_ctrl_heat_resp(JsonWriter * const dbg, network_ctrl_heat_resp_t const * const msg, poolstate_t * const state)
 {
     if (!msg || !state) {
         ESP_LOGW(TAG, "null to %s", __func__);
@@ -509,26 +544,14 @@ _ctrl_heat_resp(cJSON * const dbg, network_ctrl_heat_resp_t const * const msg, p
     poolstate_thermo_t * const pool_thermo = &state->thermos[pool_idx];
     poolstate_thermo_t * const spa_thermo  = &state->thermos[spa_idx];
 
-    pool_thermo->temp_in_f =  {
-        .valid = true,
-        .value = msg->pool_temp
-    };
-    pool_thermo->set_point_in_f =  {
-        .valid = true,
-        .value = msg->pool_set_point
-    };
+    poolstate_fields::decode<_heat_resp_pool_fields>(msg, pool_thermo);
+    poolstate_fields::decode<_heat_resp_spa_fields>(msg, spa_thermo);
+
+        // heat sources share a byte, one nibble each
     pool_thermo->heat_src = {
         .valid = true,
         .value = msg->heat_src.get_pool()
     };
-    spa_thermo->temp_in_f =  {
-        .valid = true,
-        .value = msg->spa_temp
-    };
-    spa_thermo->set_point_in_f =  {
-        .valid = true,
-        .value = msg->spa_set_point
-    };
     spa_thermo->heat_src = {
         .valid = true,
         .value = msg->heat_src.get_spa()
@@ -551,7 +574,7 @@ _ctrl_heat_resp(cJSON * const dbg, network_ctrl_heat_resp_t const * const msg, p
  * is enabled, the updated thermostat information is added to the debug JSON object.
  */
 static void
-_ctrl_heat_set(cJSON * const dbg, network_ctrl_heat_set_t const * const msg, poolstate_t * const state)
+_ctrl_heat_set(JsonWriter * const dbg, network_ctrl_heat_set_t const * const msg, poolstate_t * const state)
 {
     if (!msg || !state) {
         ESP_LOGW(TAG, "null to %s", __func__);
@@ -565,18 +588,14 @@ _ctrl_heat_set(cJSON * const dbg, network_ctrl_heat_set_t const * const msg, poo
     poolstate_thermo_t * const pool_thermo = &state->thermos[pool_idx];
     poolstate_thermo_t * const spa_thermo  = &state->thermos[spa_idx];
     
-    pool_thermo->set_point_in_f = {
-        .valid = true,
-        .value = msg->pool_set_point
-    };
+    poolstate_fields::decode<_heat_set_pool_fields>(msg, pool_thermo);
+    poolstate_fields::decode<_heat_set_spa_fields>(msg, spa_thermo);
+
+        // heat sources share a byte, one nibble each
     pool_thermo->heat_src = {
         .valid = true,
         .value = msg->heat_src.get_pool()
     };
-    spa_thermo->set_point_in_f = {
-        .valid = true,
-        .value = msg->spa_set_point
-    };
     spa_thermo->heat_src = {
         .valid = true,
         .value = msg->heat_src.get_spa()
@@ -598,21 +617,34 @@ _ctrl_heat_set(cJSON * const dbg, network_ctrl_heat_set_t const * const msg, poo
  * if verbose logging is enabled. It does not modify the pool state.
  */
 static void
-_ctrl_hex_bytes(cJSON * const dbg, uint8_t const * const bytes, uint8_t no_of_bytes)
+_ctrl_hex_bytes(JsonWriter * const dbg, uint8_t const * const bytes, uint8_t no_of_bytes)
 {
     if (ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE) {
-        cJSON * const array = cJSON_CreateArray();
-        
+        dbg->begin_array("raw");
+
         for (uint_least8_t ii = 0; ii < no_of_bytes; ii++) {
             char hex_str[3];  // "XX\0"
             ESP_LOGVV(TAG, "byte[%u] = 0x%02X", ii, bytes[ii]);
             snprintf(hex_str, sizeof(hex_str), "%02X", bytes[ii]);
-            cJSON_AddItemToArray(array, cJSON_CreateString(hex_str));
+            dbg->add_string(nullptr, hex_str);
         }
-        cJSON_AddItemToObject(dbg, "raw", array);
+        dbg->end_array();
     }
 }
 
+/**
+ * @brief       Optionally log the raw payload of a message that isn't decoded (yet).
+ *
+ * @param dbg   Optional JSON object for verbose debug logging.
+ * @param msg   Pointer to the received payload.
+ */
+template<typename T>
+static void
+_raw_hex(JsonWriter * const dbg, T const * const msg)
+{
+    _ctrl_hex_bytes(dbg, reinterpret_cast<uint8_t const *>(msg), sizeof(T));
+}
+
 /**
  * @brief       Process a controller circuit set message and update the pool state.
  *
@@ -625,7 +657,7 @@ _ctrl_hex_bytes(cJSON * const dbg, uint8_t const * const bytes, uint8_t no_of_by
  * circuit value is added to the debug JSON object.
  */
 static void
-_ctrl_circuit_set(cJSON * const dbg, network_ctrl_circuit_set_t const * const msg, poolstate_t * const state)
+_ctrl_circuit_set(JsonWriter * const dbg, network_ctrl_circuit_set_t const * const msg, poolstate_t * const state)
 {
     if (!msg || !state) {
         ESP_LOGW(TAG, "null to %s", __func__);
@@ -651,7 +683,7 @@ _ctrl_circuit_set(cJSON * const dbg, network_ctrl_circuit_set_t const * const ms
     if (ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE) {
         network_pool_circuit_t const circuit = static_cast<network_pool_circuit_t>(circuit_idx);
 
-        cJSON_AddBoolToObject(dbg, enum_str(circuit), msg->get_value());
+        dbg->add_bool(enum_str(circuit), msg->get_value());
     }
 }
 
@@ -667,7 +699,7 @@ _ctrl_circuit_set(cJSON * const dbg, network_ctrl_circuit_set_t const * const ms
  * updated schedule information is added to the debug JSON object.
  */
 static void
-_ctrl_sched_resp(cJSON * const dbg, network_ctrl_sched_resp_t const * const msg, poolstate_t * const state)
+_ctrl_sched_resp(JsonWriter * const dbg, network_ctrl_sched_resp_t const * const msg, poolstate_t * const state)
 {
     if (!msg || !state) {
         ESP_LOGW(TAG, "null to %s", __func__);
@@ -719,7 +751,7 @@ _ctrl_sched_resp(cJSON * const dbg, network_ctrl_sched_resp_t const * const msg,
  * logging is enabled, the updated state is added to the debug JSON object.
  */
 static void
-_ctrl_state(cJSON * const dbg, network_ctrl_state_bcast_t const * const msg,  poolstate_t * state)
+_ctrl_state(JsonWriter * const dbg, network_ctrl_state_bcast_t const * const msg,  poolstate_t * state)
 {
     if (!msg || !state) {
         ESP_LOGW(TAG, "null to %s", __func__);
@@ -749,7 +781,7 @@ _ctrl_state(cJSON * const dbg, network_ctrl_state_bcast_t const * const msg,  po
  * version information is added to the debug JSON object.
  */
 static void
-_ctrl_version_resp(cJSON * const dbg, network_ctrl_version_resp_t const * const msg, poolstate_t * const state)
+_ctrl_version_resp(JsonWriter * const dbg, network_ctrl_version_resp_t const * const msg, poolstate_t * const state)
 {
     if (!msg || !state) {
         ESP_LOGW(TAG, "null to %s", __func__);
@@ -777,7 +809,7 @@ _ctrl_version_resp(cJSON * const dbg, network_ctrl_version_resp_t const * const
  * is enabled.
  */
 static void
-_ctrl_set_ack(cJSON * const dbg, network_ctrl_set_ack_t const * const msg)
+_ctrl_set_ack(JsonWriter * const dbg, network_ctrl_set_ack_t const * const msg)
 {
     if (!msg) {
         ESP_LOGW(TAG, "null to %s", __func__);
@@ -788,7 +820,7 @@ _ctrl_set_ack(cJSON * const dbg, network_ctrl_set_ack_t const * const msg)
     //     2BD we could.., e.g. when a circuit is changed ..
 
     if (ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE) {
-        cJSON_AddStringToObject(dbg, poolstate_rx_log::KEY_ACK, enum_str(msg->typ));
+        dbg->add_string(poolstate_rx_log::KEY_ACK, enum_str(msg->typ));
     }
 }
 
@@ -814,29 +846,29 @@ _get_chlor_status_from_error(uint8_t const error)
 }
 
 static void
-_chlor_control_req(cJSON * const dbg, network_chlor_control_req_t const * const msg)
+_chlor_control_req(JsonWriter * const dbg, network_chlor_control_req_t const * const msg)
 {
     if (!msg) { ESP_LOGW(TAG, "null to %s", __func__); return; }
 
     if (ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE) {
         if (msg->is_control_req()) {
-            cJSON_AddStringToObject(dbg, poolstate_rx_log::KEY_SUBCMD, "CONTROL_REQ");
+            dbg->add_string(poolstate_rx_log::KEY_SUBCMD, "CONTROL_REQ");
         } else {
-            cJSON_AddNumberToObject(dbg, poolstate_rx_log::KEY_SUBCMD, msg->sub_cmd);
+            dbg->add_number(poolstate_rx_log::KEY_SUBCMD, msg->sub_cmd);
         }
     }
 }
 
 static void
-_chlor_model_req(cJSON * const dbg, network_chlor_model_req_t const * const msg)
+_chlor_model_req(JsonWriter * const dbg, network_chlor_model_req_t const * const msg)
 {
     if (!msg) { ESP_LOGW(TAG, "null to %s", __func__); return; }
 
     if (ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE) {
         if (msg->is_get_typ()) {
-            cJSON_AddStringToObject(dbg, poolstate_rx_log::KEY_SUBCMD, "MODEL_REQ");
+            dbg->add_string(poolstate_rx_log::KEY_SUBCMD, "MODEL_REQ");
         } else {
-            cJSON_AddNumberToObject(dbg, poolstate_rx_log::KEY_SUBCMD, msg->typ);
+            dbg->add_number(poolstate_rx_log::KEY_SUBCMD, msg->typ);
         }
     }
 }
@@ -852,14 +884,11 @@ _chlor_model_req(cJSON * const dbg, network_chlor_model_req_t const * const msg)
  * logs the status to the debug JSON object if verbose logging is enabled.
  */
 static void
-_chlor_model_resp(cJSON * const dbg, network_chlor_model_resp_t const * const msg, poolstate_chlor_t * const chlor)
+_chlor_model_resp(JsonWriter * const dbg, network_chlor_model_resp_t const * const msg, poolstate_chlor_t * const chlor)
 {
     if (!msg || !chlor) { ESP_LOGW(TAG, "null to %s", __func__); return; }
 
-    chlor->salt = {
-        .valid = true,
-        .value = static_cast<uint16_t>(msg->salt * 50)
-    };
+    poolstate_fields::decode<_chlor_model_resp_fields>(msg, chlor);
 
     uint32_t name_size = sizeof(chlor->name.value);
     strncpy(chlor->name.value, msg->name, name_size);
@@ -867,8 +896,8 @@ _chlor_model_resp(cJSON * const dbg, network_chlor_model_resp_t const * const ms
     chlor->name.valid = true;
 
     if (ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE) {
-        cJSON_AddNumberToObject(dbg, poolstate_rx_log::KEY_SALT, chlor->salt.value);
-        cJSON_AddStringToObject(dbg, poolstate_rx_log::KEY_NAME, chlor->name.value);
+        poolstate_fields::log<_chlor_model_resp_fields>(dbg, chlor);
+        dbg->add_string(poolstate_rx_log::KEY_NAME, chlor->name.value);
         ESP_LOGV(TAG, "Chlorine status updated: salt=%u, name=%s", chlor->salt.value, chlor->name.value);
     }
 }
@@ -884,17 +913,14 @@ _chlor_model_resp(cJSON * const dbg, network_chlor_model_resp_t const * const ms
  * status to the debug JSON object if verbose logging is enabled.
  */
 static void
-_chlor_level_set(cJSON * const dbg, network_chlor_level_set_t const * const msg, poolstate_chlor_t * const chlor)
+_chlor_level_set(JsonWriter * const dbg, network_chlor_level_set_t const * const msg, poolstate_chlor_t * const chlor)
 {
     if (!msg || !chlor) { ESP_LOGW(TAG, "null to %s", __func__); return; }   
 
-    chlor->level = {
-        .valid = true,
-        .value = msg->level
-    };
+    poolstate_fields::decode<_chlor_level_set_fields>(msg, chlor);
 
     if (ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE) {
-        cJSON_AddNumberToObject(dbg, poolstate_rx_log::KEY_LEVEL, chlor->level.value);
+        poolstate_fields::log<_chlor_level_set_fields>(dbg, chlor);
     }
 }
 
@@ -910,24 +936,118 @@ _chlor_level_set(cJSON * const dbg, network_chlor_level_set_t const * const msg,
  * Note: good salt range is 2600 to 4500 ppm.
  */
 static void
-_chlor_level_set_resp(cJSON * const dbg, network_chlor_level_resp_t const * const msg, poolstate_chlor_t * const chlor)
+_chlor_level_set_resp(JsonWriter * const dbg, network_chlor_level_resp_t const * const msg, poolstate_chlor_t * const chlor)
 {
     if (!msg || !chlor) { ESP_LOGW(TAG, "null to %s", __func__); return; }
 
-    chlor->salt = {
-        .valid = true,
-        .value = static_cast<uint16_t>(msg->salt * 50)
-    };
+    poolstate_fields::decode<_chlor_level_resp_fields>(msg, chlor);
+
+        // error bits map onto a single status
     chlor->status = {
         .valid = true,
         .value = _get_chlor_status_from_error(msg->error)
-    };  
+    };
 
     if (ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE) {
-        poolstate_rx_log::add_chlor_resp(dbg, poolstate_rx_log::KEY_CHLOR, chlor);
+        dbg->begin_object(poolstate_rx_log::KEY_CHLOR);
+        poolstate_fields::log<_chlor_level_resp_fields>(dbg, chlor);
+        dbg->add_string(poolstate_rx_log::KEY_STATUS, enum_str(chlor->status.value));
+        dbg->end_object();
+    }
+}
+
+/// @}
+
+/// @name Handler Registry
+/// @brief Maps each network message type to its handler.
+/// @{
+
+/**
+ * @brief Message types that update the pool state or the debug log, and their handler.
+ *
+ * @details
+ * Format: X(ENUM_NAME, HANDLER). The handler receives the typed payload from the
+ * DATA_MEMBER column of NETWORK_MSG_TYP_LIST, followed by what it needs to update:
+ * the pool state, the pump (by ID, with or without the pumps array), the chlorinator, or
+ * nothing. Types that aren't listed here have no handler, and cost nothing at runtime.
+ * Adding a decoder only takes an entry here.
+ */
+#define POOLSTATE_RX_HANDLER_LIST(X)                                               \
+    X(PUMP_REG_SET,          _pump_reg_set)                                        \
+    X(PUMP_REG_RESP,         _pump_reg_resp)                                       \
+    X(PUMP_REMOTE_CTRL_SET,  _pump_ctrl)                                           \
+    X(PUMP_REMOTE_CTRL_RESP, _pump_ctrl)                                           \
+    X(PUMP_RUN_MODE_SET,     _pump_mode)                                           \
+    X(PUMP_RUN_MODE_RESP,    _pump_mode)                                           \
+    X(PUMP_RUN_SET,          _pump_running)                                        \
+    X(PUMP_RUN_RESP,         _pump_running)                                        \
+    X(PUMP_STATUS_RESP,      _pump_status)                                         \
+    X(CTRL_SET_ACK,          _ctrl_set_ack)                                        \
+    X(CTRL_CIRCUIT_SET,      _ctrl_circuit_set)                                    \
+    X(CTRL_SCHED_RESP,       _ctrl_sched_resp)                                     \
+    X(CTRL_STATE_BCAST,      _ctrl_state)                                          \
+    X(CTRL_TIME_SET,         _ctrl_time)                                           \
+    X(CTRL_TIME_RESP,        _ctrl_time)                                           \
+    X(CTRL_HEAT_RESP,        _ctrl_heat_resp)                                      \
+    X(CTRL_HEAT_SET,         _ctrl_heat_set)                                       \
+    X(CTRL_VALVE_RESP,       _raw_hex<network_ctrl_valve_resp_t>)                  \
+    X(CTRL_VERSION_RESP,     _ctrl_version_resp)                                   \
+    X(CTRL_SOLARPUMP_RESP,   _raw_hex<network_ctrl_solarpump_resp_t>)              \
+    X(CTRL_DELAY_RESP,       _raw_hex<network_ctrl_delay_resp_t>)                  \
+    X(CTRL_HEAT_SETPT_RESP,  _raw_hex<network_ctrl_heat_setpt_resp_t>)             \
+    X(CTRL_CIRC_NAMES_RESP,  _raw_hex<network_ctrl_circ_names_resp_t>)             \
+    X(CTRL_SCHEDS_RESP,      _raw_hex<network_ctrl_scheds_resp_t>)                 \
+    X(CHLOR_CONTROL_REQ,     _chlor_control_req)                                   \
+    X(CHLOR_CONTROL_RESP,    _raw_hex<network_chlor_control_resp_t>)               \
+    X(CHLOR_MODEL_REQ,       _chlor_model_req)                                     \
+    X(CHLOR_MODEL_RESP,      _chlor_model_resp)                                    \
+    X(CHLOR_LEVEL_SET,       _chlor_level_set)                                     \
+    X(CHLOR_LEVEL_RESP,      _chlor_level_set_resp)
+
+    /// uniform signature of the handler thunks in the dispatch table
+using handler_t = void (*)(JsonWriter * const dbg, network_msg_t const * const msg, poolstate_t * const state);
+
+/**
+ * @brief Calls HANDLER with the typed payload of TYP and the part of the state it updates.
+ *
+ * @details
+ * The shape of the handler's parameter list selects what it is given, at compile time. A
+ * handler whose payload type doesn't match the DATA_MEMBER of TYP fails to compile.
+ */
+template<network_msg_typ_t TYP, auto HANDLER>
+static void
+_thunk(JsonWriter * const dbg, network_msg_t const * const msg, poolstate_t * const state)
+{
+    using data_t = typename network_msg_data<TYP>::type const *;
+    using fn_t = decltype(HANDLER);
+    data_t const data = &network_msg_data<TYP>::get(msg->u);
+
+    if constexpr (std::is_invocable_v<fn_t, JsonWriter *, data_t, poolstate_t *>) {
+        HANDLER(dbg, data, state);
+    } else if constexpr (std::is_invocable_v<fn_t, JsonWriter *, data_t, poolstate_chlor_t *>) {
+        HANDLER(dbg, data, &state->chlor);
+    } else if constexpr (std::is_invocable_v<fn_t, JsonWriter *, data_t, datalink_pump_id_t, poolstate_pump_t *>) {
+        datalink_pump_id_t const pump_id = msg->dst.is_pump() ? msg->dst.get_pump_id() : msg->src.get_pump_id();
+        HANDLER(dbg, data, pump_id, state->pumps);
+    } else if constexpr (std::is_invocable_v<fn_t, JsonWriter *, data_t, datalink_pump_id_t>) {
+        datalink_pump_id_t const pump_id = msg->dst.is_pump() ? msg->dst.get_pump_id() : msg->src.get_pump_id();
+        HANDLER(dbg, data, pump_id);
+    } else {
+        HANDLER(dbg, data);
     }
 }
 
+    /// dispatch table, indexed by network_msg_typ_t (nullptr if the type has no handler)
+constexpr auto handlers = [] {
+    std::array<handler_t, enum_count<network_msg_typ_t>()> table{};
+#define X_HANDLER(name, handler) table[enum_index(network_msg_typ_t::name)] = &_thunk<network_msg_typ_t::name, handler>;
+    POOLSTATE_RX_HANDLER_LIST(X_HANDLER)
+#undef X_HANDLER
+    return table;
+}();
+
+static_assert(handlers[enum_index(network_msg_typ_t::CTRL_STATE_BCAST)] != nullptr, "CTRL_STATE_BCAST must have a handler");
+
 /// @}
 
 /// @name Main Entry Point
@@ -941,9 +1061,9 @@ _chlor_level_set_resp(cJSON * const dbg, network_chlor_level_resp_t const * cons
  * @param new_state Pointer to the poolstate_t structure to update (must not be null).
  * @return          ESP_OK if the state was updated and processed successfully, ESP_FAIL otherwise.
  *
- * This function dispatches the received network message to the appropriate handler,
- * updating the provided pool state structure based on the message contents. It also
- * logs detailed debug information to a cJSON object if verbose logging is enabled.
+ * This function dispatches the received network message to its handler through the
+ * handlers[] table, updating the provided pool state structure based on the message
+ * contents. It also logs detailed debug information as JSON if verbose logging is enabled.
  *
  * The function sets the 'valid' flag in the state, updates all relevant fields according
  * to the message type, and optionally logs the update as JSON. It is the main entry point
@@ -957,128 +1077,21 @@ update_state(network_msg_t const * const msg, poolstate_t * const new_state)
     bool const verbose = ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE;
     bool const very_verbose = ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERY_VERBOSE;
 
+        // debug JSON is streamed into a fixed buffer, only reserved when verbose logging is compiled in
+    constexpr size_t json_size = (ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE) ? 1500 : 1;
+    static char json[json_size];  // only called from the main task
+    JsonWriter writer(json, json_size);
+    JsonWriter * const dbg = verbose ? &writer : nullptr;
+    if (verbose) {
+        writer.begin_object(nullptr);
+    }
+
         // adjust the new_state based on the incoming message
-    cJSON * const dbg = verbose ? cJSON_CreateObject() : nullptr; 
-
-    bool const is_to_pump = msg->dst.is_pump();
-    datalink_pump_id_t const pump_id = is_to_pump ? msg->dst.get_pump_id() : msg->src.get_pump_id();
-
-    switch (msg->typ) {
-        case network_msg_typ_t::IGNORE:
-            break;
-        case network_msg_typ_t::PUMP_REG_SET:
-            _pump_reg_set(dbg, &msg->u.a5.pump_reg_set, pump_id);
-            break;
-        case network_msg_typ_t::PUMP_REG_RESP:
-            _pump_reg_resp(dbg, &msg->u.a5.pump_reg_resp, pump_id);
-            break;
-        case network_msg_typ_t::PUMP_REMOTE_CTRL_SET:
-        case network_msg_typ_t::PUMP_REMOTE_CTRL_RESP:
-            _pump_ctrl(dbg, msg->u.a5.pump_ctrl, pump_id);
-            break;
-        case network_msg_typ_t::PUMP_RUN_MODE_SET:
-        case network_msg_typ_t::PUMP_RUN_MODE_RESP:
-            _pump_mode(dbg, msg->u.a5.pump_mode, pump_id, new_state->pumps);
-            break;
-        case network_msg_typ_t::PUMP_RUN_SET:
-        case network_msg_typ_t::PUMP_RUN_RESP:
-            _pump_running(dbg, &msg->u.a5.pump_running, pump_id, new_state->pumps);
-            break;
-        case network_msg_typ_t::PUMP_STATUS_REQ:
-             break;
-        case network_msg_typ_t::PUMP_STATUS_RESP:
-            _pump_status(dbg, &msg->u.a5.pump_status_resp, pump_id, new_state->pumps);
-            break;
-        case network_msg_typ_t::CTRL_SET_ACK:  // response to various set requests
-            _ctrl_set_ack(dbg, &msg->u.a5.ctrl_set_ack);
-            break;
-        case network_msg_typ_t::CTRL_CIRCUIT_SET:
-            _ctrl_circuit_set(dbg, &msg->u.a5.ctrl_circuit_set, new_state);
-            break;
-        case network_msg_typ_t::CTRL_SCHED_REQ:
-            break;
-        case network_msg_typ_t::CTRL_SCHED_RESP:
-            _ctrl_sched_resp(dbg, &msg->u.a5.ctrl_sched_resp, new_state);
-            break;
-        case network_msg_typ_t::CTRL_STATE_BCAST:
-            _ctrl_state(dbg, &msg->u.a5.ctrl_state_bcast, new_state);
-            break;
-        case network_msg_typ_t::CTRL_TIME_REQ:
-            break;
-        case network_msg_typ_t::CTRL_TIME_SET:
-        case network_msg_typ_t::CTRL_TIME_RESP:
-            _ctrl_time(dbg, &msg->u.a5.ctrl_time, new_state);
-            break;
-        case network_msg_typ_t::CTRL_HEAT_REQ:
-            break;
-        case network_msg_typ_t::CTRL_HEAT_RESP:
-            _ctrl_heat_resp(dbg, &msg->u.a5.ctrl_heat_resp, new_state);
-            break;
-        case network_msg_typ_t::CTRL_HEAT_SET:
-            _ctrl_heat_set(dbg, &msg->u.a5.ctrl_heat_set, new_state);
-            break;
-        case network_msg_typ_t::CTRL_LAYOUT_REQ:
-        case network_msg_typ_t::CTRL_LAYOUT_RESP:
-        case network_msg_typ_t::CTRL_LAYOUT_SET:
-            break;
-        case network_msg_typ_t::CTRL_VALVE_REQ:
-            break;
-        case network_msg_typ_t::CTRL_VALVE_RESP:
-            _ctrl_hex_bytes(dbg, msg->u.raw, sizeof(network_ctrl_valve_resp_t));
-            break;
-        case network_msg_typ_t::CTRL_VERSION_REQ:
-            break;
-        case network_msg_typ_t::CTRL_VERSION_RESP:
-            _ctrl_version_resp(dbg, &msg->u.a5.ctrl_version_resp, new_state);
-            break;
-        case network_msg_typ_t::CTRL_SOLARPUMP_REQ:
-            break;
-        case network_msg_typ_t::CTRL_SOLARPUMP_RESP:
-            _ctrl_hex_bytes(dbg, msg->u.raw, sizeof(network_ctrl_solarpump_resp_t));
-            break;
-        case network_msg_typ_t::CTRL_DELAY_REQ:
-            break;
-        case network_msg_typ_t::CTRL_DELAY_RESP:
-            _ctrl_hex_bytes(dbg, msg->u.raw, sizeof(network_ctrl_delay_resp_t));
-            break;
-        case network_msg_typ_t::CTRL_HEAT_SETPT_REQ:
-            break;
-        case network_msg_typ_t::CTRL_HEAT_SETPT_RESP:
-            _ctrl_hex_bytes(dbg, msg->u.raw, sizeof(network_ctrl_heat_setpt_resp_t));
-            break;
-        case network_msg_typ_t::CTRL_CIRC_NAMES_REQ:
-            break;
-        case network_msg_typ_t::CTRL_CIRC_NAMES_RESP:
-            _ctrl_hex_bytes(dbg, msg->u.raw, sizeof(network_ctrl_circ_names_resp_t));
-            break;
-        case network_msg_typ_t::CTRL_SCHEDS_REQ:
-            break;
-        case network_msg_typ_t::CTRL_SCHEDS_RESP:
-            _ctrl_hex_bytes(dbg, msg->u.raw, sizeof(network_ctrl_scheds_resp_t));
-            break;
-        case network_msg_typ_t::CTRL_CHEM_REQ:
-            break;
-        case network_msg_typ_t::CHLOR_CONTROL_REQ:
-            _chlor_control_req(dbg, &msg->u.ic.chlor_control_req);
-            break;
-        case network_msg_typ_t::CHLOR_CONTROL_RESP:
-            _ctrl_hex_bytes(dbg, msg->u.raw, sizeof(network_chlor_control_resp_t));
-            break;
-        case network_msg_typ_t::CHLOR_MODEL_REQ:
-            _chlor_model_req(dbg, &msg->u.ic.chlor_model_req);
-            break;
-        case network_msg_typ_t::CHLOR_MODEL_RESP:
-            _chlor_model_resp(dbg, &msg->u.ic.chlor_model_resp, &new_state->chlor);
-            break;
-        case network_msg_typ_t::CHLOR_LEVEL_SET:
-            _chlor_level_set(dbg, &msg->u.ic.chlor_level_set, &new_state->chlor);
-            break;
-        case network_msg_typ_t::CHLOR_LEVEL_RESP:
-            _chlor_level_set_resp(dbg, &msg->u.ic.chlor_level_resp, &new_state->chlor);
-            break;
-        default:
-            ESP_LOGW(TAG, "Received unknown message type: %u", static_cast<uint8_t>(msg->typ));
-            break;
+    size_t const idx = enum_index(msg->typ);
+    if (idx >= handlers.size()) {
+        ESP_LOGW(TAG, "Received unknown message type: %u", static_cast<uint8_t>(msg->typ));
+    } else if (handlers[idx] != nullptr) {
+        handlers[idx](dbg, msg, new_state);
     }
 
     bool const frequent = //msg->typ == network_msg_typ_t::CTRL_STATE_BCAST      ||
@@ -1092,24 +1105,12 @@ update_state(network_msg_t const * const msg, poolstate_t * const new_state)
                           msg->typ == network_msg_typ_t::PUMP_STATUS_RESP;
 
     if ((verbose && !frequent) || very_verbose) {
-        size_t const json_size = 1500;
-        char * const json = static_cast<char *>(calloc(1, json_size));
-        if (json == nullptr) {
-            ESP_LOGE(TAG, "Failed to allocate memory for JSON string");
-            cJSON_Delete(dbg);
-            return ESP_FAIL;
-        }
-        bool print_success = cJSON_PrintPreallocated(dbg, json, json_size, false);
-        if (!print_success) {
-            ESP_LOGE(TAG, "Failed to print JSON string");  // increase size?
-            free(json);
-            cJSON_Delete(dbg);
-            return ESP_FAIL;
+        writer.end_object();
+        if (writer.overflowed()) {
+            ESP_LOGW(TAG, "JSON string truncated at %u bytes", static_cast<unsigned>(writer.length()));  // increase json_size?
         }
-        ESP_LOGV(TAG, "{%s: %s}\n", enum_str(msg->typ), json);
-        free(json);
+        ESP_LOGV(TAG, "{%s: %s}\n", enum_str(msg->typ), writer.c_str());
     }
-    cJSON_Delete(dbg);
     return ESP_OK;
 }
 
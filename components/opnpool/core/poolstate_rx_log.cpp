@@ -6,8 +6,9 @@
  * This file provides functions to serialize the OPNpool controller's internal state and
  * its subcomponents (system, pump, chlorinator, thermostats, schedules, etc.) into a
  * compact JSON representation for logging.  Each function adds a specific part of the
- * pool state to a cJSON object, using type-safe enum-to-string helpers and value checks
- * to ensure clarity and correctness in the output.
+ * pool state to a JsonWriter, using type-safe enum-to-string helpers and value checks
+ * to ensure clarity and correctness in the output. The writer streams into a fixed
+ * buffer, so a nested object is always closed before returning to its parent.
  *
  * These functions are kept separate from poolstate_rx.cpp because their purpose is
  * to provide logging functionality, and separating them helps to avoid making that file
@@ -24,11 +25,11 @@
 #include <esp_system.h>
 #include <esp_types.h>
 #include <esphome/core/log.h>
-#include <cJSON.h>
 #include <string.h>
 #include <cstddef>
 
 #include "utils/to_str.h"
+#include "utils/json_writer.h"
 #include "utils/enum_helpers.h"
 #include "pool_task/network.h"
 #include "poolstate.h"
@@ -44,22 +45,31 @@ namespace poolstate_rx {
 namespace poolstate_rx_log {
 
 /**
- * @brief Creates or returns a JSON object for the given key.
+ * @brief Opens a JSON object for the given key.
  *
- * @param[in] obj The parent JSON object.
- * @param[in] key The key for the new child object, or nullptr to return parent.
- * @return        The created child object, or parent if key is nullptr.
+ * @param[in] obj The JSON writer, positioned in the parent object.
+ * @param[in] key The key for the new child object, or nullptr to keep writing to the parent.
  */
-[[nodiscard]] static cJSON *
-_create_item(cJSON * const obj, char const * const key)
+static void
+_begin_item(JsonWriter * const obj, char const * const key)
 {
-    if (key == nullptr) {
-        return obj;
+    if (key != nullptr) {
+        obj->begin_object(key);
     }
-    cJSON * const item = cJSON_CreateObject();
+}
 
-    cJSON_AddItemToObject(obj, key, item);
-    return item;
+/**
+ * @brief Closes the JSON object opened by _begin_item().
+ *
+ * @param[in] obj The JSON writer.
+ * @param[in] key The key that was passed to _begin_item().
+ */
+static void
+_end_item(JsonWriter * const obj, char const * const key)
+{
+    if (key != nullptr) {
+        obj->end_object();
+    }
 }
 
 /**
@@ -70,12 +80,14 @@ _create_item(cJSON * const obj, char const * const key)
  * @param[in] system Pointer to the poolstate_system_t structure.
  */
 void
-_add_system(cJSON * const obj, char const * const key, poolstate_system_t const * const system)
+_add_system(JsonWriter * const obj, char const * const key, poolstate_system_t const * const system)
 {
-    cJSON * const item = _create_item(obj, key);
+    _begin_item(obj, key);
 
-    add_time_and_date(item, KEY_TOD, &system->tod);
-    add_version(item, KEY_FIRMWARE, &system->version);
+    add_time_and_date(obj, KEY_TOD, &system->tod);
+    add_version(obj, KEY_FIRMWARE, &system->version);
+
+    _end_item(obj, key);
 }
 
 /**
@@ -86,14 +98,16 @@ _add_system(cJSON * const obj, char const * const key, poolstate_system_t const
  * @param[in] circuit Pointer to the first poolstate_circuit_t in the array.
  */
 static void
-_add_circuit_active(cJSON * const obj, char const * const key, poolstate_circuit_t const * circuit)
+_add_circuit_active(JsonWriter * const obj, char const * const key, poolstate_circuit_t const * circuit)
 {
-    cJSON * const item = _create_item(obj, key);
+    _begin_item(obj, key);
 
     for (auto typ : magic_enum::enum_values<network_pool_circuit_t>()) {
-        cJSON_AddBoolToObject(item, enum_str(typ), circuit->active.value);
+        obj->add_bool(enum_str(typ), circuit->active.value);
         circuit++;
     }
+
+    _end_item(obj, key);
 }
 
 /**
@@ -104,14 +118,16 @@ _add_circuit_active(cJSON * const obj, char const * const key, poolstate_circuit
  * @param[in] circuit Pointer to the first poolstate_circuit_t in the array.
  */
 static void
-_add_circuit_delay(cJSON * const obj, char const * const key, poolstate_circuit_t const * circuit)
+_add_circuit_delay(JsonWriter * const obj, char const * const key, poolstate_circuit_t const * circuit)
 {
-    cJSON * const item = _create_item(obj, key);
+    _begin_item(obj, key);
 
     for (auto typ : magic_enum::enum_values<network_pool_circuit_t>()) {
-        cJSON_AddBoolToObject(item, enum_str(typ), circuit->delay.value);
+        obj->add_bool(enum_str(typ), circuit->delay.value);
         circuit++;
     }
+
+    _end_item(obj, key);
 }
 
 /**
@@ -122,9 +138,9 @@ _add_circuit_delay(cJSON * const obj, char const * const key, poolstate_circuit_
  * @param[in] mode The pump mode value.
  */
 static void
-_add_pump_mode(cJSON * const obj, char const * const key, network_pump_run_mode_t const mode)
+_add_pump_mode(JsonWriter * const obj, char const * const key, network_pump_run_mode_t const mode)
 {
-    cJSON_AddStringToObject(obj, key, mode.to_str());
+    obj->add_string(key, mode.to_str());
 }
 
 /**
@@ -135,9 +151,9 @@ _add_pump_mode(cJSON * const obj, char const * const key, network_pump_run_mode_
  * @param[in] running The pump running status (true if running).
  */
 static void
-_add_pump_running(cJSON * const obj, char const * const key, bool const running)
+_add_pump_running(JsonWriter * const obj, char const * const key, bool const running)
 {
-    cJSON_AddBoolToObject(obj, key, running);
+    obj->add_bool(key, running);
 }
 
 /**
@@ -148,12 +164,14 @@ _add_pump_running(cJSON * const obj, char const * const key, bool const running)
  * @param[in] circuits Pointer to the array of poolstate_circuit_t structures.
  */
 void
-add_circuits(cJSON * const obj, char const * const key, poolstate_circuit_t const * const circuits)
+add_circuits(JsonWriter * const obj, char const * const key, poolstate_circuit_t const * const circuits)
 {
-    cJSON * const item = _create_item(obj, key);
+    _begin_item(obj, key);
+
+    _add_circuit_active(obj, KEY_ACTIVE, circuits);
+    _add_circuit_delay(obj, KEY_DELAY, circuits);
 
-    _add_circuit_active(item, KEY_ACTIVE, circuits);
-    _add_circuit_delay(item, KEY_DELAY, circuits);
+    _end_item(obj, key);
 }
 
 /**
@@ -164,14 +182,16 @@ add_circuits(cJSON * const obj, char const * const key, poolstate_circuit_t cons
  * @param[in] mode The poolstate_modes_t structure.
  */
 void
-add_mode(cJSON * const obj, char const * const key, poolstate_modes_t const mode)
+add_mode(JsonWriter * const obj, char const * const key, poolstate_modes_t const mode)
 {
-    cJSON * const item = _create_item(obj, key);
+    _begin_item(obj, key);
+
+    obj->add_bool("service", mode.value.is_service_mode());
+    obj->add_bool("temp_inc", mode.value.is_temp_increase_mode());
+    obj->add_bool("freeze_prot", mode.value.is_freeze_protection_mode());
+    obj->add_bool("timeout", mode.value.is_timeout_mode());
 
-    cJSON_AddBoolToObject(item, "service", mode.value.is_service_mode());
-    cJSON_AddBoolToObject(item, "temp_inc", mode.value.is_temp_increase_mode());
-    cJSON_AddBoolToObject(item, "freeze_prot", mode.value.is_freeze_protection_mode());
-    cJSON_AddBoolToObject(item, "timeout", mode.value.is_timeout_mode());
+    _end_item(obj, key);
 }
 
 /**
@@ -182,17 +202,19 @@ add_mode(cJSON * const obj, char const * const key, poolstate_modes_t const mode
  * @param[in] temps Pointer to the array of poolstate_uint8_t temperature values.
  */
 void
-add_temps(cJSON * const obj, char const * const key, poolstate_uint8_t const * temps)
+add_temps(JsonWriter * const obj, char const * const key, poolstate_uint8_t const * temps)
 {
-    cJSON * const item = _create_item(obj, key);
+    _begin_item(obj, key);
 
     poolstate_uint8_t const * temp = temps;
     for (auto typ : magic_enum::enum_values<poolstate_temp_typ_t>()) {
         if (temp->value != 0xFF && temp->value != 0x00) {
-            cJSON_AddNumberToObject(item, enum_str(typ), temp->value);
+            obj->add_number(enum_str(typ), temp->value);
         }
         temp++;
     }
+
+    _end_item(obj, key);
 }
 
 /**
@@ -203,11 +225,13 @@ add_temps(cJSON * const obj, char const * const key, poolstate_uint8_t const * t
  * @param[in] time Pointer to the poolstate_time_t structure containing the time.
  */
 void
-add_time(cJSON * const obj, char const * const key, poolstate_time_t const * const time)
+add_time(JsonWriter * const obj, char const * const key, poolstate_time_t const * const time)
 {
-    cJSON * const item = _create_item(obj, key);
+    _begin_item(obj, key);
+
+    obj->add_string(KEY_TIME, time_str(time->value.hour, time->value.minute));
 
-    cJSON_AddStringToObject(item, KEY_TIME, time_str(time->value.hour, time->value.minute));
+    _end_item(obj, key);
 }
 
 /**
@@ -218,12 +242,14 @@ add_time(cJSON * const obj, char const * const key, poolstate_time_t const * con
  * @param[in] tod Pointer to the poolstate_tod_t structure containing the time and date.
  */
 void
-add_time_and_date(cJSON * const obj, char const * const key, poolstate_tod_t const * const tod)
+add_time_and_date(JsonWriter * const obj, char const * const key, poolstate_tod_t const * const tod)
 {
-    cJSON * const item = _create_item(obj, key);
+    _begin_item(obj, key);
 
-    cJSON_AddStringToObject(item, KEY_TIME, time_str(tod->time.value.hour, tod->time.value.minute));
-    cJSON_AddStringToObject(item, KEY_DATE, date_str(tod->date.value.year, tod->date.value.month, tod->date.value.day));
+    obj->add_string(KEY_TIME, time_str(tod->time.value.hour, tod->time.value.minute));
+    obj->add_string(KEY_DATE, date_str(tod->date.value.year, tod->date.value.month, tod->date.value.day));
+
+    _end_item(obj, key);
 }
 
 /**
@@ -234,9 +260,9 @@ add_time_and_date(cJSON * const obj, char const * const key, poolstate_tod_t con
  * @param[in] version Pointer to the poolstate_version_t structure.
  */
 void
-add_version(cJSON * const obj, char const * const key, poolstate_version_t const * const version)
+add_version(JsonWriter * const obj, char const * const key, poolstate_version_t const * const version)
 {
-    cJSON_AddStringToObject(obj, key, version_str(version->major, version->minor));
+    obj->add_string(key, version_str(version->major, version->minor));
 }
 
 /**
@@ -250,29 +276,32 @@ add_version(cJSON * const obj, char const * const key, poolstate_version_t const
  * @param[in] showHeating Whether to include heating status.
  */
 void
-add_thermos(cJSON * const obj, char const * const key, poolstate_thermo_t const * thermos,
+add_thermos(JsonWriter * const obj, char const * const key, poolstate_thermo_t const * thermos,
             bool const showTemp, bool showSp, bool const showHeating)
 {
-    cJSON * const item = _create_item(obj, key);
+    _begin_item(obj, key);
 
     for (auto typ : magic_enum::enum_values<poolstate_thermo_typ_t>()) {
 
-        cJSON * const sub_item = _create_item(item, enum_str(typ));
+        obj->begin_object(enum_str(typ));
 
         if (showTemp) {
-            cJSON_AddNumberToObject(sub_item, KEY_TEMP, thermos->temp_in_f.value);
+            obj->add_number(KEY_TEMP, thermos->temp_in_f.value);
         }
 
         if (showSp) {
-            cJSON_AddNumberToObject(sub_item, KEY_SP, thermos->set_point_in_f.value);
+            obj->add_number(KEY_SP, thermos->set_point_in_f.value);
         }
-        cJSON_AddStringToObject(sub_item, KEY_SRC, enum_str(thermos->heat_src.value));
+        obj->add_string(KEY_SRC, enum_str(thermos->heat_src.value));
 
         if (showHeating) {
-            cJSON_AddBoolToObject(sub_item, KEY_HEATING, thermos->heating.value);
+            obj->add_bool(KEY_HEATING, thermos->heating.value);
         }
+        obj->end_object();
         thermos++;
     }
+
+    _end_item(obj, key);
 }
 
 /**
@@ -283,13 +312,13 @@ add_thermos(cJSON * const obj, char const * const key, poolstate_thermo_t const
  * @param[in] sched Pointer to the first poolstate_sched_t structure in the array.
  */
 void
-add_scheds(cJSON * const obj, char const * const key, poolstate_sched_t const * sched)
+add_scheds(JsonWriter * const obj, char const * const key, poolstate_sched_t const * sched)
 {
-    cJSON * const item = _create_item(obj, key);
+    _begin_item(obj, key);
 
     for (auto circuit : magic_enum::enum_values<network_pool_circuit_t>()) {
         if (sched->active) {
-            cJSON * const sub_item = _create_item(item, enum_str(circuit));
+            obj->begin_object(enum_str(circuit));
 
             network_time_t const start_time = {
                 .hour   = static_cast<uint8_t>(sched->start / 60),
@@ -299,11 +328,14 @@ add_scheds(cJSON * const obj, char const * const key, poolstate_sched_t const *
                 .hour   = static_cast<uint8_t>(sched->stop / 60),
                 .minute = static_cast<uint8_t>(sched->stop % 60)
             };
-            cJSON_AddStringToObject(sub_item, KEY_START, time_str(start_time.hour, start_time.minute));
-            cJSON_AddStringToObject(sub_item, KEY_STOP,  time_str( stop_time.hour,  stop_time.minute));
+            obj->add_string(KEY_START, time_str(start_time.hour, start_time.minute));
+            obj->add_string(KEY_STOP,  time_str( stop_time.hour,  stop_time.minute));
+            obj->end_object();
         }
         sched++;
     }
+
+    _end_item(obj, key);
 }
 
 /**
@@ -314,47 +346,18 @@ add_scheds(cJSON * const obj, char const * const key, poolstate_sched_t const *
  * @param[in] state Pointer to the poolstate_t structure to log.
  */
 void
-add_state(cJSON * const obj, char const * const key, poolstate_t const * const state)
+add_state(JsonWriter * const obj, char const * const key, poolstate_t const * const state)
 {
-    cJSON * const item = _create_item(obj, key);
-
-    add_thermos(item, KEY_THERMOS, state->thermos, true, false, true);
-    add_scheds(item, KEY_SCHEDS, state->scheds);
-    add_mode(item, KEY_MODES, state->system.modes);
-    add_temps(item, KEY_TEMPS, state->temps);
-    add_circuits(item, KEY_CIRCUITS, state->circuits);
-    _add_system(item, KEY_SYSTEM, &state->system);
-}
+    _begin_item(obj, key);
 
-/**
- * @brief Adds pump information to a JSON object for logging.
- *
- * @param[in] obj     The parent JSON object.
- * @param[in] key     The key under which to add the pump object.
- * @param[in] pump_id The device ID for the pump.
- * @param[in] pump    Pointer to the poolstate_pump_t structure to log.
- */
-void
-add_pump(cJSON * const obj, char const * const key, datalink_pump_id_t const pump_id, poolstate_pump_t const * const pump)
-{
-    cJSON * const item = _create_item(obj, key);
-
-    _add_pump_mode(item, KEY_MODE, pump->mode.value);
-    _add_pump_running(item, KEY_RUNNING, pump->running.value);
-
-    cJSON_AddStringToObject(item, KEY_TIME, time_str(pump->time.value.hour, pump->time.value.minute));
-    cJSON_AddStringToObject(item, KEY_STATE, enum_str(pump->state.value));
-    cJSON_AddStringToObject(item, KEY_ID, enum_str(pump_id));
-    cJSON_AddNumberToObject(item, KEY_POWER, pump->power.value);
-    cJSON_AddNumberToObject(item, KEY_SPEED, pump->speed.value);
-    if (pump->flow.value) {
-        cJSON_AddNumberToObject(item, KEY_FLOW, pump->flow.value);
-    }
-    if (pump->level.value) {
-        cJSON_AddNumberToObject(item, KEY_LEVEL, pump->level.value);
-    }
-    cJSON_AddNumberToObject(item, KEY_ERROR, pump->error.value);
-    cJSON_AddStringToObject(item, KEY_TIME, time_str(pump->timer.value.hour, pump->timer.value.minute));
+    add_thermos(obj, KEY_THERMOS, state->thermos, true, false, true);
+    add_scheds(obj, KEY_SCHEDS, state->scheds);
+    add_mode(obj, KEY_MODES, state->system.modes);
+    add_temps(obj, KEY_TEMPS, state->temps);
+    add_circuits(obj, KEY_CIRCUITS, state->circuits);
+    _add_system(obj, KEY_SYSTEM, &state->system);
+
+    _end_item(obj, key);
 }
 
 /**
@@ -366,26 +369,30 @@ add_pump(cJSON * const obj, char const * const key, datalink_pump_id_t const pum
  * @param[in] value   The pump program value to log.
  */
 void
-add_pump_reg_set(cJSON * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_reg_set_t const * const reg)
+add_pump_reg_set(JsonWriter * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_reg_set_t const * const reg)
 {
-    cJSON * const item = _create_item(obj, key);
+    _begin_item(obj, key);
 
-    cJSON_AddStringToObject(item, KEY_ID, enum_str(pump_id));
-    cJSON_AddStringToObject(item, KEY_ADDRESS, enum_str(reg->address));
-    cJSON_AddStringToObject(item, KEY_OPERATION, reg->operation.to_str());
+    obj->add_string(KEY_ID, enum_str(pump_id));
+    obj->add_string(KEY_ADDRESS, enum_str(reg->address));
+    obj->add_string(KEY_OPERATION, reg->operation.to_str());
 
     if (reg->operation.is_write()) {
-        cJSON_AddNumberToObject(item, KEY_VALUE, reg->value.to_uint16());
+        obj->add_number(KEY_VALUE, reg->value.to_uint16());
     }
+
+    _end_item(obj, key);
 }
 
 void
-add_pump_reg_resp(cJSON * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_reg_resp_t const * const reg)
+add_pump_reg_resp(JsonWriter * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_reg_resp_t const * const reg)
 {
-    cJSON * const item = _create_item(obj, key);
+    _begin_item(obj, key);
+
+    obj->add_string(KEY_ID, enum_str(pump_id));
+    obj->add_number(KEY_VALUE, reg->value.to_uint16());
 
-    cJSON_AddStringToObject(item, KEY_ID, enum_str(pump_id));
-    cJSON_AddNumberToObject(item, KEY_VALUE, reg->value.to_uint16());
+    _end_item(obj, key);
 }
 
 /**
@@ -397,11 +404,13 @@ add_pump_reg_resp(cJSON * const obj, char const * const key, datalink_pump_id_t
  * @param[in] ctrl    The pump control value to log.
  */
 void
-add_pump_ctrl(cJSON * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_ctrl_t const ctrl)
+add_pump_ctrl(JsonWriter * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_ctrl_t const ctrl)
 {
-    cJSON * const item = _create_item(obj, enum_str(pump_id));
+    obj->begin_object(enum_str(pump_id));
 
-    cJSON_AddBoolToObject(item, key, ctrl.is_local());
+    obj->add_bool(key, ctrl.is_local());
+
+    obj->end_object();
 }
 
 /**
@@ -413,11 +422,13 @@ add_pump_ctrl(cJSON * const obj, char const * const key, datalink_pump_id_t cons
  * @param[in] mode    The pump mode value to log.
  */
 void
-add_pump_mode(cJSON * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_run_mode_t const mode)
+add_pump_mode(JsonWriter * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_run_mode_t const mode)
 {
-    cJSON * const item = _create_item(obj, enum_str(pump_id));
+    obj->begin_object(enum_str(pump_id));
+
+    _add_pump_mode(obj, key, mode);
 
-    _add_pump_mode(item, key, mode);
+    obj->end_object();
 }
 
 /**
@@ -429,27 +440,13 @@ add_pump_mode(cJSON * const obj, char const * const key, datalink_pump_id_t cons
  * @param[in] running The pump running status to log (true if running).
  */
 void
-add_pump_running(cJSON * const obj, char const * const key, datalink_pump_id_t const pump_id, bool const running)
+add_pump_running(JsonWriter * const obj, char const * const key, datalink_pump_id_t const pump_id, bool const running)
 {
-    cJSON * const item = _create_item(obj, enum_str(pump_id));
+    obj->begin_object(enum_str(pump_id));
 
-    _add_pump_running(item, key, running);
-}
-
-/**
- * @brief Adds chlorinator response information to a JSON object for logging.
- *
- * @param[in] obj   The parent JSON object.
- * @param[in] key   The key under which to add the chlorinator response object.
- * @param[in] chlor Pointer to the poolstate_chlor_t structure to log.
- */
-void
-add_chlor_resp(cJSON * const obj, char const * const key, poolstate_chlor_t const * const chlor)
-{
-    cJSON * const item = _create_item(obj, key);
+    _add_pump_running(obj, key, running);
 
-    cJSON_AddNumberToObject(item, KEY_SALT, chlor->salt.value);
-    cJSON_AddStringToObject(item, KEY_STATUS, enum_str(chlor->status.value));
+    obj->end_object();
 }
 
 }  // namespace poolstate_rx_log
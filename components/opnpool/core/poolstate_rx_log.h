@@ -5,7 +5,7 @@
  * @details
  * Declares functions to serialize pool controller state and its subcomponents
  * (system info, pump, chlorinator, thermostats, schedules, etc.) into JSON
- * format for logging purposes. Uses cJSON library for JSON object construction.
+ * format for logging purposes. Writes through a JsonWriter, without heap allocations.
  *
  * @author Coert Vonk (@cvonk on GitHub)
  * @copyright Copyright (c) 2026 Coert Vonk
@@ -19,17 +19,8 @@
 
 #include <esp_system.h>
 #include <esp_types.h>
-#include <cJSON.h>
 
-#if defined(MAGIC_ENUM_RANGE_MIN)
-# undef MAGIC_ENUM_RANGE_MIN
-#endif
-#if defined(MAGIC_ENUM_RANGE_MAX)
-# undef MAGIC_ENUM_RANGE_MAX
-#endif
-#define MAGIC_ENUM_RANGE_MIN 0
-#define MAGIC_ENUM_RANGE_MAX 256
-#include "utils/magic_enum.h"
+#include "utils/enum_helpers.h"
 
 namespace esphome {
 namespace opnpool {
@@ -51,6 +42,7 @@ struct poolstate_pump_t;
 struct network_pump_ctrl_t;
 struct network_pump_run_mode_t;
 enum class datalink_pump_id_t : uint8_t;
+class JsonWriter;
 /// @}
 
 namespace poolstate_rx {
@@ -107,32 +99,25 @@ constexpr char const * const KEY_VALUE     = "value";     ///< Pump register val
 /// @name Pool State Logging Functions
 /// @brief Functions to add pool state components to JSON objects.
 /// @{
-void add_time(cJSON * const obj, char const * const key, poolstate_time_t const * const time);
-void add_time_and_date(cJSON * const obj, char const * const key, poolstate_tod_t const * const tod);
-void add_version(cJSON * const obj, char const * const key, poolstate_version_t const * const version);
-void add_thermos(cJSON * const obj, char const * const key, poolstate_thermo_t const * thermos, bool const showTemp, bool const showSp, bool const showHeating);
-void add_scheds(cJSON * const obj, char const * const key, poolstate_sched_t const * scheds);
-void add_mode(cJSON * const obj, char const * const key, poolstate_modes_t const mode);
-void add_temps(cJSON * const obj, char const * const key, poolstate_uint8_t const * temps);
-void add_circuits(cJSON * const obj, char const * const key, poolstate_circuit_t const * const circuits);
-void add_state(cJSON * const obj, char const * const key, poolstate_t const * const state);
+void add_time(JsonWriter * const obj, char const * const key, poolstate_time_t const * const time);
+void add_time_and_date(JsonWriter * const obj, char const * const key, poolstate_tod_t const * const tod);
+void add_version(JsonWriter * const obj, char const * const key, poolstate_version_t const * const version);
+void add_thermos(JsonWriter * const obj, char const * const key, poolstate_thermo_t const * thermos, bool const showTemp, bool const showSp, bool const showHeating);
+void add_scheds(JsonWriter * const obj, char const * const key, poolstate_sched_t const * scheds);
+void add_mode(JsonWriter * const obj, char const * const key, poolstate_modes_t const mode);
+void add_temps(JsonWriter * const obj, char const * const key, poolstate_uint8_t const * temps);
+void add_circuits(JsonWriter * const obj, char const * const key, poolstate_circuit_t const * const circuits);
+void add_state(JsonWriter * const obj, char const * const key, poolstate_t const * const state);
 /// @}
 
 /// @name Pump Logging Functions
 /// @brief Functions to add pump-specific data to JSON objects.
 /// @{
-void add_pump_reg_set(cJSON * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_reg_set_t const * const reg);
-void add_pump_reg_resp(cJSON * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_reg_resp_t const * const reg);
-void add_pump_ctrl(cJSON * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_ctrl_t const ctrl);
-void add_pump_mode(cJSON * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_run_mode_t const mode);
-void add_pump_running(cJSON * const obj, char const * const key, datalink_pump_id_t const pump_id, bool const running);
-void add_pump(cJSON * const obj, char const * const key, datalink_pump_id_t const pump_id, poolstate_pump_t const * const pumps);
-/// @}
-
-/// @name Chlorinator Logging Functions
-/// @brief Functions to add chlorinator data to JSON objects.
-/// @{
-void add_chlor_resp(cJSON * const obj, char const * const key, poolstate_chlor_t const * const chlor);
+void add_pump_reg_set(JsonWriter * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_reg_set_t const * const reg);
+void add_pump_reg_resp(JsonWriter * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_reg_resp_t const * const reg);
+void add_pump_ctrl(JsonWriter * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_ctrl_t const ctrl);
+void add_pump_mode(JsonWriter * const obj, char const * const key, datalink_pump_id_t const pump_id, network_pump_run_mode_t const mode);
+void add_pump_running(JsonWriter * const obj, char const * const key, datalink_pump_id_t const pump_id, bool const running);
 /// @}
 
 }  // namespace poolstate_rx_log
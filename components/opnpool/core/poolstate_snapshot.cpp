@@ -0,0 +1,227 @@
+/**
+ * @file poolstate_snapshot.cpp
+ * @brief Warm-start snapshot of the pool state in NVS.
+ *
+ * @details
+ * Implements the snapshot serializer and the NVS storage for PoolStateSnapshot.
+ *
+ * A snapshot is a poolstate_snapshot_hdr_t followed by the raw poolstate_t. The header
+ * records a format version and sizeof(poolstate_t), so a snapshot written by firmware
+ * with a different pool state layout is rejected instead of misinterpreted. Fields that
+ * change by themselves (time-of-day, pump clocks) and the learned controller address
+ * are cleared before serializing. That keeps snapshots stable when nothing meaningful
+ * changed, which limits flash wear, and ensures we don't address the controller before
+ * hearing from it.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <esp_system.h>
+#include <esp_types.h>
+#include <esphome/core/log.h>
+#include <nvs.h>
+
+#include "poolstate_snapshot.h"
+#include "poolstate.h"
+#include "utils/crc32.h"
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wunused-parameter"
+
+namespace esphome {
+namespace opnpool {
+
+constexpr char TAG[] = "poolstate_snapshot";
+
+constexpr char NVS_NAMESPACE[] = "opnpool";
+constexpr char NVS_KEY[]       = "poolstate";
+
+namespace poolstate_snapshot {
+
+size_t
+serialized_size()
+{
+    return sizeof(poolstate_snapshot_hdr_t) + sizeof(poolstate_t);
+}
+
+/**
+ * @brief Serializes a pool state into a snapshot.
+ *
+ * @details
+ * Clears the volatile fields, so that two snapshots of the same equipment state are
+ * byte-identical.
+ *
+ * @param[in]  state   Pool state to serialize.
+ * @param[out] buf     Buffer to receive the snapshot.
+ * @param[in]  buf_len Size of the buffer.
+ * @return             Number of bytes written, or 0 if the buffer is too small.
+ */
+size_t
+serialize(poolstate_t const * const state, uint8_t * const buf, size_t const buf_len)
+{
+    if (state == nullptr || buf == nullptr) { ESP_LOGW(TAG, "null to %s", __func__); return 0; }
+    if (buf_len < serialized_size()) {
+        ESP_LOGW(TAG, "buffer too small (%u < %u)", static_cast<unsigned>(buf_len), static_cast<unsigned>(serialized_size()));
+        return 0;
+    }
+    poolstate_t * const payload = reinterpret_cast<poolstate_t *>(buf + sizeof(poolstate_snapshot_hdr_t));
+    memcpy(payload, state, sizeof(poolstate_t));
+
+    payload->system.addr = {};
+    payload->system.tod = {};
+    for (auto & pump : payload->pumps) {
+        pump.time = {};
+        pump.timer = {};
+    }
+
+    poolstate_snapshot_hdr_t const hdr = {
+        .magic = MAGIC,
+        .version = VERSION,
+        .reserved = 0,
+        .size = static_cast<uint16_t>(sizeof(poolstate_t)),
+        .crc = crc32(reinterpret_cast<uint8_t const *>(payload), sizeof(poolstate_t))
+    };
+    memcpy(buf, &hdr, sizeof(hdr));
+    return serialized_size();
+}
+
+/**
+ * @brief Deserializes a snapshot into a pool state.
+ *
+ * @param[in]  buf     Buffer holding the snapshot.
+ * @param[in]  buf_len Number of bytes in the buffer.
+ * @param[out] state   Pool state to receive the snapshot.
+ * @return             ESP_OK on success, or an error if the snapshot can't be used.
+ */
+esp_err_t
+deserialize(uint8_t const * const buf, size_t const buf_len, poolstate_t * const state)
+{
+    if (buf == nullptr || state == nullptr) { ESP_LOGW(TAG, "null to %s", __func__); return ESP_ERR_INVALID_ARG; }
+
+    poolstate_snapshot_hdr_t hdr;
+    if (buf_len < sizeof(hdr)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(&hdr, buf, sizeof(hdr));
+
+    if (hdr.magic != MAGIC || hdr.version != VERSION) {
+        ESP_LOGW(TAG, "Snapshot version %u not supported", hdr.version);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (hdr.size != sizeof(poolstate_t) || buf_len != serialized_size()) {
+        ESP_LOGW(TAG, "Snapshot size mismatch (%u != %u)", hdr.size, static_cast<unsigned>(sizeof(poolstate_t)));
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint8_t const * const payload = buf + sizeof(hdr);
+    if (crc32(payload, sizeof(poolstate_t)) != hdr.crc) {
+        ESP_LOGW(TAG, "Snapshot CRC mismatch");
+        return ESP_ERR_INVALID_CRC;
+    }
+    memcpy(state, payload, sizeof(poolstate_t));
+    return ESP_OK;
+}
+
+}  // namespace poolstate_snapshot
+
+/**
+ * @brief Restores the pool state from NVS.
+ *
+ * @param[out] state Pool state to receive the snapshot.
+ * @return           ESP_OK if a valid snapshot was restored, an error otherwise.
+ */
+esp_err_t
+PoolStateSnapshot::restore(poolstate_t * const state)
+{
+    if (state == nullptr) { ESP_LOGW(TAG, "null to %s", __func__); return ESP_ERR_INVALID_ARG; }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGI(TAG, "No snapshot (%s)", esp_err_to_name(err));
+        return err;
+    }
+    uint8_t buf[sizeof(poolstate_snapshot::poolstate_snapshot_hdr_t) + sizeof(poolstate_t)];
+    size_t len = sizeof(buf);
+
+    err = nvs_get_blob(handle, NVS_KEY, buf, &len);
+    nvs_close(handle);
+    if (err != ESP_OK) {
+        ESP_LOGI(TAG, "No snapshot (%s)", esp_err_to_name(err));
+        return err;
+    }
+    err = poolstate_snapshot::deserialize(buf, len, state);
+    if (err != ESP_OK) {
+        return err;
+    }
+    poolstate_snapshot::poolstate_snapshot_hdr_t hdr;
+    memcpy(&hdr, buf, sizeof(hdr));
+    last_crc_ = hdr.crc;
+
+    ESP_LOGI(TAG, "Restored snapshot (%u bytes)", static_cast<unsigned>(len));
+    return ESP_OK;
+}
+
+/**
+ * @brief Writes the pool state to NVS if it changed and the write interval passed.
+ *
+ * @details
+ * Bounds flash wear in two ways: a snapshot identical to the last one written (or
+ * restored) is never written again, and writes are at least WRITE_INTERVAL_MS apart.
+ * NVS spreads the writes over its pages. `force` bypasses the interval, and is meant for
+ * shutdown (e.g. before an OTA reboot). A checkpoint that comes too soon marks the
+ * snapshot dirty, so the caller can checkpoint again once is_due(). A failed write is
+ * also retried after the interval.
+ *
+ * @param[in] state  Pool state to checkpoint.
+ * @param[in] now_ms Current time in milliseconds.
+ * @param[in] force  Write (if changed) regardless of the write interval.
+ * @return           ESP_OK if written or nothing to do, an error if the write failed.
+ */
+esp_err_t
+PoolStateSnapshot::checkpoint(poolstate_t const * const state, uint32_t const now_ms, bool const force)
+{
+    if (state == nullptr) { ESP_LOGW(TAG, "null to %s", __func__); return ESP_ERR_INVALID_ARG; }
+
+    if (!force && written_ && now_ms - last_write_ms_ < WRITE_INTERVAL_MS) {
+        dirty_ = true;
+        return ESP_OK;  // too soon, write once is_due()
+    }
+    uint8_t buf[sizeof(poolstate_snapshot::poolstate_snapshot_hdr_t) + sizeof(poolstate_t)];
+    size_t const len = poolstate_snapshot::serialize(state, buf, sizeof(buf));
+    if (len == 0) {
+        return ESP_FAIL;
+    }
+    poolstate_snapshot::poolstate_snapshot_hdr_t hdr;
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (hdr.crc == last_crc_) {
+        dirty_ = false;
+        return ESP_OK;  // unchanged
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, NVS_KEY, buf, len);
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    last_write_ms_ = now_ms;
+    written_ = true;
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to write snapshot (%s)", esp_err_to_name(err));
+        dirty_ = true;
+        return err;
+    }
+    last_crc_ = hdr.crc;
+    dirty_ = false;
+    write_count_++;
+    ESP_LOGV(TAG, "Wrote snapshot #%lu (%u bytes)", static_cast<unsigned long>(write_count_), static_cast<unsigned>(len));
+    return ESP_OK;
+}
+
+}  // namespace opnpool
+}  // namespace esphome
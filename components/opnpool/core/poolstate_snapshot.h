@@ -0,0 +1,131 @@
+/**
+ * @file poolstate_snapshot.h
+ * @brief Warm-start snapshot of the pool state in NVS.
+ *
+ * @details
+ * After a reboot or OTA update, all entities would stay unknown until the pool controller
+ * broadcasts its state, and schedules, firmware version and heat set points would wait
+ * for the first periodic request. This header declares a compact, versioned snapshot of
+ * poolstate_t that is checkpointed to NVS and restored during setup, so the last known
+ * state can be published right away.
+ *
+ * The serializer only needs the ESP-IDF error codes, the logger and crc32(), and the
+ * PoolStateSnapshot class also NVS. These have host stand-ins, so both are exercised on a
+ * host, see tests/host/test_poolstate_snapshot.cpp.
+ *
+ * The class bounds the write rate: it only writes when the (non-volatile part of the)
+ * state changed, and no more often than WRITE_INTERVAL_MS, except when forced on
+ * shutdown. A change that comes too soon is held until the interval passed, see is_due().
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+#ifndef __cplusplus
+# error "Requires C++ compilation"
+#endif
+
+#include <esp_system.h>
+#include <esp_types.h>
+
+namespace esphome {
+namespace opnpool {
+
+#ifndef PACK8
+# define PACK8 __attribute__((aligned( __alignof__(uint8_t)), packed))
+#endif
+
+    // forward declarations (to avoid circular dependencies)
+struct poolstate_t;
+
+namespace poolstate_snapshot {
+
+constexpr uint16_t MAGIC   = 0x504F;  ///< "PO", identifies an OPNpool snapshot.
+constexpr uint8_t  VERSION = 1;       ///< Bump when the meaning of poolstate_t fields changes.
+
+/// @brief Header that precedes the serialized poolstate_t.
+struct poolstate_snapshot_hdr_t {
+    uint16_t magic;    ///< MAGIC.
+    uint8_t  version;  ///< VERSION at the time of writing.
+    uint8_t  reserved; ///< Always 0.
+    uint16_t size;     ///< sizeof(poolstate_t) at the time of writing.
+    uint32_t crc;      ///< CRC-32 over the payload.
+} PACK8;
+
+/**
+ * @brief Returns the number of bytes needed to serialize a pool state.
+ */
+[[nodiscard]] size_t serialized_size();
+
+/**
+ * @brief Serializes a pool state into a snapshot.
+ *
+ * @param[in]  state   Pool state to serialize.
+ * @param[out] buf     Buffer to receive the snapshot.
+ * @param[in]  buf_len Size of the buffer.
+ * @return             Number of bytes written, or 0 if the buffer is too small.
+ */
+[[nodiscard]] size_t serialize(poolstate_t const * const state, uint8_t * const buf, size_t const buf_len);
+
+/**
+ * @brief Deserializes a snapshot into a pool state.
+ *
+ * @param[in]  buf     Buffer holding the snapshot.
+ * @param[in]  buf_len Number of bytes in the buffer.
+ * @param[out] state   Pool state to receive the snapshot.
+ * @return             ESP_OK on success, ESP_ERR_INVALID_VERSION, ESP_ERR_INVALID_SIZE or
+ *                     ESP_ERR_INVALID_CRC if the snapshot can't be used.
+ */
+[[nodiscard]] esp_err_t deserialize(uint8_t const * const buf, size_t const buf_len, poolstate_t * const state);
+
+}  // namespace poolstate_snapshot
+
+/**
+ * @brief Stores and restores pool state snapshots in NVS.
+ *
+ * @details
+ * Intended for use in the single-threaded ESPHome main task.
+ */
+class PoolStateSnapshot {
+
+  public:
+    static constexpr uint32_t WRITE_INTERVAL_MS = 15 * 60 * 1000;  ///< Minimum time between writes.
+
+    /**
+     * @brief Restores the pool state from NVS.
+     *
+     * @param[out] state Pool state to receive the snapshot.
+     * @return           ESP_OK if a valid snapshot was restored, an error otherwise.
+     */
+    [[nodiscard]] esp_err_t restore(poolstate_t * const state);
+
+    /**
+     * @brief Writes the pool state to NVS if it changed and the write interval passed.
+     *
+     * @param[in] state  Pool state to checkpoint.
+     * @param[in] now_ms Current time in milliseconds (e.g. millis()).
+     * @param[in] force  Write (if changed) regardless of the write interval.
+     * @return           ESP_OK if written or nothing to do, an error if the write failed.
+     */
+    esp_err_t checkpoint(poolstate_t const * const state, uint32_t const now_ms, bool const force = false);
+
+    /// @brief Returns true if a checkpoint was held back by the write interval, and the interval passed.
+    [[nodiscard]] bool is_due(uint32_t const now_ms) const {
+        return dirty_ && static_cast<int32_t>(now_ms - last_write_ms_) >= static_cast<int32_t>(WRITE_INTERVAL_MS);
+    }
+
+    /// @brief Returns the number of NVS writes since boot.
+    [[nodiscard]] uint32_t get_write_count() const { return write_count_; }
+
+  private:
+    uint32_t last_crc_{0};         ///< CRC of the last snapshot written or restored.
+    uint32_t last_write_ms_{0};    ///< Time of the last write.
+    uint32_t write_count_{0};      ///< Number of writes since boot.
+    bool     written_{false};      ///< True once a snapshot was written (or tried) since boot.
+    bool     dirty_{false};        ///< True if a checkpoint was held back, and is still to be written.
+};
+
+}  // namespace opnpool
+}  // namespace esphome
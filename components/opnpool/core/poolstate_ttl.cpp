@@ -0,0 +1,351 @@
+/**
+ * @file poolstate_ttl.cpp
+ * @brief Staleness tracking for pool state subsystems.
+ *
+ * @details
+ * Implements the PoolStateTtl timer wheel and the helpers that map network messages to
+ * the pool state subsystems they refresh, and that invalidate a subsystem once it went
+ * stale.
+ *
+ * The wheel has WHEEL_SLOTS slots of TICK_MS each. An entry is placed in the slot that
+ * corresponds to its deadline. Deadlines further out than one revolution, or deadlines
+ * that were pushed out by touch() after the entry was queued, are handled by simply
+ * re-queuing the entry when its slot is processed and the deadline hasn't passed yet.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <esp_system.h>
+#include <esp_types.h>
+#include <esphome/core/log.h>
+#include <cstddef>
+#include <cstring>
+
+#include "poolstate_ttl.h"
+#include "poolstate.h"
+#include "pool_task/network_msg.h"
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wunused-parameter"
+
+namespace esphome {
+namespace opnpool {
+
+constexpr char TAG[] = "poolstate_ttl";
+
+/**
+ * @brief Returns true if time `a` is at or after time `b`, allowing for millis() wrap.
+ */
+[[nodiscard]] static inline bool
+_time_reached(uint32_t const a, uint32_t const b)
+{
+    return static_cast<int32_t>(a - b) >= 0;
+}
+
+PoolStateTtl::PoolStateTtl() : cursor_{0}, tick_ms_{0}, started_{false}
+{
+    for (auto & entry : entries_) {
+        entry = {
+            .ttl_ms = 0,
+            .deadline_ms = 0,
+            .next = NO_ENTRY,
+            .queued = false
+        };
+    }
+    for (auto & slot : slots_) {
+        slot = NO_ENTRY;
+    }
+}
+
+void
+PoolStateTtl::set_ttl(poolstate_subsys_t const subsys, uint32_t const ttl_ms)
+{
+    entries_[enum_index(subsys)].ttl_ms = ttl_ms;
+}
+
+uint32_t
+PoolStateTtl::get_ttl(poolstate_subsys_t const subsys) const
+{
+    return entries_[enum_index(subsys)].ttl_ms;
+}
+
+/**
+ * @brief Anchors the wheel to the current time when it is first used.
+ *
+ * @param[in] now_ms Current time in milliseconds.
+ */
+void
+PoolStateTtl::start_(uint32_t const now_ms)
+{
+    if (!started_) {
+        tick_ms_ = now_ms;
+        started_ = true;
+    }
+}
+
+/**
+ * @brief Queues an entry in the wheel slot that matches its deadline.
+ *
+ * @details
+ * The slot is relative to the cursor, so the wheel keeps working when millis() wraps.
+ * Deadlines beyond one revolution go in the cursor's slot and get re-queued when visited.
+ *
+ * @param[in] idx Index of the entry.
+ */
+void
+PoolStateTtl::insert_(uint8_t const idx)
+{
+    entry_t * const entry = &entries_[idx];
+    uint32_t const delta_ms = entry->deadline_ms - tick_ms_;
+    uint32_t ticks_ahead = (delta_ms + TICK_MS - 1) / TICK_MS;  // round up, so we never fire early
+
+    if (ticks_ahead == 0 || static_cast<int32_t>(delta_ms) < 0) {
+        ticks_ahead = 1;
+    } else if (ticks_ahead > WHEEL_SLOTS) {
+        ticks_ahead = WHEEL_SLOTS;
+    }
+    uint8_t const slot = (cursor_ + ticks_ahead) % WHEEL_SLOTS;
+
+    entry->next = slots_[slot];
+    entry->queued = true;
+    slots_[slot] = idx;
+}
+
+/**
+ * @brief Marks subsystems as freshly updated.
+ *
+ * @details
+ * Pushes the deadline out by the subsystem's TTL. If the entry is already queued, it
+ * stays in its (now early) slot and is re-queued lazily by expire().
+ *
+ * @param[in] mask   Subsystems that were just updated.
+ * @param[in] now_ms Current time in milliseconds.
+ */
+void
+PoolStateTtl::touch(poolstate_subsys_mask_t const mask, uint32_t const now_ms)
+{
+    start_(now_ms);
+
+    for (uint8_t idx = 0; idx < enum_count<poolstate_subsys_t>(); idx++) {
+
+        entry_t * const entry = &entries_[idx];
+        if (!(mask & (1U << idx)) || entry->ttl_ms == 0) {
+            continue;
+        }
+        entry->deadline_ms = now_ms + entry->ttl_ms;
+        if (!entry->queued) {
+            insert_(idx);
+        }
+    }
+}
+
+/**
+ * @brief Advances the timer wheel up to `now_ms` and collects expired subsystems.
+ *
+ * @details
+ * Processes one slot for every full tick that passed since the last call, but at most
+ * one revolution. Entries whose deadline passed are reported and dequeued; the others
+ * are re-queued in the slot that matches their current deadline.
+ *
+ * @param[in] now_ms Current time in milliseconds.
+ * @return           Mask of subsystems that went stale.
+ */
+poolstate_subsys_mask_t
+PoolStateTtl::expire(uint32_t const now_ms)
+{
+    start_(now_ms);
+
+    poolstate_subsys_mask_t expired = 0;
+
+    for (uint8_t step = 0; step < WHEEL_SLOTS && now_ms - tick_ms_ >= TICK_MS; step++) {
+
+        tick_ms_ += TICK_MS;
+        cursor_ = (cursor_ + 1) % WHEEL_SLOTS;
+
+        uint8_t idx = slots_[cursor_];
+        slots_[cursor_] = NO_ENTRY;  // detach, so re-queued entries don't get processed twice
+
+        while (idx != NO_ENTRY) {
+            entry_t * const entry = &entries_[idx];
+            uint8_t const next = entry->next;
+            entry->queued = false;
+
+            if (entry->ttl_ms == 0) {
+                // TTL was disabled after the entry was queued, just drop it
+            } else if (_time_reached(now_ms, entry->deadline_ms)) {
+                expired |= static_cast<poolstate_subsys_mask_t>(1U << idx);
+                ESP_LOGV(TAG, "%s went stale", enum_str(static_cast<poolstate_subsys_t>(idx)));
+            } else {
+                insert_(idx);
+            }
+            idx = next;
+        }
+    }
+    if (now_ms - tick_ms_ >= TICK_MS) {
+        tick_ms_ = now_ms;  // fell behind by more than a revolution, resynchronize
+    }
+    return expired;
+}
+
+namespace poolstate_ttl {
+
+/**
+ * @brief Determines which subsystems a received message refreshes.
+ *
+ * @param[in] msg Pointer to the received network message.
+ * @return        Mask of subsystems refreshed by this message.
+ */
+poolstate_subsys_mask_t
+subsys_touched_by(network_msg_t const * const msg)
+{
+    if (msg == nullptr) { ESP_LOGW(TAG, "null to %s", __func__); return 0; }
+
+    switch (msg->typ) {
+        case network_msg_typ_t::CTRL_STATE_BCAST:
+            return poolstate_subsys_bit(poolstate_subsys_t::SYSTEM) |
+                   poolstate_subsys_bit(poolstate_subsys_t::CIRCUITS) |
+                   poolstate_subsys_bit(poolstate_subsys_t::TEMPS) |
+                   poolstate_subsys_bit(poolstate_subsys_t::THERMOS);
+        case network_msg_typ_t::CTRL_TIME_RESP:
+        case network_msg_typ_t::CTRL_VERSION_RESP:
+            return poolstate_subsys_bit(poolstate_subsys_t::SYSTEM);
+        case network_msg_typ_t::CTRL_HEAT_RESP:
+            return poolstate_subsys_bit(poolstate_subsys_t::THERMOS);
+        case network_msg_typ_t::CTRL_SCHED_RESP:
+            return poolstate_subsys_bit(poolstate_subsys_t::SCHEDS);
+        case network_msg_typ_t::PUMP_REG_RESP:
+        case network_msg_typ_t::PUMP_REMOTE_CTRL_RESP:
+        case network_msg_typ_t::PUMP_RUN_MODE_RESP:
+        case network_msg_typ_t::PUMP_RUN_RESP:
+        case network_msg_typ_t::PUMP_STATUS_RESP:
+            if (!msg->src.is_pump()) {
+                return 0;
+            }
+            return poolstate_subsys_bit(pump_subsys(enum_index(msg->src.get_pump_id())));
+        case network_msg_typ_t::CHLOR_MODEL_RESP:
+        case network_msg_typ_t::CHLOR_LEVEL_RESP:
+            return poolstate_subsys_bit(poolstate_subsys_t::CHLOR);
+        default:
+            return 0;
+    }
+}
+
+    // subsystem of each pump, indexed by datalink_pump_id_t
+constexpr poolstate_subsys_t _pump_subsys[] = {
+    poolstate_subsys_t::PRIMARY_PUMP, poolstate_subsys_t::SOLAR_PUMP,
+    poolstate_subsys_t::PUMP_3,  poolstate_subsys_t::PUMP_4,  poolstate_subsys_t::PUMP_5,  poolstate_subsys_t::PUMP_6,
+    poolstate_subsys_t::PUMP_7,  poolstate_subsys_t::PUMP_8,  poolstate_subsys_t::PUMP_9,  poolstate_subsys_t::PUMP_10,
+    poolstate_subsys_t::PUMP_11, poolstate_subsys_t::PUMP_12, poolstate_subsys_t::PUMP_13, poolstate_subsys_t::PUMP_14,
+    poolstate_subsys_t::PUMP_15, poolstate_subsys_t::PUMP_16,
+};
+static_assert(sizeof(_pump_subsys) / sizeof(_pump_subsys[0]) == enum_count<datalink_pump_id_t>(),
+              "_pump_subsys doesn't match datalink_pump_id_t");
+
+poolstate_subsys_t
+pump_subsys(uint8_t const pump_idx)
+{
+    return _pump_subsys[pump_idx & datalink_addr_t::PUMP_ID_MASK];
+}
+
+bool
+subsys_pump(poolstate_subsys_t const subsys, uint8_t * const pump_idx)
+{
+    for (uint8_t idx = 0; idx < enum_count<datalink_pump_id_t>(); idx++) {
+        if (_pump_subsys[idx] == subsys) {
+            *pump_idx = idx;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Part of poolstate_t that holds the fields of a subsystem.
+ */
+struct _subsys_span_t {
+    size_t offset;  ///< Offset of the first field in poolstate_t.
+    size_t size;    ///< Number of bytes.
+};
+
+[[nodiscard]] static _subsys_span_t
+_subsys_span(poolstate_subsys_t const subsys)
+{
+    switch (subsys) {
+        case poolstate_subsys_t::SYSTEM:
+            return {offsetof(poolstate_t, system), sizeof(poolstate_t::system)};
+        case poolstate_subsys_t::CIRCUITS:
+            return {offsetof(poolstate_t, circuits), sizeof(poolstate_t::circuits)};
+        case poolstate_subsys_t::TEMPS:
+            return {offsetof(poolstate_t, temps), sizeof(poolstate_t::temps)};
+        case poolstate_subsys_t::THERMOS:
+            return {offsetof(poolstate_t, thermos), sizeof(poolstate_t::thermos)};
+        case poolstate_subsys_t::SCHEDS:
+            return {offsetof(poolstate_t, scheds), sizeof(poolstate_t::scheds)};
+        case poolstate_subsys_t::CHLOR:
+            return {offsetof(poolstate_t, chlor), sizeof(poolstate_t::chlor)};
+        default:
+            break;
+    }
+    uint8_t pump_idx;
+    if (subsys_pump(subsys, &pump_idx)) {
+        return {offsetof(poolstate_t, pumps) + pump_idx * sizeof(poolstate_pump_t), sizeof(poolstate_pump_t)};
+    }
+    return {0, 0};
+}
+
+/**
+ * @brief Clears the validity of all fields that belong to a subsystem.
+ *
+ * @details
+ * All poolstate_t wrappers use `valid == false` for zero, so zeroing the subsystem's
+ * part of the state invalidates every field in it. The learned controller address is
+ * configuration rather than a reading, so it survives, and commands still reach the
+ * controller after a quiet spell.
+ *
+ * @param[in,out] state  Pool state to modify.
+ * @param[in]     subsys The subsystem to invalidate.
+ */
+void
+invalidate(poolstate_t * const state, poolstate_subsys_t const subsys)
+{
+    if (state == nullptr) { ESP_LOGW(TAG, "null to %s", __func__); return; }
+
+    poolstate_controller_addr_t const addr = state->system.addr;
+    _subsys_span_t const span = _subsys_span(subsys);
+    memset(reinterpret_cast<uint8_t *>(state) + span.offset, 0, span.size);
+    state->system.addr = addr;
+}
+
+/**
+ * @brief Determines which subsystems differ between two pool states.
+ *
+ * @details
+ * Unlike subsys_touched_by(), this also catches changes that don't come from the device
+ * that owns the data, such as a command we sent that is passed up as if received.
+ *
+ * @param[in] old_state Pool state before the change.
+ * @param[in] new_state Pool state after the change.
+ * @return              Mask of subsystems with at least one field that changed.
+ */
+poolstate_subsys_mask_t
+subsys_changed(poolstate_t const * const old_state, poolstate_t const * const new_state)
+{
+    if (old_state == nullptr || new_state == nullptr) { ESP_LOGW(TAG, "null to %s", __func__); return 0; }
+
+    poolstate_subsys_mask_t changed = 0;
+    for (auto subsys : magic_enum::enum_values<poolstate_subsys_t>()) {
+        _subsys_span_t const span = _subsys_span(subsys);
+        if (memcmp(reinterpret_cast<uint8_t const *>(old_state) + span.offset,
+                   reinterpret_cast<uint8_t const *>(new_state) + span.offset, span.size) != 0) {
+            changed |= poolstate_subsys_bit(subsys);
+        }
+    }
+    return changed;
+}
+
+}  // namespace poolstate_ttl
+
+}  // namespace opnpool
+}  // namespace esphome
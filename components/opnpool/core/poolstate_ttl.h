@@ -0,0 +1,213 @@
+/**
+ * @file poolstate_ttl.h
+ * @brief Staleness tracking for pool state subsystems.
+ *
+ * @details
+ * Once a value in poolstate_t is set, it stays valid until a message overwrites it. If
+ * a peripheral drops off the bus (e.g. the pump loses power), its last reported values
+ * would be shown forever. This header declares the PoolStateTtl class, which keeps a
+ * last-update timestamp and a configurable time-to-live (TTL) for each subsystem of the
+ * pool state. When a TTL expires, the caller invalidates that part of poolstate_t and
+ * publishes the related entities as unavailable.
+ *
+ * Expiry is driven by a small hashed timer wheel, so the main loop only looks at the
+ * entries that fall in the current tick instead of scanning every subsystem. Refreshing
+ * a subsystem is O(1): it only moves the deadline forward, and the entry is rescheduled
+ * lazily when its slot comes around.
+ *
+ * Intended for use in the single-threaded ESPHome main task.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+#ifndef __cplusplus
+# error "Requires C++ compilation"
+#endif
+
+#include <esp_system.h>
+#include <esp_types.h>
+
+#include "utils/enum_helpers.h"
+
+namespace esphome {
+namespace opnpool {
+
+    // forward declarations (to avoid circular dependencies)
+struct network_msg_t;
+struct poolstate_t;
+
+/**
+ * @brief Subsystems of poolstate_t that expire independently.
+ *
+ * @note MUST be in the same order as CONF_STALE_AFTER_DEFAULTS in __init__.py.
+ */
+enum class poolstate_subsys_t : uint8_t {
+    SYSTEM       = 0,  ///< Time-of-day, modes and firmware version.
+    CIRCUITS     = 1,  ///< Circuit active/delay flags.
+    TEMPS        = 2,  ///< Air and water temperatures.
+    THERMOS      = 3,  ///< Pool/spa set points, heat sources and heating status.
+    SCHEDS       = 4,  ///< Circuit schedules.
+    PRIMARY_PUMP = 5,  ///< Primary pump status.
+    SOLAR_PUMP   = 6,  ///< Solar pump status.
+    CHLOR        = 7,  ///< Chlorinator status.
+    PUMP_3       = 8,  ///< Status of pump 3 (0x62), and so on up to pump 16 (0x6F).
+    PUMP_4       = 9,
+    PUMP_5       = 10,
+    PUMP_6       = 11,
+    PUMP_7       = 12,
+    PUMP_8       = 13,
+    PUMP_9       = 14,
+    PUMP_10      = 15,
+    PUMP_11      = 16,
+    PUMP_12      = 17,
+    PUMP_13      = 18,
+    PUMP_14      = 19,
+    PUMP_15      = 20,
+    PUMP_16      = 21
+};
+
+/// @brief Bit mask with one bit per poolstate_subsys_t.
+using poolstate_subsys_mask_t = uint32_t;
+
+static_assert(enum_count<poolstate_subsys_t>() <= sizeof(poolstate_subsys_mask_t) * 8,
+              "poolstate_subsys_mask_t too small for poolstate_subsys_t");
+
+/**
+ * @brief Returns the mask bit for a subsystem.
+ *
+ * @param[in] subsys The subsystem.
+ * @return           The bit that represents the subsystem in a poolstate_subsys_mask_t.
+ */
+[[nodiscard]] constexpr poolstate_subsys_mask_t
+poolstate_subsys_bit(poolstate_subsys_t const subsys)
+{
+    return static_cast<poolstate_subsys_mask_t>(1U << enum_index(subsys));
+}
+
+/**
+ * @brief Tracks per-subsystem freshness using a hashed timer wheel.
+ *
+ * @details
+ * Each subsystem has a TTL in milliseconds (0 disables expiry). Calling touch() for a
+ * subsystem pushes its deadline TTL milliseconds into the future. Calling expire() with
+ * the current time returns the subsystems whose deadline has passed since they were last
+ * touched. An expired subsystem is not reported again until it is touched again.
+ */
+class PoolStateTtl {
+
+  public:
+    static constexpr uint8_t  WHEEL_SLOTS = 32;    ///< Number of slots in the timer wheel.
+    static constexpr uint32_t TICK_MS     = 1000;  ///< Time covered by each slot.
+
+    PoolStateTtl();
+
+    /**
+     * @brief Sets the time-to-live for a subsystem.
+     *
+     * @param[in] subsys The subsystem.
+     * @param[in] ttl_ms Time-to-live in milliseconds, or 0 to never expire.
+     */
+    void set_ttl(poolstate_subsys_t subsys, uint32_t ttl_ms);
+
+    /**
+     * @brief Returns the time-to-live for a subsystem.
+     *
+     * @param[in] subsys The subsystem.
+     * @return           Time-to-live in milliseconds, or 0 if it never expires.
+     */
+    [[nodiscard]] uint32_t get_ttl(poolstate_subsys_t subsys) const;
+
+    /**
+     * @brief Marks the subsystems in a mask as freshly updated.
+     *
+     * @param[in] mask   Subsystems that were just updated.
+     * @param[in] now_ms Current time in milliseconds (e.g. millis()).
+     */
+    void touch(poolstate_subsys_mask_t mask, uint32_t now_ms);
+
+    /**
+     * @brief Advances the timer wheel and collects expired subsystems.
+     *
+     * @param[in] now_ms Current time in milliseconds (e.g. millis()).
+     * @return           Mask of subsystems that became stale since the last call.
+     */
+    [[nodiscard]] poolstate_subsys_mask_t expire(uint32_t now_ms);
+
+  private:
+    static constexpr uint8_t NO_ENTRY = 0xFF;  ///< End-of-list marker.
+
+    /// @brief Per-subsystem bookkeeping (intrusive singly linked list per wheel slot).
+    struct entry_t {
+        uint32_t ttl_ms;       ///< Configured time-to-live, 0 to disable.
+        uint32_t deadline_ms;  ///< Time at which the subsystem becomes stale.
+        uint8_t  next;         ///< Next entry in the same wheel slot, or NO_ENTRY.
+        bool     queued;       ///< True while the entry sits in a wheel slot.
+    };
+
+    void start_(uint32_t now_ms);
+    void insert_(uint8_t idx);
+
+    entry_t  entries_[enum_count<poolstate_subsys_t>()];  ///< One entry per subsystem.
+    uint8_t  slots_[WHEEL_SLOTS];                          ///< Head of each slot's list.
+    uint8_t  cursor_;                                      ///< Slot of the last processed tick.
+    uint32_t tick_ms_;                                     ///< Time of the last processed tick.
+    bool     started_;                                     ///< False until the wheel is first used.
+};
+
+namespace poolstate_ttl {
+
+/**
+ * @brief Determines which subsystems a received message refreshes.
+ *
+ * @details
+ * Only messages that originate from the device that owns the data count. For example,
+ * a PUMP_STATUS_REQ from the controller doesn't prove the pump is still alive, but the
+ * PUMP_STATUS_RESP does.
+ *
+ * @param[in] msg Pointer to the received network message.
+ * @return        Mask of subsystems refreshed by this message.
+ */
+[[nodiscard]] poolstate_subsys_mask_t subsys_touched_by(network_msg_t const * const msg);
+
+/**
+ * @brief Returns the subsystem of a pump.
+ *
+ * @param[in] pump_idx Index of the pump in poolstate_t::pumps (its datalink_pump_id_t).
+ * @return             The subsystem of that pump.
+ */
+[[nodiscard]] poolstate_subsys_t pump_subsys(uint8_t const pump_idx);
+
+/**
+ * @brief Finds the pump that a subsystem belongs to.
+ *
+ * @param[in]  subsys   The subsystem.
+ * @param[out] pump_idx Receives the index of the pump in poolstate_t::pumps.
+ * @return              True if the subsystem belongs to a pump.
+ */
+[[nodiscard]] bool subsys_pump(poolstate_subsys_t const subsys, uint8_t * const pump_idx);
+
+/**
+ * @brief Clears the validity of all fields that belong to a subsystem.
+ *
+ * @param[in,out] state  Pool state to modify.
+ * @param[in]     subsys The subsystem to invalidate.
+ */
+void invalidate(poolstate_t * const state, poolstate_subsys_t const subsys);
+
+/**
+ * @brief Determines which subsystems differ between two pool states.
+ *
+ * @param[in] old_state Pool state before the change.
+ * @param[in] new_state Pool state after the change.
+ * @return              Mask of subsystems with at least one field that changed.
+ */
+[[nodiscard]] poolstate_subsys_mask_t subsys_changed(poolstate_t const * const old_state,
+                                                     poolstate_t const * const new_state);
+
+}  // namespace poolstate_ttl
+
+}  // namespace opnpool
+}  // namespace esphome
@@ -71,5 +71,23 @@ OpnPoolBinarySensor::publish_value_if_changed(bool const value)
     }
 }
 
+/**
+ * @brief Invalidates the binary sensor state because its source went stale.
+ *
+ * @details
+ * Clears the state, so Home Assistant shows it as unknown. Also clears the last
+ * published value, so the next valid value is published even if it is unchanged.
+ */
+void
+OpnPoolBinarySensor::publish_unavailable()
+{
+    if (!last_.valid) {
+        return;
+    }
+    this->invalidate_state();
+    last_.valid = false;
+    ESP_LOGV(TAG, "Published unavailable");
+}
+
 }  // namespace opnpool
 }  // namespace esphome
\ No newline at end of file
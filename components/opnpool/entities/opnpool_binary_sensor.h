@@ -51,6 +51,11 @@ class OpnPoolBinarySensor : public binary_sensor::BinarySensor, public Component
      */
     void publish_value_if_changed(bool value);
 
+    /**
+     * @brief Invalidates the binary sensor state because its source went stale.
+     */
+    void publish_unavailable();
+
   protected:
         /// @brief Tracks the last published state to avoid redundant updates
     struct last_t {
@@ -14,7 +14,9 @@
  *
  * restore_mode is ignored because state is always synchronized from the pool controller.
  * The component will always reflect the actual state of the pool/spa thermostats as 
- * reported by the pool controller.
+ * reported by the pool controller. In optimistic mode, requested settings are shown until
+ * the controller reports them, or until OPTIMISTIC_TIMEOUT_MS passes and they are rolled
+ * back.
  * 
  * @author Coert Vonk (@cvonk on GitHub)
  * @copyright Copyright (c) 2026 Coert Vonk
@@ -24,12 +26,13 @@
 #include <esp_system.h>
 #include <esp_types.h>
 #include <esphome/core/log.h>
+#include <esphome/core/hal.h>
+#include <cmath>
 #include <type_traits>
 
 #include "utils/to_str.h"
 #include "opnpool_climate.h"  // no other #includes that could make a circular dependency
 #include "core/opnpool.h"      // no other #includes that could make a circular dependency
-#include "ipc/ipc.h"          // no other #includes that could make a circular dependency
 #include "pool_task/network_msg.h"  // #includes datalink_pkt.h, that doesn't #include others that could make a circular dependency
 #include "core/poolstate.h"
 #include "opnpool_switch.h"
@@ -45,6 +48,9 @@ namespace opnpool {
 
 constexpr char TAG[] = "opnpool_climate";
 
+constexpr uint32_t COMMAND_FAILED_WARNING_MS = 10 * 1000;  ///< How long a lost command is flagged [ms]
+constexpr uint32_t OPTIMISTIC_TIMEOUT_MS     = 15 * 1000;  ///< Time for the controller to confirm optimistic settings [ms]
+
 /**
  * @brief Converts a temperature from Celsius to Fahrenheit.
  *
@@ -56,6 +62,22 @@ _celsius_to_fahrenheit(float c) {
     return c * 9.0f / 5.0f + 32.0f;
 }
 
+/**
+ * @brief Adjusts the climate action to a climate mode that the controller hasn't reported yet.
+ *
+ * @param[in] action The action reported by the controller.
+ * @param[in] mode   The climate mode that is shown.
+ * @return           OFF when the mode is OFF, IDLE instead of OFF when heating is enabled.
+ */
+[[nodiscard]] static climate::ClimateAction
+_action_for_mode(climate::ClimateAction const action, climate::ClimateMode const mode)
+{
+    if (mode == climate::CLIMATE_MODE_OFF) {
+        return climate::CLIMATE_ACTION_OFF;
+    }
+    return action == climate::CLIMATE_ACTION_OFF ? climate::CLIMATE_ACTION_IDLE : action;
+}
+
 /**
  * @brief Maps a thermostat type to its corresponding pool circuit index.
  *
@@ -98,6 +120,7 @@ OpnPoolClimate::dump_config()
     ESP_LOGCONFIG(TAG, "    Last mode: %s", last_.valid ? enum_str(last_.mode) : "<unknown>");
     ESP_LOGCONFIG(TAG, "    Last custom preset: %s", last_.valid ? last_.custom_preset : "<unknown>");
     ESP_LOGCONFIG(TAG, "    Last action: %s", last_.valid ? enum_str(last_.action) : "<unknown>");
+    ESP_LOGCONFIG(TAG, "    Optimistic: %s", optimistic_ ? "ON" : "OFF");
 }
 
 
@@ -146,10 +169,12 @@ OpnPoolClimate::traits()
  * @details
  * Processes incoming commands for target temperature, climate mode (OFF/HEAT), and heat
  * source (custom preset). The pool controller doesn't have a concept of climate modes.
- * Instead we map it to the pool/spa circuit switch. Constructs and sends protocol
- * messages to the pool controller if thermostat settings have changed. Unsupported
- * climate modes are logged and reported to Home Assistant as OFF. State is not published
- * immediately; updates are sent after confirmation from the pool controller.
+ * Instead we map it to the pool/spa circuit switch. If thermostat settings have changed,
+ * hands them to OpnPool, which merges the changes that arrive within a short window into
+ * one message to the pool controller. Unsupported climate modes are logged and reported
+ * to Home Assistant as OFF. State is not published immediately; updates are sent after
+ * confirmation from the pool controller. In optimistic mode, the requested settings are
+ * published right away instead.
  *
  * @param[in] call The climate call object containing requested changes from Home Assistant.
  */
@@ -189,6 +214,26 @@ OpnPoolClimate::control(const climate::ClimateCall &call)
         return; // bail out (user will have to try again later)
     }
 
+        // start from the changes that are still waiting in the coalescing window, so they
+        // are merged instead of undone
+    heat_setting_t const * const pending_heat_set = parent_->get_pending_heat_set();
+    if (pending_heat_set) {
+        for (auto thermos : {thermos_old, thermos_new}) {
+            thermos[thermo_pool_idx].set_point_in_f.value = pending_heat_set->pool_set_point;
+            thermos[thermo_spa_idx].set_point_in_f.value = pending_heat_set->spa_set_point;
+            thermos[thermo_pool_idx].heat_src.value = pending_heat_set->pool_heat_src;
+            thermos[thermo_spa_idx].heat_src.value = pending_heat_set->spa_heat_src;
+        }
+    }
+
+        // settings to show in optimistic mode, starting from what is shown now
+    settings_t requested = {
+        .target_temp = last_.target_temp,
+        .custom_preset = last_.custom_preset,
+        .mode = last_.mode
+    };
+    bool requested_change = false;
+
         // handle target temperature changes
 
     if (call.get_target_temperature().has_value()) {
@@ -201,6 +246,10 @@ OpnPoolClimate::control(const climate::ClimateCall &call)
             .valid = true,
             .value = static_cast<uint8_t>(target_temp_f)
         };
+
+            // as OpnPool::update_climates() will report it, so it confirms the request
+        requested.target_temp = std::round(fahrenheit_to_celsius(thermos_new[thermo_idx].set_point_in_f.value) * 10.0f) / 10.0f;
+        requested_change = true;
     }
 
         // handle mode changes (OFF, HEAT, AUTO) by turning the POOL or SPA circuit on/off
@@ -217,10 +266,14 @@ OpnPoolClimate::control(const climate::ClimateCall &call)
             case climate::CLIMATE_MODE_OFF:  // mode 0
                 ESP_LOGVV(TAG, "Turning off switch[%u]", circuit_idx);
                 parent_->get_switch(circuit_idx)->write_state(false);
+                requested.mode = requested_mode;
+                requested_change = true;
                 break;                
             case climate::CLIMATE_MODE_HEAT:  // mode 3
                 ESP_LOGVV(TAG, "Turning on switch[%u]", circuit_idx);
                 parent_->get_switch(circuit_idx)->write_state(true);
+                requested.mode = requested_mode;
+                requested_change = true;
                 break;
             default:
                 ESP_LOGW(TAG, "Unsupported requested_mode: %d", static_cast<int>(requested_mode));
@@ -238,16 +291,16 @@ OpnPoolClimate::control(const climate::ClimateCall &call)
 
         ESP_LOGV(TAG, "HA requests %s to %s", enum_str(thermo_typ), preset_str);
 
-        for (auto heat_src : magic_enum::enum_values<network_heat_src_t>()) {
-            if (strcasecmp(preset_str, enum_str(heat_src)) == 0) {
-                thermos_new[thermo_idx].heat_src = {
-                    .valid = true,
-                    .value = heat_src
-                };
-                break;
-            }
+        network_heat_src_t heat_src;
+        if (enum_lookup(std::string_view(preset_str), &heat_src)) {
+            thermos_new[thermo_idx].heat_src = {
+                .valid = true,
+                .value = heat_src
+            };
+            requested.custom_preset = enum_str(heat_src);
+            requested_change = true;
         }
-        
+
     } else if (call.get_preset().has_value()) {
 
         climate::ClimatePreset new_preset = *call.get_preset();
@@ -258,6 +311,8 @@ OpnPoolClimate::control(const climate::ClimateCall &call)
                 .valid = true,
                 .value = network_heat_src_t::NONE
             };
+            requested.custom_preset = enum_str(network_heat_src_t::NONE);
+            requested_change = true;
         }
     }        
 
@@ -267,27 +322,34 @@ OpnPoolClimate::control(const climate::ClimateCall &call)
 
     if (thermos_changed) {
 
-        network_msg_t msg = {};
-        msg.src = datalink_addr_t::remote();
-        msg.dst = controller_addr;
-        msg.typ = network_msg_typ_t::CTRL_HEAT_SET;
-        msg.u.a5.ctrl_heat_set.pool_set_point = thermos_new[thermo_pool_idx].set_point_in_f.value;
-        msg.u.a5.ctrl_heat_set.spa_set_point = thermos_new[thermo_spa_idx].set_point_in_f.value;
-        msg.u.a5.ctrl_heat_set.heat_src.set_pool(thermos_new[thermo_pool_idx].heat_src.value);
-        msg.u.a5.ctrl_heat_set.heat_src.set_spa(thermos_new[thermo_spa_idx].heat_src.value);
-
-        ESP_LOGV(TAG, "Sending HEAT_SET: pool=%u°F, spa=%u°F, heat_src=%u,%u", 
-                  msg.u.a5.ctrl_heat_set.pool_set_point, 
-                  msg.u.a5.ctrl_heat_set.spa_set_point,
-                  (uint8_t)msg.u.a5.ctrl_heat_set.heat_src.get_pool(),
-                  (uint8_t)msg.u.a5.ctrl_heat_set.heat_src.get_spa());
-                  
-        if (ipc_send_network_msg_to_pool_task(&msg, this->parent_->get_ipc()) != ESP_OK) {
-            ESP_LOGW(TAG, "Failed to send HEAT_SET message to pool task");
-        }
+        heat_setting_t const setting = {
+            .pool_set_point = thermos_new[thermo_pool_idx].set_point_in_f.value,
+            .spa_set_point = thermos_new[thermo_spa_idx].set_point_in_f.value,
+            .pool_heat_src = thermos_new[thermo_pool_idx].heat_src.value,
+            .spa_heat_src = thermos_new[thermo_spa_idx].heat_src.value
+        };
+        parent_->queue_heat_set(&setting);  // sent when the coalescing window closes
     }
 
-    // DON'T publish state here - wait for pool controller confirmation
+    if (!optimistic_ || !last_.valid || !requested_change) {
+        return;  // DON'T publish state here - wait for pool controller confirmation
+    }
+
+        // show the requested settings until the controller confirms them or the deadline passes
+    if (!pending_.valid) {
+        pending_.confirmed = {
+            .target_temp = last_.target_temp,
+            .custom_preset = last_.custom_preset,
+            .mode = last_.mode
+        };
+    }
+    pending_.valid = true;
+    pending_.deadline_ms = millis() + OPTIMISTIC_TIMEOUT_MS;
+    pending_.requested = requested;
+
+    settings_t const confirmed = pending_.confirmed;
+    this->publish_value_if_changed(last_.current_temp, confirmed.target_temp, confirmed.mode,
+                                   confirmed.custom_preset, last_.action);
 }
 
 
@@ -301,6 +363,10 @@ OpnPoolClimate::control(const climate::ClimateCall &call)
  * internal state, sets the appropriate preset or custom preset, and publishes the new
  * state to Home Assistant. This avoids redundant updates to Home Assistant.
  *
+ * While optimistic settings are pending, the controller still reports the old settings
+ * for a broadcast or two. Those are remembered for a rollback, but the requested settings
+ * are published instead. The first report that matches confirms them.
+ *
  * @param[in] value_current_temperature  The updated current temperature in Celsius.
  * @param[in] value_target_temperature   The updated target temperature in Celsius.
  * @param[in] value_mode                 The updated climate mode (OFF/HEAT).
@@ -316,26 +382,55 @@ OpnPoolClimate::publish_value_if_changed(
     poolstate_thermo_typ_t const thermo_typ = get_thermo_typ();
     last_t * const last = &last_;
 
+    float target_temperature = value_target_temperature;
+    climate::ClimateMode mode = value_mode;
+    char const * custom_preset = value_custom_preset;
+    climate::ClimateAction action = value_action;
+
+    if (pending_.valid) {
+        settings_t const & requested = pending_.requested;
+
+        if (requested.target_temp == value_target_temperature && requested.mode == value_mode &&
+            strcasecmp(requested.custom_preset, value_custom_preset) == 0) {
+
+            pending_.valid = false;
+            ESP_LOGV(TAG, "Confirmed %s settings", enum_str(thermo_typ));
+
+        } else {
+
+                // not applied yet
+            pending_.confirmed = {
+                .target_temp = value_target_temperature,
+                .custom_preset = value_custom_preset,
+                .mode = value_mode
+            };
+            target_temperature = requested.target_temp;
+            mode = requested.mode;
+            custom_preset = requested.custom_preset;
+            action = _action_for_mode(value_action, requested.mode);
+        }
+    }
+
     if (!last->valid ||
         last->current_temp != value_current_temperature ||
-        last->target_temp != value_target_temperature ||
-        last->mode != value_mode ||
-        strcasecmp(last->custom_preset, value_custom_preset) != 0 ||
-        last->action != value_action) {
+        last->target_temp != target_temperature ||
+        last->mode != mode ||
+        strcasecmp(last->custom_preset, custom_preset) != 0 ||
+        last->action != action) {
         
         this->current_temperature = value_current_temperature;
-        this->target_temperature = value_target_temperature;
-        this->mode = value_mode;
-        this->action = value_action;
+        this->target_temperature = target_temperature;
+        this->mode = mode;
+        this->action = action;
 
             // NONE is handled by the regular preset, not a custom preset
-        if (strcasecmp(value_custom_preset, enum_str(network_heat_src_t::NONE)) == 0) {
+        if (strcasecmp(custom_preset, enum_str(network_heat_src_t::NONE)) == 0) {
             ESP_LOGVV(TAG, "Setting thermostat[%s] preset to NONE", enum_str(thermo_typ));
             set_preset_(climate::CLIMATE_PRESET_NONE);
             clear_custom_preset_();
         } else {
-            ESP_LOGVV(TAG, "Setting thermostat[%s] custom_preset to %s", enum_str(thermo_typ), value_custom_preset);
-            this->set_custom_preset_(value_custom_preset);
+            ESP_LOGVV(TAG, "Setting thermostat[%s] custom_preset to %s", enum_str(thermo_typ), custom_preset);
+            this->set_custom_preset_(custom_preset);
         }
 
         this->publish_state();
@@ -343,17 +438,104 @@ OpnPoolClimate::publish_value_if_changed(
         *last = {
             .valid = true,
             .current_temp = value_current_temperature,
-            .target_temp = value_target_temperature,
-            .custom_preset = value_custom_preset,
-            .mode = value_mode,
-            .action = value_action,
+            .target_temp = target_temperature,
+            .custom_preset = custom_preset,
+            .mode = mode,
+            .action = action,
         };
-        ESP_LOGVV(TAG, "Published %s: %.0f > %.0f, mode=%s, preset=%s, action=%s", 
+        ESP_LOGVV(TAG, "Published %s: %.0f > %.0f, mode=%s, preset=%s, action=%s%s", 
             enum_str(thermo_typ),
-            value_current_temperature, value_target_temperature,
-            enum_str(value_mode), value_custom_preset, enum_str(value_action));
+            value_current_temperature, target_temperature,
+            enum_str(mode), custom_preset, enum_str(action), pending_.valid ? " (pending)" : "");
     }
 }
 
+
+/**
+ * @brief
+ * Publishes unknown temperatures because the thermostat data went stale.
+ *
+ * @details
+ * ESPHome climates have no unavailable state, so set the current and target temperature
+ * to NaN (shown as unknown by Home Assistant) and the action to OFF. Clears the last
+ * published state, so the next valid update is published even if it is unchanged.
+ */
+void
+OpnPoolClimate::publish_unavailable()
+{
+    if (!last_.valid) {
+        return;
+    }
+    this->current_temperature = NAN;
+    this->target_temperature = NAN;
+    this->action = climate::CLIMATE_ACTION_OFF;
+    this->publish_state();
+
+    last_.valid = false;
+    pending_.valid = false;
+    ESP_LOGV(TAG, "Published %s unavailable", enum_str(get_thermo_typ()));
+}
+
+/**
+ * @brief Reverts to the last confirmed state because a command was lost.
+ *
+ * @details
+ * Called when the controller didn't acknowledge a HEAT_SET after all attempts. Reverts
+ * Home Assistant to the last confirmed set point and heat source, and flags a warning on
+ * the entity for a while.
+ */
+void
+OpnPoolClimate::command_failed()
+{
+    this->rollback_("didn't acknowledge");
+}
+
+/**
+ * @brief Rolls back optimistic settings that the controller didn't confirm in time.
+ *
+ * @details
+ * Called from the main loop. The controller acknowledged the command, or is still
+ * retrying it, but its reports never showed the requested settings before the deadline.
+ *
+ * @param[in] now_ms Current time in milliseconds.
+ */
+void
+OpnPoolClimate::expire_pending(uint32_t const now_ms)
+{
+    if (pending_.valid && static_cast<int32_t>(now_ms - pending_.deadline_ms) >= 0) {
+        this->rollback_("didn't confirm");
+    }
+}
+
+/**
+ * @brief Republishes the last confirmed settings and flags a warning on the entity.
+ *
+ * @details
+ * Without pending settings, control() didn't change the published state, so publishing
+ * it again is enough to revert Home Assistant.
+ *
+ * @param[in] reason Why the requested settings didn't take effect, for the log.
+ */
+void
+OpnPoolClimate::rollback_(char const * const reason)
+{
+    ESP_LOGW(TAG, "Controller %s %s command", reason, enum_str(get_thermo_typ()));
+
+    this->status_momentary_warning("command_failed", COMMAND_FAILED_WARNING_MS);
+    if (!last_.valid) {
+        pending_.valid = false;
+        return;
+    }
+    if (!pending_.valid) {
+        this->publish_state();
+        return;
+    }
+    pending_.valid = false;
+
+    settings_t const confirmed = pending_.confirmed;
+    this->publish_value_if_changed(last_.current_temp, confirmed.target_temp, confirmed.mode,
+                                   confirmed.custom_preset, _action_for_mode(last_.action, confirmed.mode));
+}
+
 }  // namespace opnpool
 }  // namespace esphome
\ No newline at end of file
@@ -34,7 +34,9 @@ class OpnPool;
  * @details
  * Extends ESPHome's Climate and Component classes to provide pool/spa thermostat
  * control. Maps climate modes to pool circuit switches and custom presets to heat
- * sources. Only publishes state updates when values change.
+ * sources. Only publishes state updates when values change. In optimistic mode, the
+ * requested set point, heat source and mode are published right away and rolled back
+ * if the controller doesn't confirm them in time.
  */
 class OpnPoolClimate : public climate::Climate, public Component {
 
@@ -55,6 +57,13 @@ class OpnPoolClimate : public climate::Climate, public Component {
      */
     void dump_config();
 
+    /**
+     * @brief Publishes requested settings right away, instead of waiting for the controller.
+     *
+     * @param[in] optimistic True to enable optimistic mode.
+     */
+    void set_optimistic(bool const optimistic) { this->optimistic_ = optimistic; }
+
     /**
      * @brief Gets the climate traits for this entity.
      *
@@ -91,7 +100,31 @@ class OpnPoolClimate : public climate::Climate, public Component {
         char const * value_custom_preset, climate::ClimateAction const value_action
     );
 
+    /**
+     * @brief Publishes unknown temperatures because the thermostat data went stale.
+     */
+    void publish_unavailable();
+
+    /**
+     * @brief Reverts to the last confirmed state because a command was lost.
+     */
+    void command_failed();
+
+    /**
+     * @brief Rolls back optimistic settings that the controller didn't confirm in time.
+     *
+     * @param[in] now_ms Current time in milliseconds (e.g. millis()).
+     */
+    void expire_pending(uint32_t const now_ms);
+
   protected:
+    /**
+     * @brief Republishes the last confirmed settings and flags a warning on the entity.
+     *
+     * @param[in] reason Why the requested settings didn't take effect.
+     */
+    void rollback_(char const * const reason);
+
     OpnPool * const              parent_;      ///< Parent OpnPool component.
     climate_id_t const           id_;          ///< Climate entity ID.
     poolstate_thermo_typ_t const thermo_typ_ = climate_id_to_poolstate_thermo(id_);  ///< Thermostat type (POOL/SPA).
@@ -112,6 +145,28 @@ class OpnPoolClimate : public climate::Climate, public Component {
         .mode = climate::CLIMATE_MODE_OFF,
         .action = climate::CLIMATE_ACTION_OFF
     };
+
+    bool optimistic_{false};  ///< Publish requested settings before the controller confirms them.
+
+    /// @brief Settings that the controller controls, as requested or as reported.
+    struct settings_t {
+        float                target_temp;    ///< Target temperature in Celsius.
+        char const *         custom_preset;  ///< Custom preset string (heat source).
+        climate::ClimateMode mode;           ///< Climate mode (OFF/HEAT).
+    };
+
+    /// @brief Optimistically published settings, waiting for the controller to confirm them.
+    struct pending_t {
+        bool       valid;        ///< True while requested settings await confirmation.
+        uint32_t   deadline_ms;  ///< Time at which they are rolled back if still unconfirmed.
+        settings_t requested;    ///< Settings published to Home Assistant.
+        settings_t confirmed;    ///< Settings last reported by the controller, to roll back to.
+    } pending_ = {
+        .valid = false,
+        .deadline_ms = 0,
+        .requested = {},
+        .confirmed = {}
+    };
 };
 
 }  // namespace opnpool
@@ -19,6 +19,9 @@
 #include <esp_system.h>
 #include <esp_types.h>
 #include <esphome/core/log.h>
+#include <esphome/core/hal.h>
+#include <algorithm>
+#include <cmath>
 
 #include "opnpool_sensor.h"
 #pragma GCC diagnostic error "-Wall"
@@ -30,29 +33,45 @@ namespace opnpool {
 
 constexpr char TAG[] = "opnpool_sensor";
 
+    // wrap-safe "a is at or after b" for millis() timestamps
+static inline bool
+_reached(uint32_t const a, uint32_t const b)
+{
+    return static_cast<int32_t>(a - b) >= 0;
+}
+
 /**
  * @brief Dump the configuration and last known state of the sensor entity.
  *
  * @details
- * Logs the configuration details for this analog sensor, including its ID and last
- * known value (if valid). This information is useful for diagnostics and debugging,
- * providing visibility into the entity's state and configuration at runtime.
+ * Logs the configuration details for this analog sensor, including its ID, publish
+ * policy, publish counters and last known value (if valid). This information is useful
+ * for diagnostics and debugging, providing visibility into the entity's state and
+ * configuration at runtime.
  */
 void
 OpnPoolSensor::dump_config()
 {
     LOG_SENSOR("  ", "Sensor", this);
     ESP_LOGCONFIG(TAG, "    Last value: %s", last_.valid ? std::to_string(last_.value).c_str() : "<unknown>");
+    ESP_LOGCONFIG(TAG, "    Deadband: %g, %g%%", policy_.deadband, policy_.deadband_relative * 100.0f);
+    ESP_LOGCONFIG(TAG, "    Min interval: %lu ms, heartbeat: %lu ms, smoothing: %g",
+                  static_cast<unsigned long>(policy_.min_interval_ms),
+                  static_cast<unsigned long>(policy_.heartbeat_ms), policy_.smoothing);
+    ESP_LOGCONFIG(TAG, "    Updates: %lu published, %lu suppressed",
+                  static_cast<unsigned long>(stats_.published), static_cast<unsigned long>(stats_.suppressed));
 }
 
 /**
  * @brief Publishes the sensor state to Home Assistant if it has changed.
  *
  * @details
- * Compares the new sensor value with the last published value. If the state is not yet
- * valid, or if the absolute difference between the new value and the last value exceeds
- * the given tolerance, updates the internal state and publishes the new value to Home
- * Assistant. This avoids redundant updates to Home Assistant.
+ * Folds the value into the moving average. The average is published when the state is
+ * not yet valid, or when it moved beyond the deadband of the last published value. The
+ * deadband is the largest of the tolerance, the absolute deadband and the relative
+ * deadband. A change that comes sooner than the minimum interval after the last
+ * publish is held back; publish_due() publishes it when the interval ends, unless the
+ * value returned within the deadband by then.
  *
  * @param[in] value     The new sensor value to be published.
  * @param[in] tolerance The minimum change required to trigger a new state publication.
@@ -60,16 +79,102 @@ OpnPoolSensor::dump_config()
 void
 OpnPoolSensor::publish_value_if_changed(float value, float tolerance)
 {
-    if (!last_.valid || fabs(last_.value - value) > tolerance) {
-
-        this->publish_state(value);
-        
-        last_ = {
-            .valid = true,
-            .value = value
-        };
-        ESP_LOGV(TAG, "Published %.1f", value);        
+    uint32_t const now = millis();
+
+    if (filtered_.valid) {
+        filtered_.value += policy_.smoothing * (value - filtered_.value);
+    } else {
+        filtered_.value = value;
+        filtered_.valid = true;
+    }
+
+    if (!last_.valid) {
+        this->publish_(filtered_.value, now);
+        return;
+    }
+
+    float const deadband = std::max({tolerance, policy_.deadband, policy_.deadband_relative * fabsf(last_.value)});
+
+    if (fabsf(filtered_.value - last_.value) <= deadband) {
+        filtered_.held = false;
+        stats_.suppressed++;
+        return;
+    }
+    if (policy_.min_interval_ms && !_reached(now, last_ms_ + policy_.min_interval_ms)) {
+        filtered_.held = true;
+        stats_.suppressed++;
+        return;
+    }
+    this->publish_(filtered_.value, now);
+}
+
+/**
+ * @brief Publishes a change held back by the minimum interval, or a heartbeat.
+ *
+ * @details
+ * Called from the main loop, because no new value may come in after a held back change
+ * or for as long as the value is steady. The heartbeat republishes the current value,
+ * so Home Assistant can tell a steady value from a lost connection.
+ *
+ * @param[in] now_ms Current time in milliseconds.
+ */
+void
+OpnPoolSensor::publish_due(uint32_t const now_ms)
+{
+    if (!last_.valid) {
+        return;
+    }
+    if (filtered_.held && _reached(now_ms, last_ms_ + policy_.min_interval_ms)) {
+        this->publish_(filtered_.value, now_ms);
+    } else if (policy_.heartbeat_ms && _reached(now_ms, last_ms_ + policy_.heartbeat_ms)) {
+        ESP_LOGV(TAG, "Heartbeat");
+        this->publish_(filtered_.value, now_ms);
+    }
+}
+
+/**
+ * @brief Publishes a value and notes when it was published.
+ *
+ * @param[in] value  The value to publish.
+ * @param[in] now_ms Current time in milliseconds.
+ */
+void
+OpnPoolSensor::publish_(float const value, uint32_t const now_ms)
+{
+    this->publish_state(value);
+
+    last_ = {
+        .valid = true,
+        .value = value
+    };
+    last_ms_ = now_ms;
+    filtered_.held = false;
+    stats_.published++;
+    ESP_LOGV(TAG, "Published %.1f", value);
+}
+
+/**
+ * @brief Publishes the sensor as unavailable because its source went stale.
+ *
+ * @details
+ * Publishes NaN, which Home Assistant shows as unknown. Clears the last published value
+ * and the moving average, so the next valid value is published even if it equals the
+ * one before it went stale.
+ */
+void
+OpnPoolSensor::publish_unavailable()
+{
+    filtered_ = {
+        .valid = false,
+        .value = 0.0f,
+        .held = false
+    };
+    if (!last_.valid) {
+        return;
     }
+    this->publish_state(NAN);
+    last_.valid = false;
+    ESP_LOGV(TAG, "Published unavailable");
 }
 
 }  // namespace opnpool
@@ -7,6 +7,11 @@
  * for monitoring analog pool sensor values (such as temperatures, pump metrics,
  * chlorinator levels, etc.) and publishing them to Home Assistant.
  *
+ * Pump power and speed jitter by a few units on every status response. Each sensor
+ * has a publish policy that keeps that noise away from Home Assistant: an optional
+ * moving average, a deadband, a minimum interval between publishes, and a heartbeat
+ * that republishes a value that didn't change for a long time.
+ *
  * @author Coert Vonk (@cvonk on GitHub)
  * @copyright Copyright (c) 2026 Coert Vonk
  * @license SPDX-License-Identifier: GPL-3.0-or-later
@@ -30,7 +35,8 @@ namespace opnpool {
  * @details
  * Extends ESPHome's Sensor and Component classes to provide an analog sensor
  * that tracks numeric values and only publishes updates when the value changes
- * beyond a configurable tolerance threshold.
+ * beyond its deadband. The policy is applied before publish_state(), so suppressed
+ * updates cost no ESPHome filter, API or recorder work.
  */
 class OpnPoolSensor : public sensor::Sensor, public Component {
 
@@ -45,15 +51,82 @@ class OpnPoolSensor : public sensor::Sensor, public Component {
      */
     void dump_config();
 
+    /// @name Publish policy, set from the YAML configuration
+    /// @{
+    void set_deadband(float const deadband) { this->policy_.deadband = deadband; }
+    void set_deadband_relative(float const relative) { this->policy_.deadband_relative = relative; }
+    void set_min_interval(uint32_t const ms) { this->policy_.min_interval_ms = ms; }
+    void set_heartbeat(uint32_t const ms) { this->policy_.heartbeat_ms = ms; }
+    void set_smoothing(float const alpha) { this->policy_.smoothing = alpha; }
+    /// @}
+
     /**
      * @brief Publishes the sensor state to Home Assistant if it has changed.
      *
      * @param[in] value     The new sensor value to be published.
-     * @param[in] tolerance The minimum change required to trigger publication.
+     * @param[in] tolerance The minimum change required to trigger publication. The
+     *                      configured deadband applies when it is larger.
      */
     void publish_value_if_changed(float value, float tolerance = 0.01f);
 
+    /**
+     * @brief Publishes the sensor as unavailable (NaN) because its source went stale.
+     */
+    void publish_unavailable();
+
+    /**
+     * @brief Publishes a change held back by the minimum interval, or a heartbeat.
+     *
+     * @param[in] now_ms Current time in milliseconds (e.g. millis()).
+     */
+    void publish_due(uint32_t const now_ms);
+
   protected:
+    /**
+     * @brief Publishes a value and notes when it was published.
+     *
+     * @param[in] value  The value to publish.
+     * @param[in] now_ms Current time in milliseconds.
+     */
+    void publish_(float const value, uint32_t const now_ms);
+
+    /// @brief When a new value is published.
+    struct policy_t {
+        float    deadband;           ///< Minimum absolute change to publish.
+        float    deadband_relative;  ///< Minimum change relative to the last published value (0.05 is 5%).
+        uint32_t min_interval_ms;    ///< Minimum time between two publishes, 0 for none.
+        uint32_t heartbeat_ms;       ///< Republish a value that is this old, 0 for never.
+        float    smoothing;          ///< Weight of a new sample in the moving average, 1 for none.
+    } policy_ = {
+        .deadband = 0.0f,
+        .deadband_relative = 0.0f,
+        .min_interval_ms = 0,
+        .heartbeat_ms = 0,
+        .smoothing = 1.0f
+    };
+
+    /// @brief Moving average of the samples, the value that the policy publishes.
+    struct filtered_t {
+        bool  valid;  ///< True once a sample came in.
+        float value;  ///< The smoothed value.
+        bool  held;   ///< True if it changed beyond the deadband, but the minimum interval held it back.
+    } filtered_ = {
+        .valid = false,
+        .value = 0.0f,
+        .held = false
+    };
+
+    /// @brief Publish counters, for dump_config().
+    struct stats_t {
+        uint32_t published;   ///< Values handed to publish_state(), heartbeats included.
+        uint32_t suppressed;  ///< Values dropped by the deadband or the minimum interval.
+    } stats_ = {
+        .published = 0,
+        .suppressed = 0
+    };
+
+    uint32_t last_ms_{0};  ///< Time of the last publish.
+
     /// @brief Tracks the last published state to avoid redundant updates.
     struct last_t {
         bool  valid;  ///< True if a value has been published at least once.
@@ -16,7 +16,8 @@
  *
  * restore_mode is ignored because state is always synchronized from the pool controller.
  * The component will always reflect the actual state of the pool circuits as reported by
- * the controller.
+ * the controller. In optimistic mode, a requested state is shown until the controller
+ * reports it, or until OPTIMISTIC_TIMEOUT_MS passes and it is rolled back.
  * 
  * @author Coert Vonk (@cvonk on GitHub)
  * @copyright Copyright (c) 2026 Coert Vonk
@@ -25,6 +26,7 @@
 
 #include <esp_system.h>
 #include <esphome/core/log.h>
+#include <esphome/core/hal.h>
 
 #include "opnpool_switch.h"   // no other #includes that could make a circular dependency
 #include "core/opnpool.h"      // no other #includes that could make a circular dependency
@@ -33,6 +35,7 @@
 #include "core/opnpool_ids.h"      // conversion helper
 #include "utils/enum_helpers.h"
 #include "core/poolstate.h"
+#include "core/poolstate_events.h"
 #pragma GCC diagnostic error "-Wall"
 #pragma GCC diagnostic error "-Wextra"
 #pragma GCC diagnostic error "-Wunused-parameter"
@@ -42,6 +45,9 @@ namespace opnpool {
 
 constexpr char TAG[] = "opnpool_switch";
 
+constexpr uint32_t COMMAND_FAILED_WARNING_MS = 10 * 1000;  ///< How long a lost command is flagged [ms]
+constexpr uint32_t OPTIMISTIC_TIMEOUT_MS     = 15 * 1000;  ///< Time for the controller to confirm an optimistic state [ms]
+
 /**
  * @brief Dump the configuration and last known state of the switch entity.
  *
@@ -59,6 +65,7 @@ OpnPoolSwitch::dump_config()
     LOG_SWITCH("  ", "Switch", this);
     ESP_LOGCONFIG(TAG, "    Circuit: %s", enum_str(circuit));
     ESP_LOGCONFIG(TAG, "    Last state: %s", last_.valid ? (last_.value ? "ON" : "OFF") : "Unknown");
+    ESP_LOGCONFIG(TAG, "    Optimistic: %s", optimistic_ ? "ON" : "OFF");
 }
 
 /**
@@ -69,7 +76,7 @@ OpnPoolSwitch::dump_config()
  * specified circuit. The circuit index is mapped to the pool controller's circuit
  * numbering. The message is sent via IPC to the pool_task for RS-485 transmission. This
  * method is called automatically when the switch entity is toggled in Home Assistant or
- * ESPHome.
+ * ESPHome. In optimistic mode, the requested state is published right away.
  *
  * @param[in] state The desired state of the switch (true for ON, false for OFF).
  */
@@ -93,7 +100,7 @@ OpnPoolSwitch::write_state(bool value)
     network_pool_circuit_t const circuit = circuit_;
     uint8_t const circuit_idx = enum_index(circuit);
 
-    network_msg_t msg;
+    network_msg_t msg = {};
     msg.src = datalink_addr_t::remote();
     msg.dst = controller_addr;
     msg.typ = network_msg_typ_t::CTRL_CIRCUIT_SET;
@@ -107,9 +114,37 @@ OpnPoolSwitch::write_state(bool value)
     ESP_LOGVV(TAG, "Sending CIRCUIT_SET command: circuit+1=%u to %u", msg.u.a5.ctrl_circuit_set.circuit_plus_1, msg.u.ctrl_circuit_set.value);
     if (ipc_send_network_msg_to_pool_task(&msg, this->parent_->get_ipc()) != ESP_OK) {
         ESP_LOGW(TAG, "Failed to send CIRCUIT_SET message to pool task");
+        return;
     }
+    this->parent_->note_command(&msg, poolstate_event_src_t::HA);
+    this->show_requested(value);
+}
 
-    // DON'T publish state here - wait for pool controller confirmation
+/**
+ * @brief Shows a requested state right away, when in optimistic mode.
+ *
+ * @details
+ * Called after the CIRCUIT_SET for this circuit was handed to the pool_task, either by
+ * write_state() or as part of a scene. Without optimistic mode, or before the controller
+ * reported a state, nothing is published until the controller confirms the change.
+ *
+ * @param[in] value The requested state of the switch (true for ON, false for OFF).
+ */
+void
+OpnPoolSwitch::show_requested(bool const value)
+{
+    if (!optimistic_ || !last_.valid) {
+        return;  // DON'T publish state here - wait for pool controller confirmation
+    }
+
+        // show the requested state until the controller confirms it or the deadline passes
+    pending_ = {
+        .valid = true,
+        .value = value,
+        .deadline_ms = millis() + OPTIMISTIC_TIMEOUT_MS
+    };
+    this->publish_state(value);
+    ESP_LOGV(TAG, "Published %s: %s (pending)", enum_str(circuit_), value ? "ON" : "OFF");
 }
 
 /**
@@ -120,11 +155,28 @@ OpnPoolSwitch::write_state(bool value)
  * or is not yet valid, updates the internal state and publishes the new value to Home
  * Assistant. This avoids redundant updates to Home Assistant.
  *
+ * While an optimistic state is pending, the controller still reports the old state for a
+ * broadcast or two. Those reports are not published; the first matching one confirms the
+ * pending state, which Home Assistant already shows.
+ *
  * @param[in] value The new state of the switch (true for ON, false for OFF).
  */
 void
 OpnPoolSwitch::publish_value_if_changed(bool value)
 {
+    if (pending_.valid) {
+        if (value != pending_.value) {
+            return;  // not applied yet
+        }
+        pending_.valid = false;
+        last_ = {
+            .valid = true,
+            .value = value
+        };
+        ESP_LOGV(TAG, "Confirmed %s: %s", enum_str(circuit_), value ? "ON" : "OFF");
+        return;
+    }
+
     if (!last_.valid || last_.value != value) {
 
         this->publish_state(value);
@@ -139,5 +191,54 @@ OpnPoolSwitch::publish_value_if_changed(bool value)
     }
 }
 
+/**
+ * @brief Reverts to the last confirmed state because a command was lost.
+ *
+ * @details
+ * Called when the controller didn't acknowledge a CIRCUIT_SET for this circuit after all
+ * attempts. Republishes the last confirmed state, so the toggle in Home Assistant flips
+ * back, and flags a warning on the entity for a while.
+ */
+void
+OpnPoolSwitch::command_failed()
+{
+    this->rollback_("didn't acknowledge");
+}
+
+/**
+ * @brief Rolls back an optimistic state that the controller didn't confirm in time.
+ *
+ * @details
+ * Called from the main loop. The controller acknowledged the command, or is still
+ * retrying it, but its broadcasts never showed the requested state before the deadline.
+ *
+ * @param[in] now_ms Current time in milliseconds.
+ */
+void
+OpnPoolSwitch::expire_pending(uint32_t const now_ms)
+{
+    if (pending_.valid && static_cast<int32_t>(now_ms - pending_.deadline_ms) >= 0) {
+        this->rollback_("didn't confirm");
+    }
+}
+
+/**
+ * @brief Republishes the last confirmed state and flags a warning on the entity.
+ *
+ * @param[in] reason Why the requested state didn't take effect, for the log.
+ */
+void
+OpnPoolSwitch::rollback_(char const * const reason)
+{
+    network_pool_circuit_t const circuit = circuit_;
+    ESP_LOGW(TAG, "Controller %s %s command", reason, enum_str(circuit));
+
+    pending_.valid = false;
+    this->status_momentary_warning("command_failed", COMMAND_FAILED_WARNING_MS);
+    if (last_.valid) {
+        this->publish_state(last_.value);
+    }
+}
+
 }  // namespace opnpool
 }  // namespace esphome
\ No newline at end of file
@@ -34,7 +34,9 @@ class OpnPool;
  * @details
  * Extends ESPHome's Switch and Component classes to provide control over pool
  * circuits. Sends commands to the pool controller via RS-485 and publishes
- * state updates only when the controller confirms the change.
+ * state updates only when the controller confirms the change. In optimistic mode,
+ * the requested state is published right away and rolled back if the controller
+ * doesn't confirm it in time.
  */
 class OpnPoolSwitch : public switch_::Switch, public Component {
   public:
@@ -54,6 +56,13 @@ class OpnPoolSwitch : public switch_::Switch, public Component {
      */
     void dump_config();
 
+    /**
+     * @brief Publishes requested states right away, instead of waiting for the controller.
+     *
+     * @param[in] optimistic True to enable optimistic mode.
+     */
+    void set_optimistic(bool const optimistic) { this->optimistic_ = optimistic; }
+
     /**
      * @brief Handles switch state changes triggered by Home Assistant.
      *
@@ -61,6 +70,13 @@ class OpnPoolSwitch : public switch_::Switch, public Component {
      */
     void write_state(bool state) override;
 
+    /**
+     * @brief Shows a requested state right away, when in optimistic mode.
+     *
+     * @param[in] value The requested state (true for ON, false for OFF).
+     */
+    void show_requested(bool const value);
+
     /**
      * @brief Publishes the switch state to Home Assistant if it has changed.
      *
@@ -68,7 +84,26 @@ class OpnPoolSwitch : public switch_::Switch, public Component {
      */
     void publish_value_if_changed(bool const new_value);
 
+    /**
+     * @brief Reverts to the last confirmed state because a command was lost.
+     */
+    void command_failed();
+
+    /**
+     * @brief Rolls back an optimistic state that the controller didn't confirm in time.
+     *
+     * @param[in] now_ms Current time in milliseconds (e.g. millis()).
+     */
+    void expire_pending(uint32_t const now_ms);
+
   protected:
+    /**
+     * @brief Republishes the last confirmed state and flags a warning on the entity.
+     *
+     * @param[in] reason Why the requested state didn't take effect.
+     */
+    void rollback_(char const * const reason);
+
     OpnPool * const              parent_;   ///< Parent OpnPool component.
     switch_id_t const            id_;       ///< Switch entity ID.
     network_pool_circuit_t const circuit_ = switch_id_to_network_circuit(id_);  ///< Mapped circuit type.
@@ -81,6 +116,19 @@ class OpnPoolSwitch : public switch_::Switch, public Component {
         .valid = false,
         .value = false
     };
+
+    bool optimistic_{false};  ///< Publish requested states before the controller confirms them.
+
+    /// @brief Optimistically published state, waiting for the controller to confirm it.
+    struct pending_t {
+        bool     valid;        ///< True while a requested state awaits confirmation.
+        bool     value;        ///< The requested switch state.
+        uint32_t deadline_ms;  ///< Time at which it is rolled back if still unconfirmed.
+    } pending_ = {
+        .valid = false,
+        .value = false,
+        .deadline_ms = 0
+    };
 };
 
 }  // namespace opnpool
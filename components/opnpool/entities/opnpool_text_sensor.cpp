@@ -70,5 +70,23 @@ OpnPoolTextSensor::publish_value_if_changed(const std::string & value)
     }
 }
 
+/**
+ * @brief Publishes "unavailable" because the source of the text went stale.
+ *
+ * @details
+ * Text sensors have no unknown state, so publish a placeholder instead. Clears the last
+ * published value, so the next valid value is published even if it is unchanged.
+ */
+void
+OpnPoolTextSensor::publish_unavailable()
+{
+    if (!last_.valid) {
+        return;
+    }
+    this->publish_state("unavailable");
+    last_.valid = false;
+    ESP_LOGV(TAG, "Published unavailable");
+}
+
 }  // namespace opnpool
 }  // namespace esphome
\ No newline at end of file
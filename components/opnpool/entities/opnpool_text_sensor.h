@@ -53,6 +53,11 @@ class OpnPoolTextSensor : public text_sensor::TextSensor, public Component {
      */
     void publish_value_if_changed(const std::string &value);
 
+    /**
+     * @brief Publishes "unavailable" because the source of the text went stale.
+     */
+    void publish_unavailable();
+
   protected:
     /// @brief Tracks the last published state to avoid redundant updates.
     struct last_t {
@@ -23,6 +23,7 @@
 #include <freertos/queue.h>
 
 #include "core/opnpool.h" // for rs485_pins_t
+#include "pool_task/poll_sched.h"
 
 namespace esphome {
 namespace opnpool {
@@ -33,7 +34,8 @@ struct network_msg_t;
 
 /// @brief Configuration for the pool task.
 struct config_t {
-    rs485_pins_t rs485_pins;  ///< RS-485 pin assignments.
+    rs485_pins_t  rs485_pins;  ///< RS-485 pin assignments.
+    poll_config_t poll;        ///< Poll scheduler configuration.
 };
 
 /// @brief IPC context holding FreeRTOS queues and configuration.
@@ -16,6 +16,7 @@
 
 #include "matter_bridge.h"
 
+#include <cmath>
 #include <esp_log.h>
 #include <esp_matter.h>
 #include <esp_matter_attribute_utils.h>
@@ -42,6 +43,16 @@ constexpr char TAG[] = "matter_bridge";
 
 constexpr size_t PENDING_CMD_QUEUE_LEN = 10;
 
+constexpr float GPM_TO_DECI_M3_PER_H = 2.2712470f;  // 1 GPM = 0.2271247 m³/h, Matter flow is in 0.1 m³/h
+
+// Reporting of the noisy pump values, so they can't saturate the Thread network
+constexpr matter_report_policy_t report_policies[MATTER_NUM_REPORTS] = {
+    {10, 10 * 1000},  // MATTER_REPORT_PUMP_POWER [W]
+    {10, 10 * 1000},  // MATTER_REPORT_PUMP_SPEED [RPM]
+    { 2, 10 * 1000},  // MATTER_REPORT_PUMP_CAPACITY [0.1 m³/h], about 1 GPM
+    { 2, 10 * 1000},  // MATTER_REPORT_FLOW_SENSOR [0.1 m³/h]
+};
+
 /// @name Matter Bridge Implementation
 /// @{
 
@@ -111,6 +122,18 @@ MatterBridge::init(matter_config_t const * config)
         return err;
     }
 
+    err = create_pump_endpoints();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create pump endpoints: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = create_chlorinator_endpoint();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create chlorinator endpoint: %s", esp_err_to_name(err));
+        return err;
+    }
+
     // Start Matter
     err = esp_matter::start(attribute_update_callback);
     if (err != ESP_OK) {
@@ -260,118 +283,330 @@ MatterBridge::create_temperature_sensor_endpoints()
     return ESP_OK;
 }
 
-void
-MatterBridge::update_from_poolstate(poolstate_t const * state)
+esp_err_t
+MatterBridge::create_pump_endpoints()
 {
-    if (state == nullptr || node_ == nullptr) {
-        return;
+    // Pump, with its running state, speed, power and capacity (flow)
+    {
+        endpoint::pump::config_t pump_config;
+        pump_config.on_off.on_off = false;
+
+        endpoint_t * ep = endpoint::pump::create(node_, &pump_config, ENDPOINT_FLAG_NONE, this);
+        if (ep == nullptr) {
+            ESP_LOGE(TAG, "Failed to create pump endpoint");
+            return ESP_FAIL;
+        }
+
+        pump_endpoint_ = endpoint::get_id(ep);
+        ESP_LOGI(TAG, "Created pump endpoint: %u", pump_endpoint_);
+
+        // Speed and power are optional attributes
+        cluster_t * pump_cluster = cluster::get(ep, PumpConfigurationAndControl::Id);
+        if (pump_cluster) {
+            cluster::pump_configuration_and_control::attribute::create_speed(pump_cluster, nullable<uint16_t>());
+            cluster::pump_configuration_and_control::attribute::create_power(pump_cluster, nullable<uint32_t>());
+        }
+
+        cluster_t * basic_cluster = cluster::get(ep, BasicInformation::Id);
+        if (basic_cluster) {
+            char node_label[] = "Pump";
+            attribute::set_val(
+                attribute::get(basic_cluster, BasicInformation::Attributes::NodeLabel::Id),
+                esp_matter_char_str(node_label, sizeof(node_label) - 1)
+            );
+        }
     }
 
-    // Update thermostat local temperatures from water temperature
-    if (state->temps[enum_index(poolstate_temp_typ_t::WATER)].valid) {
-        int16_t temp_centi_c = static_cast<int16_t>(
-            matter_fahrenheit_to_celsius(
-                static_cast<float>(state->temps[enum_index(poolstate_temp_typ_t::WATER)].value)
-            ) * 100.0f
-        );
+    // Flow sensor, for controllers that don't show the pump capacity
+    {
+        endpoint::flow_sensor::config_t flow_config;
+        flow_config.flow_measurement.measured_value = nullable<uint16_t>();
+        flow_config.flow_measurement.min_measured_value = nullable<uint16_t>(0);
+        flow_config.flow_measurement.max_measured_value = nullable<uint16_t>(300);  // 30.0 m³/h, about 130 GPM
+
+        endpoint_t * ep = endpoint::flow_sensor::create(node_, &flow_config, ENDPOINT_FLAG_NONE, this);
+        if (ep == nullptr) {
+            ESP_LOGE(TAG, "Failed to create flow sensor endpoint");
+            return ESP_FAIL;
+        }
 
-        esp_matter_attr_val_t val = esp_matter_nullable_int16(temp_centi_c);
+        flow_sensor_endpoint_ = endpoint::get_id(ep);
+        ESP_LOGI(TAG, "Created flow sensor endpoint: %u", flow_sensor_endpoint_);
 
-        // Update both thermostat endpoints
-        for (size_t i = 0; i < MATTER_NUM_THERMOSTATS; i++) {
-            attribute::update(
-                thermostat_endpoints_[i],
-                Thermostat::Id,
-                Thermostat::Attributes::LocalTemperature::Id,
-                &val
+        cluster_t * basic_cluster = cluster::get(ep, BasicInformation::Id);
+        if (basic_cluster) {
+            char node_label[] = "Pump Flow";
+            attribute::set_val(
+                attribute::get(basic_cluster, BasicInformation::Attributes::NodeLabel::Id),
+                esp_matter_char_str(node_label, sizeof(node_label) - 1)
             );
         }
+    }
 
-        // Update water temperature sensor
-        attribute::update(
-            temp_sensor_endpoints_[0],  // Water temp sensor
-            TemperatureMeasurement::Id,
-            TemperatureMeasurement::Attributes::MeasuredValue::Id,
-            &val
-        );
+    return ESP_OK;
+}
+
+esp_err_t
+MatterBridge::create_chlorinator_endpoint()
+{
+    // Matter has no cluster for the salt level or chlorine output, so the chlorinator
+    // shows as a contact sensor that is closed while it reports OK
+    endpoint::contact_sensor::config_t chlor_config;
+    chlor_config.boolean_state.state_value = false;
+
+    endpoint_t * ep = endpoint::contact_sensor::create(node_, &chlor_config, ENDPOINT_FLAG_NONE, this);
+    if (ep == nullptr) {
+        ESP_LOGE(TAG, "Failed to create chlorinator endpoint");
+        return ESP_FAIL;
     }
 
-    // Update air temperature sensor
-    if (state->temps[enum_index(poolstate_temp_typ_t::AIR)].valid) {
-        int16_t temp_centi_c = static_cast<int16_t>(
-            matter_fahrenheit_to_celsius(
-                static_cast<float>(state->temps[enum_index(poolstate_temp_typ_t::AIR)].value)
-            ) * 100.0f
-        );
+    chlor_endpoint_ = endpoint::get_id(ep);
+    ESP_LOGI(TAG, "Created chlorinator endpoint: %u", chlor_endpoint_);
 
-        esp_matter_attr_val_t val = esp_matter_nullable_int16(temp_centi_c);
-        attribute::update(
-            temp_sensor_endpoints_[1],  // Air temp sensor
-            TemperatureMeasurement::Id,
-            TemperatureMeasurement::Attributes::MeasuredValue::Id,
-            &val
+    cluster_t * basic_cluster = cluster::get(ep, BasicInformation::Id);
+    if (basic_cluster) {
+        char node_label[] = "Chlorinator OK";
+        attribute::set_val(
+            attribute::get(basic_cluster, BasicInformation::Attributes::NodeLabel::Id),
+            esp_matter_char_str(node_label, sizeof(node_label) - 1)
         );
     }
 
-    // Update thermostat setpoints
-    for (size_t i = 0; i < MATTER_NUM_THERMOSTATS; i++) {
-        auto const & thermo = state->thermos[i];
-        if (thermo.set_point_in_f.valid) {
+    return ESP_OK;
+}
+
+void
+MatterBridge::update_from_poolstate(poolstate_t const * state, poolstate_subsys_mask_t changed, uint32_t now_ms)
+{
+    if (state == nullptr || node_ == nullptr) {
+        return;
+    }
+
+    // Water and air temperatures
+    if (changed & poolstate_subsys_bit(poolstate_subsys_t::TEMPS)) {
+        for (size_t i = 0; i < MATTER_NUM_TEMP_SENSORS; i++) {
+            // Sensor 0 is water, 1 is air
+            auto const temp_typ = i == 0 ? poolstate_temp_typ_t::WATER : poolstate_temp_typ_t::AIR;
+            auto const & temp = state->temps[enum_index(temp_typ)];
+            if (!temp.valid) {
+                continue;
+            }
+            int16_t temp_centi_c = static_cast<int16_t>(
+                matter_fahrenheit_to_celsius(static_cast<float>(temp.value)) * 100.0f
+            );
+            esp_matter_attr_val_t val = esp_matter_nullable_int16(temp_centi_c);
+
+            stage_push(&temp_sensor_shadow_[i], temp_centi_c, temp_sensor_endpoints_[i],
+                       TemperatureMeasurement::Id, TemperatureMeasurement::Attributes::MeasuredValue::Id, val);
+
+            // Thermostat local temperatures follow the water temperature
+            if (temp_typ == poolstate_temp_typ_t::WATER) {
+                for (size_t j = 0; j < MATTER_NUM_THERMOSTATS; j++) {
+                    stage_push(&local_temp_shadow_[j], temp_centi_c, thermostat_endpoints_[j],
+                               Thermostat::Id, Thermostat::Attributes::LocalTemperature::Id, val);
+                }
+            }
+        }
+    }
+
+    // Thermostat setpoints
+    if (changed & poolstate_subsys_bit(poolstate_subsys_t::THERMOS)) {
+        for (size_t i = 0; i < MATTER_NUM_THERMOSTATS; i++) {
+            auto const & thermo = state->thermos[i];
+            if (!thermo.set_point_in_f.valid) {
+                continue;
+            }
             int16_t setpoint_centi_c = static_cast<int16_t>(
-                matter_fahrenheit_to_celsius(
-                    static_cast<float>(thermo.set_point_in_f.value)
-                ) * 100.0f
+                matter_fahrenheit_to_celsius(static_cast<float>(thermo.set_point_in_f.value)) * 100.0f
             );
+            stage_push(&setpoint_shadow_[i], setpoint_centi_c, thermostat_endpoints_[i],
+                       Thermostat::Id, Thermostat::Attributes::OccupiedHeatingSetpoint::Id,
+                       esp_matter_int16(setpoint_centi_c));
+        }
+    }
+
+    if (changed & poolstate_subsys_bit(poolstate_subsys_t::CIRCUITS)) {
+
+        // Thermostat system mode based on circuit active state, the pool thermostat
+        // depends on the POOL circuit, and the spa thermostat on the SPA circuit
+        static uint8_t const thermo_circuit_idx[MATTER_NUM_THERMOSTATS] = {
+            5,  // network_pool_circuit_t::POOL
+            0   // network_pool_circuit_t::SPA
+        };
+        for (size_t i = 0; i < MATTER_NUM_THERMOSTATS; i++) {
+            auto const & active = state->circuits[thermo_circuit_idx[i]].active;
+            if (!active.valid) {
+                continue;
+            }
+            uint8_t mode = active.value ? 4 : 0;  // 4=Heat, 0=Off
+            stage_push(&system_mode_shadow_[i], mode, thermostat_endpoints_[i],
+                       Thermostat::Id, Thermostat::Attributes::SystemMode::Id, esp_matter_enum8(mode));
+        }
+
+        // Circuit OnOff states
+        for (size_t i = 0; i < MATTER_NUM_CIRCUITS; i++) {
+            auto const & active = state->circuits[i].active;
+            if (!active.valid) {
+                continue;
+            }
+            stage_push(&circuit_shadow_[i], active.value, circuit_endpoints_[i],
+                       OnOff::Id, OnOff::Attributes::OnOff::Id, esp_matter_bool(active.value));
+        }
+    }
+
+    // Primary pump, the noisy values are rate-limited
+    if (changed & poolstate_subsys_bit(poolstate_subsys_t::PRIMARY_PUMP)) {
+        auto const & pump = state->pumps[enum_index(datalink_pump_id_t::PRIMARY)];
 
-            esp_matter_attr_val_t val = esp_matter_int16(setpoint_centi_c);
-            attribute::update(
-                thermostat_endpoints_[i],
-                Thermostat::Id,
-                Thermostat::Attributes::OccupiedHeatingSetpoint::Id,
-                &val
+        if (pump.running.valid) {
+            stage_push(&pump_running_shadow_, pump.running.value, pump_endpoint_,
+                       OnOff::Id, OnOff::Attributes::OnOff::Id, esp_matter_bool(pump.running.value));
+        }
+        if (pump.power.valid) {
+            stage_report(MATTER_REPORT_PUMP_POWER, pump.power.value, now_ms, pump_endpoint_,
+                         PumpConfigurationAndControl::Id, PumpConfigurationAndControl::Attributes::Power::Id,
+                         esp_matter_nullable_uint32(pump.power.value));
+        }
+        if (pump.speed.valid) {
+            stage_report(MATTER_REPORT_PUMP_SPEED, pump.speed.value, now_ms, pump_endpoint_,
+                         PumpConfigurationAndControl::Id, PumpConfigurationAndControl::Attributes::Speed::Id,
+                         esp_matter_nullable_uint16(pump.speed.value));
+        }
+        if (pump.flow.valid) {
+            uint16_t flow_deci_m3_per_h = static_cast<uint16_t>(
+                std::lround(static_cast<float>(pump.flow.value) * GPM_TO_DECI_M3_PER_H)
             );
+            stage_report(MATTER_REPORT_PUMP_CAPACITY, flow_deci_m3_per_h, now_ms, pump_endpoint_,
+                         PumpConfigurationAndControl::Id, PumpConfigurationAndControl::Attributes::Capacity::Id,
+                         esp_matter_nullable_int16(static_cast<int16_t>(flow_deci_m3_per_h)));
+            stage_report(MATTER_REPORT_FLOW_SENSOR, flow_deci_m3_per_h, now_ms, flow_sensor_endpoint_,
+                         FlowMeasurement::Id, FlowMeasurement::Attributes::MeasuredValue::Id,
+                         esp_matter_nullable_uint16(flow_deci_m3_per_h));
         }
     }
 
-    // Update thermostat system mode based on circuit active state
-    // Pool thermostat mode depends on POOL circuit
-    uint8_t pool_circuit_idx = 5;  // network_pool_circuit_t::POOL = 5
-    if (state->circuits[pool_circuit_idx].active.valid) {
-        uint8_t mode = state->circuits[pool_circuit_idx].active.value ? 4 : 0;  // 4=Heat, 0=Off
-        esp_matter_attr_val_t val = esp_matter_enum8(mode);
-        attribute::update(
-            thermostat_endpoints_[MATTER_POOL_THERMO_IDX],
-            Thermostat::Id,
-            Thermostat::Attributes::SystemMode::Id,
-            &val
-        );
+    // Chlorinator
+    if (changed & poolstate_subsys_bit(poolstate_subsys_t::CHLOR)) {
+        auto const & status = state->chlor.status;
+        if (status.valid) {
+            bool ok = status.value == poolstate_chlor_status_typ_t::OK;
+            stage_push(&chlor_ok_shadow_, ok, chlor_endpoint_,
+                       BooleanState::Id, BooleanState::Attributes::StateValue::Id, esp_matter_bool(ok));
+        }
     }
 
-    // Spa thermostat mode depends on SPA circuit
-    uint8_t spa_circuit_idx = 0;  // network_pool_circuit_t::SPA = 0
-    if (state->circuits[spa_circuit_idx].active.valid) {
-        uint8_t mode = state->circuits[spa_circuit_idx].active.value ? 4 : 0;
-        esp_matter_attr_val_t val = esp_matter_enum8(mode);
-        attribute::update(
-            thermostat_endpoints_[MATTER_SPA_THERMO_IDX],
-            Thermostat::Id,
-            Thermostat::Attributes::SystemMode::Id,
-            &val
-        );
+    flush_pushes();
+}
+
+void
+MatterBridge::publish_due(uint32_t now_ms)
+{
+    for (uint8_t i = 0; i < MATTER_NUM_REPORTS; i++) {
+        matter_report_t & report = reports_[i];
+        if (!report.held ||
+            static_cast<int32_t>(now_ms - (report.last_ms + report_policies[i].min_interval_ms)) < 0) {
+            continue;
+        }
+        matter_attr_push_t const & pending = report.pending;
+        report.held = false;
+        report.last_ms = now_ms;
+        stage_push(pending.shadow, pending.value, pending.endpoint_id, pending.cluster_id,
+                   pending.attribute_id, pending.val);
     }
+    flush_pushes();
+}
 
-    // Update circuit OnOff states
-    for (size_t i = 0; i < MATTER_NUM_CIRCUITS; i++) {
-        if (state->circuits[i].active.valid) {
-            esp_matter_attr_val_t val = esp_matter_bool(state->circuits[i].active.value);
-            attribute::update(
-                circuit_endpoints_[i],
-                OnOff::Id,
-                OnOff::Attributes::OnOff::Id,
-                &val
-            );
+void
+MatterBridge::stage_report(uint8_t report_idx, int32_t value, uint32_t now_ms, uint16_t endpoint_id,
+                           uint32_t cluster_id, uint32_t attribute_id, esp_matter_attr_val_t val)
+{
+    matter_report_t & report = reports_[report_idx];
+    matter_report_policy_t const & policy = report_policies[report_idx];
+
+    if (report.shadow.valid) {
+        int32_t delta = value > report.shadow.value ? value - report.shadow.value : report.shadow.value - value;
+        if (delta == 0 || delta < policy.deadband) {
+            report.held = false;  // back within the deadband of what was reported
+            stats_.skipped++;
+            return;
+        }
+        if (static_cast<int32_t>(now_ms - (report.last_ms + policy.min_interval_ms)) < 0) {
+            report.held = true;
+            report.pending = {
+                .shadow = &report.shadow,
+                .value = value,
+                .endpoint_id = endpoint_id,
+                .cluster_id = cluster_id,
+                .attribute_id = attribute_id,
+                .val = val
+            };
+            stats_.held++;
+            return;
         }
     }
+    report.held = false;
+    report.last_ms = now_ms;
+    stage_push(&report.shadow, value, endpoint_id, cluster_id, attribute_id, val);
+}
+
+void
+MatterBridge::stage_push(matter_shadow_t * shadow, int32_t value, uint16_t endpoint_id,
+                         uint32_t cluster_id, uint32_t attribute_id, esp_matter_attr_val_t val)
+{
+    if (shadow->valid && shadow->value == value) {
+        stats_.skipped++;
+        return;
+    }
+    if (num_pushes_ >= MATTER_NUM_PUSHED_ATTRS) {
+        ESP_LOGW(TAG, "Too many attribute pushes");
+        return;
+    }
+    pushes_[num_pushes_++] = {
+        .shadow = shadow,
+        .value = value,
+        .endpoint_id = endpoint_id,
+        .cluster_id = cluster_id,
+        .attribute_id = attribute_id,
+        .val = val
+    };
+}
+
+void
+MatterBridge::flush_pushes()
+{
+    if (num_pushes_ == 0) {
+        return;
+    }
+
+    // One lock for the whole batch, instead of one per attribute::update()
+    lock::status_t const lock_status = lock::chip_stack_lock(portMAX_DELAY);
+    if (lock_status == lock::FAILED) {
+        ESP_LOGW(TAG, "Failed to lock the CHIP stack, %u attribute updates dropped", num_pushes_);
+        num_pushes_ = 0;
+        return;
+    }
+    stats_.batches++;
+
+    // The write callback also sees our own updates, those aren't commands
+    pushing_ = true;
+    for (uint8_t i = 0; i < num_pushes_; i++) {
+        matter_attr_push_t & push = pushes_[i];
+        if (attribute::update(push.endpoint_id, push.cluster_id, push.attribute_id, &push.val) == ESP_OK) {
+            push.shadow->valid = true;
+            push.shadow->value = push.value;
+            stats_.pushed++;
+        } else {
+            ESP_LOGW(TAG, "Failed to update attribute: endpoint=%u, cluster=0x%04lx, attr=0x%04lx",
+                     push.endpoint_id, static_cast<unsigned long>(push.cluster_id),
+                     static_cast<unsigned long>(push.attribute_id));
+        }
+    }
+    pushing_ = false;
+
+    if (lock_status == lock::SUCCESS) {
+        lock::chip_stack_unlock();
+    }
+    num_pushes_ = 0;
 }
 
 bool
@@ -548,6 +783,11 @@ MatterBridge::attribute_update_callback(
         return ESP_OK;
     }
 
+    // Our own updates from the pool state
+    if (bridge->pushing_) {
+        return ESP_OK;
+    }
+
     ESP_LOGD(TAG, "Attribute update: endpoint=%u, cluster=0x%04lx, attr=0x%04lx",
              endpoint_id, static_cast<unsigned long>(cluster_id), static_cast<unsigned long>(attribute_id));
 
@@ -28,6 +28,7 @@
 #include <freertos/queue.h>
 
 #include "../core/poolstate.h"
+#include "../core/poolstate_ttl.h"
 #include "../pool_task/network_msg.h"
 #include "../utils/enum_helpers.h"
 
@@ -62,6 +63,72 @@ constexpr uint8_t MATTER_NUM_THERMOSTATS = 2;  ///< Total thermostat endpoints.
 constexpr uint8_t MATTER_NUM_CIRCUITS    = 9;  ///< Total circuit (switch) endpoints.
 constexpr uint8_t MATTER_NUM_TEMP_SENSORS = 2; ///< Total temperature sensor endpoints.
 
+constexpr uint8_t MATTER_REPORT_PUMP_POWER    = 0;  ///< Pump power report index.
+constexpr uint8_t MATTER_REPORT_PUMP_SPEED    = 1;  ///< Pump speed report index.
+constexpr uint8_t MATTER_REPORT_PUMP_CAPACITY = 2;  ///< Pump capacity (flow) report index.
+constexpr uint8_t MATTER_REPORT_FLOW_SENSOR   = 3;  ///< Flow sensor report index.
+constexpr uint8_t MATTER_NUM_REPORTS          = 4;  ///< Total rate-limited attributes.
+
+/// Attributes pushed from the pool state: local temperature, setpoint and system mode per
+/// thermostat, measured value per temperature sensor, OnOff per circuit, the rate-limited
+/// attributes, pump OnOff and the chlorinator state.
+constexpr uint8_t MATTER_NUM_PUSHED_ATTRS = 3 * MATTER_NUM_THERMOSTATS + MATTER_NUM_TEMP_SENSORS + MATTER_NUM_CIRCUITS +
+                                            MATTER_NUM_REPORTS + 2;
+
+/// @}
+
+/// @name Attribute Shadow Cache
+/// @brief Types for pushing only the attribute values that changed.
+/// @{
+
+/**
+ * @brief Last value pushed to a Matter attribute.
+ */
+struct matter_shadow_t {
+    bool    valid;  ///< True once a value was pushed.
+    int32_t value;  ///< The pushed value, in Matter units.
+};
+
+/**
+ * @brief An attribute value that differs from its shadow, waiting to be pushed.
+ */
+struct matter_attr_push_t {
+    matter_shadow_t *     shadow;        ///< Shadow to update once pushed.
+    int32_t               value;         ///< Value for the shadow.
+    uint16_t              endpoint_id;   ///< Endpoint of the attribute.
+    uint32_t              cluster_id;    ///< Cluster of the attribute.
+    uint32_t              attribute_id;  ///< The attribute.
+    esp_matter_attr_val_t val;           ///< Value for the Matter stack.
+};
+
+/**
+ * @brief When to report a noisy attribute, such as the pump power.
+ */
+struct matter_report_policy_t {
+    int32_t  deadband;         ///< Smallest change that is reported, in Matter units.
+    uint32_t min_interval_ms;  ///< Shortest time between reports.
+};
+
+/**
+ * @brief Reporting state of a rate-limited attribute.
+ */
+struct matter_report_t {
+    matter_shadow_t    shadow;   ///< Last pushed value.
+    uint32_t           last_ms;  ///< Time of the last push.
+    bool               held;     ///< True while a change waits for the minimum interval.
+    matter_attr_push_t pending;  ///< The change that waits.
+};
+
+/**
+ * @brief Counts of attribute pushes, for diagnostics.
+ */
+struct matter_push_stats_t {
+    uint32_t pushed;   ///< Attribute values pushed to the Matter stack.
+    uint32_t skipped;  ///< Attribute values that were already pushed, or within their deadband.
+    uint32_t held;     ///< Changes held back by the minimum interval of their attribute.
+    uint32_t batches;  ///< CHIP stack lock acquisitions to push them.
+};
+
 /// @}
 
 /// @name Matter Bridge Class
@@ -97,9 +164,36 @@ public:
      * attribute values. Updates thermostat temperatures, circuit on/off states,
      * and sensor readings.
      *
-     * @param[in] state Pointer to current pool state.
+     * Only attribute values that differ from the last pushed value are pushed,
+     * all within one CHIP stack lock, to keep Thread traffic and subscription
+     * reports down.
+     *
+     * The pump power, speed and flow are reported only when they change by more than
+     * their deadband, and at most once per minimum interval.
+     *
+     * @param[in] state   Pointer to current pool state.
+     * @param[in] changed Subsystems that changed, the others are not looked at.
+     * @param[in] now_ms  Current time in milliseconds.
+     */
+    void update_from_poolstate(poolstate_t const * state, poolstate_subsys_mask_t changed, uint32_t now_ms);
+
+    /**
+     * @brief Push the changes that were held back, once their minimum interval passed.
+     *
+     * @details
+     * Called from the main loop, so a held change is reported even if the pump
+     * doesn't report again.
+     *
+     * @param[in] now_ms Current time in milliseconds.
      */
-    void update_from_poolstate(poolstate_t const * state);
+    void publish_due(uint32_t now_ms);
+
+    /**
+     * @brief Get the attribute push counts.
+     *
+     * @return Counts since boot.
+     */
+    matter_push_stats_t get_push_stats() const { return stats_; }
 
     /**
      * @brief Get pending command from Matter controller.
@@ -185,6 +279,12 @@ private:
     /// @brief Create temperature sensor endpoints.
     esp_err_t create_temperature_sensor_endpoints();
 
+    /// @brief Create pump and flow sensor endpoints for the primary pump.
+    esp_err_t create_pump_endpoints();
+
+    /// @brief Create the chlorinator endpoint.
+    esp_err_t create_chlorinator_endpoint();
+
     /// @brief Find circuit index from endpoint ID.
     int find_circuit_index(uint16_t endpoint_id) const;
 
@@ -200,6 +300,17 @@ private:
     /// @brief Handle Thermostat mode write.
     esp_err_t handle_thermostat_mode_write(uint16_t endpoint_id, uint8_t mode);
 
+    /// @brief Stage an attribute value, unless it equals the last pushed value.
+    void stage_push(matter_shadow_t * shadow, int32_t value, uint16_t endpoint_id,
+                    uint32_t cluster_id, uint32_t attribute_id, esp_matter_attr_val_t val);
+
+    /// @brief Stage a rate-limited attribute value, or hold it until its minimum interval passed.
+    void stage_report(uint8_t report_idx, int32_t value, uint32_t now_ms, uint16_t endpoint_id,
+                      uint32_t cluster_id, uint32_t attribute_id, esp_matter_attr_val_t val);
+
+    /// @brief Push the staged attribute values within one CHIP stack lock.
+    void flush_pushes();
+
     esp_matter::node_t * node_ = nullptr;  ///< Matter node handle.
 
     /// Endpoint IDs for thermostats (pool, spa).
@@ -211,6 +322,15 @@ private:
     /// Endpoint IDs for temperature sensors (water, air).
     uint16_t temp_sensor_endpoints_[MATTER_NUM_TEMP_SENSORS] = {0};
 
+    /// Endpoint ID for the primary pump.
+    uint16_t pump_endpoint_ = 0;
+
+    /// Endpoint ID for the primary pump flow sensor.
+    uint16_t flow_sensor_endpoint_ = 0;
+
+    /// Endpoint ID for the chlorinator.
+    uint16_t chlor_endpoint_ = 0;
+
     /// Pending commands queue (from Matter → Pool).
     QueueHandle_t pending_commands_q_ = nullptr;
 
@@ -219,6 +339,34 @@ private:
 
     /// Commissioning status.
     bool commissioned_ = false;
+
+    /// Last pushed values, per thermostat.
+    matter_shadow_t local_temp_shadow_[MATTER_NUM_THERMOSTATS] = {};
+    matter_shadow_t setpoint_shadow_[MATTER_NUM_THERMOSTATS] = {};
+    matter_shadow_t system_mode_shadow_[MATTER_NUM_THERMOSTATS] = {};
+
+    /// Last pushed values, per temperature sensor.
+    matter_shadow_t temp_sensor_shadow_[MATTER_NUM_TEMP_SENSORS] = {};
+
+    /// Last pushed values, per circuit.
+    matter_shadow_t circuit_shadow_[MATTER_NUM_CIRCUITS] = {};
+
+    /// Last pushed values, for the pump running state and the chlorinator state.
+    matter_shadow_t pump_running_shadow_ = {};
+    matter_shadow_t chlor_ok_shadow_ = {};
+
+    /// Reporting state of the rate-limited attributes.
+    matter_report_t reports_[MATTER_NUM_REPORTS] = {};
+
+    /// Attribute values that differ from their shadow, waiting to be pushed.
+    matter_attr_push_t pushes_[MATTER_NUM_PUSHED_ATTRS] = {};
+    uint8_t num_pushes_ = 0;
+
+    /// True while pushing, so the write callback doesn't mistake our own updates for commands.
+    bool pushing_ = false;
+
+    /// Attribute push counts.
+    matter_push_stats_t stats_ = {};
 };
 
 /// @}
@@ -0,0 +1,380 @@
+/**
+ * @file cmd_tracker.cpp
+ * @brief Pool task: tracking of commands until the controller acknowledges them
+ *
+ * @details
+ * Implements the outstanding-command table declared in cmd_tracker.h. The table and
+ * statistics live in static memory.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <esp_system.h>
+#include <esp_types.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <esphome/core/log.h>
+
+#include "utils/enum_helpers.h"
+#include "datalink.h"
+#include "network_msg.h"
+#include "cmd_tracker.h"
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wunused-parameter"
+
+namespace esphome {
+namespace opnpool {
+
+constexpr char TAG[] = "cmd_tracker";
+
+constexpr uint8_t  CMD_MAX_ATTEMPTS     = 3;          ///< Transmissions before a command fails
+constexpr uint32_t CMD_ACK_TIMEOUT_MS   = 2000;       ///< Time from transmit to CTRL_SET_ACK [ms]
+constexpr uint32_t CMD_BACKOFF_MS       = 1000;       ///< Delay before the first retry, doubles per retry [ms]
+constexpr uint32_t CMD_CONFIRM_MS       = 3000;       ///< Time from CTRL_SET_ACK to the state broadcast [ms]
+constexpr uint32_t CMD_QUEUE_TIMEOUT_MS = 15 * 1000;  ///< Time a command may wait for a transmit window [ms]
+constexpr uint8_t  CMD_FAILED_SIZE      = CMD_TRACKER_SIZE;  ///< Failed commands kept for the main task, so all of a failed scene reverts
+
+    // commands that the controller acknowledges with a CTRL_SET_ACK
+constexpr network_msg_typ_t _tracked[] = {
+    network_msg_typ_t::CTRL_CIRCUIT_SET,
+    network_msg_typ_t::CTRL_HEAT_SET,
+    network_msg_typ_t::CTRL_TIME_SET,
+    network_msg_typ_t::CTRL_LAYOUT_SET,
+};
+constexpr uint8_t CMD_TYP_COUNT = sizeof(_tracked) / sizeof(_tracked[0]);
+
+/// @brief State of an outstanding command.
+enum class cmd_state_t : uint8_t {
+    FREE    = 0,  ///< Slot is unused.
+    QUEUED  = 1,  ///< In the transmit queue.
+    SENT    = 2,  ///< On the bus, waiting for CTRL_SET_ACK.
+    ACKED   = 3,  ///< Acknowledged, waiting for the state broadcast.
+    BACKOFF = 4   ///< Waiting to be sent again.
+};
+
+/// @brief An outstanding command.
+struct cmd_entry_t {
+    network_msg_t msg;        ///< The command.
+    cmd_state_t   state;      ///< Where it is in its life cycle.
+    uint8_t       typ_idx;    ///< Index in _tracked.
+    uint8_t       attempts;   ///< Number of times it was queued for transmission.
+    uint32_t      start_ms;   ///< Time the main task issued it.
+    uint32_t      state_ms;   ///< Time it entered its current state.
+    uint32_t      retry_ms;   ///< Time it is due to be sent again (BACKOFF only).
+};
+
+static cmd_entry_t _entries[CMD_TRACKER_SIZE] = {};
+static cmd_tracker_stats_t _stats[CMD_TYP_COUNT] = {};
+static network_msg_t _failed[CMD_FAILED_SIZE] = {};
+static uint8_t _failed_head = 0;
+static uint8_t _failed_count = 0;
+static portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+    // wrap-safe "a is at or after b" for millis() timestamps
+static inline bool
+_reached(uint32_t const a, uint32_t const b)
+{
+    return static_cast<int32_t>(a - b) >= 0;
+}
+
+static int8_t
+_typ_idx(network_msg_typ_t const typ)
+{
+    for (uint8_t idx = 0; idx < CMD_TYP_COUNT; idx++) {
+        if (_tracked[idx] == typ) {
+            return static_cast<int8_t>(idx);
+        }
+    }
+    return -1;
+}
+
+    // a newer command for the same circuit or thermostat makes an older one obsolete
+static bool
+_same_target(network_msg_t const * const a, network_msg_t const * const b)
+{
+    if (a->typ != b->typ) {
+        return false;
+    }
+    if (a->typ == network_msg_typ_t::CTRL_CIRCUIT_SET) {
+        return a->u.a5.ctrl_circuit_set.circuit_plus_1 == b->u.a5.ctrl_circuit_set.circuit_plus_1;
+    }
+    return true;
+}
+
+static uint8_t
+_bucket(uint32_t const ms)
+{
+    uint8_t bucket = 0;
+    while (bucket < CMD_TRACKER_BUCKETS - 1 && ms >= CMD_TRACKER_BUCKET_MS[bucket]) {
+        bucket++;
+    }
+    return bucket;
+}
+
+    // oldest entry of a type in a state, so ACKs are matched in order
+static cmd_entry_t *
+_find_oldest(network_msg_typ_t const typ, cmd_state_t const state)
+{
+    cmd_entry_t * found = nullptr;
+    for (auto & entry : _entries) {
+        if (entry.state == state && entry.msg.typ == typ &&
+            (!found || _reached(found->state_ms, entry.state_ms))) {
+            found = &entry;
+        }
+    }
+    return found;
+}
+
+    // call with _lock held
+static void
+_fail(cmd_entry_t * const entry)
+{
+    _stats[entry->typ_idx].failed++;
+    _failed[(_failed_head + _failed_count) % CMD_FAILED_SIZE] = entry->msg;
+    if (_failed_count < CMD_FAILED_SIZE) {
+        _failed_count++;
+    } else {
+        _failed_head = (_failed_head + 1) % CMD_FAILED_SIZE;  // drop the oldest
+    }
+    entry->state = cmd_state_t::FREE;
+}
+
+void
+cmd_tracker_queued(network_msg_t const * const msg, uint32_t const now_ms)
+{
+    if (!msg) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return;
+    }
+    int8_t const typ_idx = _typ_idx(msg->typ);
+    if (typ_idx < 0) {
+        return;
+    }
+
+    portENTER_CRITICAL(&_lock);
+
+    _stats[typ_idx].commands++;
+
+    cmd_entry_t * slot = nullptr;
+    for (auto & entry : _entries) {
+        if (entry.state == cmd_state_t::BACKOFF && _same_target(&entry.msg, msg)) {
+            entry.state = cmd_state_t::FREE;  // superseded
+            _stats[typ_idx].superseded++;
+        }
+        if (!slot && entry.state == cmd_state_t::FREE) {
+            slot = &entry;
+        }
+    }
+    if (slot) {
+        *slot = {
+            .msg      = *msg,
+            .state    = cmd_state_t::QUEUED,
+            .typ_idx  = static_cast<uint8_t>(typ_idx),
+            .attempts = 1,
+            .start_ms = now_ms,
+            .state_ms = now_ms,
+            .retry_ms = 0,
+        };
+    }
+
+    portEXIT_CRITICAL(&_lock);
+
+    if (!slot) {
+        ESP_LOGW(TAG, "Too many outstanding commands, not tracking %s", enum_str(msg->typ));
+    }
+}
+
+void
+cmd_tracker_dropped(network_msg_t const * const msg)
+{
+    if (!msg) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return;
+    }
+
+    portENTER_CRITICAL(&_lock);
+
+    cmd_entry_t * const entry = _find_oldest(msg->typ, cmd_state_t::QUEUED);
+    if (entry) {
+        _stats[entry->typ_idx].superseded++;
+        entry->state = cmd_state_t::FREE;
+    }
+
+    portEXIT_CRITICAL(&_lock);
+}
+
+void
+cmd_tracker_sent(network_msg_t const * const msg, uint32_t const now_ms)
+{
+    if (!msg) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return;
+    }
+
+    portENTER_CRITICAL(&_lock);
+
+    cmd_entry_t * const entry = _find_oldest(msg->typ, cmd_state_t::QUEUED);
+    if (entry) {
+        entry->state = cmd_state_t::SENT;
+        entry->state_ms = now_ms;
+    }
+
+    portEXIT_CRITICAL(&_lock);
+}
+
+void
+cmd_tracker_observe(network_msg_t const * const msg, uint32_t const now_ms)
+{
+    if (!msg) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return;
+    }
+    if (!msg->src.is_controller()) {
+        return;
+    }
+
+    portENTER_CRITICAL(&_lock);
+
+    if (msg->typ == network_msg_typ_t::CTRL_SET_ACK && msg->dst.addr == datalink_addr_t::REMOTE) {
+
+            // an ACK names the type it acknowledges; match it to the oldest of that type
+        for (auto const typ : _tracked) {
+            if (network_msg_typ_info[enum_index(typ)].datalink_typ.ctrl != msg->u.a5.ctrl_set_ack.typ) {
+                continue;
+            }
+            cmd_entry_t * const entry = _find_oldest(typ, cmd_state_t::SENT);
+            if (entry) {
+                cmd_tracker_stats_t & stats = _stats[entry->typ_idx];
+                stats.acked++;
+                stats.ack_hist[_bucket(now_ms - entry->state_ms)]++;
+                entry->state = cmd_state_t::ACKED;
+                entry->state_ms = now_ms;
+            }
+            break;
+        }
+
+    } else if (msg->typ == network_msg_typ_t::CTRL_STATE_BCAST) {
+
+            // the broadcast after the ACK reflects the command
+        for (auto & entry : _entries) {
+            if (entry.state == cmd_state_t::ACKED) {
+                cmd_tracker_stats_t & stats = _stats[entry.typ_idx];
+                stats.confirmed++;
+                stats.done_hist[_bucket(now_ms - entry.start_ms)]++;
+                entry.state = cmd_state_t::FREE;
+            }
+        }
+    }
+
+    portEXIT_CRITICAL(&_lock);
+}
+
+bool
+cmd_tracker_retry(uint32_t const now_ms, network_msg_t * const msg)
+{
+    if (!msg) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return false;
+    }
+
+    bool retry = false;
+    uint8_t attempts = 0;
+
+    portENTER_CRITICAL(&_lock);
+
+    for (auto & entry : _entries) {
+        switch (entry.state) {
+            case cmd_state_t::QUEUED:
+                if (_reached(now_ms, entry.state_ms + CMD_QUEUE_TIMEOUT_MS)) {
+                    _fail(&entry);  // no transmit window, the bus is probably down
+                }
+                break;
+            case cmd_state_t::SENT:
+                if (_reached(now_ms, entry.state_ms + CMD_ACK_TIMEOUT_MS)) {
+                    if (entry.attempts < CMD_MAX_ATTEMPTS) {
+                        entry.state = cmd_state_t::BACKOFF;
+                        entry.state_ms = now_ms;
+                        entry.retry_ms = now_ms + (CMD_BACKOFF_MS << (entry.attempts - 1));
+                    } else {
+                        _fail(&entry);
+                    }
+                }
+                break;
+            case cmd_state_t::ACKED:
+                if (_reached(now_ms, entry.state_ms + CMD_CONFIRM_MS)) {
+                    entry.state = cmd_state_t::FREE;  // acknowledged is good enough
+                }
+                break;
+            case cmd_state_t::BACKOFF:
+                if (!retry && _reached(now_ms, entry.retry_ms)) {
+                    entry.attempts++;
+                    entry.state = cmd_state_t::QUEUED;
+                    entry.state_ms = now_ms;
+                    _stats[entry.typ_idx].retries++;
+                    *msg = entry.msg;
+                    attempts = entry.attempts;
+                    retry = true;
+                }
+                break;
+            case cmd_state_t::FREE:
+                break;
+        }
+    }
+
+    portEXIT_CRITICAL(&_lock);
+
+    if (retry) {
+        ESP_LOGW(TAG, "No ACK for %s, attempt %u of %u", enum_str(msg->typ), attempts, CMD_MAX_ATTEMPTS);
+    }
+    return retry;
+}
+
+bool
+cmd_tracker_take_failed(network_msg_t * const msg)
+{
+    if (!msg) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return false;
+    }
+
+    bool taken = false;
+
+    portENTER_CRITICAL(&_lock);
+    if (_failed_count > 0) {
+        *msg = _failed[_failed_head];
+        _failed_head = (_failed_head + 1) % CMD_FAILED_SIZE;
+        _failed_count--;
+        taken = true;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    return taken;
+}
+
+bool
+cmd_tracker_get_stats(uint8_t const idx, cmd_tracker_stats_t * const stats)
+{
+    if (!stats || idx >= CMD_TYP_COUNT) {
+        ESP_LOGW(TAG, "invalid args to %s", __func__);
+        return false;
+    }
+
+    portENTER_CRITICAL(&_lock);
+    *stats = _stats[idx];
+    portEXIT_CRITICAL(&_lock);
+
+    stats->typ = _tracked[idx];
+    return true;
+}
+
+uint8_t
+cmd_tracker_typ_count()
+{
+    return CMD_TYP_COUNT;
+}
+
+}  // namespace opnpool
+}  // namespace esphome
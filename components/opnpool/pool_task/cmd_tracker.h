@@ -0,0 +1,124 @@
+/**
+ * @file cmd_tracker.h
+ * @brief Pool task: tracking of commands until the controller acknowledges them
+ *
+ * @details
+ * The controller answers each command (e.g. CTRL_CIRCUIT_SET) with a CTRL_SET_ACK and
+ * applies it by the next state broadcast. Commands get lost on a busy RS-485 bus, so
+ * each command from the main task is kept in a small table of outstanding commands:
+ *
+ *   QUEUED  -> handed to the transmit queue, waiting for it to go out on the bus
+ *   SENT    -> on the bus, waiting for the CTRL_SET_ACK
+ *   ACKED   -> acknowledged, waiting for the next state broadcast
+ *   BACKOFF -> not acknowledged in time, waiting to be sent again
+ *
+ * A command that is not acknowledged is sent again after an increasing delay. When the
+ * last attempt fails, the command is handed back to the main task, so the entity can
+ * revert to its last known state and flag the failure. A newer command for the same
+ * circuit or thermostat supersedes an older one that is waiting to be retried.
+ *
+ * The table is only modified from the pool_task. The main task reads the statistics
+ * and takes the failed commands, so those are copied in and out under a spinlock.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+#ifndef __cplusplus
+# error "Requires C++ compilation"
+#endif
+
+#include <esp_system.h>
+#include <esp_types.h>
+
+#include "network_msg.h"
+
+namespace esphome {
+namespace opnpool {
+
+    // a scene that sets every circuit, plus a HEAT_SET
+constexpr uint8_t CMD_TRACKER_SIZE    = enum_count<network_pool_circuit_t>() + 1;  ///< Number of outstanding commands tracked.
+constexpr uint8_t CMD_TRACKER_BUCKETS = 6;                                         ///< Number of latency histogram buckets.
+
+/// @brief Upper bounds of the latency histogram buckets; the last bucket has no bound.
+constexpr uint32_t CMD_TRACKER_BUCKET_MS[CMD_TRACKER_BUCKETS - 1] = {100, 250, 500, 1000, 2500};
+
+/// @brief Command statistics for one command type.
+struct cmd_tracker_stats_t {
+    network_msg_typ_t typ;                            ///< Command type.
+    uint32_t          commands;                       ///< Commands received from the main task.
+    uint32_t          retries;                        ///< Commands sent again after a timeout.
+    uint32_t          acked;                          ///< Commands acknowledged by the controller.
+    uint32_t          confirmed;                      ///< Acknowledged commands followed by a state broadcast.
+    uint32_t          failed;                         ///< Commands given up on.
+    uint32_t          superseded;                     ///< Commands replaced by a newer one before they were acknowledged.
+    uint32_t          ack_hist[CMD_TRACKER_BUCKETS];  ///< Time from (last) transmit to CTRL_SET_ACK.
+    uint32_t          done_hist[CMD_TRACKER_BUCKETS]; ///< Time from the main task to the confirming broadcast.
+};
+
+/**
+ * @brief Starts tracking a command from the main task.
+ *
+ * @param[in] msg    The command, as it is queued for transmission.
+ * @param[in] now_ms Current time in milliseconds (e.g. millis()).
+ */
+void cmd_tracker_queued(network_msg_t const * const msg, uint32_t const now_ms);
+
+/**
+ * @brief Stops tracking a command that was taken out of the transmit queue unsent.
+ *
+ * @param[in] msg The command, as it was queued.
+ */
+void cmd_tracker_dropped(network_msg_t const * const msg);
+
+/**
+ * @brief Notes that a message went out on the bus.
+ *
+ * @param[in] msg    The message as echoed by the network layer after transmission.
+ * @param[in] now_ms Current time in milliseconds.
+ */
+void cmd_tracker_sent(network_msg_t const * const msg, uint32_t const now_ms);
+
+/**
+ * @brief Matches a received message against the outstanding commands.
+ *
+ * @param[in] msg    A message received from the bus.
+ * @param[in] now_ms Current time in milliseconds.
+ */
+void cmd_tracker_observe(network_msg_t const * const msg, uint32_t const now_ms);
+
+/**
+ * @brief Handles timeouts and returns a command to send again, if one is due.
+ *
+ * @param[in]  now_ms Current time in milliseconds.
+ * @param[out] msg    Receives the command to queue for transmission.
+ * @return            True if a command should be sent again now.
+ */
+[[nodiscard]] bool cmd_tracker_retry(uint32_t const now_ms, network_msg_t * const msg);
+
+/**
+ * @brief Takes a command that failed after all attempts (main task).
+ *
+ * @param[out] msg Receives the failed command.
+ * @return         True if there was a failed command.
+ */
+[[nodiscard]] bool cmd_tracker_take_failed(network_msg_t * const msg);
+
+/**
+ * @brief Copies the statistics of a command type.
+ *
+ * @param[in]  idx   Index of the command type, 0 to cmd_tracker_typ_count() - 1.
+ * @param[out] stats Receives the statistics.
+ * @return           True if idx is valid.
+ */
+[[nodiscard]] bool cmd_tracker_get_stats(uint8_t const idx, cmd_tracker_stats_t * const stats);
+
+/**
+ * @brief Returns the number of command types that are tracked.
+ */
+[[nodiscard]] uint8_t cmd_tracker_typ_count();
+
+}  // namespace opnpool
+}  // namespace esphome
@@ -42,10 +42,24 @@ struct datalink_pkt_t;
 struct rs485_instance_t;
 using rs485_handle_t = rs485_instance_t *;
 
-    // common pump ids 
+    // pump ids, one per address 0x60..0x6F; the controller calls these pump 1 to 16
 enum class datalink_pump_id_t : uint8_t {
     PRIMARY = 0x00,
-    SOLAR   = 0x01
+    SOLAR   = 0x01,
+    PUMP_3  = 0x02,
+    PUMP_4  = 0x03,
+    PUMP_5  = 0x04,
+    PUMP_6  = 0x05,
+    PUMP_7  = 0x06,
+    PUMP_8  = 0x07,
+    PUMP_9  = 0x08,
+    PUMP_10 = 0x09,
+    PUMP_11 = 0x0A,
+    PUMP_12 = 0x0B,
+    PUMP_13 = 0x0C,
+    PUMP_14 = 0x0D,
+    PUMP_15 = 0x0E,
+    PUMP_16 = 0x0F
 };
 
 using datalink_preamble_a5_t  = uint8_t[3];
@@ -101,6 +115,8 @@ struct datalink_addr_t {
     }
 } PACK8;
 static_assert(sizeof(datalink_addr_t) == 1, "datalink_addr_t must be 1 byte");
+static_assert(static_cast<uint8_t>(datalink_pump_id_t::PUMP_16) == datalink_addr_t::PUMP_ID_MASK,
+              "one datalink_pump_id_t per pump address");
 
 /// @brief IC protocol header structure.
 struct datalink_hdr_ic_t {
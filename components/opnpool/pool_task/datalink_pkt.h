@@ -21,6 +21,7 @@
 #include <esp_system.h>
 #include <esp_types.h>
 
+#include "utils/enum_helpers.h"
 #include "datalink.h"
 
 #ifndef PACK8
@@ -48,6 +49,7 @@ enum class datalink_prot_t : uint8_t {
     A5_PUMP = 0x02,  ///< Protocol type for the A5 pump protocol.
     NONE    = 0xFF   ///< No valid protocol was detected.
 };
+ENUM_HELPERS_UINT8_RANGE(datalink_prot_t)
 
 /**
  * @brief Controller message types
@@ -111,6 +113,7 @@ enum class datalink_ctrl_typ_t : uint8_t {
     // LIGHT_REQ        = 0xE7,
     // LIGHT_RESP       = 0x27,
 };
+ENUM_HELPERS_UINT8_RANGE(datalink_ctrl_typ_t)
 
 /**
  * @brief Pump message types
@@ -130,6 +133,7 @@ enum class datalink_pump_typ_t : uint8_t {
     REG_VS      = 0x0A,  // variable speed (RPM)
     REJECTING   = 0xFF
 };
+ENUM_HELPERS_UINT8_RANGE(datalink_pump_typ_t)
 
 /**
  * @brief Chlorinator message types
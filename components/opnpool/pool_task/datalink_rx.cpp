@@ -268,7 +268,7 @@ _read_head(rs485_handle_t const rs485, local_data_t * const local, datalink_pkt_
                 pkt->src      = hdr->src;
                 pkt->dst      = hdr->dst;
                 pkt->data_len = hdr->len;
-                if (pkt->data_len > sizeof(network_data_a5_t)) {
+                if (pkt->data_len > sizeof(network_data_t)) {
                     return ESP_FAIL;
                 }
                 return ESP_OK;
@@ -7,9 +7,11 @@
  * network layer abstracts protocol translation and message construction, enabling
  * reliable communication between the ESP32 and pool controller over RS-485.
  *
- * The network layer provides two main functions:
+ * The network layer provides these main functions:
  * 1. `network_rx_msg()`: overlays a raw datalink packet with a network message structure.
  * 2. `network_create_pkt()`: Creates a datalink packet from a network message.
+ * 3. `network_create_tx_pkt()`: Creates a packet to transmit that keeps its network message,
+ *    which `network_tx_pkt_msg()` returns once the packet has been transmitted.
  *
  * The design supports multiple protocol variants and is intended for use in a
  * single-threaded ESPHome environment. Forward declarations are used to avoid
@@ -34,6 +36,7 @@ namespace opnpool {
     // forward declarations (to avoid circular dependencies)
 struct datalink_pkt_t;
 struct network_msg_t;
+struct network_tx_pkt_t;
 
 /**
  * @brief Decode a datalink packet into a network message for higher-level processing.
@@ -65,5 +68,26 @@ struct network_msg_t;
  */
 [[nodiscard]] esp_err_t network_create_pkt(network_msg_t const * const msg, datalink_pkt_t * const pkt);
 
+/**
+ * @brief Creates a packet to transmit, that keeps a copy of the network message.
+ *
+ * @details
+ * Allocates the packet and the message copy as one block. Queue `&tx->pkt` for
+ * transmission; whoever dequeues it frees `pkt->skb` and then `pkt`, which also frees
+ * the message copy.
+ *
+ * @param[in] msg Pointer to the network message to transmit.
+ * @return        The new packet, or nullptr if message type is unknown or allocation fails.
+ */
+[[nodiscard]] network_tx_pkt_t * network_create_tx_pkt(network_msg_t const * const msg);
+
+/**
+ * @brief Returns the network message that a packet from network_create_tx_pkt() was created from.
+ *
+ * @param[in] pkt A packet dequeued from the RS-485 transmit queue.
+ * @return        The network message, valid until the packet is freed.
+ */
+[[nodiscard]] network_msg_t const * network_tx_pkt_msg(datalink_pkt_t const * const pkt);
+
 }  // namespace opnpool
 }  // namespace esphome
\ No newline at end of file
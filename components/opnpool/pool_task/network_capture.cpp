@@ -0,0 +1,201 @@
+/**
+ * @file network_capture.cpp
+ * @brief Network layer: capture of frames that could not be decoded
+ *
+ * @details
+ * Implements the capture ring declared in network_capture.h. The ring lives in static
+ * memory; each critical section copies at most one entry.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <esp_system.h>
+#include <esp_types.h>
+#include <stdio.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <esphome/core/log.h>
+#include <esphome/core/hal.h>
+
+#include "utils/enum_helpers.h"
+#include "datalink.h"
+#include "datalink_pkt.h"
+#include "network_capture.h"
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wunused-parameter"
+
+namespace esphome {
+namespace opnpool {
+
+constexpr char TAG[] = "network_capture";
+
+static network_capture_entry_t _ring[NETWORK_CAPTURE_SIZE] = {};  // count == 0 marks an empty slot
+static uint32_t _frames = 0;
+static uint32_t _evicted = 0;
+static portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+    // 32-bit FNV-1a
+static uint32_t
+_hash(uint8_t const * const data, uint8_t const len)
+{
+    uint32_t hash = 2166136261UL;
+    for (uint8_t ii = 0; ii < len; ii++) {
+        hash ^= data[ii];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+static char const *
+_typ_str(datalink_prot_t const prot, uint8_t const typ)
+{
+    switch (prot) {
+        case datalink_prot_t::A5_CTRL: return enum_str(static_cast<datalink_ctrl_typ_t>(typ));
+        case datalink_prot_t::A5_PUMP: return enum_str(static_cast<datalink_pump_typ_t>(typ));
+        case datalink_prot_t::IC:      return enum_str(static_cast<datalink_chlor_typ_t>(typ));
+        default:                       return "?";
+    }
+}
+
+void
+network_capture_add(datalink_pkt_t const * const pkt, network_capture_reason_t const reason, uint8_t const known_len)
+{
+    if (!pkt) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return;
+    }
+
+    uint8_t const len = static_cast<uint8_t>(pkt->data_len);
+    uint8_t const stored_len = len < DATALINK_MAX_DATA_SIZE ? len : DATALINK_MAX_DATA_SIZE;
+    uint8_t const skip = known_len < stored_len ? known_len : stored_len;
+    uint32_t const hash = _hash(pkt->data + skip, stored_len - skip);
+    uint32_t const now = millis();
+
+    portENTER_CRITICAL(&_lock);
+
+    _frames++;
+
+        // same frame as before, or else the first empty or least recently seen slot
+    network_capture_entry_t * victim = &_ring[0];
+    for (auto & entry : _ring) {
+        if (entry.count != 0 && entry.hash == hash && entry.len == len && entry.known_len == known_len &&
+            entry.prot == pkt->prot && entry.typ == pkt->typ.raw &&
+            memcmp(entry.data + skip, pkt->data + skip, stored_len - skip) == 0) {
+
+            entry.count++;
+            entry.last_ms = now;
+            entry.src = pkt->src;
+            entry.dst = pkt->dst;
+            memcpy(entry.data, pkt->data, skip);
+            portEXIT_CRITICAL(&_lock);
+            return;
+        }
+        if (victim->count != 0 && (entry.count == 0 || now - entry.last_ms > now - victim->last_ms)) {
+            victim = &entry;
+        }
+    }
+    if (victim->count != 0) {
+        _evicted++;
+    }
+    *victim = {
+        .first_ms  = now,
+        .last_ms   = now,
+        .count     = 1,
+        .hash      = hash,
+        .prot      = pkt->prot,
+        .typ       = pkt->typ.raw,
+        .src       = pkt->src,
+        .dst       = pkt->dst,
+        .reason    = reason,
+        .len       = len,
+        .known_len = known_len,
+        .data      = {},
+    };
+    memcpy(victim->data, pkt->data, stored_len);
+
+    portEXIT_CRITICAL(&_lock);
+}
+
+bool
+network_capture_get(uint8_t const idx, network_capture_entry_t * const entry)
+{
+    if (!entry || idx >= NETWORK_CAPTURE_SIZE) {
+        ESP_LOGW(TAG, "invalid args to %s", __func__);
+        return false;
+    }
+
+    portENTER_CRITICAL(&_lock);
+    *entry = _ring[idx];
+    portEXIT_CRITICAL(&_lock);
+
+    return entry->count != 0;
+}
+
+network_capture_stats_t
+network_capture_stats()
+{
+    network_capture_stats_t stats = {};
+
+    portENTER_CRITICAL(&_lock);
+    for (auto const & entry : _ring) {
+        stats.entries += entry.count != 0;
+    }
+    stats.frames = _frames;
+    stats.evicted = _evicted;
+    portEXIT_CRITICAL(&_lock);
+
+    return stats;
+}
+
+void
+network_capture_dump()
+{
+    network_capture_stats_t const stats = network_capture_stats();
+    ESP_LOGI(TAG, "Undecoded frames: %u distinct, %lu total, %lu evicted",
+             stats.entries, static_cast<unsigned long>(stats.frames), static_cast<unsigned long>(stats.evicted));
+
+    uint32_t const now = millis();
+
+    for (uint8_t idx = 0; idx < NETWORK_CAPTURE_SIZE; idx++) {
+
+        network_capture_entry_t entry;
+        if (!network_capture_get(idx, &entry)) {
+            continue;
+        }
+
+            // a '|' marks where the decoded prefix ends
+        char hex[DATALINK_MAX_DATA_SIZE * 3 + 2 + 1];
+        char * p = hex;
+        uint8_t const stored_len = entry.len < DATALINK_MAX_DATA_SIZE ? entry.len : DATALINK_MAX_DATA_SIZE;
+        for (uint8_t ii = 0; ii < stored_len; ii++) {
+            if (ii == entry.known_len && ii != 0) {
+                p += snprintf(p, sizeof(hex) - (p - hex), " |");
+            }
+            p += snprintf(p, sizeof(hex) - (p - hex), " %02X", entry.data[ii]);
+        }
+        *p = '\0';
+
+        ESP_LOGI(TAG, "  %s %s (0x%02X) %02X->%02X %s len=%u x%lu, first %lus ago, last %lus ago:%s",
+                 enum_str(entry.prot), _typ_str(entry.prot, entry.typ), entry.typ,
+                 entry.src.addr, entry.dst.addr, enum_str(entry.reason), entry.len,
+                 static_cast<unsigned long>(entry.count),
+                 static_cast<unsigned long>((now - entry.first_ms) / 1000),
+                 static_cast<unsigned long>((now - entry.last_ms) / 1000), hex);
+    }
+}
+
+void
+network_capture_clear()
+{
+    portENTER_CRITICAL(&_lock);
+    memset(_ring, 0, sizeof(_ring));
+    _frames = 0;
+    _evicted = 0;
+    portEXIT_CRITICAL(&_lock);
+}
+
+}  // namespace opnpool
+}  // namespace esphome
@@ -0,0 +1,106 @@
+/**
+ * @file network_capture.h
+ * @brief Network layer: capture of frames that could not be decoded
+ *
+ * @details
+ * Frames that `network_rx_msg()` drops, because their type is not in
+ * `NETWORK_MSG_TYP_LIST` or their length doesn't match, are kept in a small ring for
+ * protocol reverse engineering. Identical frames (same protocol, type, length and
+ * payload) share one entry with a repeat count, so a chatty device can't flush out rare
+ * frames. When the ring is full, the least recently seen entry is replaced.
+
+Frames that were decoded using a longer, firmware-dependent layout are captured too, so
+their extra bytes can be studied. For those, only the bytes past the known prefix are
+compared, so a state broadcast that changes every second still occupies a single entry.
+ *
+ * Frames are added from the pool_task and read from the main task, so entries are
+ * copied in and out under a spinlock. Dumping never stalls the RS-485 bus.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+#ifndef __cplusplus
+# error "Requires C++ compilation"
+#endif
+
+#include <esp_system.h>
+#include <esp_types.h>
+
+#include "datalink_pkt.h"
+#include "network_msg.h"
+
+namespace esphome {
+namespace opnpool {
+
+constexpr uint8_t NETWORK_CAPTURE_SIZE = 16;  ///< Number of distinct frames kept.
+
+/// @brief Why a frame was captured.
+enum class network_capture_reason_t : uint8_t {
+    UNSUPPORTED_TYP = 0,  ///< Type is not in NETWORK_MSG_TYP_LIST.
+    BAD_LENGTH      = 1,  ///< Type is known, but the payload length doesn't match.
+    EXTRA_BYTES     = 2   ///< Decoded, but the payload has bytes past the known prefix.
+};
+
+/// @brief A captured frame and how often it was seen.
+struct network_capture_entry_t {
+    uint32_t                 first_ms;  ///< Time the frame was first seen (millis()).
+    uint32_t                 last_ms;   ///< Time the frame was last seen (millis()).
+    uint32_t                 count;     ///< Number of times the frame was seen.
+    uint32_t                 hash;      ///< FNV-1a hash of the payload past known_len.
+    datalink_prot_t          prot;      ///< Protocol.
+    uint8_t                  typ;       ///< Raw message type.
+    datalink_addr_t          src;       ///< Source address.
+    datalink_addr_t          dst;       ///< Destination address.
+    network_capture_reason_t reason;    ///< Why the frame was captured.
+    uint8_t                  len;       ///< Payload length as received.
+    uint8_t                  known_len; ///< Length of the decoded prefix, 0 if not decoded.
+    uint8_t                  data[DATALINK_MAX_DATA_SIZE];  ///< Payload (first DATALINK_MAX_DATA_SIZE bytes).
+};
+
+/// @brief Capture statistics.
+struct network_capture_stats_t {
+    uint8_t  entries;  ///< Number of distinct frames in the ring.
+    uint32_t frames;   ///< Number of frames captured since boot (or the last clear).
+    uint32_t evicted;  ///< Number of distinct frames replaced because the ring was full.
+};
+
+/**
+ * @brief Adds an undecoded frame to the capture ring.
+ *
+ * @param[in] pkt       The datalink packet that could not be (fully) decoded.
+ * @param[in] reason    Why it was captured.
+ * @param[in] known_len Length of the decoded prefix. Frames that only differ within the
+ *                      prefix share an entry that holds the most recent prefix.
+ */
+void network_capture_add(datalink_pkt_t const * const pkt, network_capture_reason_t const reason,
+                         uint8_t const known_len = 0);
+
+/**
+ * @brief Copies a captured frame.
+ *
+ * @param[in]  idx   Index in the ring, 0 to NETWORK_CAPTURE_SIZE - 1.
+ * @param[out] entry Receives the frame.
+ * @return           True if the slot holds a frame.
+ */
+[[nodiscard]] bool network_capture_get(uint8_t const idx, network_capture_entry_t * const entry);
+
+/**
+ * @brief Returns the capture statistics.
+ */
+[[nodiscard]] network_capture_stats_t network_capture_stats();
+
+/**
+ * @brief Logs all captured frames.
+ */
+void network_capture_dump();
+
+/**
+ * @brief Empties the capture ring.
+ */
+void network_capture_clear();
+
+}  // namespace opnpool
+}  // namespace esphome
@@ -76,5 +76,49 @@ network_create_pkt(network_msg_t const * const msg, datalink_pkt_t * const pkt)
     return ESP_OK;
 }
 
+/**
+ * @brief Creates a packet to transmit, that keeps a copy of the network message.
+ *
+ * @param[in] msg Pointer to the network message to transmit.
+ * @return        The new packet, or nullptr if message type is unknown or allocation fails.
+ */
+network_tx_pkt_t *
+network_create_tx_pkt(network_msg_t const * const msg)
+{
+    if (!msg) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return nullptr;
+    }
+
+    network_tx_pkt_t * const tx = static_cast<network_tx_pkt_t *>(calloc(1, sizeof(network_tx_pkt_t)));
+    if (!tx) {
+        ESP_LOGW(TAG, "Failed to allocate tx packet");
+        return nullptr;
+    }
+    tx->msg = *msg;
+    tx->msg.layout = network_msg_layout_t::BASE;  // as created by network_create_pkt()
+    tx->msg.len = 0;
+
+    if (network_create_pkt(&tx->msg, &tx->pkt) != ESP_OK) {
+        if (tx->pkt.skb) free(tx->pkt.skb);
+        free(tx);
+        return nullptr;
+    }
+    return tx;
+}
+
+/**
+ * @brief Returns the network message that a packet from network_create_tx_pkt() was created from.
+ *
+ * @param[in] pkt A packet dequeued from the RS-485 transmit queue.
+ * @return        The network message, valid until the packet is freed.
+ */
+network_msg_t const *
+network_tx_pkt_msg(datalink_pkt_t const * const pkt)
+{
+        // pkt is the first member of network_tx_pkt_t
+    return &reinterpret_cast<network_tx_pkt_t const *>(pkt)->msg;
+}
+
 } // namespace opnpool
 } // namespace esphome
\ No newline at end of file
@@ -30,16 +30,8 @@
 #include <cstddef>
 #include <cstdint>
 #include <algorithm>
-
-#if defined(MAGIC_ENUM_RANGE_MIN)
-# undef MAGIC_ENUM_RANGE_MIN
-#endif
-#if defined(MAGIC_ENUM_RANGE_MAX)
-# undef MAGIC_ENUM_RANGE_MAX
-#endif
-#define MAGIC_ENUM_RANGE_MIN 0
-#define MAGIC_ENUM_RANGE_MAX 256
-#include "utils/magic_enum.h"
+#include <type_traits>
+#include <utility>
 
 #include "datalink_pkt.h"
 #include "utils/to_str.h"
@@ -526,9 +518,34 @@ union network_data_ic_t {
     network_chlor_level_set_t    chlor_level_set;
     network_chlor_level10_set_t  chlor_level10_set;
     network_chlor_level_resp_t   chlor_level_resp;
+    network_chlor_ichlor_bcast_t chlor_ichlor_bcast;
 } PACK8;
 
-inline constexpr uint8_t DATALINK_MAX_DATA_SIZE = std::max(sizeof(network_data_a5_t), sizeof(network_data_ic_t));
+/**
+ * @brief X-Macro defining the firmware-dependent layouts of network messages.
+ *
+ * @details
+ * Some controller firmwares (IntelliTouch, newer EasyTouch) send a longer version of a
+ * message than the struct in NETWORK_MSG_TYP_LIST. That struct is the known prefix of
+ * each layout, so it is decoded in place, and the bytes after it are kept in
+ * network_msg_t::u.raw. A payload that matches SIZE_EXPR in NETWORK_MSG_TYP_LIST has the
+ * BASE layout and is not listed here.
+ *
+ * Format: X(ENUM_NAME, LAYOUT, MIN_SIZE, MAX_SIZE)
+ *   - ENUM_NAME: The network_msg_typ_t value name
+ *   - LAYOUT: The network_msg_layout_t value name
+ *   - MIN_SIZE, MAX_SIZE: Range of payload lengths that select this layout
+ */
+#define NETWORK_MSG_LAYOUT_LIST(X) \
+    X(CTRL_STATE_BCAST, EXTENDED, sizeof(network_ctrl_state_bcast_t) + 1, sizeof(network_ctrl_state_bcast_t) + 8)
+
+inline constexpr uint8_t DATALINK_MAX_DATA_SIZE = std::max({
+    sizeof(network_data_a5_t),
+    sizeof(network_data_ic_t),
+#define X_MAX_SIZE(name, layout, min_size, max_size) static_cast<size_t>(max_size),
+    NETWORK_MSG_LAYOUT_LIST(X_MAX_SIZE)
+#undef X_MAX_SIZE
+});
 
 union network_data_t {
     network_data_a5_t a5;
@@ -544,68 +561,69 @@ union network_data_t {
  * This macro generates the enum values, size lookup table, and protocol info table
  * from a single definition, ensuring they stay synchronized.
  *
- * Format: X(ENUM_NAME, SIZE_EXPR, IS_TO_PUMP, PROTOCOL, DATALINK_TYPE)
+ * Format: X(ENUM_NAME, SIZE_EXPR, IS_TO_PUMP, PROTOCOL, DATALINK_TYPE, DATA_MEMBER)
  *   - ENUM_NAME: The enum value name
  *   - SIZE_EXPR: sizeof(struct) for messages with data, 0 for empty messages
  *   - IS_TO_PUMP: Whether the message is sent to the pump (true) or from the pump (false)
  *   - PROTOCOL: datalink_prot_t value (A5_PUMP, A5_CTRL, or IC)
  *   - DATALINK_TYPE: The datalink type enum value
+ *   - DATA_MEMBER: The network_data_t member that holds the payload (raw for empty messages)
  * 
  * @note In C++ empty structs have a size of 1, not 0.  For those we use 0 in this table.
  */
 #define NETWORK_MSG_TYP_LIST(X) \
-    X(IGNORE,                1,                                     false, A5_PUMP, datalink_pump_typ_t::REJECTING)    \
-    X(PUMP_REG_SET,          sizeof(network_pump_reg_set_t),        true,  A5_PUMP, datalink_pump_typ_t::REG)          \
-    X(PUMP_REG_RESP,         sizeof(network_pump_reg_resp_t),       false, A5_PUMP, datalink_pump_typ_t::REG)          \
-    X(PUMP_REG_VF_SET,       sizeof(network_pump_reg_set_t),        true,  A5_PUMP, datalink_pump_typ_t::REG_VF)       \
-    X(PUMP_REG_VF_RESP,      sizeof(network_pump_reg_resp_t),       false, A5_PUMP, datalink_pump_typ_t::REG_VF)       \
-    X(PUMP_REG_VS_SET,       sizeof(network_pump_reg_set_t),        true,  A5_PUMP, datalink_pump_typ_t::REG_VS)       \
-    X(PUMP_REG_VS_RESP,      sizeof(network_pump_reg_resp_t),       false, A5_PUMP, datalink_pump_typ_t::REG_VS)       \
-    X(PUMP_REMOTE_CTRL_SET,  sizeof(network_pump_ctrl_t),           true,  A5_PUMP, datalink_pump_typ_t::REMOTE_CTRL)  \
-    X(PUMP_REMOTE_CTRL_RESP, sizeof(network_pump_ctrl_t),           false, A5_PUMP, datalink_pump_typ_t::REMOTE_CTRL)  \
-    X(PUMP_RUN_MODE_SET,     sizeof(network_pump_run_mode_t),       true,  A5_PUMP, datalink_pump_typ_t::RUN_MODE)     \
-    X(PUMP_RUN_MODE_RESP,    sizeof(network_pump_run_mode_t),       false, A5_PUMP, datalink_pump_typ_t::RUN_MODE)     \
-    X(PUMP_RUN_SET,          sizeof(network_pump_running_t),        true,  A5_PUMP, datalink_pump_typ_t::RUN)          \
-    X(PUMP_RUN_RESP,         sizeof(network_pump_running_t),        false, A5_PUMP, datalink_pump_typ_t::RUN)          \
-    X(PUMP_STATUS_REQ,       0,                                     true,  A5_PUMP, datalink_pump_typ_t::STATUS)       \
-    X(PUMP_STATUS_RESP,      sizeof(network_pump_status_resp_t),    false, A5_PUMP, datalink_pump_typ_t::STATUS)       \
-    X(CTRL_SET_ACK,          sizeof(network_ctrl_set_ack_t),        false, A5_CTRL, datalink_ctrl_typ_t::SET_ACK)      \
-    X(CTRL_CIRCUIT_SET,      sizeof(network_ctrl_circuit_set_t),    false, A5_CTRL, datalink_ctrl_typ_t::CIRCUIT_SET)  \
-    X(CTRL_SCHED_REQ,        0,                                     false, A5_CTRL, datalink_ctrl_typ_t::SCHED_REQ)    \
-    X(CTRL_SCHED_RESP,       sizeof(network_ctrl_sched_resp_t),     false, A5_CTRL, datalink_ctrl_typ_t::SCHED_RESP)   \
-    X(CTRL_STATE_BCAST,      sizeof(network_ctrl_state_bcast_t),    false, A5_CTRL, datalink_ctrl_typ_t::STATE_BCAST)  \
-    X(CTRL_TIME_REQ,         0,                                     false, A5_CTRL, datalink_ctrl_typ_t::TIME_REQ)     \
-    X(CTRL_TIME_RESP,        sizeof(network_ctrl_time_t),           false, A5_CTRL, datalink_ctrl_typ_t::TIME_RESP)    \
-    X(CTRL_TIME_SET,         sizeof(network_ctrl_time_t),           false, A5_CTRL, datalink_ctrl_typ_t::TIME_SET)     \
-    X(CTRL_HEAT_REQ,         0,                                     false, A5_CTRL, datalink_ctrl_typ_t::HEAT_REQ)     \
-    X(CTRL_HEAT_RESP,        sizeof(network_ctrl_heat_resp_t),      false, A5_CTRL, datalink_ctrl_typ_t::HEAT_RESP)    \
-    X(CTRL_HEAT_SET,         sizeof(network_ctrl_heat_set_t),       false, A5_CTRL, datalink_ctrl_typ_t::HEAT_SET)     \
-    X(CTRL_LAYOUT_REQ,       0,                                     false, A5_CTRL, datalink_ctrl_typ_t::LAYOUT_REQ)   \
-    X(CTRL_LAYOUT_RESP,      sizeof(network_ctrl_layout_t),         false, A5_CTRL, datalink_ctrl_typ_t::LAYOUT_RESP)  \
-    X(CTRL_LAYOUT_SET,       sizeof(network_ctrl_layout_t),         false, A5_CTRL, datalink_ctrl_typ_t::LAYOUT_SET)   \
-    X(CTRL_VALVE_REQ,        0,                                     false, A5_CTRL, datalink_ctrl_typ_t::VALVE_REQ)    \
-    X(CTRL_VALVE_RESP,       sizeof(network_ctrl_valve_resp_t),     false, A5_CTRL, datalink_ctrl_typ_t::VALVE_RESP)   \
-    X(CTRL_VERSION_REQ,      0,                                     false, A5_CTRL, datalink_ctrl_typ_t::VERSION_REQ)  \
-    X(CTRL_VERSION_RESP,     sizeof(network_ctrl_version_resp_t),   false, A5_CTRL, datalink_ctrl_typ_t::VERSION_RESP) \
-    X(CTRL_SOLARPUMP_REQ,    0,                                     false, A5_CTRL, datalink_ctrl_typ_t::SOLARPUMP_REQ)   \
-    X(CTRL_SOLARPUMP_RESP,   sizeof(network_ctrl_solarpump_resp_t), false, A5_CTRL, datalink_ctrl_typ_t::SOLARPUMP_RESP)  \
-    X(CTRL_DELAY_REQ,        0,                                     false, A5_CTRL, datalink_ctrl_typ_t::DELAY_REQ)       \
-    X(CTRL_DELAY_RESP,       sizeof(network_ctrl_delay_resp_t),     false, A5_CTRL, datalink_ctrl_typ_t::DELAY_RESP)      \
-    X(CTRL_HEAT_SETPT_REQ,   0,                                     false, A5_CTRL, datalink_ctrl_typ_t::HEAT_SETPT_REQ)  \
-    X(CTRL_HEAT_SETPT_RESP,  sizeof(network_ctrl_heat_setpt_resp_t),false, A5_CTRL, datalink_ctrl_typ_t::HEAT_SETPT_RESP) \
-    X(CTRL_CIRC_NAMES_REQ,   sizeof(network_ctrl_circ_names_req_t), false, A5_CTRL, datalink_ctrl_typ_t::CIRC_NAMES_REQ)  \
-    X(CTRL_CIRC_NAMES_RESP,  sizeof(network_ctrl_circ_names_resp_t),false, A5_CTRL, datalink_ctrl_typ_t::CIRC_NAMES_RESP) \
-    X(CTRL_SCHEDS_REQ,       sizeof(network_ctrl_scheds_req_t),     false, A5_CTRL, datalink_ctrl_typ_t::SCHEDS_REQ)    \
-    X(CTRL_SCHEDS_RESP,      sizeof(network_ctrl_scheds_resp_t),    false, A5_CTRL, datalink_ctrl_typ_t::SCHEDS_RESP)   \
-    X(CTRL_CHEM_REQ,         sizeof(network_ctrl_chem_req_t),       false, A5_CTRL, datalink_ctrl_typ_t::CHEM_REQ)      \
-    X(CHLOR_CONTROL_REQ,     sizeof(network_chlor_control_req_t),   false, IC,      datalink_chlor_typ_t::CONTROL_REQ)  \
-    X(CHLOR_CONTROL_RESP,    sizeof(network_chlor_control_resp_t),  false, IC,      datalink_chlor_typ_t::CONTROL_RESP) \
-    X(CHLOR_MODEL_REQ,       sizeof(network_chlor_model_req_t),     false, IC,      datalink_chlor_typ_t::MODEL_REQ)    \
-    X(CHLOR_MODEL_RESP,      sizeof(network_chlor_model_resp_t),    false, IC,      datalink_chlor_typ_t::MODEL_RESP)   \
-    X(CHLOR_LEVEL_SET,       sizeof(network_chlor_level_set_t),     false, IC,      datalink_chlor_typ_t::LEVEL_SET)    \
-    X(CHLOR_LEVEL_SET10,     sizeof(network_chlor_level10_set_t),   false, IC,      datalink_chlor_typ_t::LEVEL_SET10)  \
-    X(CHLOR_LEVEL_RESP,      sizeof(network_chlor_level_resp_t),    false, IC,      datalink_chlor_typ_t::LEVEL_RESP)   \
-    X(CHLOR_ICHLOR_BCAST,    sizeof(network_chlor_ichlor_bcast_t),  false, IC,      datalink_chlor_typ_t::ICHLOR_BCAST)
+    X(IGNORE,                1,                                     false, A5_PUMP, datalink_pump_typ_t::REJECTING,       raw)                     \
+    X(PUMP_REG_SET,          sizeof(network_pump_reg_set_t),        true,  A5_PUMP, datalink_pump_typ_t::REG,             a5.pump_reg_set)         \
+    X(PUMP_REG_RESP,         sizeof(network_pump_reg_resp_t),       false, A5_PUMP, datalink_pump_typ_t::REG,             a5.pump_reg_resp)        \
+    X(PUMP_REG_VF_SET,       sizeof(network_pump_reg_set_t),        true,  A5_PUMP, datalink_pump_typ_t::REG_VF,          a5.pump_reg_set)         \
+    X(PUMP_REG_VF_RESP,      sizeof(network_pump_reg_resp_t),       false, A5_PUMP, datalink_pump_typ_t::REG_VF,          a5.pump_reg_resp)        \
+    X(PUMP_REG_VS_SET,       sizeof(network_pump_reg_set_t),        true,  A5_PUMP, datalink_pump_typ_t::REG_VS,          a5.pump_reg_set)         \
+    X(PUMP_REG_VS_RESP,      sizeof(network_pump_reg_resp_t),       false, A5_PUMP, datalink_pump_typ_t::REG_VS,          a5.pump_reg_resp)        \
+    X(PUMP_REMOTE_CTRL_SET,  sizeof(network_pump_ctrl_t),           true,  A5_PUMP, datalink_pump_typ_t::REMOTE_CTRL,     a5.pump_ctrl)            \
+    X(PUMP_REMOTE_CTRL_RESP, sizeof(network_pump_ctrl_t),           false, A5_PUMP, datalink_pump_typ_t::REMOTE_CTRL,     a5.pump_ctrl)            \
+    X(PUMP_RUN_MODE_SET,     sizeof(network_pump_run_mode_t),       true,  A5_PUMP, datalink_pump_typ_t::RUN_MODE,        a5.pump_mode)            \
+    X(PUMP_RUN_MODE_RESP,    sizeof(network_pump_run_mode_t),       false, A5_PUMP, datalink_pump_typ_t::RUN_MODE,        a5.pump_mode)            \
+    X(PUMP_RUN_SET,          sizeof(network_pump_running_t),        true,  A5_PUMP, datalink_pump_typ_t::RUN,             a5.pump_running)         \
+    X(PUMP_RUN_RESP,         sizeof(network_pump_running_t),        false, A5_PUMP, datalink_pump_typ_t::RUN,             a5.pump_running)         \
+    X(PUMP_STATUS_REQ,       0,                                     true,  A5_PUMP, datalink_pump_typ_t::STATUS,          raw)                     \
+    X(PUMP_STATUS_RESP,      sizeof(network_pump_status_resp_t),    false, A5_PUMP, datalink_pump_typ_t::STATUS,          a5.pump_status_resp)     \
+    X(CTRL_SET_ACK,          sizeof(network_ctrl_set_ack_t),        false, A5_CTRL, datalink_ctrl_typ_t::SET_ACK,         a5.ctrl_set_ack)         \
+    X(CTRL_CIRCUIT_SET,      sizeof(network_ctrl_circuit_set_t),    false, A5_CTRL, datalink_ctrl_typ_t::CIRCUIT_SET,     a5.ctrl_circuit_set)     \
+    X(CTRL_SCHED_REQ,        0,                                     false, A5_CTRL, datalink_ctrl_typ_t::SCHED_REQ,       raw)                     \
+    X(CTRL_SCHED_RESP,       sizeof(network_ctrl_sched_resp_t),     false, A5_CTRL, datalink_ctrl_typ_t::SCHED_RESP,      a5.ctrl_sched_resp)      \
+    X(CTRL_STATE_BCAST,      sizeof(network_ctrl_state_bcast_t),    false, A5_CTRL, datalink_ctrl_typ_t::STATE_BCAST,     a5.ctrl_state_bcast)     \
+    X(CTRL_TIME_REQ,         0,                                     false, A5_CTRL, datalink_ctrl_typ_t::TIME_REQ,        raw)                     \
+    X(CTRL_TIME_RESP,        sizeof(network_ctrl_time_t),           false, A5_CTRL, datalink_ctrl_typ_t::TIME_RESP,       a5.ctrl_time)            \
+    X(CTRL_TIME_SET,         sizeof(network_ctrl_time_t),           false, A5_CTRL, datalink_ctrl_typ_t::TIME_SET,        a5.ctrl_time)            \
+    X(CTRL_HEAT_REQ,         0,                                     false, A5_CTRL, datalink_ctrl_typ_t::HEAT_REQ,        raw)                     \
+    X(CTRL_HEAT_RESP,        sizeof(network_ctrl_heat_resp_t),      false, A5_CTRL, datalink_ctrl_typ_t::HEAT_RESP,       a5.ctrl_heat_resp)       \
+    X(CTRL_HEAT_SET,         sizeof(network_ctrl_heat_set_t),       false, A5_CTRL, datalink_ctrl_typ_t::HEAT_SET,        a5.ctrl_heat_set)        \
+    X(CTRL_LAYOUT_REQ,       0,                                     false, A5_CTRL, datalink_ctrl_typ_t::LAYOUT_REQ,      raw)                     \
+    X(CTRL_LAYOUT_RESP,      sizeof(network_ctrl_layout_t),         false, A5_CTRL, datalink_ctrl_typ_t::LAYOUT_RESP,     a5.ctrl_layout_resp)     \
+    X(CTRL_LAYOUT_SET,       sizeof(network_ctrl_layout_t),         false, A5_CTRL, datalink_ctrl_typ_t::LAYOUT_SET,      a5.ctrl_layout_set)      \
+    X(CTRL_VALVE_REQ,        0,                                     false, A5_CTRL, datalink_ctrl_typ_t::VALVE_REQ,       raw)                     \
+    X(CTRL_VALVE_RESP,       sizeof(network_ctrl_valve_resp_t),     false, A5_CTRL, datalink_ctrl_typ_t::VALVE_RESP,      a5.ctrl_valve_resp)      \
+    X(CTRL_VERSION_REQ,      0,                                     false, A5_CTRL, datalink_ctrl_typ_t::VERSION_REQ,     raw)                     \
+    X(CTRL_VERSION_RESP,     sizeof(network_ctrl_version_resp_t),   false, A5_CTRL, datalink_ctrl_typ_t::VERSION_RESP,    a5.ctrl_version_resp)    \
+    X(CTRL_SOLARPUMP_REQ,    0,                                     false, A5_CTRL, datalink_ctrl_typ_t::SOLARPUMP_REQ,   raw)                     \
+    X(CTRL_SOLARPUMP_RESP,   sizeof(network_ctrl_solarpump_resp_t), false, A5_CTRL, datalink_ctrl_typ_t::SOLARPUMP_RESP,  a5.ctrl_solarpump_resp)  \
+    X(CTRL_DELAY_REQ,        0,                                     false, A5_CTRL, datalink_ctrl_typ_t::DELAY_REQ,       raw)                     \
+    X(CTRL_DELAY_RESP,       sizeof(network_ctrl_delay_resp_t),     false, A5_CTRL, datalink_ctrl_typ_t::DELAY_RESP,      a5.ctrl_delay_resp)      \
+    X(CTRL_HEAT_SETPT_REQ,   0,                                     false, A5_CTRL, datalink_ctrl_typ_t::HEAT_SETPT_REQ,  raw)                     \
+    X(CTRL_HEAT_SETPT_RESP,  sizeof(network_ctrl_heat_setpt_resp_t),false, A5_CTRL, datalink_ctrl_typ_t::HEAT_SETPT_RESP, a5.ctrl_heat_setpt_resp) \
+    X(CTRL_CIRC_NAMES_REQ,   sizeof(network_ctrl_circ_names_req_t), false, A5_CTRL, datalink_ctrl_typ_t::CIRC_NAMES_REQ,  a5.ctrl_circ_names_req)  \
+    X(CTRL_CIRC_NAMES_RESP,  sizeof(network_ctrl_circ_names_resp_t),false, A5_CTRL, datalink_ctrl_typ_t::CIRC_NAMES_RESP, a5.ctrl_circ_names_resp) \
+    X(CTRL_SCHEDS_REQ,       sizeof(network_ctrl_scheds_req_t),     false, A5_CTRL, datalink_ctrl_typ_t::SCHEDS_REQ,      a5.ctrl_scheds_req)      \
+    X(CTRL_SCHEDS_RESP,      sizeof(network_ctrl_scheds_resp_t),    false, A5_CTRL, datalink_ctrl_typ_t::SCHEDS_RESP,     a5.ctrl_scheds_resp)     \
+    X(CTRL_CHEM_REQ,         sizeof(network_ctrl_chem_req_t),       false, A5_CTRL, datalink_ctrl_typ_t::CHEM_REQ,        a5.ctrl_chem_req)        \
+    X(CHLOR_CONTROL_REQ,     sizeof(network_chlor_control_req_t),   false, IC,      datalink_chlor_typ_t::CONTROL_REQ,    ic.chlor_control_req)    \
+    X(CHLOR_CONTROL_RESP,    sizeof(network_chlor_control_resp_t),  false, IC,      datalink_chlor_typ_t::CONTROL_RESP,   ic.chlor_status_resp)    \
+    X(CHLOR_MODEL_REQ,       sizeof(network_chlor_model_req_t),     false, IC,      datalink_chlor_typ_t::MODEL_REQ,      ic.chlor_model_req)      \
+    X(CHLOR_MODEL_RESP,      sizeof(network_chlor_model_resp_t),    false, IC,      datalink_chlor_typ_t::MODEL_RESP,     ic.chlor_model_resp)     \
+    X(CHLOR_LEVEL_SET,       sizeof(network_chlor_level_set_t),     false, IC,      datalink_chlor_typ_t::LEVEL_SET,      ic.chlor_level_set)      \
+    X(CHLOR_LEVEL_SET10,     sizeof(network_chlor_level10_set_t),   false, IC,      datalink_chlor_typ_t::LEVEL_SET10,    ic.chlor_level10_set)    \
+    X(CHLOR_LEVEL_RESP,      sizeof(network_chlor_level_resp_t),    false, IC,      datalink_chlor_typ_t::LEVEL_RESP,     ic.chlor_level_resp)     \
+    X(CHLOR_ICHLOR_BCAST,    sizeof(network_chlor_ichlor_bcast_t),  false, IC,      datalink_chlor_typ_t::ICHLOR_BCAST,   ic.chlor_ichlor_bcast)
 
 /**
  * @brief Enumerates all supported network message types for OPNpool.
@@ -617,11 +635,30 @@ union network_data_t {
  * NETWORK_MSG_TYP_LIST X-Macro.
  */
 enum class network_msg_typ_t : uint8_t {
-#define X_ENUM(name, size, is_to_pump, proto, typ) name,
+#define X_ENUM(name, size, is_to_pump, proto, typ, data) name,
     NETWORK_MSG_TYP_LIST(X_ENUM)
 #undef X_ENUM
 };
 
+/// @brief Names of the network_msg_typ_t values, for enum_str() and enum_lookup(). Generated from NETWORK_MSG_TYP_LIST X-Macro.
+inline constexpr std::string_view network_msg_typ_names[] = {
+#define X_NAME(name, size, is_to_pump, proto, typ, data) #name,
+    NETWORK_MSG_TYP_LIST(X_NAME)
+#undef X_NAME
+};
+ENUM_HELPERS_NAMES(network_msg_typ_t, network_msg_typ_names)
+
+/**
+ * @brief Layout of a network message payload.
+ *
+ * @details
+ * See NETWORK_MSG_LAYOUT_LIST.
+ */
+enum class network_msg_layout_t : uint8_t {
+    BASE     = 0,  ///< Payload length matches the struct in NETWORK_MSG_TYP_LIST.
+    EXTENDED = 1   ///< Known prefix followed by firmware-dependent bytes.
+};
+
 /**
  * @brief Metadata structure for network message types.
  *
@@ -651,7 +688,7 @@ struct network_msg_typ_info_t {
 
     // maps {datalink_prot and datalink_typ_t} to network_msg_typ_t.
 constexpr network_msg_typ_info_t network_msg_typ_info[] = {
-#define X_INFO(name, size, is_to_pump, proto, typ) {datalink_prot_t::proto, typ, size, is_to_pump, network_msg_typ_t::name},
+#define X_INFO(name, size, is_to_pump, proto, typ, data) {datalink_prot_t::proto, typ, size, is_to_pump, network_msg_typ_t::name},
     NETWORK_MSG_TYP_LIST(X_INFO)
 #undef X_INFO
 };
@@ -727,6 +764,45 @@ network_msg_typ_get_info(datalink_chlor_typ_t const chlor_typ)
     return nullptr;
 }
 
+/// @brief Range of payload lengths for a firmware-dependent layout.
+struct network_msg_layout_info_t {
+    network_msg_typ_t    typ;
+    network_msg_layout_t layout;
+    uint8_t              min_size;
+    uint8_t              max_size;
+};
+
+constexpr network_msg_layout_info_t network_msg_layout_info[] = {
+#define X_LAYOUT(name, layout, min_size, max_size) \
+    {network_msg_typ_t::name, network_msg_layout_t::layout, min_size, max_size},
+    NETWORK_MSG_LAYOUT_LIST(X_LAYOUT)
+#undef X_LAYOUT
+};
+
+/**
+ * @brief            Selects the layout of a received payload by its length.
+ *
+ * @param[in]  info   Message type info, as found by network_msg_typ_get_info().
+ * @param[in]  len    Payload length as received.
+ * @param[out] layout Receives the layout.
+ * @return            True if the length matches a known layout of the message type.
+ */
+[[nodiscard]] constexpr bool
+network_msg_layout_get(network_msg_typ_info_t const * const info, size_t const len, network_msg_layout_t * const layout)
+{
+    if (len == info->size) {
+        *layout = network_msg_layout_t::BASE;
+        return true;
+    }
+    for (auto const & row : network_msg_layout_info) {
+        if (row.typ == info->network_msg_typ && len >= row.min_size && len <= row.max_size) {
+            *layout = row.layout;
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * @brief Represents a generic network message for the Pentair protocol.
  *
@@ -735,21 +811,70 @@ network_msg_typ_get_info(datalink_chlor_typ_t const chlor_typ)
  * structures, allowing flexible handling of controller, pump, and chlorinator messages.
  */
 struct network_msg_t {
-    datalink_addr_t    src;  ///< source address from datalink_hdr
-    datalink_addr_t    dst;  ///< destination address from datalink_hdr
-    network_msg_typ_t  typ;  ///< The network message type identifier.
-    network_data_t     u;    ///< Union containing all supported message data structures for A5/controller, A5/pump, and IC messages.
+    datalink_addr_t      src;     ///< source address from datalink_hdr
+    datalink_addr_t      dst;     ///< destination address from datalink_hdr
+    network_msg_typ_t    typ;     ///< The network message type identifier.
+    network_msg_layout_t layout;  ///< Layout of the payload, BASE for messages we create.
+    uint8_t              len;     ///< Payload length as received, 0 for messages we create.
+    uint8_t              burst;   ///< Number of messages after this one to transmit in the same window, 0 if none.
+    network_data_t       u;       ///< Union containing all supported message data structures for A5/controller, A5/pump, and IC messages.
 };
 
+/**
+ * @brief A packet queued for transmission, together with the message it was created from.
+ *
+ * @details
+ * The datalink and RS-485 layers only see `pkt`, and free it as a single allocation.
+ * After the packet is written to the bus, the pool_task forwards `msg` to the main task
+ * as is, instead of decoding the bytes that it just created.
+ */
+struct network_tx_pkt_t {
+    datalink_pkt_t pkt;  ///< MUST be the first member, so &pkt is the start of the allocation.
+    network_msg_t  msg;  ///< The message that pkt was created from.
+};
+
+/**
+ * @brief Typed access to the payload of a network message.
+ *
+ * @details
+ * For message type TYP, `network_msg_data<TYP>::type` is the payload struct, and
+ * `network_msg_data<TYP>::get(msg->u)` returns the network_data_t member that holds it.
+ * Generated from the DATA_MEMBER column of NETWORK_MSG_TYP_LIST, so a handler can't be
+ * given the wrong union member.
+ */
+template<network_msg_typ_t TYP> struct network_msg_data;
+
+#define X_DATA(name, size, is_to_pump, proto, typ, data)                                   \
+    template<> struct network_msg_data<network_msg_typ_t::name> {                          \
+        using type = std::remove_reference_t<decltype(std::declval<network_data_t>().data)>; \
+        static type const & get(network_data_t const & u) { return u.data; }               \
+    };
+NETWORK_MSG_TYP_LIST(X_DATA)
+#undef X_DATA
+
     // sanity checks
 static_assert(sizeof(uint8_heat_status_t) == 1, "uint8_heat_status_t must be 1 byte");
 static_assert(sizeof(uint8_heat_src_t)    == 1, "uint8_heat_src_t must be 1 byte");
 static_assert(sizeof(network_data_t)      <= UINT8_MAX, "network_data_t size exceeds UINT8_MAX");
 static_assert(std::size(network_msg_typ_info) == enum_count<network_msg_typ_t>());
+#define X_DATA_SIZE(name, size, is_to_pump, proto, typ, data)                   \
+    static_assert(std::is_array_v<network_msg_data<network_msg_typ_t::name>::type> || \
+                  sizeof(network_msg_data<network_msg_typ_t::name>::type) == size,  \
+                  "DATA_MEMBER doesn't match SIZE_EXPR for " #name);
+NETWORK_MSG_TYP_LIST(X_DATA_SIZE)
+#undef X_DATA_SIZE
 static_assert(network_msg_typ_get_info(datalink_pump_typ_t::STATUS, true)  == &network_msg_typ_info[enum_index(network_msg_typ_t::PUMP_STATUS_REQ)]);
 static_assert(network_msg_typ_get_info(datalink_pump_typ_t::STATUS, false) == &network_msg_typ_info[enum_index(network_msg_typ_t::PUMP_STATUS_RESP)]);
 static_assert(network_msg_typ_get_info(datalink_ctrl_typ_t::STATE_BCAST)   == &network_msg_typ_info[enum_index(network_msg_typ_t::CTRL_STATE_BCAST)]);
 static_assert(network_msg_typ_get_info(datalink_chlor_typ_t::LEVEL_RESP)   == &network_msg_typ_info[enum_index(network_msg_typ_t::CHLOR_LEVEL_RESP)]);
+#define X_LAYOUT_SIZE(name, layout, min_size, max_size)                                                    \
+    static_assert(min_size > network_msg_typ_info[enum_index(network_msg_typ_t::name)].size &&              \
+                  min_size <= max_size && max_size <= DATALINK_MAX_DATA_SIZE,                                \
+                  "bad size range for " #name " " #layout);
+NETWORK_MSG_LAYOUT_LIST(X_LAYOUT_SIZE)
+#undef X_LAYOUT_SIZE
+static_assert(std::is_standard_layout_v<network_tx_pkt_t> && offsetof(network_tx_pkt_t, pkt) == 0,
+              "network_tx_pkt_t::pkt must be at the start of the allocation");
 
 }  // namespace opnpool
 }  // namespace esphome
\ No newline at end of file
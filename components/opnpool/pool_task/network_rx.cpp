@@ -26,6 +26,7 @@
 #include "datalink_pkt.h"
 #include "network.h"
 #include "network_msg.h"
+#include "network_capture.h"
 #pragma GCC diagnostic error "-Wall"
 #pragma GCC diagnostic error "-Wextra"
 #pragma GCC diagnostic error "-Wunused-parameter"
@@ -35,6 +36,44 @@ namespace opnpool {
 
 constexpr char TAG[] = "network_rx";
 
+/**
+ * @brief          Check the payload length and copy the packet into a network message.
+ *
+ * @details
+ * A payload that is longer than the message struct is accepted when its length matches a
+ * layout in NETWORK_MSG_LAYOUT_LIST. The struct overlays the start of the payload, so the
+ * known prefix decodes as usual and the extra bytes follow it in msg->u.raw. Such frames
+ * are also captured, so their extra bytes can be studied.
+ *
+ * @param[in]  pkt  Pointer to the datalink packet to decode.
+ * @param[in]  info Message type info for the packet.
+ * @param[out] msg  Pointer to the network message structure to populate.
+ * @return          ESP_OK if the length matches a known layout, ESP_FAIL otherwise.
+ */
+[[nodiscard]] static esp_err_t
+_decode_payload(datalink_pkt_t const * const pkt, network_msg_typ_info_t const * const info, network_msg_t * const msg)
+{
+    network_msg_layout_t layout;
+    if (!network_msg_layout_get(info, pkt->data_len, &layout)) {
+        ESP_LOGW(TAG, "%s invalid length: expected %lu, got %u", enum_str(info->network_msg_typ), static_cast<unsigned long>(info->size), pkt->data_len);
+        network_capture_add(pkt, network_capture_reason_t::BAD_LENGTH);
+        return ESP_FAIL;
+    }
+    if (layout != network_msg_layout_t::BASE) {
+        ESP_LOGV(TAG, "%s %s layout, %u bytes", enum_str(info->network_msg_typ), enum_str(layout), pkt->data_len);
+        network_capture_add(pkt, network_capture_reason_t::EXTRA_BYTES, info->size);
+    }
+
+    msg->typ       = info->network_msg_typ;
+    msg->src       = pkt->src;
+    msg->dst       = pkt->dst;
+    msg->layout    = layout;
+    msg->len       = static_cast<uint8_t>(pkt->data_len);
+    msg->burst     = 0;
+    memcpy(msg->u.raw, pkt->data, pkt->data_len);  // saves lots of code to using a union-aware switch
+    return ESP_OK;
+}
+
 /**
  * @brief          Decode an A5_PUMP datalink packet to form a network message.
  *
@@ -52,20 +91,14 @@ _decode_msg_a5_pump(datalink_pkt_t const * const pkt, network_msg_t * const msg)
     network_msg_typ_info_t const * const info = network_msg_typ_get_info(datalink_pump_typ, is_to_pump);
     if (info == nullptr) {
         ESP_LOGW(TAG, "unsupported pump_typ (%s) ", enum_str(datalink_pump_typ));
+        network_capture_add(pkt, network_capture_reason_t::UNSUPPORTED_TYP);
         return ESP_FAIL;
     }
 
-    if (pkt->data_len != info->size) {
-
-        ESP_LOGW(TAG, "{%s %u} => %s invalid length: expected %lu, got %u", enum_str(datalink_pump_typ), is_to_pump, enum_str(msg->typ), info->size, pkt->data_len);
+    if (_decode_payload(pkt, info, msg) != ESP_OK) {
         return ESP_FAIL;
     }
 
-    msg->typ       = info->network_msg_typ;
-    msg->src       = pkt->src;
-    msg->dst       = pkt->dst;
-    memcpy(msg->u.raw, pkt->data, pkt->data_len);  // saves lots of code to using a union-aware switch
-
     ESP_LOGVV(TAG, "%s: decoded A5_PUMP msg typ %s", __FUNCTION__, enum_str(msg->typ));
     return ESP_OK;
 }
@@ -86,19 +119,14 @@ _decode_msg_a5_ctrl(datalink_pkt_t const * const pkt, network_msg_t * const msg)
     network_msg_typ_info_t const * const info = network_msg_typ_get_info(datalink_ctrl_typ);
     if (info == nullptr) {
         ESP_LOGW(TAG, "unsupported ctrl_typ (%s) ", enum_str(datalink_ctrl_typ));
+        network_capture_add(pkt, network_capture_reason_t::UNSUPPORTED_TYP);
         return ESP_FAIL;
     }
 
-    if (pkt->data_len != info->size) {
-        ESP_LOGW(TAG, "%s => %s invalid length: expected %lu, got %u", enum_str(datalink_ctrl_typ), enum_str(msg->typ), info->size, pkt->data_len);
+    if (_decode_payload(pkt, info, msg) != ESP_OK) {
         return ESP_FAIL;
     }
 
-    msg->typ       = info->network_msg_typ;
-    msg->src       = pkt->src;
-    msg->dst       = pkt->dst;
-    memcpy(msg->u.raw, pkt->data, pkt->data_len);  // saves lots of code to using a union-aware switch
-
     ESP_LOGVV(TAG, "%s: decoded A5_CTRL msg typ %s", __FUNCTION__, enum_str(msg->typ));
     return ESP_OK;
 }
@@ -119,19 +147,14 @@ _decode_msg_ic_chlor(datalink_pkt_t const * const pkt, network_msg_t * const msg
     network_msg_typ_info_t const * const info = network_msg_typ_get_info(datalink_chlor_typ);
     if (info == nullptr) {
         ESP_LOGW(TAG, "unsupported chlor_typ (%s) ", enum_str(datalink_chlor_typ));
+        network_capture_add(pkt, network_capture_reason_t::UNSUPPORTED_TYP);
         return ESP_FAIL;
     }
 
-    if (pkt->data_len != info->size) {
-        ESP_LOGW(TAG, "%s => %s invalid length: expected %lu, got %u", enum_str(datalink_chlor_typ), enum_str(msg->typ), info->size, pkt->data_len);
+    if (_decode_payload(pkt, info, msg) != ESP_OK) {
         return ESP_FAIL;
     }
 
-    msg->typ       = info->network_msg_typ;
-    msg->src       = pkt->src;
-    msg->dst       = pkt->dst;
-    memcpy(msg->u.raw, pkt->data, pkt->data_len);  // saves lots of code to using a union-aware switch
-
     ESP_LOGVV(TAG, "%s: decoded IC msg typ %s", __FUNCTION__, enum_str(msg->typ));
     return ESP_OK;
 }
@@ -146,8 +169,7 @@ _decode_msg_ic_chlor(datalink_pkt_t const * const pkt, network_msg_t * const msg
  * transmission opportunity flag if the decoded message allows for a response.
  *
  * Packets with unsupported or irrelevant destination groups are ignored. The function
- * resets the string conversion mechanism for entity names and logs decoding results for
- * debugging.
+ * logs decoding results for debugging.
  *
  * @param[in]  pkt           Pointer to the datalink packet to decode.
  * @param[out] msg           Pointer to the network message structure to populate.
@@ -158,9 +180,6 @@ _decode_msg_ic_chlor(datalink_pkt_t const * const pkt, network_msg_t * const msg
 esp_err_t
 network_rx_msg(datalink_pkt_t const * const pkt, network_msg_t * const msg, bool * const txOpportunity)
 {
-        // reset mechanism that converts various formats to string
-    name_reset_idx();
-
 #if 0
         (pkt->prot == datalink_prot_t::IC && dst != datalink_group_addr_t::ALL && dst != datalink_group_addr_t::CHLOR)) {
 #endif    
@@ -0,0 +1,364 @@
+/**
+ * @file poll_sched.cpp
+ * @brief Pool task: staleness-driven scheduling of controller requests
+ *
+ * @details
+ * Implements the scheduler declared in poll_sched.h. Each poll type has a deadline. A
+ * reply from the controller moves it a full interval ahead, a related command pulls it
+ * in to shortly after the command, and sending the poll moves it ahead by the retry
+ * interval in case the reply gets lost. The retry interval doubles while the controller
+ * doesn't answer, so requests that a controller doesn't support fade to the background.
+ *
+ * During discovery, the spacing is not applied. The pool_task only queues a request when
+ * the transmit queue is empty, so discovery requests go out one per transmit window.
+ * Discovery ends when each of its requests was answered, or after POLL_DISCOVERY_MS.
+ *
+ * PUMP keeps its deadline and retry interval per pump, and a reply from a pump only
+ * refreshes that pump. PUMP is due when one of its pumps is, and competes with the other
+ * poll types by its most overdue pump. The request then goes to the first due pump after
+ * the one asked last, so each due pump is asked in turn.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <esp_system.h>
+#include <esp_types.h>
+#include <esphome/core/log.h>
+
+#include "utils/enum_helpers.h"
+#include "datalink.h"
+#include "network_msg.h"
+#include "poll_sched.h"
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wunused-parameter"
+
+namespace esphome {
+namespace opnpool {
+
+constexpr char TAG[] = "poll_sched";
+
+constexpr uint32_t POLL_RETRY_MS           = 30 * 1000;  ///< Initial time before an unanswered poll is repeated [ms]
+constexpr uint32_t POLL_DISCOVERY_MS       = 30 * 1000;  ///< Maximum duration of the discovery phase [ms]
+constexpr uint32_t POLL_DISCOVERY_RETRY_MS = 5 * 1000;   ///< Time before an unanswered discovery poll is repeated [ms]
+
+    // request to send for each poll type, indexed by poll_typ_t
+constexpr network_msg_typ_t _req_typ[] = {
+    network_msg_typ_t::CTRL_VERSION_REQ,
+    network_msg_typ_t::CTRL_TIME_REQ,
+    network_msg_typ_t::CTRL_HEAT_REQ,
+    network_msg_typ_t::CTRL_SCHED_REQ,
+    network_msg_typ_t::CTRL_LAYOUT_REQ,
+    network_msg_typ_t::CTRL_VALVE_REQ,
+    network_msg_typ_t::CTRL_CIRC_NAMES_REQ,
+    network_msg_typ_t::PUMP_STATUS_REQ,
+};
+static_assert(sizeof(_req_typ) / sizeof(_req_typ[0]) == enum_count<poll_typ_t>(), "_req_typ doesn't match poll_typ_t");
+
+/// @brief How a message affects a poll type.
+struct poll_trigger_t {
+    network_msg_typ_t typ;    ///< Message type.
+    poll_typ_t        poll;   ///< Poll type it affects.
+    bool              boost;  ///< True if it changes the data, false if it carries it.
+};
+
+constexpr poll_trigger_t _triggers[] = {
+    {network_msg_typ_t::CTRL_VERSION_RESP,    poll_typ_t::VERSION,    false},
+    {network_msg_typ_t::CTRL_TIME_RESP,       poll_typ_t::TIME,       false},
+    {network_msg_typ_t::CTRL_STATE_BCAST,     poll_typ_t::TIME,       false},
+    {network_msg_typ_t::CTRL_TIME_SET,        poll_typ_t::TIME,       true},
+    {network_msg_typ_t::CTRL_HEAT_RESP,       poll_typ_t::HEAT,       false},
+    {network_msg_typ_t::CTRL_HEAT_SET,        poll_typ_t::HEAT,       true},
+    {network_msg_typ_t::CTRL_SCHED_RESP,      poll_typ_t::SCHED,      false},
+    {network_msg_typ_t::CTRL_LAYOUT_RESP,     poll_typ_t::LAYOUT,     false},
+    {network_msg_typ_t::CTRL_LAYOUT_SET,      poll_typ_t::LAYOUT,     true},
+    {network_msg_typ_t::CTRL_VALVE_RESP,      poll_typ_t::VALVE,      false},
+    {network_msg_typ_t::CTRL_CIRC_NAMES_RESP, poll_typ_t::CIRC_NAMES, false},
+    {network_msg_typ_t::PUMP_STATUS_RESP,     poll_typ_t::PUMP,       false},
+};
+
+    // requests that complete the dashboard, in the order they are sent at boot
+constexpr poll_typ_t _discovery[] = {
+    poll_typ_t::VERSION,
+    poll_typ_t::HEAT,
+    poll_typ_t::SCHED,
+    poll_typ_t::TIME,
+    poll_typ_t::PUMP,
+};
+
+/// @brief Phase of the scheduler.
+enum class poll_phase_t : uint8_t {
+    WAITING     = 0,  ///< Waiting for the first state broadcast.
+    DISCOVERING = 1,  ///< Sending the discovery requests back to back.
+    STEADY      = 2   ///< Polling at the configured intervals.
+};
+
+static poll_config_t _config = {};
+static uint32_t _due_ms[enum_count<poll_typ_t>()] = {};
+static uint32_t _retry_ms[enum_count<poll_typ_t>()] = {};
+static uint32_t _last_poll_ms = 0;
+static bool _polled = false;
+static poll_phase_t _phase = poll_phase_t::WAITING;
+static uint32_t _discovery_start_ms = 0;
+static uint16_t _answered = 0;  // bit per poll_typ_t, set once a reply was seen
+static_assert(enum_count<poll_typ_t>() <= sizeof(_answered) * 8, "_answered too small for poll_typ_t");
+
+    // PUMP, per pump
+static uint32_t _pump_due_ms[enum_count<datalink_pump_id_t>()] = {};
+static uint32_t _pump_retry_ms[enum_count<datalink_pump_id_t>()] = {};
+static uint16_t _pumps_answered = 0;  // bit per datalink_pump_id_t, set once a reply was seen
+static uint8_t _last_pump = 0;        // pump asked last
+static_assert(enum_count<datalink_pump_id_t>() <= sizeof(_pumps_answered) * 8, "_pumps_answered too small for datalink_pump_id_t");
+
+    // wrap-safe "a is at or after b" for millis() timestamps
+static inline bool
+_reached(uint32_t const a, uint32_t const b)
+{
+    return static_cast<int32_t>(a - b) >= 0;
+}
+
+    // true once a reply was seen; for PUMP, from each polled pump
+static bool
+_is_answered(poll_typ_t const poll)
+{
+    if (poll == poll_typ_t::PUMP) {
+        return (_pumps_answered & _config.pumps) == _config.pumps;
+    }
+    return _answered & (1U << enum_index(poll));
+}
+
+    // the polled pump to ask next: the first due one after the pump asked last, so the
+    // pumps take turns; *overdue_ms receives how late the most overdue one is
+static int8_t
+_due_pump(uint32_t const now_ms, bool const unanswered_only, uint32_t * const overdue_ms)
+{
+    int8_t pick = -1;
+    *overdue_ms = 0;
+    constexpr uint8_t count = enum_count<datalink_pump_id_t>();
+    for (uint8_t step = 1; step <= count; step++) {
+        uint8_t const id = (_last_pump + step) % count;
+        uint16_t const bit = 1U << id;
+        if (!(_config.pumps & bit) || (unanswered_only && (_pumps_answered & bit)) || !_reached(now_ms, _pump_due_ms[id])) {
+            continue;
+        }
+        if (pick < 0) {
+            pick = static_cast<int8_t>(id);
+        }
+        if (now_ms - _pump_due_ms[id] > *overdue_ms) {
+            *overdue_ms = now_ms - _pump_due_ms[id];
+        }
+    }
+    return pick;
+}
+
+static void
+_start_discovery(uint32_t const now_ms)
+{
+    for (auto & due_ms : _due_ms) {
+        due_ms = now_ms;
+    }
+    for (auto & due_ms : _pump_due_ms) {
+        due_ms = now_ms;
+    }
+    _discovery_start_ms = now_ms;
+    _phase = poll_phase_t::DISCOVERING;
+    ESP_LOGV(TAG, "discovery started");
+}
+
+    // discovery is done when all its requests were answered, or time is up
+static void
+_check_discovery(uint32_t const now_ms)
+{
+    bool done = _reached(now_ms, _discovery_start_ms + POLL_DISCOVERY_MS);
+    if (!done) {
+        done = true;
+        for (auto const poll : _discovery) {
+            if (_config.every_ms[enum_index(poll)] != 0 && !_is_answered(poll)) {
+                done = false;
+                break;
+            }
+        }
+    }
+    if (done) {
+        _phase = poll_phase_t::STEADY;
+        ESP_LOGI(TAG, "discovery done in %lu ms, answered 0x%02X",
+                 static_cast<unsigned long>(now_ms - _discovery_start_ms), _answered);
+    }
+}
+
+void
+poll_sched_init(poll_config_t const * const config, uint32_t const now_ms)
+{
+    if (!config) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return;
+    }
+    _config = *config;
+    for (uint8_t idx = 0; idx < enum_count<poll_typ_t>(); idx++) {
+        _due_ms[idx] = now_ms;
+        _retry_ms[idx] = POLL_RETRY_MS;
+    }
+    for (uint8_t id = 0; id < enum_count<datalink_pump_id_t>(); id++) {
+        _pump_due_ms[id] = now_ms;
+        _pump_retry_ms[id] = POLL_RETRY_MS;
+    }
+    _polled = false;
+    _phase = poll_phase_t::WAITING;
+    _answered = 0;
+    _pumps_answered = 0;
+    _last_pump = enum_count<datalink_pump_id_t>() - 1;  // so PRIMARY goes first
+}
+
+void
+poll_sched_observe(network_msg_t const * const msg, uint32_t const now_ms)
+{
+    if (!msg) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return;
+    }
+
+    if (_phase == poll_phase_t::WAITING && msg->typ == network_msg_typ_t::CTRL_STATE_BCAST && msg->src.is_controller()) {
+        _start_discovery(now_ms);
+    }
+
+    for (auto const & trigger : _triggers) {
+        if (trigger.typ != msg->typ) {
+            continue;
+        }
+        uint8_t const idx = enum_index(trigger.poll);
+        if (trigger.poll == poll_typ_t::PUMP) {
+            if (msg->src.is_pump()) {
+                    // fresh data from this pump, whoever asked for it
+                uint8_t const id = enum_index(msg->src.get_pump_id());
+                _pump_due_ms[id] = now_ms + _config.every_ms[idx];
+                _pump_retry_ms[id] = POLL_RETRY_MS;
+                _pumps_answered |= 1U << id;
+                _answered |= 1U << idx;
+            }
+            continue;
+        }
+        uint32_t & due_ms = _due_ms[idx];
+
+        if (trigger.boost) {
+                // confirm the change shortly after the controller processed it
+            uint32_t const boost_ms = now_ms + _config.boost_after_ms;
+            if (_reached(due_ms, boost_ms)) {
+                due_ms = boost_ms;
+                ESP_LOGV(TAG, "boost %s", enum_str(trigger.poll));
+            }
+        } else if (msg->src.is_controller() || msg->src.is_pump()) {
+                // fresh data, whoever asked for it
+            due_ms = now_ms + _config.every_ms[idx];
+            _retry_ms[idx] = POLL_RETRY_MS;
+            _answered |= 1U << idx;
+        }
+    }
+}
+
+bool
+poll_sched_next(uint32_t const now_ms, network_msg_t * const msg)
+{
+    if (!msg) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return false;
+    }
+    if (_phase == poll_phase_t::WAITING) {
+        return false;
+    }
+    if (_phase == poll_phase_t::DISCOVERING) {
+        _check_discovery(now_ms);
+    }
+
+    int8_t pick = -1;
+    int8_t pick_pump = -1;
+    uint32_t pick_overdue_ms = 0;
+
+    if (_phase == poll_phase_t::DISCOVERING) {
+
+            // first unanswered discovery request, without spacing
+        for (auto const poll : _discovery) {
+            uint8_t const idx = enum_index(poll);
+            if (_config.every_ms[idx] == 0) {
+                continue;
+            }
+            if (poll == poll_typ_t::PUMP) {
+                pick_pump = _due_pump(now_ms, true, &pick_overdue_ms);
+                if (pick_pump >= 0) {
+                    pick = static_cast<int8_t>(idx);
+                    break;
+                }
+            } else if (!(_answered & (1U << idx)) && _reached(now_ms, _due_ms[idx])) {
+                pick = static_cast<int8_t>(idx);
+                pick_overdue_ms = now_ms - _due_ms[idx];
+                break;
+            }
+        }
+        if (pick < 0) {
+            return false;
+        }
+        (pick_pump >= 0 ? _pump_due_ms[pick_pump] : _due_ms[pick]) = now_ms + POLL_DISCOVERY_RETRY_MS;
+
+    } else {
+
+        if (_polled && !_reached(now_ms, _last_poll_ms + _config.spacing_ms)) {
+            return false;
+        }
+
+            // most overdue first
+        for (uint8_t idx = 0; idx < enum_count<poll_typ_t>(); idx++) {
+            if (_config.every_ms[idx] == 0) {
+                continue;
+            }
+            int8_t pump = -1;
+            uint32_t overdue_ms;
+            if (idx == enum_index(poll_typ_t::PUMP)) {
+                pump = _due_pump(now_ms, false, &overdue_ms);
+                if (pump < 0) {
+                    continue;
+                }
+            } else if (_reached(now_ms, _due_ms[idx])) {
+                overdue_ms = now_ms - _due_ms[idx];
+            } else {
+                continue;
+            }
+            if (pick < 0 || overdue_ms > pick_overdue_ms) {
+                pick = static_cast<int8_t>(idx);
+                pick_pump = pump;
+                pick_overdue_ms = overdue_ms;
+            }
+        }
+        if (pick < 0) {
+            return false;
+        }
+
+        uint32_t const every_ms = _config.every_ms[pick];
+        uint32_t & due_ms = pick_pump >= 0 ? _pump_due_ms[pick_pump] : _due_ms[pick];
+        uint32_t & retry_ms = pick_pump >= 0 ? _pump_retry_ms[pick_pump] : _retry_ms[pick];
+        due_ms = now_ms + (every_ms < retry_ms ? every_ms : retry_ms);
+        retry_ms = every_ms / 2 < retry_ms ? every_ms : retry_ms * 2;
+    }
+    _last_poll_ms = now_ms;
+    _polled = true;
+
+    *msg = {};
+    msg->typ = _req_typ[pick];
+    switch (msg->typ) {
+        case network_msg_typ_t::CTRL_CIRC_NAMES_REQ:
+            msg->u.a5.ctrl_circ_names_req.req_id = 0x01;  // first name only, the reply is only logged
+            break;
+        case network_msg_typ_t::PUMP_STATUS_REQ:
+            msg->dst = datalink_addr_t::pump(static_cast<datalink_pump_id_t>(pick_pump));
+            _last_pump = static_cast<uint8_t>(pick_pump);
+            break;
+        default:
+            break;
+    }
+    ESP_LOGV(TAG, "poll %s (0x%02X), %lu ms overdue", enum_str(static_cast<poll_typ_t>(pick)), msg->dst.addr,
+             static_cast<unsigned long>(pick_overdue_ms));
+    return true;
+}
+
+}  // namespace opnpool
+}  // namespace esphome
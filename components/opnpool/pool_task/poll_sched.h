@@ -0,0 +1,107 @@
+/**
+ * @file poll_sched.h
+ * @brief Pool task: staleness-driven scheduling of controller requests
+ *
+ * @details
+ * The controller broadcasts its state every second, but some data is only sent in reply
+ * to a request (set points, schedules, firmware version, ...). This scheduler decides
+ * when to send each of those requests.
+ *
+ * Each poll type has its own desired freshness. Any reply from the controller counts as
+ * a refresh, even when another device asked for it. So a poll is skipped when snooped
+ * traffic already brought the data up to date. When data is due, at most one request is
+ * sent per spacing interval, the most overdue first, so polls never come in bursts. A
+ * command that changes the data (e.g. HEAT_SET) makes the related poll due shortly
+ * after, so the new state is confirmed without waiting a full interval.
+ *
+ * The pump status is polled per pump, for each pump in poll_config_t::pumps. The pumps
+ * that are due take turns, so one slow or silent pump doesn't keep the others waiting.
+ *
+ * Polling starts with a discovery phase at the first state broadcast from the
+ * controller. It sends the requests that complete the dashboard back to back, one per
+ * transmit window, and then hands over to the steady-state intervals.
+ *
+ * Only used from the pool_task, so no locking is needed.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+#ifndef __cplusplus
+# error "Requires C++ compilation"
+#endif
+
+#include <esp_system.h>
+#include <esp_types.h>
+
+#include "utils/enum_helpers.h"
+
+namespace esphome {
+namespace opnpool {
+
+    // forward declarations (to avoid circular dependencies)
+struct network_msg_t;
+
+/**
+ * @brief Data that is polled from the controller.
+ *
+ * @note MUST be in the same order as CONF_POLL_EVERY_DEFAULTS in __init__.py.
+ */
+enum class poll_typ_t : uint8_t {
+    VERSION    = 0,  ///< Firmware version (CTRL_VERSION_REQ).
+    TIME       = 1,  ///< Time and date (CTRL_TIME_REQ).
+    HEAT       = 2,  ///< Set points and heat sources (CTRL_HEAT_REQ).
+    SCHED      = 3,  ///< Circuit schedules (CTRL_SCHED_REQ).
+    LAYOUT     = 4,  ///< Remote button layout (CTRL_LAYOUT_REQ).
+    VALVE      = 5,  ///< Valve assignments (CTRL_VALVE_REQ).
+    CIRC_NAMES = 6,  ///< Circuit names (CTRL_CIRC_NAMES_REQ).
+    PUMP       = 7   ///< Pump status, of each pump in poll_config_t::pumps (PUMP_STATUS_REQ).
+};
+
+/// @brief Poll scheduler configuration.
+struct poll_config_t {
+    uint32_t every_ms[enum_count<poll_typ_t>()]{  ///< Desired freshness per poll type, 0 to never poll.
+        24 * 3600 * 1000,  // VERSION
+        3600 * 1000,       // TIME
+        60 * 1000,         // HEAT
+        120 * 1000,        // SCHED
+        0,                 // LAYOUT, not decoded
+        0,                 // VALVE, only logged as hex
+        0,                 // CIRC_NAMES, only logged as hex
+        600 * 1000,        // PUMP
+    };
+    uint32_t spacing_ms{2000};      ///< Minimum time between two polls.
+    uint32_t boost_after_ms{3000};  ///< Delay from a related command to the confirming poll.
+    uint16_t pumps{0x0001};         ///< Pumps to poll for PUMP, one bit per datalink_pump_id_t.
+};
+
+/**
+ * @brief Initializes the scheduler. Nothing is due until the discovery phase starts.
+ *
+ * @param[in] config Scheduler configuration.
+ * @param[in] now_ms Current time in milliseconds (e.g. millis()).
+ */
+void poll_sched_init(poll_config_t const * const config, uint32_t const now_ms);
+
+/**
+ * @brief Lets the scheduler see a message on the bus or a command from the main task.
+ *
+ * @param[in] msg    The network message.
+ * @param[in] now_ms Current time in milliseconds.
+ */
+void poll_sched_observe(network_msg_t const * const msg, uint32_t const now_ms);
+
+/**
+ * @brief Returns the next request to send, if one is due.
+ *
+ * @param[in]  now_ms Current time in milliseconds.
+ * @param[out] msg    Receives the request type and payload, and dst for requests to a pump.
+ *                    The caller sets src, and dst for requests to the controller.
+ * @return            True if a request should be sent now.
+ */
+[[nodiscard]] bool poll_sched_next(uint32_t const now_ms, network_msg_t * const msg);
+
+}  // namespace opnpool
+}  // namespace esphome
@@ -15,10 +15,12 @@
  * - Handling requests from the main task, converting them into protocol packets, and transmitting
  *   them to the pool controller.
  * - Managing a transmit queue for outgoing packets, ensuring correct half-duplex operation
- *   (using RTS for direction control) and echoing sent messages back up the protocol stack for
+ *   (using RTS for direction control) and forwarding sent messages to the main task for
  *   state consistency.
- * - Periodically sending control and status requests (heat, schedule, version queries) to
- *   keep the pool state synchronized.
+ * - Tracking commands until the controller acknowledges them, and sending them again when
+ *   it doesn't (see cmd_tracker.h).
+ * - Polling the controller for data that it doesn't broadcast (heat, schedule, version, ...),
+ *   when that data is due for a refresh (see poll_sched.h).
  *
  * @note The pool controller broadcasts state every ~1 second. The task waits for these broadcasts
  *       to identify transmit opportunities, avoiding bus collisions on the shared RS-485 bus.
@@ -29,6 +31,8 @@
  * @see datalink_rx.cpp for packet reception and parsing
  * @see datalink_tx.cpp for packet transmission
  * @see network_rx.cpp for network message decoding
+ * @see poll_sched.cpp for request scheduling
+ * @see cmd_tracker.cpp for command acknowledgement
  * @see ipc.h for inter-task communication
  *
  * @author Coert Vonk (@cvonk on GitHub)
@@ -39,6 +43,7 @@
 #include <esp_system.h>
 #include <esp_types.h>
 #include "esphome/core/log.h"
+#include "esphome/core/hal.h"
 #include <string.h>
 
 #include "utils/to_str.h"
@@ -49,6 +54,8 @@
 #include "datalink_pkt.h"
 #include "network.h"
 #include "network_msg.h"
+#include "poll_sched.h"
+#include "cmd_tracker.h"
 #include "ipc/ipc.h"
 #include "pool_task.h"
 #pragma GCC diagnostic error "-Wall"
@@ -60,9 +67,8 @@ namespace opnpool {
 
 constexpr char TAG[] = "pool_task";
 
-constexpr uint32_t POOL_TASK_DELAY_MS       = 100;        ///< Main loop delay between iterations [ms]
-constexpr uint32_t POOL_REQ_INTERVAL_MS     = 30 * 1000;  ///< Interval between periodic controller queries [ms]
-constexpr uint32_t POOL_REQ_TASK_STACK_SIZE = 2 * 4096;   ///< Stack size for pool_req_task [bytes]
+constexpr uint32_t POOL_TASK_DELAY_MS = 100;  ///< Main loop delay between iterations [ms]
+constexpr uint32_t BURST_WAIT_MS      = 10;   ///< Wait for the rest of a burst that the main task is still sending [ms]
 
 /// Controller address learned from broadcast messages. Used as destination for outgoing requests.
 static datalink_addr_t _controller_addr = datalink_addr_t::unknown();
@@ -99,6 +105,10 @@ _service_pkts_from_rs485(rs485_handle_t const rs485, ipc_t const * const ipc)
                 ESP_LOGV(TAG, "learned controller address: 0x%02X", msg.src.addr);
             }
 
+                // replies to anyone's requests count as fresh data
+            poll_sched_observe(&msg, millis());
+            cmd_tracker_observe(&msg, millis());
+
             if( ipc_send_network_msg_to_main_task(&msg, ipc) != ESP_OK) {
                 ESP_LOGW(TAG, "Failed to send network message to main task");
             }
@@ -113,6 +123,58 @@ _service_pkts_from_rs485(rs485_handle_t const rs485, ipc_t const * const ipc)
     return txOpportunity;
 }
 
+/**
+ * @brief Packetizes a network message and queues it for RS-485 transmission.
+ *
+ * The packet keeps the message, so it can be forwarded to the main task once it is
+ * transmitted (see network_create_tx_pkt()).
+ *
+ * @param[in] rs485 RS-485 handle for queuing outgoing packets.
+ * @param[in] msg   Network message to send.
+ * @return          True if the packet was created and handed to the transmit queue.
+ */
+static bool
+_queue_msg(rs485_handle_t const rs485, network_msg_t const * const msg)
+{
+    network_tx_pkt_t * const tx = network_create_tx_pkt(msg);
+    if (!tx) {
+        return false;
+    }
+    datalink_tx_pkt_queue(rs485, &tx->pkt);  // tx->pkt.skb and tx freed by recipient
+    return true;
+}
+
+/**
+ * @brief Drops the packets of a message type that are still waiting in the transmit queue.
+ *
+ * The other packets keep their order. Only the pool_task uses the transmit queue, so it
+ * can't change while it is rotated.
+ *
+ * @param[in] rs485 RS-485 handle with the transmit queue.
+ * @param[in] typ   Message type to drop.
+ */
+static void
+_drop_queued(rs485_handle_t const rs485, network_msg_typ_t const typ)
+{
+    UBaseType_t const count = uxQueueMessagesWaiting(rs485->tx_q);
+
+    for (UBaseType_t idx = 0; idx < count; idx++) {
+        datalink_pkt_t const * const pkt = rs485->dequeue(rs485);
+        if (!pkt) {
+            break;
+        }
+        network_msg_t const * const msg = network_tx_pkt_msg(pkt);
+        if (msg->typ == typ) {
+            ESP_LOGV(TAG, "Dropping queued %s", enum_str(typ));
+            cmd_tracker_dropped(msg);
+            free(pkt->skb);
+            free((void *) pkt);
+        } else {
+            rs485->queue(rs485, pkt);
+        }
+    }
+}
+
 /**
  * @brief Handles requests from the main task and queues them for RS-485 transmission.
  *
@@ -120,6 +182,9 @@ _service_pkts_from_rs485(rs485_handle_t const rs485, ipc_t const * const ipc)
  * queues it for transmission to the pool controller. The actual transmission occurs later
  * when a transmit opportunity is detected.
  *
+ * The messages of a burst (e.g. a scene) are received together, so they sit next to
+ * each other in the transmit queue and no poll or retry gets in between.
+ *
  * @param[in] rs485 RS-485 handle for queuing outgoing packets.
  * @param[in] ipc   IPC structure containing the to_pool_q queue.
  *
@@ -129,64 +194,109 @@ static void
 _service_requests_from_main(rs485_handle_t rs485, ipc_t const * const ipc)
 {
     network_msg_t msg;
+    TickType_t wait = 0;
 
-    if (xQueueReceive(ipc->to_pool_q, &msg, (TickType_t)0) == pdPASS) {
+    while (xQueueReceive(ipc->to_pool_q, &msg, wait) == pdPASS) {
 
-        datalink_pkt_t * const pkt = static_cast<datalink_pkt_t*>(calloc(1, sizeof(datalink_pkt_t)));
+            // confirm the resulting state soon after
+        poll_sched_observe(&msg, millis());
 
-        if (network_create_pkt(&msg, pkt) == ESP_OK) {
+            // a HEAT_SET carries the settings of both thermostats, so a newer one supersedes
+            // one that is still waiting for a transmit opportunity
+        if (msg.typ == network_msg_typ_t::CTRL_HEAT_SET) {
+            _drop_queued(rs485, msg.typ);
+        }
+
+        if (_queue_msg(rs485, &msg)) {
+            cmd_tracker_queued(&msg, millis());
+        }
 
-            datalink_tx_pkt_queue(rs485, pkt);  // pkt and pkt->skb freed by recipient
-            return;
+            // the rest of a burst follows right away
+        if (msg.burst == 0) {
+            break;
         }
-        if (pkt->skb) free(pkt->skb);
-        free(pkt);
+        wait = pdMS_TO_TICKS(BURST_WAIT_MS);
+    }
+}
+
+/**
+ * @brief Queues commands again that the controller didn't acknowledge.
+ *
+ * Also lets the command tracker time out the commands that are outstanding.
+ *
+ * @param[in] rs485 RS-485 handle for queuing outgoing packets.
+ */
+static void
+_service_cmd_retries(rs485_handle_t const rs485)
+{
+    network_msg_t msg;
+
+    if (cmd_tracker_retry(millis(), &msg)) {
+        msg.burst = 0;  // the rest of its burst was sent already
+        (void)_queue_msg(rs485, &msg);
     }
 }
 
 /**
  * @brief Queues a request message for transmission to the pool controller.
  *
- * Creates a network message of the specified type with this device as source (pretending
- * to be a remote control) and the learned controller address as destination. The message
+ * Sets this device as source (pretending to be a remote control) and, unless the
+ * message is for a pump, the learned controller address as destination. The message
  * is packetized and queued for transmission.
  *
- * @param[in] rs485 RS-485 handle for queuing outgoing packets.
- * @param[in] typ   Network message type to send (typically a *_REQ type).
+ * @param[in]     rs485 RS-485 handle for queuing outgoing packets.
+ * @param[in,out] msg   Network message to send (typically a *_REQ type).
  *
  * @note Requires _controller_addr to be learned from a previous broadcast.
- * @see pool_req_task() for periodic request scheduling
+ * @see _service_polls() for request scheduling
  */
 static void
-_queue_req(rs485_handle_t const rs485, network_msg_typ_t const typ)
+_queue_req(rs485_handle_t const rs485, network_msg_t * const msg)
 {
-    network_msg_t msg = {};
-    msg.typ = typ;
-    msg.src = datalink_addr_t::remote();               // pretent we're a remote control
-    msg.dst = _controller_addr;  // use controller address
-
-    datalink_pkt_t * const pkt = static_cast<datalink_pkt_t*>(calloc(1, sizeof(datalink_pkt_t)));
-
-    if (network_create_pkt(&msg, pkt) == ESP_OK) {
-
-        datalink_tx_pkt_queue(rs485, pkt);  // pkt and pkt->skb freed by mailbox recipient
+    msg->src = datalink_addr_t::remote();  // pretent we're a remote control
+    if (!network_msg_typ_info[enum_index(msg->typ)].is_to_pump) {
+        msg->dst = _controller_addr;       // use controller address
+    }
+    (void)_queue_msg(rs485, msg);
+}
 
-    } else {
-        if (pkt->skb) free(pkt->skb);
-        free(pkt);
+/**
+ * @brief Dequeues the next packet of a burst, if it is next in the transmit queue.
+ *
+ * @param[in] rs485 RS-485 handle.
+ * @param[in] typ   Message type of the packet that was just sent.
+ * @param[in] burst Its number of messages still to follow.
+ * @return          The packet, or nullptr if the queue holds something else at the front.
+ */
+[[nodiscard]] static datalink_pkt_t const *
+_next_in_burst(rs485_handle_t const rs485, network_msg_typ_t const typ, uint8_t const burst)
+{
+    datalink_pkt_t const * const next = rs485->peek(rs485);
+    if (next != nullptr) {
+        network_msg_t const * const msg = network_tx_pkt_msg(next);
+        if (msg->typ == typ && msg->burst == burst - 1) {
+            return rs485->dequeue(rs485);
+        }
     }
+    ESP_LOGW(TAG, "Burst cut short, %u messages not queued in time", burst);
+    return nullptr;
 }
 
 /**
  * @brief Forwards a queued packet from the transmit queue to the RS-485 bus.
  *
  * Dequeues a single packet from the RS-485 transmit queue and sends it on the bus.
- * Uses RTS to switch the transceiver to transmit mode. After transmission, the packet
- * is "echoed" back through the network layer to update local state as if the message
- * was received, ensuring consistent state tracking.
+ * Uses RTS to switch the transceiver to transmit mode. After transmission, the network
+ * message that the packet was created from is forwarded to the main task, to update
+ * local state as if the message was received, ensuring consistent state tracking.
+ *
+ * If the message starts a burst, the packets of the rest of the burst are sent back to
+ * back in the same transmit opportunity, without releasing the bus in between. Only
+ * packets that continue the burst are sent this way. When the main task queued only part
+ * of a burst, whatever follows in the queue waits for the next transmit opportunity.
  *
  * @param[in] rs485 RS-485 handle for bus communication.
- * @param[in] ipc   IPC structure for relaying the echoed message to main task.
+ * @param[in] ipc   IPC structure for relaying the sent message to main task.
  *
  * @note Both pkt and pkt->skb are freed after processing.
  * @note Only called when a transmit opportunity is available (bus idle after broadcast).
@@ -194,8 +304,13 @@ _queue_req(rs485_handle_t const rs485, network_msg_typ_t const typ)
 static void
 _forward_queued_pkt_to_rs485(rs485_handle_t const rs485, ipc_t const * const ipc)
 {
-    datalink_pkt_t const * const pkt = rs485->dequeue(rs485);
-    if (pkt) {
+    datalink_pkt_t const * pkt = rs485->dequeue(rs485);
+    if (!pkt) {
+        return;
+    }
+    rs485->tx_mode(true);
+
+    while (pkt) {
         ESP_LOGVV(TAG, "forward_queue: pkt typ=%s", enum_str(static_cast<datalink_ctrl_typ_t>(pkt->typ)));
 
         if (ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE) {
@@ -208,59 +323,48 @@ _forward_queued_pkt_to_rs485(rs485_handle_t const rs485, ipc_t const * const ipc
                 ESP_LOGVV(TAG, "tx { %s}", dbg);
             }
         }
-        rs485->tx_mode(true);
         rs485->write_bytes(pkt->skb->priv.data, pkt->skb->len);
-        rs485->tx_mode(false);
-
-            // pretend that we received our own message to ensure consistent state tracking
 
-        bool txOpportunity = false;
-        network_msg_t msg;
+            // pass the message that we sent up, as if we received it, to ensure consistent
+            // state tracking. it is the one the packet was created from, so no need to decode.
 
-        ESP_LOGVV(TAG, "pretend rx: pkt typ=%s", enum_str(static_cast<datalink_ctrl_typ_t>(pkt->typ)));
+        network_msg_t const * const msg = network_tx_pkt_msg(pkt);
+        network_msg_typ_t const typ = msg->typ;
+        uint8_t const burst = msg->burst;
 
-        if (network_rx_msg(pkt, &msg, &txOpportunity) == ESP_OK) {
+        cmd_tracker_sent(msg, millis());
 
-            if (ipc_send_network_msg_to_main_task(&msg, ipc) != ESP_OK) {
-                ESP_LOGW(TAG, "Failed to send network message to main task");
-            }
+        if (ipc_send_network_msg_to_main_task(msg, ipc) != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to send network message to main task");
         }
         free(pkt->skb);
         free((void *) pkt);
+
+        pkt = burst != 0 ? _next_in_burst(rs485, typ, burst) : nullptr;
     }
+    rs485->tx_mode(false);
 }
 
 /**
- * @brief FreeRTOS sub-task for periodic pool controller requests.
+ * @brief Queues the next controller request, if one is due.
  *
- * Runs in an infinite loop, sending request messages to the pool controller at
- * POOL_REQ_INTERVAL_MS intervals. Queries version, heat status, and schedules to
- * keep the cached pool state synchronized with the controller.
+ * Asks the poll scheduler for the data that is most overdue. Waits while the transmit
+ * queue still holds packets, so that commands from the main task go first and polls
+ * don't pile up.
  *
- * @param[in] rs485_void Pointer to the RS-485 handle (cast to void* for FreeRTOS API).
+ * @param[in] rs485 RS-485 handle for queuing outgoing packets.
  *
  * @note Waits for _controller_addr to be learned before sending requests.
- * @note Spawned by pool_task() during initialization.
  */
-void
-pool_req_task(void * rs485_void) 
+static void
+_service_polls(rs485_handle_t const rs485)
 {
-    rs485_handle_t const rs485 = (rs485_handle_t)rs485_void;
-
-    while (1) {
-
-        vTaskDelay((TickType_t)POOL_REQ_INTERVAL_MS / portTICK_PERIOD_MS);
-
-        if (!_controller_addr.is_controller()) {
-            ESP_LOGW(TAG, "Controller address still unknown, skipping periodic requests");
-            vTaskDelay((TickType_t)POOL_REQ_INTERVAL_MS / portTICK_PERIOD_MS);
-            continue;
-        }
-        _queue_req(rs485, network_msg_typ_t::CTRL_VERSION_REQ);
-        //_queue_req(rs485, network_msg_typ_t::CTRL_TIME_REQ);
-
-        _queue_req(rs485, network_msg_typ_t::CTRL_HEAT_REQ);
-        _queue_req(rs485, network_msg_typ_t::CTRL_SCHED_REQ);
+    if (!_controller_addr.is_controller() || uxQueueMessagesWaiting(rs485->tx_q) != 0) {
+        return;
+    }
+    network_msg_t msg;
+    if (poll_sched_next(millis(), &msg)) {
+        _queue_req(rs485, &msg);
     }
 }
 
@@ -270,18 +374,21 @@ pool_req_task(void * rs485_void)
  * Entry point for the pool communication task. Runs in an infinite loop with
  * POOL_TASK_DELAY_MS between iterations. Each iteration:
  *   1. Services any pending requests from the main ESPHome task (non-blocking).
- *   2. Attempts to receive and process a packet from the RS-485 bus.
- *   3. If a transmit opportunity is detected (after controller broadcast), forwards
- *      one queued packet to the bus.
+ *   2. Queues unacknowledged commands again, when their retry is due.
+ *   3. Queues a controller request, if the poll scheduler has one due.
+ *   4. Attempts to receive and process a packet from the RS-485 bus.
+ *   5. If a transmit opportunity is detected (after controller broadcast), forwards
+ *      one queued packet, or one burst of packets, to the bus.
  *
  * On startup:
+ *   - Claims a string arena for this task (see to_str.h).
  *   - Initializes the RS-485 interface with pins from the IPC config.
- *   - Spawns the pool_req_task() sub-task for periodic controller queries.
+ *   - Initializes the poll scheduler from the IPC config.
  *
  * @param[in] ipc_void Pointer to the IPC structure (cast to void* for FreeRTOS API).
  *
  * @note This task runs on a separate FreeRTOS task from ESPHome's main loop.
- * @see pool_req_task() for periodic request handling
+ * @see _service_polls() for periodic request handling
  * @see ipc_t for the inter-task communication structure
  */
 void
@@ -290,19 +397,31 @@ pool_task(void * ipc_void)
     ESP_LOGI(TAG, "init ..");
 
     ipc_t * const ipc = static_cast<ipc_t*>(ipc_void);
+    if (to_str_bind_task() != ESP_OK) {
+        ESP_LOGW(TAG, "No string arena for pool_task");
+    }
     rs485_handle_t const rs485 = rs485_init(&ipc->config.rs485_pins);
 
-        // periodically request information from controller
-    if (xTaskCreate(&pool_req_task, "pool_req_task", POOL_REQ_TASK_STACK_SIZE, rs485, 5, NULL) != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create pool_req_task");
-    }
+        // request information that the controller doesn't broadcast
+    poll_sched_init(&ipc->config.poll, millis());
 
     while (1) {
 
+            // strings formatted during this iteration are released at its end
+        to_str_scope_t const to_str_scope;
+
             // read from ipc->to_pool_q
 
         _service_requests_from_main(rs485, ipc);
 
+            // send commands again that the controller didn't acknowledge
+
+        _service_cmd_retries(rs485);
+
+            // request data that is due for a refresh
+
+        _service_polls(rs485);
+
             // read from the rs485 device, until there is a packet,
             // then move the packet up the protocol stack to process it.
 
@@ -34,6 +34,7 @@
 #include <string.h>
 
 #include "rs485.h"
+#include "cmd_tracker.h"
 #include "datalink.h"
 #include "datalink_pkt.h"
 #pragma GCC diagnostic error "-Wall"
@@ -48,6 +49,8 @@ constexpr char TAG[] = "rs485";
 constexpr size_t      RX_BUF_SIZE = 127;
 constexpr TickType_t  RX_TIMEOUT  = (100 / portTICK_PERIOD_MS);
 constexpr TickType_t  TX_TIMEOUT  = (100 / portTICK_PERIOD_MS);
+constexpr UBaseType_t TX_Q_LEN    = 12;  // room for a scene that sets every circuit
+static_assert(TX_Q_LEN >= CMD_TRACKER_SIZE, "the transmit queue can't hold all commands the tracker can track");
 
 constexpr uart_port_t           UART_PORT = static_cast<uart_port_t>(UART_NUM_1);
 constexpr int                   BAUD_RATE = 9600;
@@ -147,6 +150,22 @@ _dequeue(rs485_handle_t const handle)
     return nullptr;
 }
 
+/**
+ * @brief            Returns the packet at the front of the RS-485 transmit queue.
+ *
+ * @param[in] handle RS-485 handle.
+ * @return           Pointer to the packet, still owned by the queue, or NULL if none available.
+ */
+[[nodiscard]] static datalink_pkt_t const *
+_peek(rs485_handle_t const handle)
+{
+    rs485_q_msg_t msg{};
+    if (xQueuePeek(handle->tx_q, &msg, (TickType_t)0) == pdPASS) {
+        return msg.pkt;
+    }
+    return nullptr;
+}
+
 /**
  * @brief               Sets the RS-485 transceiver to transmit or receive mode.
  *
@@ -223,7 +242,7 @@ rs485_init(rs485_pins_t const * const rs485_pins)
     uart_driver_install(UART_PORT, RX_BUF_SIZE * 2, 0, 0, NULL, 0);  // no tx buffer
     uart_set_mode(UART_PORT, UART_MODE_RS485_HALF_DUPLEX);
 
-    QueueHandle_t const tx_q = xQueueCreate(5, sizeof(rs485_q_msg_t));
+    QueueHandle_t const tx_q = xQueueCreate(TX_Q_LEN, sizeof(rs485_q_msg_t));
     if (tx_q == nullptr) {
         ESP_LOGE(TAG, "Failed to create TX queue");
         return nullptr;
@@ -243,6 +262,7 @@ rs485_init(rs485_pins_t const * const rs485_pins)
     handle->tx_mode = _tx_mode;
     handle->queue = _queue;
     handle->dequeue = _dequeue;
+    handle->peek = _peek;
     handle->tx_q = tx_q;
     
     _tx_mode(false);
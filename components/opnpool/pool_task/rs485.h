@@ -69,6 +69,9 @@ using rs485_queue_fnc_t       = void (*)(rs485_handle_t const handle, datalink_p
 /// @brief Function pointer: dequeues a packet from the transmit queue.
 using rs485_dequeue_fnc_t     = datalink_pkt_t const * (*)(rs485_handle_t const handle);
 
+/// @brief Function pointer: returns the packet at the front of the transmit queue, leaving it queued.
+using rs485_peek_fnc_t        = datalink_pkt_t const * (*)(rs485_handle_t const handle);
+
 /// @}
 
 /// @name RS-485 Instance Structure
@@ -91,6 +94,7 @@ struct rs485_instance_t {
     rs485_tx_mode_fnc_t     tx_mode;      ///< Controls RTS pin for half-duplex direction.
     rs485_queue_fnc_t       queue;        ///< Queues packet to tx_q for transmission.
     rs485_dequeue_fnc_t     dequeue;      ///< Dequeues packet from tx_q.
+    rs485_peek_fnc_t        peek;         ///< Returns packet at the front of tx_q, leaving it queued.
     QueueHandle_t           tx_q;         ///< FreeRTOS transmit queue handle.
 };
 
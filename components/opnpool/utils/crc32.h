@@ -0,0 +1,54 @@
+/**
+ * @file crc32.h
+ * @brief CRC-32 (IEEE 802.3) for the records OPNpool keeps in flash.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+#ifndef __cplusplus
+# error "Requires C++ compilation"
+#endif
+
+#include <esp_system.h>
+#include <esp_types.h>
+#ifdef ESP_PLATFORM
+# include <esp_rom_crc.h>
+#endif
+
+namespace esphome {
+namespace opnpool {
+
+/**
+ * @brief Computes the CRC-32 (IEEE 802.3) of a buffer.
+ *
+ * @details
+ * On the ESP32, this uses the table driven implementation in ROM, so it costs no flash.
+ * That inverts the CRC on entry and exit, so a seed of 0 gives the standard CRC-32.
+ * Host builds, such as the tests in tests/host, use the bitwise equivalent.
+ *
+ * @param[in] data Pointer to the data.
+ * @param[in] len  Number of bytes.
+ * @return         The CRC-32.
+ */
+[[nodiscard]] inline uint32_t
+crc32(uint8_t const * const data, size_t const len)
+{
+#ifdef ESP_PLATFORM
+    return esp_rom_crc32_le(0, data, static_cast<uint32_t>(len));
+#else
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t ii = 0; ii < len; ii++) {
+        crc ^= data[ii];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+#endif
+}
+
+}  // namespace opnpool
+}  // namespace esphome
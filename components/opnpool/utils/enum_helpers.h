@@ -3,10 +3,24 @@
  * @brief Template helper functions for enum-to-string and string-to-enum conversions
  *
  * @details
- * Provides type-safe template utilities that wrap the magic_enum library for converting
- * between enum values and their string representations. Includes fallback mechanisms for
- * values outside the magic_enum range. The MAGIC_ENUM_RANGE is configured for 0..256 to
- * cover all uint8_t-based protocol enumerations used by the pool controller.
+ * Provides type-safe template utilities for converting between enum values and their
+ * string representations. Includes fallback mechanisms for values without a name. The
+ * names and fallbacks are constant strings, so they are safe to use from any task.
+ *
+ * The conversions read name tables that are built at compile time. An enum that is
+ * generated from an X-macro list, such as network_msg_typ_t from NETWORK_MSG_TYP_LIST,
+ * passes the names from that same list with ENUM_HELPERS_NAMES(). For the other enums,
+ * magic_enum extracts the names from the declaration. Either way, the conversions don't
+ * call magic_enum at run time.
+ *
+ * magic_enum finds the names by instantiating a template for every value in its range,
+ * so the range drives compile time and flash. It is 0..63 by default, which covers the
+ * enums that simply count from 0. Protocol enums with values up to 0xFF declare so with
+ * ENUM_HELPERS_UINT8_RANGE() right after their definition.
+ *
+ * Value to name lookups index the table by value. Name to value lookups use a
+ * case-insensitive perfect hash table, so a lookup hashes the name once and compares it
+ * against a single candidate.
  *
  * @author Coert Vonk (@cvonk on GitHub)
  * @copyright Copyright (c) 2014, 2019, 2022, 2026 Coert Vonk
@@ -31,16 +45,235 @@
 # undef MAGIC_ENUM_RANGE_MAX
 #endif
 #define MAGIC_ENUM_RANGE_MIN 0
-#define MAGIC_ENUM_RANGE_MAX 256
+#define MAGIC_ENUM_RANGE_MAX 63
 #include "magic_enum.h"
 
+#include <array>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+
 #include "to_str.h"
 
+    /// Declares that an enum (in the current namespace) has values up to 0xFF.
+#define ENUM_HELPERS_UINT8_RANGE(EnumT)                                                 \
+    constexpr auto magic_enum_define_range_adl(EnumT) {                                 \
+        return magic_enum::customize::adl_info().minmax<0, UINT8_MAX>();                \
+    }
+
+    /// Declares the names of an enum (in the current namespace) that counts from 0, in value order.
+#define ENUM_HELPERS_NAMES(EnumT, NAMES)                                                \
+    constexpr auto const & enum_helpers_names_adl(EnumT) {                              \
+        return NAMES;                                                                   \
+    }
+
 namespace esphome {
 namespace opnpool {
 
 constexpr char const * const ENUM_HELPER_TAG = "enum_helpers";
 
+namespace enum_helpers_detail {
+
+[[nodiscard]] constexpr char
+lower(char const c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+[[nodiscard]] constexpr bool
+iequal(std::string_view const a, std::string_view const b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t ii = 0; ii < a.size(); ii++) {
+        if (lower(a[ii]) != lower(b[ii])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+    // case-insensitive 32-bit FNV-1a, followed by a mixer so that every seed spreads differently
+[[nodiscard]] constexpr uint32_t
+hash(std::string_view const name, uint32_t const seed)
+{
+    uint32_t h = 2166136261UL ^ seed;
+    for (char const c : name) {
+        h ^= static_cast<uint8_t>(lower(c));
+        h *= 16777619UL;
+    }
+    h ^= h >> 16;
+    h *= 0x7FEB352DUL;
+    h ^= h >> 15;
+    return h;
+}
+
+    // smallest power of two with at least 4 slots per name, so a seed is found quickly
+[[nodiscard]] constexpr size_t
+table_size(size_t const count)
+{
+    size_t size = 1;
+    while (size < count * 4) {
+        size <<= 1;
+    }
+    return size;
+}
+
+template<typename EnumT, typename = void>
+struct has_names : std::false_type {};
+
+template<typename EnumT>
+struct has_names<EnumT, std::void_t<decltype(enum_helpers_names_adl(EnumT{}))>> : std::true_type {};
+
+/**
+ * @brief Names and values of EnumT, in value order, plus an index from value to name.
+ *
+ * @details
+ * Taken from the ENUM_HELPERS_NAMES() list if the enum has one, otherwise from the
+ * magic_enum names of its declaration. When the values count from 0 the value is the
+ * index; otherwise each byte of the index holds the position of a name plus 1, or 0
+ * for values without a name.
+ */
+template<typename EnumT>
+[[nodiscard]] constexpr size_t
+name_count()
+{
+    if constexpr (has_names<EnumT>::value) {
+        return std::size(enum_helpers_names_adl(EnumT{}));
+    } else {
+        return magic_enum::enum_count<EnumT>();
+    }
+}
+
+template<typename EnumT>
+struct name_table {
+    static constexpr size_t
+    count()
+    {
+        return name_count<EnumT>();
+    }
+
+    static constexpr std::array<std::string_view, count()>
+    make_names()
+    {
+        if constexpr (has_names<EnumT>::value) {
+            std::array<std::string_view, count()> names = {};
+            for (size_t idx = 0; idx < count(); idx++) {
+                names[idx] = enum_helpers_names_adl(EnumT{})[idx];
+            }
+            return names;
+        } else {
+            return magic_enum::enum_names<EnumT>();
+        }
+    }
+
+    static constexpr std::array<EnumT, count()>
+    make_values()
+    {
+        if constexpr (has_names<EnumT>::value) {
+            std::array<EnumT, count()> values = {};
+            for (size_t idx = 0; idx < count(); idx++) {
+                values[idx] = static_cast<EnumT>(idx);
+            }
+            return values;
+        } else {
+            return magic_enum::enum_values<EnumT>();
+        }
+    }
+
+    static constexpr auto names  = make_names();
+    static constexpr auto values = make_values();
+    static_assert(count() > 0 && count() < UINT8_MAX, "name_table indices are uint8_t");
+
+    static constexpr bool
+    counts_from_0()
+    {
+        for (size_t idx = 0; idx < count(); idx++) {
+            if (static_cast<size_t>(values[idx]) != idx) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static constexpr bool   dense = counts_from_0();
+    static constexpr size_t span  = static_cast<size_t>(values[count() - 1]) + 1;
+
+    static constexpr std::array<uint8_t, dense ? 1 : span>
+    make_index()
+    {
+        std::array<uint8_t, dense ? 1 : span> index = {};
+        if constexpr (!dense) {
+            for (size_t idx = 0; idx < count(); idx++) {
+                index[static_cast<size_t>(values[idx])] = static_cast<uint8_t>(idx + 1);
+            }
+        }
+        return index;
+    }
+
+    static constexpr auto index = make_index();
+
+        // returns the name of a value, or an empty view if it has none
+    [[nodiscard]] static constexpr std::string_view
+    name(EnumT const value)
+    {
+        size_t const raw = static_cast<size_t>(value);
+        if (raw >= span) {
+            return {};
+        }
+        if constexpr (dense) {
+            return names[raw];
+        } else {
+            uint8_t const slot = index[raw];
+            return slot ? names[slot - 1] : std::string_view{};
+        }
+    }
+};
+
+/**
+ * @brief Perfect hash table from (case-insensitive) names to the values of EnumT.
+ *
+ * @details
+ * Built at compile time from name_table by trying seeds until every name lands in its
+ * own slot. Each slot holds the index of a name plus 1, or 0 when empty.
+ */
+template<typename EnumT>
+struct name_hash {
+    static constexpr auto const & names  = name_table<EnumT>::names;
+    static constexpr auto const & values = name_table<EnumT>::values;
+    static constexpr size_t       size   = table_size(names.size());
+    static_assert(names.size() < UINT8_MAX, "name_hash slots are uint8_t");
+
+    struct table_t {
+        uint32_t seed;
+        uint8_t  slots[size];
+    };
+
+    static constexpr table_t
+    make()
+    {
+        for (uint32_t seed = 0; seed < 4096; seed++) {
+            table_t table = {seed, {}};
+            bool perfect = true;
+            for (size_t idx = 0; idx < names.size() && perfect; idx++) {
+                uint8_t & slot = table.slots[hash(names[idx], seed) & (size - 1)];
+                perfect = slot == 0;
+                slot = static_cast<uint8_t>(idx + 1);
+            }
+            if (perfect) {
+                return table;
+            }
+        }
+        return {UINT32_MAX, {}};
+    }
+
+    static constexpr table_t table = make();
+    static_assert(table.seed != UINT32_MAX, "no perfect hash seed found");
+};
+
+}  // namespace enum_helpers_detail
+
 /**
  * @brief Convert an enum value to its string representation.
  *
@@ -52,13 +285,57 @@ template<typename EnumT>
 [[nodiscard]] inline const char *
 enum_str(EnumT value)
 {
-    auto name = magic_enum::enum_name(value);
+    auto name = enum_helpers_detail::name_table<EnumT>::name(value);
     if (!name.empty()) {
         return name.data();
     }
     return uint8_str(static_cast<uint8_t>(value));  // fallback
 }
 
+/**
+ * @brief Convert an enum value to a view of its string representation.
+ *
+ * @details
+ * Like enum_str(), but also returns the length, so callers that copy or compare the
+ * name don't need a strlen().
+ *
+ * @tparam EnumT  Enum type to convert.
+ * @param[in] value  The enum value.
+ * @return           Name of the enum value, or hex fallback via uint8_sv(). Null terminated.
+ */
+template<typename EnumT>
+[[nodiscard]] inline std::string_view
+enum_sv(EnumT value)
+{
+    auto name = enum_helpers_detail::name_table<EnumT>::name(value);
+    if (!name.empty()) {
+        return name;
+    }
+    return uint8_sv(static_cast<uint8_t>(value));  // fallback
+}
+
+/**
+ * @brief Look up an enum value by its name (case-insensitive).
+ *
+ * @tparam EnumT  Enum type to convert to.
+ * @param[in]  name   Name to look up.
+ * @param[out] value  Receives the enum value, if found.
+ * @return            True if name is the name of an EnumT value.
+ */
+template<typename EnumT>
+[[nodiscard]] constexpr bool
+enum_lookup(std::string_view const name, EnumT * const value)
+{
+    using hash_t = enum_helpers_detail::name_hash<EnumT>;
+
+    uint8_t const slot = hash_t::table.slots[enum_helpers_detail::hash(name, hash_t::table.seed) & (hash_t::size - 1)];
+    if (slot == 0 || !enum_helpers_detail::iequal(name, hash_t::names[slot - 1])) {
+        return false;
+    }
+    *value = hash_t::values[slot - 1];
+    return true;
+}
+
 /**
  * @brief Convert a string to its enum value (as int).
  *
@@ -74,18 +351,9 @@ enum_nr(char const * const enum_str)
         ESP_LOGE(ENUM_HELPER_TAG, "null to %s", __func__);
         return 0;  // can't return -1, will cause OOB array access
     }
-        // try magic_enum first for efficient lookup
-    auto value = magic_enum::enum_cast<EnumT>(std::string_view(enum_str), magic_enum::case_insensitive);
-    if (value.has_value()) {
-        return static_cast<int>(value.value());
-    }
-        // fallback: search through entire uint8_t range if not found in enum
-    for (uint16_t ii = 0; ii <= 0xFF; ii++) {
-        auto candidate = static_cast<EnumT>(ii);
-        auto name = magic_enum::enum_name(candidate);
-        if (!name.empty() && strcasecmp(enum_str, name.data()) == 0) {
-            return ii;
-        }
+    EnumT value;
+    if (enum_lookup(std::string_view(enum_str), &value)) {
+        return static_cast<int>(value);
     }
     ESP_LOGE(ENUM_HELPER_TAG, "enum_str '%s' not found", enum_str);
     return 0;  // can't return -1, will cause OOB array access
@@ -100,7 +368,7 @@ enum_nr(char const * const enum_str)
 template<typename EnumT>
 [[nodiscard]] constexpr size_t
 enum_count() {
-    return magic_enum::enum_count<EnumT>();
+    return enum_helpers_detail::name_count<EnumT>();
 }
 
 /**
@@ -0,0 +1,323 @@
+/**
+ * @file flash_log.cpp
+ * @brief Wear-levelled log of fixed-size records in raw flash.
+ *
+ * @details
+ * Implements FlashLog. Sector s, slot n lives at offset s*sector_size + n*slot_size.
+ * Within a sector, slots are written in order, so the first blank slot ends the part
+ * of the sector that was used. A slot that isn't blank but doesn't hold a valid record
+ * (a write torn by a power loss) is never reused until its sector is erased.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <esp_system.h>
+#include <esp_types.h>
+#include <esphome/core/log.h>
+#include <cstring>
+
+#include "flash_log.h"
+#include "crc32.h"
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wunused-parameter"
+
+namespace esphome {
+namespace opnpool {
+
+constexpr char TAG[] = "flash_log";
+
+/**
+ * @brief Returns true if all bytes are erased (0xFF).
+ */
+[[nodiscard]] static bool
+_is_blank(uint8_t const * const buf, size_t const len)
+{
+    for (size_t ii = 0; ii < len; ii++) {
+        if (buf[ii] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Returns the CRC-32 over the sequence number and the payload of a record.
+ */
+[[nodiscard]] static uint32_t
+_record_crc(uint32_t const seq, uint8_t const * const payload, uint8_t const len)
+{
+    uint8_t buf[sizeof(seq) + FlashLog::MAX_PAYLOAD];
+    memcpy(buf, &seq, sizeof(seq));
+    memcpy(buf + sizeof(seq), payload, len);
+    return crc32(buf, sizeof(seq) + len);
+}
+
+FlashLog::FlashLog(FlashLogIo * const io, uint8_t const tag, uint8_t const len) :
+    io_{io}, tag_{tag}, len_{len},
+    slot_size_{static_cast<uint16_t>((sizeof(flash_log_hdr_t) + len + 3) & ~3U)},
+    sector_size_{0}, slots_{0}, sectors_{0}, sector_{0}, slot_{0}, seq_{0}, opened_{false}, stats_{}
+{
+}
+
+/**
+ * @brief Reads a slot.
+ *
+ * @param[in]  sector The sector.
+ * @param[in]  slot   The slot within the sector.
+ * @param[out] buf    Receives slot_size_ bytes.
+ * @return            ESP_OK, or the error from the flash read.
+ */
+esp_err_t
+FlashLog::read_slot_(uint8_t const sector, uint16_t const slot, uint8_t * const buf)
+{
+    return io_->read(sector * sector_size_ + slot * slot_size_, buf, slot_size_);
+}
+
+/**
+ * @brief Checks if a slot holds a valid record of our format.
+ *
+ * @param[in]  buf The slot.
+ * @param[out] seq Sequence number of the record, if valid.
+ * @return         True if valid.
+ */
+bool
+FlashLog::is_valid_(uint8_t const * const buf, uint32_t * const seq) const
+{
+    flash_log_hdr_t hdr;
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (hdr.magic != MAGIC || hdr.tag != tag_ || hdr.len != len_) {
+        return false;
+    }
+    if (_record_crc(hdr.seq, buf + sizeof(hdr), len_) != hdr.crc) {
+        return false;
+    }
+    *seq = hdr.seq;
+    return true;
+}
+
+/**
+ * @brief Finds the sequence number of the first valid record in a sector.
+ *
+ * @details
+ * That is normally slot 0, unless the first write after erasing the sector was torn.
+ *
+ * @param[in]  sector The sector.
+ * @param[out] seq    Sequence number of the record.
+ * @return            True if the sector holds a valid record.
+ */
+bool
+FlashLog::first_seq_(uint8_t const sector, uint32_t * const seq)
+{
+    uint8_t buf[MAX_SLOT];
+    for (uint16_t slot = 0; slot < slots_; slot++) {
+        if (read_slot_(sector, slot, buf) != ESP_OK || _is_blank(buf, slot_size_)) {
+            return false;
+        }
+        if (is_valid_(buf, seq)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Finds the last valid record in a sector, and the slot after the used part.
+ *
+ * @param[in]  sector  The sector.
+ * @param[out] payload Receives the last valid record, if any.
+ * @param[out] found   True if the sector holds a valid record.
+ * @return             Index of the first slot after the used part (slots_ if full).
+ */
+uint16_t
+FlashLog::scan_sector_(uint8_t const sector, uint8_t * const payload, bool * const found)
+{
+    uint8_t buf[MAX_SLOT];
+    uint16_t next = 0;
+    *found = false;
+
+    for (uint16_t slot = 0; slot < slots_; slot++) {
+        if (read_slot_(sector, slot, buf) != ESP_OK || _is_blank(buf, slot_size_)) {
+            break;
+        }
+        next = slot + 1;
+        uint32_t seq;
+        if (is_valid_(buf, &seq) && (!*found || static_cast<int32_t>(seq - seq_) > 0)) {
+            memcpy(payload, buf + sizeof(flash_log_hdr_t), len_);
+            seq_ = seq;
+            *found = true;
+        }
+    }
+    return next;
+}
+
+esp_err_t
+FlashLog::open(void * const payload)
+{
+    if (!io_ || !payload) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len_ == 0 || len_ > MAX_PAYLOAD) {
+        ESP_LOGW(TAG, "payload length %u not supported", len_);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    sector_size_ = io_->sector_size();
+    uint32_t const sectors = sector_size_ ? io_->size() / sector_size_ : 0;
+    sectors_ = static_cast<uint8_t>(sectors < MAX_SECTORS ? sectors : MAX_SECTORS);
+    slots_ = static_cast<uint16_t>(sector_size_ / slot_size_);
+    if (sectors_ < 2 || slots_ == 0) {
+        ESP_LOGW(TAG, "region too small (%lu bytes)", static_cast<unsigned long>(io_->size()));
+        return ESP_ERR_INVALID_SIZE;
+    }
+    opened_ = true;
+
+        // the sector written last is the one whose first record is newest
+    bool have_newest = false;
+    uint8_t newest = 0;
+    uint32_t newest_seq = 0;
+    for (uint8_t sector = 0; sector < sectors_; sector++) {
+        uint32_t seq;
+        if (first_seq_(sector, &seq) && (!have_newest || static_cast<int32_t>(seq - newest_seq) > 0)) {
+            newest = sector;
+            newest_seq = seq;
+            have_newest = true;
+        }
+    }
+    if (!have_newest) {
+            // empty log: the first append() moves on to sector 0 and erases it
+        sector_ = sectors_ - 1;
+        slot_ = slots_;
+        seq_ = 0;
+        ESP_LOGI(TAG, "Empty log (%u sectors of %u slots)", sectors_, slots_);
+        return ESP_ERR_NOT_FOUND;
+    }
+    bool found;
+    sector_ = newest;
+    slot_ = scan_sector_(newest, static_cast<uint8_t *>(payload), &found);
+    stats_.recovered = seq_;
+    ESP_LOGI(TAG, "Recovered record #%lu from sector %u, slot %u",
+             static_cast<unsigned long>(seq_), sector_, slot_ - 1);
+    return found ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+/**
+ * @brief Appends a record.
+ *
+ * @details
+ * Skips slots that aren't blank, e.g. after a torn write. When the current sector is
+ * full, the next sector is erased and used. The record is read back, and written again
+ * in the next slot if it didn't take.
+ *
+ * @param[in] payload The record.
+ * @return            ESP_OK, or an error if the flash access failed.
+ */
+esp_err_t
+FlashLog::append(void const * const payload)
+{
+    if (!payload) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!opened_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t const seq = seq_ + 1;
+    uint8_t buf[MAX_SLOT];
+    memset(buf, 0xFF, slot_size_);
+    flash_log_hdr_t const hdr = {
+        .magic = MAGIC,
+        .tag = tag_,
+        .len = len_,
+        .seq = seq,
+        .crc = _record_crc(seq, static_cast<uint8_t const *>(payload), len_)
+    };
+    memcpy(buf, &hdr, sizeof(hdr));
+    memcpy(buf + sizeof(hdr), payload, len_);
+
+        // try at most a sector worth of slots, so failing flash doesn't erase everything
+    for (uint16_t attempt = 0; attempt <= slots_; attempt++) {
+        if (slot_ >= slots_) {
+            sector_ = (sector_ + 1) % sectors_;
+            slot_ = 0;
+            esp_err_t const err = io_->erase_sector(sector_ * sector_size_);
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Failed to erase sector %u (%s)", sector_, esp_err_to_name(err));
+                return err;
+            }
+            stats_.erases++;
+        }
+        uint32_t const offset = sector_ * sector_size_ + slot_ * slot_size_;
+        uint8_t check[MAX_SLOT];
+        if (read_slot_(sector_, slot_, check) == ESP_OK && _is_blank(check, slot_size_)) {
+            esp_err_t const err = io_->write(offset, buf, slot_size_);
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Failed to write sector %u, slot %u (%s)", sector_, slot_, esp_err_to_name(err));
+                slot_++;  // may be partly written
+                stats_.skipped++;
+                return err;
+            }
+            uint32_t written_seq;
+            if (read_slot_(sector_, slot_, check) == ESP_OK && is_valid_(check, &written_seq) && written_seq == seq) {
+
+                slot_++;
+                seq_ = seq;
+                stats_.writes++;
+                return ESP_OK;
+            }
+        }
+        slot_++;
+        stats_.skipped++;
+    }
+    return ESP_FAIL;
+}
+
+/**
+ * @brief Visits the records in the log, oldest first.
+ *
+ * @details
+ * The sector after the one being written holds the oldest records. A record that was
+ * written again after a failed read-back is only visited once.
+ *
+ * @param[in] visit Called for each record.
+ * @param[in] ctx   Passed to visit.
+ * @return          ESP_OK, or ESP_ERR_INVALID_STATE if the log isn't open.
+ */
+esp_err_t
+FlashLog::for_each(flash_log_visit_t const visit, void * const ctx)
+{
+    if (!visit) {
+        ESP_LOGW(TAG, "null to %s", __func__);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!opened_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t buf[MAX_SLOT];
+    bool have_last = false;
+    uint32_t last_seq = 0;
+
+    for (uint8_t ii = 1; ii <= sectors_; ii++) {
+        uint8_t const sector = (sector_ + ii) % sectors_;
+        for (uint16_t slot = 0; slot < slots_; slot++) {
+            if (read_slot_(sector, slot, buf) != ESP_OK || _is_blank(buf, slot_size_)) {
+                break;
+            }
+            uint32_t seq;
+            if (!is_valid_(buf, &seq) || (have_last && static_cast<int32_t>(seq - last_seq) <= 0)) {
+                continue;
+            }
+            have_last = true;
+            last_seq = seq;
+            if (!visit(ctx, seq, buf + sizeof(flash_log_hdr_t))) {
+                return ESP_OK;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+}  // namespace opnpool
+}  // namespace esphome
@@ -0,0 +1,160 @@
+/**
+ * @file flash_log.h
+ * @brief Wear-levelled log of fixed-size records in raw flash.
+ *
+ * @details
+ * Keeps the latest version of a small record (e.g. counters) in a flash region of a few
+ * sectors. Every write appends a new copy of the record after the previous one, so a
+ * sector is only erased once all its slots are used, and the sectors are used round
+ * robin. With S sectors of N slots, each sector is erased once every S*N writes.
+ *
+ * Each slot holds a flash_log_hdr_t followed by the payload, padded to 4 bytes. The
+ * header carries a sequence number and a CRC-32 over the sequence number and payload, so
+ * a record torn by a power loss is skipped and the previous one is used instead.
+ *
+ * On open(), the first slot of each sector tells which sector was written last, and only
+ * that sector is scanned; this keeps recovery at S+N slot reads.
+ *
+ * The older records stay readable until their sector is erased, so for_each() can also
+ * read the log back as a history, e.g. for an event log.
+ *
+ * The log only talks to flash through FlashLogIo, so it can be exercised on a host
+ * against a simulated flash, see tests/host/test_flash_log.cpp.
+ *
+ * Intended for use in the single-threaded ESPHome main task.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+#ifndef __cplusplus
+# error "Requires C++ compilation"
+#endif
+
+#include <esp_system.h>
+#include <esp_types.h>
+
+namespace esphome {
+namespace opnpool {
+
+#ifndef PACK8
+# define PACK8 __attribute__((aligned( __alignof__(uint8_t)), packed))
+#endif
+
+/**
+ * @brief Flash access for FlashLog.
+ *
+ * @details
+ * Offsets are relative to the start of the region. Like NOR flash, erasing sets a whole
+ * sector to 0xFF, and writing can only clear bits.
+ */
+class FlashLogIo {
+
+  public:
+    virtual ~FlashLogIo() = default;
+
+    virtual esp_err_t read(uint32_t const offset, void * const dst, size_t const len) = 0;
+    virtual esp_err_t write(uint32_t const offset, void const * const src, size_t const len) = 0;
+    virtual esp_err_t erase_sector(uint32_t const offset) = 0;
+    [[nodiscard]] virtual uint32_t size() const = 0;         ///< Size of the region in bytes.
+    [[nodiscard]] virtual uint32_t sector_size() const = 0;  ///< Size of an erase sector in bytes.
+};
+
+/// @brief Header of each record in the log.
+struct flash_log_hdr_t {
+    uint16_t magic;  ///< FlashLog::MAGIC, or 0xFFFF for an erased slot.
+    uint8_t  tag;    ///< Identifies the payload format; records with a different tag are ignored.
+    uint8_t  len;    ///< Payload length.
+    uint32_t seq;    ///< Incremented with every record written.
+    uint32_t crc;    ///< CRC-32 over seq and the payload.
+} PACK8;
+
+/// @brief Statistics of a FlashLog.
+struct flash_log_stats_t {
+    uint32_t writes;     ///< Records written since open().
+    uint32_t erases;     ///< Sectors erased since open().
+    uint32_t skipped;    ///< Slots skipped because they weren't blank.
+    uint32_t recovered;  ///< Sequence number of the record found by open(), 0 if none.
+};
+
+/**
+ * @brief Called by FlashLog::for_each() for each record.
+ *
+ * @param[in] ctx     Context given to for_each().
+ * @param[in] seq     Sequence number of the record.
+ * @param[in] payload The record.
+ * @return            True to continue, false to stop.
+ */
+using flash_log_visit_t = bool (*)(void * const ctx, uint32_t const seq, void const * const payload);
+
+/**
+ * @brief Log of fixed-size records in raw flash, wear-levelled over its sectors.
+ */
+class FlashLog {
+
+  public:
+    static constexpr uint16_t MAGIC       = 0x4C46;  ///< "FL", identifies a record.
+    static constexpr uint8_t  MAX_PAYLOAD = 240;     ///< Largest payload.
+    static constexpr uint8_t  MAX_SECTORS = 64;      ///< Most sectors used from the region.
+
+    /**
+     * @param[in] io  Flash region that holds the log.
+     * @param[in] tag Identifies the payload format, e.g. a version number.
+     * @param[in] len Payload length, at most MAX_PAYLOAD.
+     */
+    FlashLog(FlashLogIo * const io, uint8_t const tag, uint8_t const len);
+
+    /**
+     * @brief Finds the last record and where to append the next one.
+     *
+     * @param[out] payload Receives the last record, untouched if there is none.
+     * @return             ESP_OK if a record was found, ESP_ERR_NOT_FOUND if the log is
+     *                     empty, or an error if the region can't be used.
+     */
+    [[nodiscard]] esp_err_t open(void * const payload);
+
+    /**
+     * @brief Appends a record.
+     *
+     * @param[in] payload The record, of the length given to the constructor.
+     * @return            ESP_OK, or an error if the flash access failed.
+     */
+    esp_err_t append(void const * const payload);
+
+    /**
+     * @brief Visits the records in the log, oldest first.
+     *
+     * @param[in] visit Called for each record.
+     * @param[in] ctx   Passed to visit.
+     * @return          ESP_OK, or ESP_ERR_INVALID_STATE if the log isn't open.
+     */
+    esp_err_t for_each(flash_log_visit_t const visit, void * const ctx);
+
+    [[nodiscard]] flash_log_stats_t get_stats() const { return stats_; }  ///< Returns the statistics.
+
+  private:
+    static constexpr uint16_t MAX_SLOT = (sizeof(flash_log_hdr_t) + MAX_PAYLOAD + 3) & ~3U;
+
+    [[nodiscard]] esp_err_t read_slot_(uint8_t const sector, uint16_t const slot, uint8_t * const buf);
+    [[nodiscard]] bool is_valid_(uint8_t const * const buf, uint32_t * const seq) const;
+    [[nodiscard]] bool first_seq_(uint8_t const sector, uint32_t * const seq);
+    [[nodiscard]] uint16_t scan_sector_(uint8_t const sector, uint8_t * const payload, bool * const found);
+
+    FlashLogIo *      io_;           ///< Flash region.
+    uint8_t           tag_;          ///< Payload format.
+    uint8_t           len_;          ///< Payload length.
+    uint16_t          slot_size_;    ///< Header and payload, padded to 4 bytes.
+    uint32_t          sector_size_;  ///< Size of an erase sector.
+    uint16_t          slots_;        ///< Slots per sector.
+    uint8_t           sectors_;      ///< Sectors in the region.
+    uint8_t           sector_;       ///< Sector that receives the next record.
+    uint16_t          slot_;         ///< Slot that receives the next record.
+    uint32_t          seq_;          ///< Sequence number of the last record.
+    bool              opened_;       ///< True once open() succeeded.
+    flash_log_stats_t stats_;        ///< Statistics.
+};
+
+}  // namespace opnpool
+}  // namespace esphome
@@ -0,0 +1,178 @@
+/**
+ * @file json_writer.cpp
+ * @brief Streaming JSON writer into a fixed buffer.
+ *
+ * @details
+ * Implements JsonWriter. The output matches what cJSON_PrintUnformatted() produces for
+ * the same sequence of items, but is written in a single pass without allocating memory.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <esp_system.h>
+#include <esp_types.h>
+#include <stdio.h>
+
+#include "json_writer.h"
+#pragma GCC diagnostic error "-Wall"
+#pragma GCC diagnostic error "-Wextra"
+#pragma GCC diagnostic error "-Wunused-parameter"
+
+namespace esphome {
+namespace opnpool {
+
+JsonWriter::JsonWriter(char * const buf, size_t const size) :
+    buf_{buf}, size_{size}, len_{0}, depth_{0}, has_item_{0}, overflow_{buf == nullptr || size == 0}
+{
+    if (!overflow_) {
+        buf_[0] = '\0';
+    }
+}
+
+/**
+ * @brief Appends a character, keeping the buffer null-terminated.
+ */
+void
+JsonWriter::put_(char const c)
+{
+    if (overflow_ || len_ + 1 >= size_) {
+        overflow_ = true;
+        return;
+    }
+    buf_[len_++] = c;
+    buf_[len_] = '\0';
+}
+
+void
+JsonWriter::put_raw_(char const * str)
+{
+    while (*str) {
+        put_(*str++);
+    }
+}
+
+/**
+ * @brief Appends a quoted string, escaping it as needed.
+ */
+void
+JsonWriter::put_quoted_(char const * str)
+{
+    put_('"');
+    for (; *str; str++) {
+        char const c = *str;
+        switch (c) {
+            case '"':  put_raw_("\\\""); break;
+            case '\\': put_raw_("\\\\"); break;
+            case '\b': put_raw_("\\b"); break;
+            case '\f': put_raw_("\\f"); break;
+            case '\n': put_raw_("\\n"); break;
+            case '\r': put_raw_("\\r"); break;
+            case '\t': put_raw_("\\t"); break;
+            default:
+                if (static_cast<uint8_t>(c) < 0x20) {
+                    char esc[7];  // "\u00XX\0"
+                    snprintf(esc, sizeof(esc), "\\u%04x", static_cast<uint8_t>(c));
+                    put_raw_(esc);
+                } else {
+                    put_(c);
+                }
+        }
+    }
+    put_('"');
+}
+
+/**
+ * @brief Appends the comma and key that precede an item.
+ *
+ * @param[in] key The key, or nullptr for array elements and the root.
+ */
+void
+JsonWriter::separator_(char const * const key)
+{
+    uint32_t const bit = 1UL << depth_;
+    if (has_item_ & bit) {
+        put_(',');
+    }
+    has_item_ |= bit;
+
+    if (key != nullptr) {
+        put_quoted_(key);
+        put_(':');
+    }
+}
+
+void
+JsonWriter::begin_(char const * const key, char const open)
+{
+    if (depth_ + 1 >= MAX_DEPTH) {
+        overflow_ = true;
+        return;
+    }
+    separator_(key);
+    put_(open);
+    depth_++;
+    has_item_ &= ~(1UL << depth_);
+}
+
+void
+JsonWriter::end_(char const close)
+{
+    if (depth_ == 0) {
+        return;
+    }
+    depth_--;
+    put_(close);
+}
+
+void
+JsonWriter::begin_object(char const * const key)
+{
+    begin_(key, '{');
+}
+
+void
+JsonWriter::end_object()
+{
+    end_('}');
+}
+
+void
+JsonWriter::begin_array(char const * const key)
+{
+    begin_(key, '[');
+}
+
+void
+JsonWriter::end_array()
+{
+    end_(']');
+}
+
+void
+JsonWriter::add_bool(char const * const key, bool const value)
+{
+    separator_(key);
+    put_raw_(value ? "true" : "false");
+}
+
+void
+JsonWriter::add_number(char const * const key, int32_t const value)
+{
+    char str[12];  // "-2147483648\0"
+    snprintf(str, sizeof(str), "%ld", static_cast<long>(value));
+
+    separator_(key);
+    put_raw_(str);
+}
+
+void
+JsonWriter::add_string(char const * const key, char const * const value)
+{
+    separator_(key);
+    put_quoted_(value != nullptr ? value : "");
+}
+
+}  // namespace opnpool
+}  // namespace esphome
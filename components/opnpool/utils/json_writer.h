@@ -0,0 +1,74 @@
+/**
+ * @file json_writer.h
+ * @brief Streaming JSON writer into a fixed buffer.
+ *
+ * @details
+ * Writes compact JSON text directly into a caller-provided buffer, without building a
+ * tree and without heap allocations. Objects and arrays are opened and closed in the
+ * order they appear in the output, so a nested item must be closed before anything else
+ * is added to its parent. When the buffer is full, the output is truncated (but stays
+ * null-terminated) and overflowed() returns true.
+ *
+ * Used for the verbose debug output of poolstate_rx.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+#ifndef __cplusplus
+# error "Requires C++ compilation"
+#endif
+
+#include <esp_system.h>
+#include <esp_types.h>
+
+namespace esphome {
+namespace opnpool {
+
+/**
+ * @brief Appends JSON text to a fixed buffer.
+ *
+ * @details
+ * A `key` of nullptr adds the value without a key, as needed for the root object and for
+ * array elements.
+ */
+class JsonWriter {
+
+  public:
+    static constexpr uint8_t MAX_DEPTH = 32;  ///< Maximum nesting of objects and arrays.
+
+    JsonWriter(char * const buf, size_t const size);
+
+    void begin_object(char const * const key);
+    void end_object();
+    void begin_array(char const * const key);
+    void end_array();
+
+    void add_bool(char const * const key, bool const value);
+    void add_number(char const * const key, int32_t const value);
+    void add_string(char const * const key, char const * const value);
+
+    [[nodiscard]] char const * c_str() const { return buf_; }          ///< Returns the JSON text.
+    [[nodiscard]] size_t       length() const { return len_; }         ///< Returns the length of the JSON text.
+    [[nodiscard]] bool         overflowed() const { return overflow_; }  ///< True if output was truncated.
+
+  private:
+    void begin_(char const * const key, char const open);
+    void end_(char const close);
+    void separator_(char const * const key);
+    void put_(char const c);
+    void put_raw_(char const * str);
+    void put_quoted_(char const * str);
+
+    char *   buf_;       ///< Output buffer.
+    size_t   size_;      ///< Size of the output buffer.
+    size_t   len_;       ///< Number of characters written.
+    uint8_t  depth_;     ///< Current nesting level.
+    uint32_t has_item_;  ///< Bit n set if the container at level n already has an item.
+    bool     overflow_;  ///< True once output didn't fit.
+};
+
+}  // namespace opnpool
+}  // namespace esphome
@@ -0,0 +1,49 @@
+/**
+ * @file partition_io.h
+ * @brief FlashLogIo for a data partition.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+#ifndef __cplusplus
+# error "Requires C++ compilation"
+#endif
+
+#include <esp_system.h>
+#include <esp_types.h>
+#include <esp_partition.h>
+
+#include "flash_log.h"
+
+namespace esphome {
+namespace opnpool {
+
+/**
+ * @brief FlashLogIo for a data partition.
+ */
+class PartitionIo : public FlashLogIo {
+
+  public:
+    explicit PartitionIo(esp_partition_t const * const partition) : partition_{partition} {}
+
+    esp_err_t read(uint32_t const offset, void * const dst, size_t const len) override {
+        return esp_partition_read(partition_, offset, dst, len);
+    }
+    esp_err_t write(uint32_t const offset, void const * const src, size_t const len) override {
+        return esp_partition_write(partition_, offset, src, len);
+    }
+    esp_err_t erase_sector(uint32_t const offset) override {
+        return esp_partition_erase_range(partition_, offset, partition_->erase_size);
+    }
+    uint32_t size() const override        { return partition_->size; }
+    uint32_t sector_size() const override { return partition_->erase_size; }
+
+  private:
+    esp_partition_t const * partition_;
+};
+
+}  // namespace opnpool
+}  // namespace esphome
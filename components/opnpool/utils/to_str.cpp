@@ -1,16 +1,18 @@
 /**
  * @file to_str.cpp
- * @brief Helper functions for converting values to strings using a fixed buffer.
+ * @brief Helper functions for converting values to strings using per-task arenas.
  *
  * @details
  * Provides lightweight, allocation-free string conversion utilities for unsigned integers
- * and booleans, optimized for embedded environments. All conversions use a shared
- * fixed-size buffer to minimize memory usage and avoid dynamic allocation. These
- * functions are used throughout the OPNpool component for logging, diagnostics, and
- * protocol message formatting.
+ * and booleans, optimized for embedded environments. Booleans and uint8_t values come
+ * from constant tables. The other conversions use a fixed-size arena per task, to
+ * minimize memory usage and avoid dynamic allocation. These functions are used
+ * throughout the OPNpool component for logging, diagnostics, and protocol message
+ * formatting.
  *
- * ESPHome operates in a single-threaded environment, so explicit thread safety measures
- * are not required within the pool_task context.
+ * The main task and the pool_task both format strings. Each owns an arena, found by
+ * comparing task handles, so formatting needs no locks. Only to_str_bind_task() takes a
+ * spinlock, once per task.
  *
  * @author Coert Vonk (@cvonk on GitHub)
  * @copyright Copyright (c) 2014, 2019, 2022, 2026 Coert Vonk
@@ -20,36 +22,144 @@
 #include <esp_system.h>
 #include <esp_types.h>
 #include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 #include "to_str.h"
 #pragma GCC diagnostic error "-Wall"
 #pragma GCC diagnostic error "-Wextra"
 #pragma GCC diagnostic error "-Wunused-parameter"
 
-#ifndef ARRAY_SIZE
-# define ARRAY_SIZE(a) (sizeof(a) / sizeof(*(a)))
-#endif
-
 namespace esphome {
 namespace opnpool {
 
-name_str_t name_str = {
-    .str = {0},
-    .idx = 0,
-    .noMem = "sNOMEM", // increase size of str.str[]
-    .digits = "0123456789ABCDEF",
+constexpr char const * const NO_MEM = "sNOMEM";  // increase TO_STR_ARENA_SIZE, or call to_str_bind_task()
+constexpr char const * const DIGITS = "0123456789ABCDEF";
+
+/// @brief String buffer owned by one task.
+struct to_str_arena_t {
+    char          str[TO_STR_ARENA_SIZE];  ///< Conversion buffer.
+    uint_least8_t idx;                     ///< Current write index into the buffer.
+    uint_least8_t depth;                   ///< Number of to_str_scope_t's alive.
+    bool          bound;                   ///< True once a task claimed the arena.
+    TaskHandle_t  task;                    ///< Task that owns the arena.
 };
 
+static to_str_arena_t _arenas[TO_STR_ARENA_COUNT] = {};
+static portMUX_TYPE _bind_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/// @brief "00" to "FF", null terminated, so uint8_t values don't need an arena.
+struct hex8_table_t {
+    char str[256][3];
+};
+
+static constexpr hex8_table_t
+_make_hex8_table()
+{
+    hex8_table_t table = {};
+    for (uint16_t value = 0; value < 256; value++) {
+        table.str[value][0] = DIGITS[value >> 4];
+        table.str[value][1] = DIGITS[value & 0x0F];
+        table.str[value][2] = '\0';
+    }
+    return table;
+}
+
+static constexpr hex8_table_t _hex8 = _make_hex8_table();
+
+    // arena of the calling task, or nullptr if it didn't call to_str_bind_task()
+static to_str_arena_t *
+_arena()
+{
+    TaskHandle_t const self = xTaskGetCurrentTaskHandle();
+    for (auto & arena : _arenas) {
+        if (arena.bound && arena.task == self) {
+            return &arena;
+        }
+    }
+    return nullptr;
+}
+
+    // reserves len bytes in the arena of the calling task, or returns nullptr
+static char *
+_alloc(size_t const len)
+{
+    to_str_arena_t * const arena = _arena();
+    if (!arena || arena->idx + len > TO_STR_ARENA_SIZE) {
+        return nullptr;
+    }
+    char * const s = arena->str + arena->idx;
+    arena->idx += len;
+    return s;
+}
+
 /**
- * @brief Resets the index of the shared string buffer used for value-to-string conversions.
+ * @brief Claims an arena for the calling task.
  *
- * @details
- * This function should be called periodically to avoid running out of buffer space.
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if all arenas are taken.
  */
-void
-name_reset_idx()
+esp_err_t
+to_str_bind_task()
 {
-    name_str.idx = 0;
+    TaskHandle_t const self = xTaskGetCurrentTaskHandle();
+    esp_err_t result = ESP_ERR_NO_MEM;
+
+    portENTER_CRITICAL(&_bind_lock);
+    for (auto & arena : _arenas) {
+        if (arena.bound && arena.task == self) {
+            result = ESP_OK;  // already bound
+            break;
+        }
+    }
+    if (result != ESP_OK) {
+        for (auto & arena : _arenas) {
+            if (!arena.bound) {
+                arena.task = self;
+                arena.idx = 0;
+                arena.depth = 0;
+                arena.bound = true;
+                result = ESP_OK;
+                break;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&_bind_lock);
+
+    return result;
+}
+
+/**
+ * @brief Opens a scope in the arena of the calling task.
+ */
+to_str_scope_t::to_str_scope_t()
+    : arena_{_arena()}, mark_{arena_ ? arena_->idx : uint_least8_t(0)}
+{
+    if (arena_) {
+        arena_->depth++;
+    }
+}
+
+/**
+ * @brief Closes the scope, releasing the strings formatted since it was opened.
+ */
+to_str_scope_t::~to_str_scope_t()
+{
+    if (arena_) {
+        arena_->depth--;
+        arena_->idx = arena_->depth == 0 ? 0 : mark_;
+    }
+}
+
+/**
+ * @brief                    Get a hexadecimal string view of a uint8_t, without an arena
+ *
+ * @param value              The uint8_t value to convert
+ * @return std::string_view  Two hex digits, null terminated
+ */
+std::string_view
+uint8_sv(uint8_t const value)
+{
+    return std::string_view(_hex8.str[value], 2);
 }
 
 /**
@@ -61,15 +171,7 @@ name_reset_idx()
 char const *
 bool_str(bool const value)
 {
-    char const * const value_str = value ? "true" : "false";
-    uint8_t const len = strlen(value_str) + 1;  // +1 for null terminator
-    if (name_str.idx + len >= ARRAY_SIZE(name_str.str)) {
-        return name_str.noMem;
-    }
-    char * s = name_str.str + name_str.idx;
-    strcpy(s, value_str);
-    name_str.idx += len;
-    return s;
+    return value ? "true" : "false";
 }
 
 /**
@@ -81,17 +183,7 @@ bool_str(bool const value)
 char const *
 uint8_str(uint8_t const value)
 {
-    uint_least8_t const nrdigits = sizeof(value) << 1;
-
-    if (name_str.idx + nrdigits + 1U >= ARRAY_SIZE(name_str.str)) {
-        return name_str.noMem;  // increase size of str.str[]
-    }
-    char * s = name_str.str + name_str.idx;
-    s[0] = name_str.digits[(value & 0xF0) >> 4];
-    s[1] = name_str.digits[(value & 0x0F)];
-    s[nrdigits] = '\0';
-    name_str.idx += nrdigits + 1U;
-    return s;
+    return _hex8.str[value];
 }
 
 /**
@@ -105,16 +197,15 @@ uint16_str(uint16_t const value)
 {
     uint_least8_t const nrdigits = sizeof(value) << 1;
 
-    if (name_str.idx + nrdigits + 1U >= ARRAY_SIZE(name_str.str)) {
-        return name_str.noMem;  // to prevent this, increase the size of str.str[]
+    char * const s = _alloc(nrdigits + 1U);
+    if (!s) {
+        return NO_MEM;
     }
-    char * s = name_str.str + name_str.idx;
-    s[0] = name_str.digits[(value & 0xF000) >> 12];
-    s[1] = name_str.digits[(value & 0x0F00) >>  8];
-    s[2] = name_str.digits[(value & 0x00F0) >>  4];
-    s[3] = name_str.digits[(value & 0x000F)];
+    s[0] = DIGITS[(value & 0xF000) >> 12];
+    s[1] = DIGITS[(value & 0x0F00) >>  8];
+    s[2] = DIGITS[(value & 0x00F0) >>  4];
+    s[3] = DIGITS[(value & 0x000F)];
     s[nrdigits] = '\0';
-    name_str.idx += nrdigits + 1U;
     return s;
 }
 
@@ -129,20 +220,19 @@ uint32_str(uint32_t const value)
 {
     uint_least8_t const nrdigits = sizeof(value) << 1;
 
-    if (name_str.idx + nrdigits + 1U >= ARRAY_SIZE(name_str.str)) {
-        return name_str.noMem;  // to prevent this, increase the size of str.str[]
+    char * const s = _alloc(nrdigits + 1U);
+    if (!s) {
+        return NO_MEM;
     }
-    char * s = name_str.str + name_str.idx;
-    s[0] = name_str.digits[(value & 0xF0000000) >> 28];
-    s[1] = name_str.digits[(value & 0x0F000000) >> 24];
-    s[2] = name_str.digits[(value & 0x00F00000) >> 20];
-    s[3] = name_str.digits[(value & 0x000F0000) >> 16];
-    s[4] = name_str.digits[(value & 0x0000F000) >> 12];
-    s[5] = name_str.digits[(value & 0x00000F00) >>  8];
-    s[6] = name_str.digits[(value & 0x000000F0) >>  4];
-    s[7] = name_str.digits[(value & 0x0000000F)];
+    s[0] = DIGITS[(value & 0xF0000000) >> 28];
+    s[1] = DIGITS[(value & 0x0F000000) >> 24];
+    s[2] = DIGITS[(value & 0x00F00000) >> 20];
+    s[3] = DIGITS[(value & 0x000F0000) >> 16];
+    s[4] = DIGITS[(value & 0x0000F000) >> 12];
+    s[5] = DIGITS[(value & 0x00000F00) >>  8];
+    s[6] = DIGITS[(value & 0x000000F0) >>  4];
+    s[7] = DIGITS[(value & 0x0000000F)];
     s[nrdigits] = '\0';
-    name_str.idx += nrdigits + 1U;
     return s;
 }
 
@@ -158,12 +248,11 @@ char const *
 date_str(uint16_t const year, uint8_t const month, uint8_t const day)
 {
     size_t const len = 14;  // worst case: "65535-255-255\0"
-    if (name_str.idx + len >= ARRAY_SIZE(name_str.str)) {
-        return name_str.noMem;  // increase size of str.str[]
+    char * const s = _alloc(len);
+    if (!s) {
+        return NO_MEM;
     }
-    char * s = name_str.str + name_str.idx;
     snprintf(s, len, "%04u-%02u-%02u", 2000 + year, month, day);
-    name_str.idx += len;
     return s;
 }
 
@@ -178,12 +267,11 @@ char const *
 time_str(uint8_t const hour, uint8_t const minute)
 {
     size_t const len = 8;  // worst case: "255:255\0"
-    if (name_str.idx + len >= ARRAY_SIZE(name_str.str)) {
-        return name_str.noMem;  // increase size of str.str[]
+    char * const s = _alloc(len);
+    if (!s) {
+        return NO_MEM;
     }
-    char * s = name_str.str + name_str.idx;
     snprintf(s, len, "%02u:%02u", hour, minute);
-    name_str.idx += len;
     return s;
 }
 
@@ -198,14 +286,13 @@ char const *
 version_str(uint8_t const major, uint8_t const minor)
 {
     size_t const len = 8;  // "MMM.mmm\0"
-    if (name_str.idx + len >= ARRAY_SIZE(name_str.str)) {
-        return name_str.noMem;  // increase size of str.str[]
+    char * const s = _alloc(len);
+    if (!s) {
+        return NO_MEM;
     }
-    char * s = name_str.str + name_str.idx;
     snprintf(s, len, "%u.%u", major, minor);
-    name_str.idx += len;
     return s;
 }
 
 } // namespace opnpool
-} // namespace esphome
\ No newline at end of file
+} // namespace esphome
@@ -3,9 +3,21 @@
  * @brief String conversion utilities for logging and debugging
  *
  * @details
- * Provides functions to convert various data types to string representations
- * using a shared buffer. The buffer is reset via name_reset_idx() before each
- * packet processing cycle.
+ * Provides functions to convert various data types to string representations.
+ *
+ * Booleans and uint8_t values come from constant tables, so they never run out and can
+ * be used from any task. The other conversions format into a small arena that belongs
+ * to the calling task. Each task that formats claims its arena once with
+ * to_str_bind_task(). A to_str_scope_t releases the strings formatted during its
+ * lifetime, so a task's processing cycle runs in one scope:
+ *
+ *     void loop() {
+ *         to_str_scope_t const scope;   // strings live until the end of this cycle
+ *         ...
+ *     }
+ *
+ * Because every task has its own arena, no locks are needed and one task can't
+ * overwrite strings that another task is still logging.
  *
  * @author Coert Vonk (@cvonk on GitHub)
  * @copyright Copyright (c) 2014, 2019, 2022, 2026 Coert Vonk
@@ -19,31 +31,61 @@
 
 #include <esp_system.h>
 #include <esp_types.h>
+#include <string_view>
 
 namespace esphome {
 namespace opnpool {
 
-    /// Buffer must be at least ((sizeof(datalink_hdr_t) +
+    /// Arena must be at least ((sizeof(datalink_hdr_t) +
     /// sizeof(network_ctrl_state_bcast_t) + 1) * 3 + 50). That is 3 bytes for each hex
     /// value when displaying raw, and another 50 for displaying date/time.
-constexpr size_t TO_STR_BUF_SIZE = 200;
-
-/// @brief Reusable global string buffer for to_str conversions.
-struct name_str_t {
-    char str[TO_STR_BUF_SIZE];  ///< Shared conversion buffer.
-    uint_least8_t idx;           ///< Current write index into the buffer.
-    char const * const noMem;    ///< Returned when buffer space is exhausted.
-    char const * const digits;   ///< Hex digit lookup table.
+constexpr size_t TO_STR_ARENA_SIZE = 200;
+
+    /// One arena for the main task and one for the pool_task.
+constexpr uint8_t TO_STR_ARENA_COUNT = 2;
+
+static_assert(TO_STR_ARENA_SIZE <= UINT8_MAX, "arena index is a uint8_t");
+
+    // forward declarations (to avoid exposing FreeRTOS types)
+struct to_str_arena_t;
+
+/**
+ * @brief Releases the arena strings that the calling task formats during its lifetime.
+ *
+ * @details
+ * Scopes nest. The outermost scope empties the arena when it ends, so strings formatted
+ * outside any scope (e.g. in an ESPHome callback) are reclaimed at the end of the
+ * task's next cycle.
+ */
+class to_str_scope_t {
+  public:
+    to_str_scope_t();
+    ~to_str_scope_t();
+    to_str_scope_t(to_str_scope_t const &) = delete;
+    to_str_scope_t & operator=(to_str_scope_t const &) = delete;
+
+  private:
+    to_str_arena_t * const arena_;  ///< Arena of the task that created the scope, or nullptr.
+    uint_least8_t const    mark_;   ///< Arena index to return to.
 };
 
-extern name_str_t name_str;
+/**
+ * @brief Claims an arena for the calling task. Call once, before it formats anything.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if all TO_STR_ARENA_COUNT arenas are taken.
+ */
+esp_err_t to_str_bind_task();
 
 /// @name String Conversion Functions
-/// @brief Convert values to string representations in the shared buffer.
+/// @brief Convert values to string representations.
 /// @{
 
+    // constant, from any task
+[[nodiscard]] std::string_view uint8_sv(uint8_t const value);
 [[nodiscard]] char const * bool_str(bool const value);
 [[nodiscard]] char const * uint8_str(uint8_t const value);
+
+    // in the arena of the calling task
 [[nodiscard]] char const * uint16_str(uint16_t const value);
 [[nodiscard]] char const * uint32_str(uint32_t const value);
 [[nodiscard]] char const * date_str(uint16_t const year, uint8_t const month, uint8_t const day);
@@ -52,8 +94,5 @@ extern name_str_t name_str;
 
 /// @}
 
-/// @brief Reset the shared buffer write index. Call before processing each packet.
-void name_reset_idx();
-
 } // namespace opnpool
-} // namespace esphome
\ No newline at end of file
+} // namespace esphome
@@ -0,0 +1,87 @@
+/**
+ * @file bench_enum_lookup.cpp
+ * @brief Host benchmark of the enum name tables against calling magic_enum at run time.
+ *
+ * @details
+ * For a message type enum generated from NETWORK_MSG_TYP_LIST, a sparse protocol enum
+ * and a short enum, it checks that enum_sv() gives the magic_enum name of every value
+ * in 0..0xFF, and that enum_lookup() finds every name in lower case and rejects
+ * unknown ones. It then times both directions against magic_enum::enum_name() and the
+ * strcasecmp() loop over the names that enum_nr() used before.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <string>
+#include <strings.h>
+#include <vector>
+
+#include "host_test.h"
+#include "pool_task/network_msg.h"
+#include "utils/to_str.cpp"
+
+using namespace esphome::opnpool;
+
+static volatile size_t sink = 0;  // keeps the results alive
+
+template<typename EnumT>
+static bool
+_loop_lookup(char const * const name, EnumT * const value)
+{
+    for (auto const candidate : magic_enum::enum_values<EnumT>()) {
+        if (strcasecmp(name, magic_enum::enum_name(candidate).data()) == 0) {
+            *value = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename EnumT>
+static void
+_bench(char const * const name)
+{
+    for (unsigned raw = 0; raw <= UINT8_MAX; raw++) {
+        auto const value = static_cast<EnumT>(raw);
+        std::string_view const expected = magic_enum::enum_name(value);
+        CHECK(enum_sv(value) == (expected.empty() ? uint8_sv(static_cast<uint8_t>(raw)) : expected));
+    }
+
+    std::vector<std::string> lower;
+    for (auto const value : magic_enum::enum_values<EnumT>()) {
+        std::string name(magic_enum::enum_name(value));
+        for (auto & c : name) {
+            c = static_cast<char>(tolower(c));
+        }
+        EnumT found;
+        CHECK(enum_lookup(name, &found) && found == value);
+        lower.push_back(name);
+    }
+    EnumT found;
+    CHECK(!enum_lookup("NO_SUCH_NAME", &found));
+    CHECK(!enum_lookup("", &found));
+
+    auto const values = magic_enum::enum_values<EnumT>();
+    size_t idx = 0;
+    double const table_str_ns = host_bench_ns([&] { sink = enum_sv(values[idx++ % values.size()]).size(); });
+    double const magic_str_ns = host_bench_ns([&] { sink = magic_enum::enum_name(values[idx++ % values.size()]).size(); });
+    double const hash_ns = host_bench_ns([&] {
+        sink = enum_lookup(std::string_view(lower[idx++ % lower.size()]), &found);
+    });
+    double const loop_ns = host_bench_ns([&] { sink = _loop_lookup(lower[idx++ % lower.size()].c_str(), &found); });
+
+    printf("  %-20s %2lu names: name %4.1f ns (magic_enum %4.1f ns), lookup %4.1f ns (loop %6.1f ns)\n", name,
+           static_cast<unsigned long>(values.size()), table_str_ns, magic_str_ns, hash_ns, loop_ns);
+}
+
+int
+main()
+{
+    _bench<network_msg_typ_t>("network_msg_typ_t");
+    _bench<datalink_ctrl_typ_t>("datalink_ctrl_typ_t");
+    _bench<network_heat_src_t>("network_heat_src_t");
+
+    return host_test_result("bench_enum_lookup");
+}
@@ -0,0 +1,284 @@
+/**
+ * @file bench_json_writer.cpp
+ * @brief Host benchmark of the streaming JsonWriter against a cJSON-style tree.
+ *
+ * @details
+ * The verbose log of a received message used to be built as a cJSON tree and then
+ * printed. JsonWriter streams the same text into a fixed buffer instead. For the
+ * messages with the largest logs, this times poolstate_rx_log writing into a JsonWriter,
+ * and times building, printing and freeing a tree with the same items the way cJSON
+ * does: a heap node per item, a copy of each key and string, and a print buffer that
+ * starts at 256 bytes, doubles, and shrinks to fit. The tree is replayed from the items
+ * in the JsonWriter output, so it skips the enum lookups and number formatting, which
+ * favors the tree. The printed tree must match the JsonWriter output byte for byte.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "host_test.h"
+#include "core/poolstate_rx_log.cpp"
+#include "utils/json_writer.cpp"
+#include "utils/to_str.cpp"
+
+using namespace esphome::opnpool;
+using namespace esphome::opnpool::poolstate_rx;
+
+static size_t allocs = 0;
+
+static void *
+_counted_alloc(size_t const size)
+{
+    allocs++;
+    return malloc(size);
+}
+
+static char *
+_strdup(std::string const & str)
+{
+    char * const copy = static_cast<char *>(_counted_alloc(str.size() + 1));
+    memcpy(copy, str.c_str(), str.size() + 1);
+    return copy;
+}
+
+    // one item of the JSON text, as the log functions added it
+struct item_t {
+    char        typ;    // '{', '[', '}', ']', 's'tring, 'n'umber, 'b'ool
+    std::string key;    // empty inside arrays
+    std::string value;  // text of a string, number or bool
+};
+
+static std::vector<item_t>
+_items(char const * json)
+{
+    std::vector<item_t> items;
+    std::string key;
+    while (*json) {
+        char const c = *json++;
+        if (c == ',' || c == ':') {
+            continue;
+        }
+        if (c == '{' || c == '[' || c == '}' || c == ']') {
+            items.push_back({c, c == '{' || c == '[' ? key : "", ""});
+            key.clear();
+            continue;
+        }
+        std::string token;
+        if (c == '"') {
+            while (*json != '"') {
+                token += *json++;
+            }
+            json++;
+            if (*json == ':') {
+                key = token;
+                continue;
+            }
+            items.push_back({'s', key, token});
+        } else {
+            token += c;
+            while (*json && !strchr(",}]", *json)) {
+                token += *json++;
+            }
+            items.push_back({token == "true" || token == "false" ? 'b' : 'n', key, token});
+        }
+        key.clear();
+    }
+    return items;
+}
+
+    // a cJSON node: sibling list, child list, copied key and string
+struct node_t {
+    node_t * next;
+    node_t * child;
+    char     typ;
+    char *   key;
+    char *   str;
+    int32_t  num;
+    bool     flag;
+};
+
+static node_t *
+_build(std::vector<item_t> const & items, size_t & idx)
+{
+    item_t const & item = items[idx++];
+    node_t * const node = static_cast<node_t *>(_counted_alloc(sizeof(node_t)));
+    *node = {nullptr, nullptr, item.typ, item.key.empty() ? nullptr : _strdup(item.key), nullptr, 0, false};
+    switch (item.typ) {
+        case '{':
+        case '[': {
+            node_t ** tail = &node->child;
+            while (items[idx].typ != '}' && items[idx].typ != ']') {
+                *tail = _build(items, idx);
+                tail = &(*tail)->next;
+            }
+            idx++;
+            break;
+        }
+        case 's': node->str = _strdup(item.value); break;
+        case 'n': node->num = atoi(item.value.c_str()); break;
+        case 'b': node->flag = item.value == "true"; break;
+    }
+    return node;
+}
+
+struct print_buf_t {
+    char * buf;
+    size_t size;
+    size_t len;
+};
+
+static void
+_put(print_buf_t & out, char const * const str, size_t const len)
+{
+    if (out.len + len + 1 > out.size) {
+        while (out.len + len + 1 > out.size) {
+            out.size *= 2;
+        }
+        char * const grown = static_cast<char *>(_counted_alloc(out.size));
+        memcpy(grown, out.buf, out.len);
+        free(out.buf);
+        out.buf = grown;
+    }
+    memcpy(out.buf + out.len, str, len);
+    out.len += len;
+}
+
+static void
+_print(print_buf_t & out, node_t const * const node)
+{
+    if (node->key) {
+        _put(out, "\"", 1);
+        _put(out, node->key, strlen(node->key));
+        _put(out, "\":", 2);
+    }
+    switch (node->typ) {
+        case '{':
+        case '[':
+            _put(out, node->typ == '{' ? "{" : "[", 1);
+            for (node_t const * child = node->child; child; child = child->next) {
+                _print(out, child);
+                if (child->next) {
+                    _put(out, ",", 1);
+                }
+            }
+            _put(out, node->typ == '{' ? "}" : "]", 1);
+            break;
+        case 's':
+            _put(out, "\"", 1);
+            _put(out, node->str, strlen(node->str));
+            _put(out, "\"", 1);
+            break;
+        case 'n': {
+            char num[12];
+            _put(out, num, snprintf(num, sizeof(num), "%ld", static_cast<long>(node->num)));
+            break;
+        }
+        case 'b':
+            _put(out, node->flag ? "true" : "false", node->flag ? 4 : 5);
+            break;
+    }
+}
+
+static void
+_delete(node_t * node)
+{
+    while (node) {
+        node_t * const next = node->next;
+        _delete(node->child);
+        free(node->key);
+        free(node->str);
+        free(node);
+        node = next;
+    }
+}
+
+    // builds, prints and frees the tree, like cJSON_CreateObject() .. cJSON_PrintUnformatted() .. cJSON_Delete()
+static void
+_tree(std::vector<item_t> const & items, std::string * const printed)
+{
+    size_t idx = 0;
+    node_t * const root = _build(items, idx);
+    print_buf_t out = {static_cast<char *>(_counted_alloc(256)), 256, 0};
+    _print(out, root);
+    out.buf[out.len] = '\0';
+    out.buf = static_cast<char *>(realloc(out.buf, out.len + 1));
+    allocs++;
+    if (printed) {
+        printed->assign(out.buf, out.len);
+    }
+    free(out.buf);
+    _delete(root);
+}
+
+static void
+_bench(char const * const name, std::function<void(JsonWriter *)> const & log)
+{
+    static char json[1500];  // same as update_state()
+    auto const write = [&] {
+        JsonWriter writer(json, sizeof(json));
+        writer.begin_object(nullptr);
+        log(&writer);
+        writer.end_object();
+        CHECK(!writer.overflowed());
+    };
+    write();
+    size_t const len = strlen(json);
+    std::vector<item_t> const items = _items(json);
+
+    std::string printed;
+    allocs = 0;
+    _tree(items, &printed);
+    size_t const tree_allocs = allocs;
+    CHECK(printed == json);
+
+    double const writer_ns = host_bench_ns(write);
+    double const tree_ns = host_bench_ns([&] { _tree(items, nullptr); });
+    printf("  %-17s %4lu bytes: JsonWriter %5.2f us, no heap; tree %5.2f us, %3lu allocs\n", name,
+           static_cast<unsigned long>(len), writer_ns / 1000, tree_ns / 1000, static_cast<unsigned long>(tree_allocs));
+}
+
+int
+main()
+{
+    poolstate_t state = {};
+    state.system.tod = {.date = {.valid = true, .value = {.day = 18, .month = 10, .year = 26}},
+                        .time = {.valid = true, .value = {.hour = 14, .minute = 5}}};
+    state.system.version = {.valid = true, .major = 2, .minor = 80};
+    state.system.modes = {.valid = true, .value = {.bits = 0x08}};
+    state.temps[enum_index(poolstate_temp_typ_t::AIR)] = {.valid = true, .value = 64};
+    state.temps[enum_index(poolstate_temp_typ_t::WATER)] = {.valid = true, .value = 79};
+    for (auto & thermo : state.thermos) {
+        thermo = {.temp_in_f = {true, 79}, .set_point_in_f = {true, 84},
+                  .heat_src = {true, network_heat_src_t::SolarPreferred}, .heating = {true, false}};
+    }
+    for (size_t ii = 0; ii < std::size(state.circuits); ii++) {
+        state.circuits[ii] = {.active = {true, ii % 3 == 0}, .delay = {true, false}};
+        state.scheds[ii] = {.valid = true, .active = ii < 3, .start = static_cast<uint16_t>(480 + ii * 60), .stop = 960};
+    }
+    network_pump_reg_resp_t const reg = {.value = {.high = 0x0A, .low = 0x8C}};
+
+    _bench("CTRL_STATE_BCAST", [&](JsonWriter * dbg) {
+        poolstate_rx_log::add_state(dbg, poolstate_rx_log::KEY_STATE, &state);
+    });
+    _bench("CTRL_HEAT_RESP", [&](JsonWriter * dbg) {
+        poolstate_rx_log::add_thermos(dbg, poolstate_rx_log::KEY_THERMOS, state.thermos, true, true, false);
+    });
+    _bench("CTRL_SCHED_RESP", [&](JsonWriter * dbg) {
+        poolstate_rx_log::add_scheds(dbg, poolstate_rx_log::KEY_SCHEDS, state.scheds);
+    });
+    _bench("CTRL_TIME", [&](JsonWriter * dbg) {
+        poolstate_rx_log::add_time_and_date(dbg, poolstate_rx_log::KEY_TOD, &state.system.tod);
+    });
+    _bench("PUMP_REG_RESP", [&](JsonWriter * dbg) {
+        poolstate_rx_log::add_pump_reg_resp(dbg, poolstate_rx_log::KEY_RESP, datalink_pump_id_t::PRIMARY, &reg);
+    });
+
+    return host_test_result("bench_json_writer");
+}
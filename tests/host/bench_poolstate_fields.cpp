@@ -0,0 +1,130 @@
+/**
+ * @file bench_poolstate_fields.cpp
+ * @brief Host benchmark of the poolstate_fields decoder against hand-written assignments.
+ *
+ * @details
+ * Decodes PUMP_STATUS_RESP and CTRL_HEAT_RESP payloads with descriptor tables, and with
+ * the hand-written assignments that poolstate_rx.cpp used before. The tables are copies
+ * of those in poolstate_rx.cpp, which can't be built on the host. It checks that both
+ * paths give byte-identical pool state, and reports the time of each.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <random>
+
+#include "host_test.h"
+#include "core/poolstate.h"
+#include "core/poolstate_fields.h"
+#include "core/poolstate_rx_log.h"
+#include "utils/json_writer.cpp"
+
+using namespace esphome::opnpool;
+namespace log_key = poolstate_rx::poolstate_rx_log;
+using enc_t = poolstate_field_enc_t;
+
+constexpr auto _pump_status_fields = std::make_tuple(
+    poolstate_field(offsetof(network_pump_status_resp_t, mode),      enc_t::RAW,       &poolstate_pump_t::mode,  log_key::KEY_MODE),
+    poolstate_field(offsetof(network_pump_status_resp_t, clock),     enc_t::RAW,       &poolstate_pump_t::time,  log_key::KEY_TIME),
+    poolstate_field(offsetof(network_pump_status_resp_t, state),     enc_t::RAW,       &poolstate_pump_t::state, log_key::KEY_STATE),
+    poolstate_field(offsetof(network_pump_status_resp_t, power),     enc_t::U16_HI_LO, &poolstate_pump_t::power, log_key::KEY_POWER),
+    poolstate_field(offsetof(network_pump_status_resp_t, speed),     enc_t::U16_HI_LO, &poolstate_pump_t::speed, log_key::KEY_SPEED),
+    poolstate_field(offsetof(network_pump_status_resp_t, flow),      enc_t::U8,        &poolstate_pump_t::flow,  log_key::KEY_FLOW, 1, true),
+    poolstate_field(offsetof(network_pump_status_resp_t, level),     enc_t::U8,        &poolstate_pump_t::level, log_key::KEY_LEVEL, 1, true),
+    poolstate_field(offsetof(network_pump_status_resp_t, error),     enc_t::U8,        &poolstate_pump_t::error, log_key::KEY_ERROR),
+    poolstate_field(offsetof(network_pump_status_resp_t, remaining), enc_t::RAW,       &poolstate_pump_t::timer, log_key::KEY_TIMER)
+);
+static_assert(poolstate_fields::fits<network_pump_status_resp_t>(_pump_status_fields), "bad PUMP_STATUS_RESP field");
+
+constexpr auto _heat_resp_pool_fields = std::make_tuple(
+    poolstate_field(offsetof(network_ctrl_heat_resp_t, pool_temp),      enc_t::U8, &poolstate_thermo_t::temp_in_f,      nullptr),
+    poolstate_field(offsetof(network_ctrl_heat_resp_t, pool_set_point), enc_t::U8, &poolstate_thermo_t::set_point_in_f, nullptr)
+);
+constexpr auto _heat_resp_spa_fields = std::make_tuple(
+    poolstate_field(offsetof(network_ctrl_heat_resp_t, spa_temp),       enc_t::U8, &poolstate_thermo_t::temp_in_f,      nullptr),
+    poolstate_field(offsetof(network_ctrl_heat_resp_t, spa_set_point),  enc_t::U8, &poolstate_thermo_t::set_point_in_f, nullptr)
+);
+
+__attribute__((noinline)) static void
+_pump_status_hand(network_pump_status_resp_t const * const msg, poolstate_pump_t * const pump)
+{
+    *pump = {
+        .time    = {.valid = true, .value = msg->clock},
+        .mode    = {.valid = true, .value = msg->mode},
+        .running = {.valid = true, .value = msg->running.is_on()},
+        .state   = {.valid = true, .value = msg->state},
+        .power   = {.valid = true, .value = msg->power.to_uint16()},
+        .flow    = {.valid = true, .value = msg->flow},
+        .speed   = {.valid = true, .value = msg->speed.to_uint16()},
+        .level   = {.valid = true, .value = msg->level},
+        .error   = {.valid = true, .value = msg->error},
+        .timer   = {.valid = true, .value = msg->remaining}
+    };
+}
+
+__attribute__((noinline)) static void
+_pump_status_table(network_pump_status_resp_t const * const msg, poolstate_pump_t * const pump)
+{
+    pump->running = {.valid = true, .value = msg->running.is_on()};
+    poolstate_fields::decode<_pump_status_fields>(msg, pump);
+}
+
+__attribute__((noinline)) static void
+_heat_resp_hand(network_ctrl_heat_resp_t const * const msg, poolstate_thermo_t * const thermos)
+{
+    auto * const pool_thermo = &thermos[enum_index(poolstate_thermo_typ_t::POOL)];
+    auto * const spa_thermo = &thermos[enum_index(poolstate_thermo_typ_t::SPA)];
+    pool_thermo->temp_in_f = {.valid = true, .value = msg->pool_temp};
+    pool_thermo->set_point_in_f = {.valid = true, .value = msg->pool_set_point};
+    spa_thermo->temp_in_f = {.valid = true, .value = msg->spa_temp};
+    spa_thermo->set_point_in_f = {.valid = true, .value = msg->spa_set_point};
+}
+
+__attribute__((noinline)) static void
+_heat_resp_table(network_ctrl_heat_resp_t const * const msg, poolstate_thermo_t * const thermos)
+{
+    poolstate_fields::decode<_heat_resp_pool_fields>(msg, &thermos[enum_index(poolstate_thermo_typ_t::POOL)]);
+    poolstate_fields::decode<_heat_resp_spa_fields>(msg, &thermos[enum_index(poolstate_thermo_typ_t::SPA)]);
+}
+
+    // decodes every payload both ways, checks they agree, and times each way
+template<typename MSG, typename S, size_t N>
+static void
+_bench(char const * const name, void (* const hand)(MSG const *, S *), void (* const table)(MSG const *, S *))
+{
+    static MSG payloads[64];
+    std::mt19937 rng(1);
+    for (auto & payload : payloads) {
+        for (size_t ii = 0; ii < sizeof(payload); ii++) {
+            reinterpret_cast<uint8_t *>(&payload)[ii] = static_cast<uint8_t>(rng());
+        }
+    }
+    for (auto const & payload : payloads) {
+        S by_hand[N], by_table[N];
+        memset(by_hand, 0, sizeof(by_hand));  // also clears the padding that memcmp sees
+        memset(by_table, 0, sizeof(by_table));
+        hand(&payload, by_hand);
+        table(&payload, by_table);
+        CHECK(memcmp(by_hand, by_table, sizeof(by_hand)) == 0);
+    }
+
+    static S out[N];
+    size_t idx = 0;
+    double const hand_ns = host_bench_ns([&] { hand(&payloads[idx++ % std::size(payloads)], out); });
+    double const table_ns = host_bench_ns([&] { table(&payloads[idx++ % std::size(payloads)], out); });
+    printf("  %-16s hand-written %5.1f ns, table %5.1f ns\n", name, hand_ns, table_ns);
+}
+
+int
+main()
+{
+    _bench<network_pump_status_resp_t, poolstate_pump_t, 1>("PUMP_STATUS_RESP", _pump_status_hand, _pump_status_table);
+    _bench<network_ctrl_heat_resp_t, poolstate_thermo_t, enum_count<poolstate_thermo_typ_t>()>(
+        "CTRL_HEAT_RESP", _heat_resp_hand, _heat_resp_table);
+
+    return host_test_result("bench_poolstate_fields");
+}
@@ -0,0 +1,84 @@
+/**
+ * @file bench_poolstate_history.cpp
+ * @brief Host benchmark of PoolStateHistory: compression ratio and query cost.
+ *
+ * @details
+ * Feeds a synthetic day into the history: one sample a minute, with the water warming
+ * up and cooling down, the pump running from 8:00 to 16:00, the salt level stepping,
+ * loop() jitter on the sample times, and millis() wrapping mid-day. It reports the
+ * compressed and raw size, and the time of a full-day query() and of a 24-bucket
+ * downsample(). It also checks the queried points and the bucket counts against what
+ * was fed in, so the benchmark fails rather than measure a wrong answer.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <vector>
+
+#include "host_test.h"
+#include "core/poolstate_history.cpp"
+#include "utils/to_str.cpp"
+
+using namespace esphome::opnpool;
+
+constexpr uint32_t MINUTE_MS = 60 * 1000;
+constexpr uint32_t HOUR_MS = 60 * MINUTE_MS;
+
+int
+main()
+{
+    static PoolStateHistory history;
+    poolstate_t state = {};
+    auto & water = state.temps[enum_index(poolstate_temp_typ_t::WATER)];
+    auto & pump = state.pumps[enum_index(datalink_pump_id_t::PRIMARY)];
+    auto & pool = state.circuits[enum_index(network_pool_circuit_t::POOL)].active;
+
+    uint32_t const t0 = UINT32_MAX - 5 * HOUR_MS;  // millis() wraps mid-day
+    std::vector<int32_t> water_fed;
+
+    for (uint32_t minute = 0; minute < 24 * 60; minute++) {
+        bool const pump_on = minute >= 8 * 60 && minute < 16 * 60;
+        water = {.valid = true, .value = static_cast<uint8_t>(78 + (minute / 90) % 5)};
+        pump.power = {.valid = pump_on, .value = static_cast<uint16_t>(pump_on ? 1500 + minute % 3 : 0)};
+        pump.speed = {.valid = pump_on, .value = static_cast<uint16_t>(pump_on ? 2700 : 0)};
+        pump.flow = {.valid = pump_on, .value = static_cast<uint16_t>(pump_on ? 40 : 0)};
+        state.chlor.salt = {.valid = true, .value = static_cast<uint16_t>(3200 + (minute / 240) % 2 * 100)};
+        pool = {.valid = true, .value = pump_on};
+        water_fed.push_back(water.value);
+        history.sample(&state, t0 + minute * MINUTE_MS + (minute % 7) * 13);  // loop() jitter
+    }
+
+    printf("  %lu samples in %lu bytes, %lu raw (%.1fx), %lu bytes RAM\n",
+           static_cast<unsigned long>(history.get_sample_count()), static_cast<unsigned long>(history.get_byte_count()),
+           static_cast<unsigned long>(history.get_raw_byte_count()),
+           static_cast<double>(history.get_raw_byte_count()) / history.get_byte_count(),
+           static_cast<unsigned long>(sizeof(history)));
+
+    static poolstate_history_point_t points[24 * 60];
+    size_t count = 0;
+    double const query_ns = host_bench_ns([&] {
+        count = history.query(poolstate_history_series_t::WATER_TEMP, t0, t0 + 24 * HOUR_MS, points, std::size(points));
+    });
+    printf("  query() of a full day: %lu points in %.1f us\n", static_cast<unsigned long>(count), query_ns / 1000);
+
+    CHECK(count > 0 && count <= water_fed.size());
+    size_t const oldest = water_fed.size() - count;
+    for (size_t ii = 0; ii < count; ii++) {
+        CHECK(points[ii].value == water_fed[oldest + ii]);
+    }
+
+    poolstate_history_bucket_t buckets[24];
+    double const downsample_ns = host_bench_ns([&] {
+        history.downsample(poolstate_history_series_t::PUMP_POWER, t0, HOUR_MS, buckets, std::size(buckets));
+    });
+    printf("  downsample() into 24 hourly buckets: %.1f us\n", downsample_ns / 1000);
+
+    for (size_t bb = 0; bb < std::size(buckets); bb++) {
+        uint32_t const from = t0 + bb * HOUR_MS;
+        CHECK(history.query(poolstate_history_series_t::PUMP_POWER, from, from + HOUR_MS - 1,
+                            points, std::size(points)) == buckets[bb].count);
+    }
+    return host_test_result("bench_poolstate_history");
+}
@@ -0,0 +1,161 @@
+/**
+ * @file bench_poolstate_metrics.cpp
+ * @brief Host benchmark of PoolStateMetrics: cost of a feed and memory, against a rescan.
+ *
+ * @details
+ * Feeds 30 hours of pool state every FEED_INTERVAL_MS, with millis() wrapping on the
+ * way: the pump running from 8:00 to 16:00 with the pool circuit, the spa from 19:00
+ * to 20:00, the heater on one feed in four, and the water temperature following the
+ * hour. The same samples go into a ring that holds a full day, from which the metrics
+ * are recomputed by a scan, as a template over the recorder history would.
+ *
+ * It checks that the windowed metrics agree with the scan to within the one bucket that
+ * the sliding window may lag, and reports the memory and the time of a feed, of reading
+ * all metrics, and of the scan.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <cmath>
+
+#include "host_test.h"
+#include "core/poolstate_metrics.cpp"
+
+using namespace esphome::opnpool;
+
+constexpr uint32_t FEED_MS = PoolStateMetrics::FEED_INTERVAL_MS;
+constexpr uint32_t HOUR_MS = 60 * 60 * 1000;
+constexpr size_t   FEEDS_PER_DAY = 24 * HOUR_MS / FEED_MS;
+
+    // what the scan keeps of each feed
+struct sample_t {
+    uint16_t power;
+    uint16_t flow;
+    uint8_t  water;
+    bool     heating;
+    bool     pool_on;
+    bool     spa_on;
+};
+
+struct scan_t {
+    float energy_kwh;
+    float volume_gal;
+    float duty_pct;
+    float pool_h;
+    float spa_h;
+    float water_min;
+    float water_max;
+};
+
+static sample_t ring[FEEDS_PER_DAY];
+
+static scan_t
+_scan(size_t const count)
+{
+    scan_t scan = {0, 0, 0, 0, 0, 255, 0};
+    size_t heating = 0;
+    for (size_t ii = 0; ii < count; ii++) {
+        sample_t const & sample = ring[ii];
+        scan.energy_kwh += sample.power * (FEED_MS / 1000.0f) / 3600.0f / 1000.0f;
+        scan.volume_gal += sample.flow * (FEED_MS / 1000.0f) / 60.0f;
+        heating += sample.heating;
+        scan.pool_h += sample.pool_on * (FEED_MS / static_cast<float>(HOUR_MS));
+        scan.spa_h += sample.spa_on * (FEED_MS / static_cast<float>(HOUR_MS));
+        scan.water_min = fminf(scan.water_min, sample.water);
+        scan.water_max = fmaxf(scan.water_max, sample.water);
+    }
+    scan.duty_pct = 100.0f * heating / count;
+    return scan;
+}
+
+static void
+_set(poolstate_t * const state, uint32_t const feed)
+{
+    uint32_t const hour = feed * FEED_MS / HOUR_MS % 24;
+    bool const pump_on = hour >= 8 && hour < 16;
+    auto & pump = state->pumps[enum_index(datalink_pump_id_t::PRIMARY)];
+    pump.power = {.valid = true, .value = static_cast<uint16_t>(pump_on ? 1500 : 0)};
+    pump.flow = {.valid = true, .value = static_cast<uint16_t>(pump_on ? 45 : 0)};
+    state->thermos[enum_index(poolstate_thermo_typ_t::POOL)].heating = {.valid = true, .value = feed % 4 == 0};
+    state->circuits[enum_index(network_pool_circuit_t::POOL)].active = {.valid = true, .value = pump_on};
+    state->circuits[enum_index(network_pool_circuit_t::SPA)].active = {.valid = true, .value = hour == 19};
+    state->temps[enum_index(poolstate_temp_typ_t::WATER)] = {.valid = true, .value = static_cast<uint8_t>(74 + hour / 3)};
+}
+
+static float
+_get(PoolStateMetrics const & metrics, poolstate_metric_t const metric)
+{
+    float value = NAN;
+    CHECK(metrics.get(metric, &value));
+    return value;
+}
+
+int
+main()
+{
+    static PoolStateMetrics metrics;
+    metrics.set_pool_volume(20000);
+    poolstate_t state = {};
+    uint32_t const t0 = UINT32_MAX - 3 * HOUR_MS;  // millis() wraps early on
+    uint32_t const feeds = 30 * HOUR_MS / FEED_MS;
+
+    for (uint32_t feed = 0; feed < feeds; feed++) {
+        _set(&state, feed);
+        metrics.feed(&state, t0 + feed * FEED_MS);
+
+            // the feed integrates the values held since the previous one
+        if (feed > 0) {
+            sample_t & sample = ring[(feed - 1) % FEEDS_PER_DAY];
+            poolstate_t previous = {};
+            _set(&previous, feed - 1);
+            sample = {previous.pumps[enum_index(datalink_pump_id_t::PRIMARY)].power.value,
+                      previous.pumps[enum_index(datalink_pump_id_t::PRIMARY)].flow.value,
+                      previous.temps[enum_index(poolstate_temp_typ_t::WATER)].value,
+                      previous.thermos[enum_index(poolstate_thermo_typ_t::POOL)].heating.value,
+                      previous.circuits[enum_index(network_pool_circuit_t::POOL)].active.value,
+                      previous.circuits[enum_index(network_pool_circuit_t::SPA)].active.value};
+        }
+    }
+    scan_t const scan = _scan(FEEDS_PER_DAY);
+
+        // the window holds 23 full buckets and the current one, so it may miss up to an hour
+    CHECK(fabsf(_get(metrics, poolstate_metric_t::PUMP_ENERGY) - scan.energy_kwh) <= 1.5f);
+    CHECK(fabsf(_get(metrics, poolstate_metric_t::PUMP_VOLUME) - scan.volume_gal) <= 45 * 60);
+    CHECK(fabsf(_get(metrics, poolstate_metric_t::HEATER_DUTY) - scan.duty_pct) <= 0.5f);
+    CHECK(fabsf(_get(metrics, poolstate_metric_t::POOL_RUNTIME) - scan.pool_h) <= 1.0f);
+    CHECK(fabsf(_get(metrics, poolstate_metric_t::SPA_RUNTIME) - scan.spa_h) <= 1.0f);
+    CHECK(fabsf(_get(metrics, poolstate_metric_t::WATER_TEMP_MIN) - scan.water_min) <= 1.0f);
+    CHECK(fabsf(_get(metrics, poolstate_metric_t::WATER_TEMP_MAX) - scan.water_max) <= 1.0f);
+    CHECK(fabsf(_get(metrics, poolstate_metric_t::PUMP_EFFICIENCY) - 1500.0f / 45) < 0.01f);
+    CHECK(fabsf(_get(metrics, poolstate_metric_t::TURNOVER_TIME) - 20000.0f / (45 * 60)) < 0.01f);
+
+    printf("  after 30 h: %.2f kWh, %.0f gal, %.1f%% heating, pool %.2f h, spa %.2f h, water %.0f..%.0f F\n",
+           _get(metrics, poolstate_metric_t::PUMP_ENERGY), _get(metrics, poolstate_metric_t::PUMP_VOLUME),
+           _get(metrics, poolstate_metric_t::HEATER_DUTY), _get(metrics, poolstate_metric_t::POOL_RUNTIME),
+           _get(metrics, poolstate_metric_t::SPA_RUNTIME), _get(metrics, poolstate_metric_t::WATER_TEMP_MIN),
+           _get(metrics, poolstate_metric_t::WATER_TEMP_MAX));
+    printf("  memory: %lu bytes, a day of samples to scan %lu bytes\n",
+           static_cast<unsigned long>(sizeof(metrics)), static_cast<unsigned long>(sizeof(ring)));
+
+    uint32_t feed = feeds;
+    double const feed_ns = host_bench_ns([&] {
+        metrics.feed(&state, t0 + feed++ * FEED_MS);
+    });
+    static volatile float sink = 0;  // keeps the results alive
+    double const get_ns = host_bench_ns([&] {
+        for (uint8_t mm = 0; mm <= enum_index(poolstate_metric_t::WATER_TEMP_MAX); mm++) {
+            float value;
+            if (metrics.get(static_cast<poolstate_metric_t>(mm), &value)) {
+                sink = sink + value;
+            }
+        }
+    });
+    double const scan_ns = host_bench_ns([&] {
+        sink = _scan(FEEDS_PER_DAY).energy_kwh;
+    });
+    printf("  feed() %.0f ns, get() of all metrics %.0f ns, scan of a day %.1f us\n", feed_ns, get_ns, scan_ns / 1000);
+
+    return host_test_result("bench_poolstate_metrics");
+}
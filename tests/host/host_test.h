@@ -0,0 +1,60 @@
+/**
+ * @file host_test.h
+ * @brief Minimal check macros for the host tests and benchmarks.
+ *
+ * @details
+ * The tests include the translation units they exercise, and are built against the
+ * stand-ins in stubs/ for the few ESP-IDF and ESPHome headers those need. See run.sh.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+inline int host_test_failures = 0;
+
+    // records a failure, and continues so one run shows all of them
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            host_test_failures++; \
+        } \
+    } while (0)
+
+/**
+ * @brief Returns the average time of a call in ns, over enough iterations to take ~100 ms.
+ */
+template<typename F>
+[[nodiscard]] double
+host_bench_ns(F && fnc)
+{
+    using clock = std::chrono::steady_clock;
+    size_t iterations = 1;
+    for (;;) {
+        auto const start = clock::now();
+        for (size_t ii = 0; ii < iterations; ii++) {
+            fnc();
+        }
+        double const ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        if (ns > 100e6 || iterations >= (size_t{1} << 30)) {
+            return ns / iterations;
+        }
+        iterations *= 2;
+    }
+}
+
+/**
+ * @brief Prints the result and returns the exit code of a test.
+ */
+[[nodiscard]] inline int
+host_test_result(char const * const name)
+{
+    printf("%s: %s (%d failures)\n", name, host_test_failures ? "FAIL" : "PASS", host_test_failures);
+    return host_test_failures ? 1 : 0;
+}
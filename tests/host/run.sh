@@ -0,0 +1,26 @@
+#!/bin/sh
+# Builds and runs the host tests and benchmarks, e.g. `tests/host/run.sh` or
+# `tests/host/run.sh bench_poolstate_history`. The log output of a test goes to
+# <build>/<name>.log, and is shown when the test fails.
+
+set -e
+HOST_DIR=$(cd "$(dirname "$0")" && pwd)
+COMPONENT_DIR="$HOST_DIR/../../components/opnpool"
+BUILD_DIR=${BUILD_DIR:-"$HOST_DIR/_build"}
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:-"-std=gnu++17 -O2 -Wall -Wextra -Wno-format"}
+
+mkdir -p "$BUILD_DIR"
+if [ $# -eq 0 ]; then
+    set -- $(cd "$HOST_DIR" && ls test_*.cpp bench_*.cpp 2>/dev/null | sed 's/\.cpp$//')
+fi
+
+failed=0
+for name in "$@"; do
+    $CXX $CXXFLAGS -I"$COMPONENT_DIR" -I"$HOST_DIR/stubs" -I"$HOST_DIR" "$HOST_DIR/$name.cpp" -o "$BUILD_DIR/$name"
+    if ! "$BUILD_DIR/$name" 2>"$BUILD_DIR/$name.log"; then
+        cat "$BUILD_DIR/$name.log"
+        failed=1
+    fi
+done
+exit $failed
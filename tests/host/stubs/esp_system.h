@@ -0,0 +1,13 @@
+/**
+ * @file esp_system.h
+ * @brief Host stand-in for the ESP-IDF system header.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "esp_types.h"
+#include "esp_err.h"
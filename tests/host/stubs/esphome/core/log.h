@@ -0,0 +1,34 @@
+/**
+ * @file log.h
+ * @brief Host stand-in for the ESPHome logger; warnings and errors go to stderr.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <cstdio>
+
+#define ESPHOME_LOG_LEVEL_NONE         0
+#define ESPHOME_LOG_LEVEL_ERROR        1
+#define ESPHOME_LOG_LEVEL_WARN         2
+#define ESPHOME_LOG_LEVEL_INFO         3
+#define ESPHOME_LOG_LEVEL_CONFIG       4
+#define ESPHOME_LOG_LEVEL_DEBUG        5
+#define ESPHOME_LOG_LEVEL_VERBOSE      6
+#define ESPHOME_LOG_LEVEL_VERY_VERBOSE 7
+#ifndef ESPHOME_LOG_LEVEL
+# define ESPHOME_LOG_LEVEL ESPHOME_LOG_LEVEL_WARN
+#endif
+
+#define ESP_HOST_LOG_(tag, fmt, ...) fprintf(stderr, "[%s] " fmt "\n", tag, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, fmt, ...)      ESP_HOST_LOG_(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...)      ESP_HOST_LOG_(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...)      do {} while (0)
+#define ESP_LOGCONFIG(tag, fmt, ...) do {} while (0)
+#define ESP_LOGD(tag, fmt, ...)      do {} while (0)
+#define ESP_LOGV(tag, fmt, ...)      do {} while (0)
+#define ESP_LOGVV(tag, fmt, ...)     do {} while (0)
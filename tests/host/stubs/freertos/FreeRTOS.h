@@ -0,0 +1,19 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in for the FreeRTOS types that the pool state headers mention.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <cstdint>
+
+typedef void *   QueueHandle_t;
+typedef void *   TaskHandle_t;
+typedef void *   SemaphoreHandle_t;
+typedef uint32_t TickType_t;
+typedef unsigned UBaseType_t;
+typedef int      BaseType_t;
@@ -0,0 +1,25 @@
+/**
+ * @file task.h
+ * @brief Host stand-in for the FreeRTOS task API: a single task, and no-op critical sections.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef struct { int unused; } portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux)  ((void)(mux))
+
+inline TaskHandle_t
+xTaskGetCurrentTaskHandle()
+{
+    static int host_task;
+    return &host_task;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file nvs.h
+ * @brief Host stand-in for ESP-IDF NVS: blobs in RAM, with a switch to make writes fail.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "esp_err.h"
+
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+
+typedef uint32_t nvs_handle_t;
+enum nvs_open_mode_t { NVS_READONLY, NVS_READWRITE };
+
+/// @brief The simulated NVS partition.
+struct host_nvs_t {
+    std::map<std::string, std::vector<uint8_t>> blobs;  ///< Key to value.
+    uint32_t writes = 0;                                ///< Successful nvs_set_blob() calls.
+    bool     fail_writes = false;                       ///< Make nvs_set_blob() fail.
+};
+
+inline host_nvs_t host_nvs;
+
+inline esp_err_t nvs_open(char const *, nvs_open_mode_t, nvs_handle_t * const handle) { *handle = 1; return ESP_OK; }
+inline void nvs_close(nvs_handle_t) {}
+inline esp_err_t nvs_commit(nvs_handle_t) { return ESP_OK; }
+
+inline esp_err_t
+nvs_get_blob(nvs_handle_t, char const * const key, void * const dst, size_t * const len)
+{
+    auto const it = host_nvs.blobs.find(key);
+    if (it == host_nvs.blobs.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (dst != nullptr) {
+        if (*len < it->second.size()) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        memcpy(dst, it->second.data(), it->second.size());
+    }
+    *len = it->second.size();
+    return ESP_OK;
+}
+
+inline esp_err_t
+nvs_set_blob(nvs_handle_t, char const * const key, void const * const src, size_t const len)
+{
+    if (host_nvs.fail_writes) {
+        return ESP_FAIL;
+    }
+    auto const bytes = static_cast<uint8_t const *>(src);
+    host_nvs.blobs[key].assign(bytes, bytes + len);
+    host_nvs.writes++;
+    return ESP_OK;
+}
+
+inline esp_err_t
+nvs_erase_key(nvs_handle_t, char const * const key)
+{
+    return host_nvs.blobs.erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
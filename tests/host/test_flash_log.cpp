@@ -0,0 +1,241 @@
+/**
+ * @file test_flash_log.cpp
+ * @brief Host test of FlashLog: wear levelling and recovery from power loss.
+ *
+ * @details
+ * Runs FlashLog against a simulated NOR flash (FlashLogIo) that can lose power in the
+ * middle of a write or an erase. Over many simulated boots it checks that:
+ *
+ *   - open() returns the last record whose append() completed, or the one before if
+ *     the power failed during the last append(),
+ *   - the sectors are erased evenly, once every sectors * slots records,
+ *   - for_each() returns the records in order, and
+ *   - records of another format (tag) are ignored.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "host_test.h"
+#include "utils/flash_log.cpp"
+
+using namespace esphome::opnpool;
+
+/**
+ * @brief NOR flash in RAM, that loses power after a given number of byte operations.
+ */
+class SimFlash : public FlashLogIo {
+
+  public:
+    SimFlash(uint32_t const sectors, uint32_t const sector_size) :
+        mem_(sectors * sector_size, 0xFF), erases_(sectors, 0), sector_size_{sector_size} {}
+
+    esp_err_t read(uint32_t const offset, void * const dst, size_t const len) override {
+        if (offset + len > mem_.size()) return ESP_ERR_INVALID_SIZE;
+        memcpy(dst, &mem_[offset], len);
+        return ESP_OK;
+    }
+    esp_err_t write(uint32_t const offset, void const * const src, size_t const len) override {
+        if (offset + len > mem_.size()) return ESP_ERR_INVALID_SIZE;
+        auto const bytes = static_cast<uint8_t const *>(src);
+        for (size_t ii = 0; ii < len; ii++) {
+            if (!power_()) return ESP_FAIL;
+            mem_[offset + ii] &= bytes[ii];  // writing can only clear bits
+        }
+        return ESP_OK;
+    }
+    esp_err_t erase_sector(uint32_t const offset) override {
+        if (offset % sector_size_ != 0 || offset >= mem_.size()) return ESP_ERR_INVALID_ARG;
+        for (uint32_t ii = 0; ii < sector_size_; ii++) {
+            if (!power_()) return ESP_FAIL;
+            mem_[offset + ii] = 0xFF;
+        }
+        erases_[offset / sector_size_]++;
+        return ESP_OK;
+    }
+    [[nodiscard]] uint32_t size() const override { return mem_.size(); }
+    [[nodiscard]] uint32_t sector_size() const override { return sector_size_; }
+
+    void fail_after(int32_t const ops) { budget_ = ops; }  ///< Lose power after ops bytes, -1 for never.
+    void power_on() { budget_ = -1; }
+    [[nodiscard]] std::vector<uint32_t> const & erases() const { return erases_; }
+
+  private:
+    bool power_() {
+        if (budget_ < 0) return true;
+        if (budget_ == 0) return false;
+        budget_--;
+        return true;
+    }
+
+    std::vector<uint8_t>  mem_;
+    std::vector<uint32_t> erases_;
+    uint32_t              sector_size_;
+    int32_t               budget_{-1};
+};
+
+/// @brief Record as the counters would use it.
+struct record_t {
+    uint32_t value;
+    uint32_t fill[12];
+};
+
+[[nodiscard]] static record_t
+_record(uint32_t const value)
+{
+    record_t rec;
+    rec.value = value;
+    std::fill(std::begin(rec.fill), std::end(rec.fill), value * 2654435761U);
+    return rec;
+}
+
+static void
+_test_empty()
+{
+    SimFlash flash(4, 4096);
+    FlashLog log(&flash, 1, sizeof(record_t));
+    record_t rec{};
+    CHECK(log.open(&rec) == ESP_ERR_NOT_FOUND);
+    CHECK(log.append(&rec) == ESP_OK);
+}
+
+static void
+_test_power_loss_and_wear()
+{
+    constexpr uint32_t SECTORS = 8;
+    constexpr uint32_t SECTOR_SIZE = 4096;
+    constexpr uint32_t BOOTS = 3000;
+
+    SimFlash flash(SECTORS, SECTOR_SIZE);
+    std::mt19937 rng(1);
+    uint32_t committed = 0;  // value of the last append() that returned ESP_OK
+    uint32_t torn = 0;       // value of an append() that lost power, 0 if none
+    uint32_t appended = 0;
+    uint32_t power_losses = 0;
+
+    for (uint32_t boot = 0; boot < BOOTS; boot++) {
+
+        flash.power_on();
+        FlashLog log(&flash, 1, sizeof(record_t));
+        record_t rec{};
+        esp_err_t const err = log.open(&rec);
+
+        if (committed == 0 && torn == 0) {
+            CHECK(err == ESP_ERR_NOT_FOUND);
+        } else {
+                // a torn append may or may not have made it
+            CHECK(err == ESP_OK);
+            CHECK(rec.value == committed || (torn != 0 && rec.value == torn));
+            record_t const expected = _record(rec.value);
+            CHECK(memcmp(&rec, &expected, sizeof(rec)) == 0);
+            committed = rec.value;
+        }
+        torn = 0;
+
+        uint32_t const count = rng() % 200;
+        for (uint32_t ii = 0; ii < count; ii++) {
+            record_t const next = _record(committed + 1);
+            bool const lose_power = rng() % 40 == 0;
+            if (lose_power) {
+                    // anywhere in the record, or in the erase that precedes it
+                flash.fail_after(rng() % (sizeof(flash_log_hdr_t) + sizeof(record_t) + 64));
+            }
+            if (log.append(&next) == ESP_OK && !lose_power) {
+                committed = next.value;
+                appended++;
+                continue;
+            }
+            if (lose_power) {
+                torn = next.value;
+                power_losses++;
+                break;
+            }
+            CHECK(false);  // append() failed with power on
+        }
+    }
+
+        // every sector is erased about as often
+    auto const & erases = flash.erases();
+    uint32_t const min = *std::min_element(erases.begin(), erases.end());
+    uint32_t const max = *std::max_element(erases.begin(), erases.end());
+    uint32_t total = 0;
+    for (auto const count : erases) total += count;
+    CHECK(max - min <= 2);
+
+    uint32_t const slots = SECTOR_SIZE / ((sizeof(flash_log_hdr_t) + sizeof(record_t) + 3) & ~3U);
+    printf("  %lu records over %lu boots with %lu power losses: %lu erases (%lu..%lu per sector), %lu slots per sector\n",
+           static_cast<unsigned long>(appended), static_cast<unsigned long>(BOOTS), static_cast<unsigned long>(power_losses),
+           static_cast<unsigned long>(total), static_cast<unsigned long>(min), static_cast<unsigned long>(max),
+           static_cast<unsigned long>(slots));
+    CHECK(total <= appended / slots + SECTORS + power_losses);
+}
+
+static void
+_test_for_each()
+{
+    SimFlash flash(4, 4096);
+    FlashLog log(&flash, 1, sizeof(record_t));
+    record_t rec{};
+    CHECK(log.open(&rec) == ESP_ERR_NOT_FOUND);
+    constexpr uint32_t COUNT = 500;  // more than fit, so the oldest are erased
+    for (uint32_t value = 1; value <= COUNT; value++) {
+        record_t const next = _record(value);
+        CHECK(log.append(&next) == ESP_OK);
+    }
+    struct ctx_t {
+        uint32_t first;
+        uint32_t last;
+        uint32_t count;
+        bool     ordered;
+    } ctx = {0, 0, 0, true};
+
+    CHECK(log.for_each([](void * const ptr, uint32_t const /*seq*/, void const * const payload) {
+        auto const ctx = static_cast<ctx_t *>(ptr);
+        record_t rec;
+        memcpy(&rec, payload, sizeof(rec));
+        if (ctx->count == 0) {
+            ctx->first = rec.value;
+        } else if (rec.value != ctx->last + 1) {
+            ctx->ordered = false;
+        }
+        ctx->last = rec.value;
+        ctx->count++;
+        return true;
+    }, &ctx) == ESP_OK);
+
+    CHECK(ctx.ordered);
+    CHECK(ctx.last == COUNT);
+    CHECK(ctx.count == COUNT - ctx.first + 1);
+    CHECK(ctx.count >= 3 * (4096 / ((sizeof(flash_log_hdr_t) + sizeof(record_t) + 3) & ~3U)));
+}
+
+static void
+_test_other_tag()
+{
+    SimFlash flash(4, 4096);
+    {
+        FlashLog log(&flash, 1, sizeof(record_t));
+        record_t rec{};
+        (void)log.open(&rec);
+        record_t const next = _record(7);
+        CHECK(log.append(&next) == ESP_OK);
+    }
+    FlashLog log(&flash, 2, sizeof(record_t));
+    record_t rec{};
+    CHECK(log.open(&rec) == ESP_ERR_NOT_FOUND);
+}
+
+int
+main()
+{
+    _test_empty();
+    _test_power_loss_and_wear();
+    _test_for_each();
+    _test_other_tag();
+    return host_test_result("test_flash_log");
+}
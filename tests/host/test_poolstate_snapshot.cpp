@@ -0,0 +1,203 @@
+/**
+ * @file test_poolstate_snapshot.cpp
+ * @brief Host test of the pool state snapshot: serializer and write policy.
+ *
+ * @details
+ * Checks that a snapshot round-trips except for the volatile fields, that it is
+ * rejected when its magic, version, size or CRC doesn't match, and that
+ * PoolStateSnapshot only writes changed snapshots, at most once per write interval,
+ * holding back and retrying what it couldn't write. NVS is the RAM stand-in from
+ * stubs/nvs.h.
+ *
+ * @author Coert Vonk (@cvonk on GitHub)
+ * @copyright Copyright (c) 2026 Coert Vonk
+ * @license SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <vector>
+
+#include "host_test.h"
+#include "core/poolstate_snapshot.cpp"
+
+using namespace esphome::opnpool;
+
+using hdr_t = poolstate_snapshot::poolstate_snapshot_hdr_t;
+
+[[nodiscard]] static poolstate_t
+_state(uint8_t const water_temp)
+{
+    poolstate_t state = {};
+    state.system.addr = {.valid = true, .value = {.addr = 0x10}};
+    state.system.tod.time.valid = true;
+    state.system.version.valid = true;
+    state.temps[enum_index(poolstate_temp_typ_t::WATER)] = {.valid = true, .value = water_temp};
+    state.chlor.salt = {.valid = true, .value = 3200};
+    state.circuits[enum_index(network_pool_circuit_t::POOL)].active = {.valid = true, .value = true};
+    auto & pump = state.pumps[enum_index(datalink_pump_id_t::PRIMARY)];
+    pump.power = {.valid = true, .value = 1100};
+    pump.time.valid = true;
+    pump.timer.valid = true;
+    return state;
+}
+
+[[nodiscard]] static std::vector<uint8_t>
+_serialize(poolstate_t const & state)
+{
+    std::vector<uint8_t> buf(poolstate_snapshot::serialized_size());
+    CHECK(poolstate_snapshot::serialize(&state, buf.data(), buf.size()) == buf.size());
+    return buf;
+}
+
+static void
+_test_round_trip()
+{
+    poolstate_t const state = _state(80);
+    std::vector<uint8_t> const buf = _serialize(state);
+
+    poolstate_t restored;
+    CHECK(poolstate_snapshot::deserialize(buf.data(), buf.size(), &restored) == ESP_OK);
+
+        // volatile fields are cleared, the rest is as it was
+    poolstate_t expected = state;
+    expected.system.addr = {};
+    expected.system.tod = {};
+    for (auto & pump : expected.pumps) {
+        pump.time = {};
+        pump.timer = {};
+    }
+    CHECK(memcmp(&restored, &expected, sizeof(poolstate_t)) == 0);
+
+        // states that only differ in volatile fields give the same snapshot
+    poolstate_t later = state;
+    later.system.tod.time.value.minute = 42;
+    later.system.addr = {};
+    CHECK(_serialize(later) == buf);
+
+    uint8_t small[sizeof(hdr_t)];
+    CHECK(poolstate_snapshot::serialize(&state, small, sizeof(small)) == 0);
+}
+
+static void
+_test_rejects()
+{
+    std::vector<uint8_t> const good = _serialize(_state(80));
+    poolstate_t restored;
+    hdr_t hdr;
+
+    std::vector<uint8_t> buf = good;  // not ours
+    memcpy(&hdr, buf.data(), sizeof(hdr));
+    hdr.magic ^= 0x0101;
+    memcpy(buf.data(), &hdr, sizeof(hdr));
+    CHECK(poolstate_snapshot::deserialize(buf.data(), buf.size(), &restored) == ESP_ERR_INVALID_VERSION);
+
+    buf = good;  // other format version
+    memcpy(&hdr, buf.data(), sizeof(hdr));
+    hdr.version++;
+    memcpy(buf.data(), &hdr, sizeof(hdr));
+    CHECK(poolstate_snapshot::deserialize(buf.data(), buf.size(), &restored) == ESP_ERR_INVALID_VERSION);
+
+    buf = good;  // written by firmware with another poolstate_t layout
+    memcpy(&hdr, buf.data(), sizeof(hdr));
+    hdr.size += 4;
+    memcpy(buf.data(), &hdr, sizeof(hdr));
+    CHECK(poolstate_snapshot::deserialize(buf.data(), buf.size(), &restored) == ESP_ERR_INVALID_SIZE);
+
+    buf = good;  // same header, but a longer blob
+    buf.resize(buf.size() + 4);
+    CHECK(poolstate_snapshot::deserialize(buf.data(), buf.size(), &restored) == ESP_ERR_INVALID_SIZE);
+
+    buf = good;  // truncated
+    CHECK(poolstate_snapshot::deserialize(buf.data(), buf.size() - 1, &restored) == ESP_ERR_INVALID_SIZE);
+    CHECK(poolstate_snapshot::deserialize(buf.data(), sizeof(hdr) - 1, &restored) == ESP_ERR_INVALID_SIZE);
+
+    for (size_t offset = sizeof(hdr); offset < good.size(); offset += 7) {  // corrupted payload
+        buf = good;
+        buf[offset] ^= 0x10;
+        CHECK(poolstate_snapshot::deserialize(buf.data(), buf.size(), &restored) == ESP_ERR_INVALID_CRC);
+    }
+
+    buf = good;  // nothing was touched on the way
+    poolstate_t const before = _state(99);
+    restored = before;
+    buf[sizeof(hdr)] ^= 0x10;
+    CHECK(poolstate_snapshot::deserialize(buf.data(), buf.size(), &restored) != ESP_OK);
+    CHECK(memcmp(&restored, &before, sizeof(poolstate_t)) == 0);
+}
+
+static void
+_test_write_policy()
+{
+    constexpr uint32_t INTERVAL = PoolStateSnapshot::WRITE_INTERVAL_MS;
+    host_nvs = {};
+    uint32_t now = 0xFFFF0000;  // across the millis() wrap
+
+    {
+        PoolStateSnapshot snapshot;
+        poolstate_t restored;
+        CHECK(snapshot.restore(&restored) != ESP_OK);  // nothing stored yet
+
+        poolstate_t const s80 = _state(80);
+        CHECK(snapshot.checkpoint(&s80, now) == ESP_OK);
+        CHECK(host_nvs.writes == 1);
+
+        now += 1000;  // unchanged, also not once the held back checkpoint is due
+        CHECK(snapshot.checkpoint(&s80, now) == ESP_OK);
+        CHECK(snapshot.checkpoint(&s80, now + INTERVAL) == ESP_OK);
+        CHECK(host_nvs.writes == 1);
+        CHECK(!snapshot.is_due(now + INTERVAL));
+
+        poolstate_t const s81 = _state(81);  // changed, but too soon
+        CHECK(snapshot.checkpoint(&s81, now) == ESP_OK);
+        CHECK(host_nvs.writes == 1);
+        CHECK(!snapshot.is_due(now));
+        now += INTERVAL;
+        CHECK(snapshot.is_due(now));
+        CHECK(snapshot.checkpoint(&s81, now) == ESP_OK);
+        CHECK(host_nvs.writes == 2);
+        CHECK(!snapshot.is_due(now + INTERVAL));
+
+        poolstate_t const s82 = _state(82);  // forced, e.g. on shutdown
+        now += 1000;
+        CHECK(snapshot.checkpoint(&s82, now, true) == ESP_OK);
+        CHECK(host_nvs.writes == 3);
+
+        poolstate_t const s83 = _state(83);  // failed write is retried
+        now += INTERVAL;
+        host_nvs.fail_writes = true;
+        CHECK(snapshot.checkpoint(&s83, now) != ESP_OK);
+        CHECK(!snapshot.is_due(now));
+        host_nvs.fail_writes = false;
+        now += INTERVAL;
+        CHECK(snapshot.is_due(now));
+        CHECK(snapshot.checkpoint(&s83, now) == ESP_OK);
+        CHECK(host_nvs.writes == 4);
+        CHECK(snapshot.get_write_count() == 4);
+    }
+    {
+        PoolStateSnapshot snapshot;  // after a reboot
+        poolstate_t restored;
+        CHECK(snapshot.restore(&restored) == ESP_OK);
+        CHECK(restored.temps[enum_index(poolstate_temp_typ_t::WATER)].value == 83);
+        CHECK(!restored.system.addr.valid);
+
+        poolstate_t const s83 = _state(83);  // same as restored, so not written again
+        CHECK(snapshot.checkpoint(&s83, now) == ESP_OK);
+        CHECK(host_nvs.writes == 4);
+    }
+    {
+        host_nvs.blobs.begin()->second[sizeof(hdr_t) + 1] ^= 0x01;  // bit rot in NVS
+        PoolStateSnapshot snapshot;
+        poolstate_t restored;
+        CHECK(snapshot.restore(&restored) == ESP_ERR_INVALID_CRC);
+    }
+}
+
+int
+main()
+{
+    _test_round_trip();
+    _test_rejects();
+    _test_write_policy();
+    printf("  snapshot of %lu bytes\n", static_cast<unsigned long>(poolstate_snapshot::serialized_size()));
+    return host_test_result("test_poolstate_snapshot");
+}